@@ -52,6 +52,10 @@ public string MethodNameWithGenericArgTypes
         [JsonPropertyName("moduleVersionId")]
         public Guid ModuleVersionId { get; set; }
 
+        [JsonPropertyName("instantiationHash")]
+        [JsonIgnore(Condition = JsonIgnoreCondition.WhenWritingDefault)]
+        public ulong InstantiationHash { get; set; }
+
         [JsonPropertyName("hidden")]
         public bool Hidden { get; set; }
 
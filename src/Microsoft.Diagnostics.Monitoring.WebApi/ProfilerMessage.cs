@@ -12,16 +12,35 @@ namespace Microsoft.Diagnostics.Monitoring.StartupHook.Monitoring
 namespace Microsoft.Diagnostics.Monitoring
 #endif
 {
+    // Kept in sync with src/Profilers/MonitorProfiler/Communication/Messages.h, which documents each value.
+    // ProfilerChannel only uses single message framing and status-only responses. The connection commands, flags,
+    // Data responses, non-EventPipe callstack formats and the profiler commands after StartAllFeatures are implemented
+    // by the profiler but not sent from here yet.
     public enum CommandSet : ushort
     {
         ServerResponse,
         Profiler,
-        StartupHook
+        StartupHook,
+        Connection
     }
 
     public enum ServerResponseCommand : ushort
     {
-        Status
+        Status,
+        Data,
+    };
+
+    public enum ConnectionCommand : ushort
+    {
+        Multiplex,
+        GetSharedRingBuffer,
+    };
+
+    [Flags]
+    public enum ConnectionFlags : uint
+    {
+        None = 0,
+        CompletionResponses = 0x1,
     };
 
     public enum ProfilerCommand : ushort
@@ -29,6 +48,18 @@ public enum ProfilerCommand : ushort
         Callstack,
         StopAllFeatures,
         StartAllFeatures,
+        SetKnownModuleVersionIds,
+        ExportSymbolTable,
+        ExceptionCounts,
+        EnableExceptionEvents,
+        DisableExceptionEvents,
+    };
+
+    public enum CallstackFormat : uint
+    {
+        EventPipe = 0,
+        Binary = 1,
+        SharedRingBuffer = 2,
     };
 
     public enum StartupHookCommand : ushort
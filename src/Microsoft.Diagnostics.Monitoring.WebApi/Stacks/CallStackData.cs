@@ -25,6 +25,12 @@ internal sealed class CallStackFrame
 
         public Guid ModuleVersionId { get; set; }
 
+        /// <summary>
+        /// Identifies the generic instantiation across processes; zero for non-generic functions
+        /// and when the profiler did not send it.
+        /// </summary>
+        public ulong InstantiationHash { get; set; }
+
         public ulong Offset { get; set; }
     }
 
@@ -15,6 +15,7 @@ internal static class CallStackEvents
         public const TraceEventID ModuleDesc = (TraceEventID)4;
         public const TraceEventID TokenDesc = (TraceEventID)5;
         public const TraceEventID End = (TraceEventID)6;
+        public const TraceEventID CallstackContinuation = (TraceEventID)7;
 
         public static class CallstackPayloads
         {
@@ -24,6 +25,16 @@ public static class CallstackPayloads
             public const int IpOffsets = 3;
         }
 
+        /// <summary>
+        /// Additional frames of the preceding Callstack event on the same thread, for stacks too deep for a single event.
+        /// </summary>
+        public static class CallstackContinuationPayloads
+        {
+            public const int ThreadId = 0;
+            public const int FunctionIds = 1;
+            public const int IpOffsets = 2;
+        }
+
         public static class EndPayloads
         {
             public const int Unused = 0;
@@ -5,6 +5,7 @@
 using Microsoft.Diagnostics.NETCore.Client;
 using Microsoft.Diagnostics.Tracing;
 using System;
+using System.Collections.Generic;
 using System.Diagnostics.Tracing;
 using System.Threading;
 using System.Threading.Tasks;
@@ -25,6 +26,11 @@ internal sealed class EventStacksPipeline : EventSourcePipeline<EventStacksPipel
     {
         private TaskCompletionSource<CallStackResult> _stackResult = new(TaskCreationOptions.RunContinuationsAsynchronously);
         private CallStackResult _result = new();
+        private CallStack? _lastStack;
+
+        // Keys sent by the native profiler alongside each function. Names are omitted for modules the client already
+        // knows, so these are what identify those frames.
+        private readonly Dictionary<ulong, (Guid ModuleVersionId, ulong InstantiationHash)> _functionKeys = new();
 
         public EventStacksPipeline(DiagnosticsClient client, EventStacksPipelineSettings settings)
             : base(client, settings)
@@ -80,28 +86,21 @@ private void Callback(TraceEvent action)
                 ulong[] offsets = action.GetPayload<ulong[]>(CallStackEvents.CallstackPayloads.IpOffsets);
 
                 _result.Stacks.Add(stack);
+                _lastStack = stack;
 
-                if (functionIds != null && offsets != null && functionIds.Length == offsets.Length)
-                {
-                    for (int i = 0; i < functionIds.Length; i++)
-                    {
-                        CallStackFrame stackFrame = new CallStackFrame
-                        {
-                            FunctionId = functionIds[i],
-                            Offset = offsets[i]
-                        };
-
-                        if (_result.NameCache.FunctionData.TryGetValue(stackFrame.FunctionId, out FunctionData? functionData))
-                        {
-                            stackFrame.MethodToken = functionData.MethodToken;
-                            if (_result.NameCache.ModuleData.TryGetValue(functionData.ModuleId, out ModuleData? moduleData))
-                            {
-                                stackFrame.ModuleVersionId = moduleData.ModuleVersionId;
-                            }
-                        }
+                AddFrames(stack, functionIds, offsets);
+            }
+            else if (action.ID == CallStackEvents.CallstackContinuation)
+            {
+                uint threadId = action.GetPayload<uint>(CallStackEvents.CallstackContinuationPayloads.ThreadId);
 
-                        stack.Frames.Add(stackFrame);
-                    }
+                // Continuations are written immediately after the Callstack event they extend.
+                if (_lastStack != null && _lastStack.ThreadId == threadId)
+                {
+                    AddFrames(
+                        _lastStack,
+                        action.GetPayload<ulong[]>(CallStackEvents.CallstackContinuationPayloads.FunctionIds),
+                        action.GetPayload<ulong[]>(CallStackEvents.CallstackContinuationPayloads.IpOffsets));
                 }
             }
             else if (action.ID == CallStackEvents.FunctionDesc)
@@ -119,6 +118,13 @@ private void Callback(TraceEvent action)
                     );
 
                 _result.NameCache.FunctionData.TryAdd(id, functionData);
+
+                if (action.PayloadNames.Length > NameIdentificationEvents.FunctionDescPayloads.InstantiationHash)
+                {
+                    _functionKeys.TryAdd(id, (
+                        action.GetPayload<Guid>(NameIdentificationEvents.FunctionDescPayloads.ModuleVersionId),
+                        action.GetPayload<ulong>(NameIdentificationEvents.FunctionDescPayloads.InstantiationHash)));
+                }
             }
             else if (action.ID == CallStackEvents.ClassDesc)
             {
@@ -162,5 +168,37 @@ private void Callback(TraceEvent action)
                 _stackResult.TrySetResult(_result);
             }
         }
+
+        private void AddFrames(CallStack stack, ulong[] functionIds, ulong[] offsets)
+        {
+            if (functionIds != null && offsets != null && functionIds.Length == offsets.Length)
+            {
+                for (int i = 0; i < functionIds.Length; i++)
+                {
+                    CallStackFrame stackFrame = new CallStackFrame
+                    {
+                        FunctionId = functionIds[i],
+                        Offset = offsets[i]
+                    };
+
+                    if (_result.NameCache.FunctionData.TryGetValue(stackFrame.FunctionId, out FunctionData? functionData))
+                    {
+                        stackFrame.MethodToken = functionData.MethodToken;
+                        if (_result.NameCache.ModuleData.TryGetValue(functionData.ModuleId, out ModuleData? moduleData))
+                        {
+                            stackFrame.ModuleVersionId = moduleData.ModuleVersionId;
+                        }
+                    }
+
+                    if (_functionKeys.TryGetValue(stackFrame.FunctionId, out (Guid ModuleVersionId, ulong InstantiationHash) functionKey))
+                    {
+                        stackFrame.ModuleVersionId = functionKey.ModuleVersionId;
+                        stackFrame.InstantiationHash = functionKey.InstantiationHash;
+                    }
+
+                    stack.Frames.Add(stackFrame);
+                }
+            }
+        }
     }
 }
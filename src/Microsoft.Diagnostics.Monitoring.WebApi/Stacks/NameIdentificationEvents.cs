@@ -20,6 +20,9 @@ public static class FunctionDescPayloads
             public const int Name = 6;
             public const int TypeArgs = 7;
             public const int ParameterTypes = 8;
+            // Only sent by the native profiler
+            public const int ModuleVersionId = 9;
+            public const int InstantiationHash = 10;
         }
 
         public static class ClassDescPayloads
@@ -30,6 +33,9 @@ public static class ClassDescPayloads
             public const int Flags = 3;
             public const int StackTraceHidden = 4;
             public const int TypeArgs = 5;
+            // Only sent by the native profiler
+            public const int ModuleVersionId = 6;
+            public const int InstantiationHash = 7;
         }
 
         public static class ModuleDescPayloads
@@ -47,6 +53,8 @@ public static class TokenDescPayloads
             public const int StackTraceHidden = 3;
             public const int Name = 4;
             public const int Namespace = 5;
+            // Only sent by the native profiler
+            public const int ModuleVersionId = 6;
         }
     }
 }
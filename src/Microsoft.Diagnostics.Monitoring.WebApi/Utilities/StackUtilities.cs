@@ -44,7 +44,8 @@ internal static Models.CallStackFrame CreateFrameModel(CallStackFrame frame, Nam
                 //TODO Bring this back once we have a useful offset value
                 //Offset = frame.Offset,
                 ModuleName = NameFormatter.UnknownModule,
-                ModuleVersionId = Guid.Empty,
+                ModuleVersionId = frame.ModuleVersionId,
+                InstantiationHash = frame.InstantiationHash,
                 Hidden = false,
 
                 SimpleParameterTypes = ensureParameterTypeFieldsNotNull ? [] : null,
@@ -0,0 +1,225 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "macros.h"
+
+/// <summary>
+/// Fixed capacity queue for any number of producers and a single consumer. Items are moved in and out.
+/// Producers claim slots without locking and either fail when the queue is full (TryEnqueue) or wait for space (Enqueue).
+/// The mutex is only used to park the consumer when the queue is empty, or producers when it is full.
+/// </summary>
+template<typename T, size_t Capacity>
+class BoundedQueue final
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    BoundedQueue() :
+        _enqueuePosition(0),
+        _dequeuePosition(0),
+        _consumerWaiting(false),
+        _producersWaiting(0),
+        _complete(false)
+    {
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            _cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Never blocks. Returns S_FALSE when the queue is full, in which case item is left untouched.
+    HRESULT TryEnqueue(T&& item)
+    {
+        if (_complete.load())
+        {
+            return E_UNEXPECTED;
+        }
+
+        size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &_cells[position & Mask];
+            intptr_t difference = static_cast<intptr_t>(cell->Sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The consumer has not released this slot yet.
+                return S_FALSE;
+            }
+            else
+            {
+                // Another producer claimed the slot.
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->Value = std::move(item);
+        cell->Sequence.store(position + 1, std::memory_order_release);
+
+        // Pairs with the fence in WaitForItems: either the consumer sees the item, or we see that it is waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_consumerWaiting.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _notEmpty.notify_one();
+        }
+
+        return S_OK;
+    }
+
+    // Waits while the queue is full.
+    HRESULT Enqueue(T&& item)
+    {
+        while (true)
+        {
+            HRESULT hr = TryEnqueue(std::move(item));
+            if (hr != S_FALSE)
+            {
+                return hr;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _producersWaiting.fetch_add(1, std::memory_order_relaxed);
+            // Pairs with the fence in NotifyProducers.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            _notFull.wait(lock, [this]() { return !IsFull() || _complete.load(); });
+            _producersWaiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Only one thread may dequeue. Returns S_FALSE once the queue is complete; remaining items are discarded.
+    HRESULT BlockingDequeue(T& item)
+    {
+        while (!_complete.load())
+        {
+            if (TryDequeue(item))
+            {
+                NotifyProducers();
+                return S_OK;
+            }
+
+            WaitForItems();
+        }
+
+        return S_FALSE;
+    }
+
+    // Moves up to maxItems into items, waiting until there is at least one.
+    HRESULT BlockingDequeue(std::vector<T>& items, size_t maxItems)
+    {
+        items.clear();
+        IfOomRetMem(items.reserve(maxItems));
+
+        while (!_complete.load())
+        {
+            T item;
+            while (items.size() < maxItems && TryDequeue(item))
+            {
+                items.push_back(std::move(item));
+            }
+
+            if (!items.empty())
+            {
+                NotifyProducers();
+                return S_OK;
+            }
+
+            WaitForItems();
+        }
+
+        return S_FALSE;
+    }
+
+    void Complete()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _complete.store(true);
+        }
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+
+private:
+    struct Cell
+    {
+        // Equal to the position when the slot is free, and to position + 1 once it holds an item.
+        std::atomic<size_t> Sequence;
+        T Value;
+    };
+
+    // Consumer only.
+    bool HasItem() const
+    {
+        return _cells[_dequeuePosition & Mask].Sequence.load(std::memory_order_acquire) == _dequeuePosition + 1;
+    }
+
+    bool IsFull() const
+    {
+        size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        return static_cast<intptr_t>(_cells[position & Mask].Sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(position) < 0;
+    }
+
+    // Consumer only.
+    bool TryDequeue(T& item)
+    {
+        if (!HasItem())
+        {
+            return false;
+        }
+
+        Cell& cell = _cells[_dequeuePosition & Mask];
+        item = std::move(cell.Value);
+        cell.Sequence.store(_dequeuePosition + Capacity, std::memory_order_release);
+        _dequeuePosition++;
+
+        return true;
+    }
+
+    void WaitForItems()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _consumerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        _notEmpty.wait(lock, [this]() { return HasItem() || _complete.load(); });
+        _consumerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    void NotifyProducers()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_producersWaiting.load(std::memory_order_relaxed) != 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _notFull.notify_all();
+        }
+    }
+
+    static constexpr size_t Mask = Capacity - 1;
+
+    Cell _cells[Capacity];
+    // Kept on separate cache lines so that producers and the consumer do not contend.
+    alignas(64) std::atomic<size_t> _enqueuePosition;
+    alignas(64) size_t _dequeuePosition;
+    std::atomic_bool _consumerWaiting;
+    std::atomic<int> _producersWaiting;
+    std::atomic_bool _complete;
+
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+};
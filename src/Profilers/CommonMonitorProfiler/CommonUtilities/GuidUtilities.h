@@ -0,0 +1,55 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include <string.h>
+
+class GuidUtilities
+{
+    public:
+        // Size of a GUID laid out as Data1, Data2, Data3, Data4 with no padding. This matches System.Guid.ToByteArray.
+        static constexpr size_t FlatSize = sizeof(UINT32) + sizeof(UINT16) + sizeof(UINT16) + 8 * sizeof(BYTE);
+
+        static void Write(const GUID& guid, BYTE* buffer)
+        {
+            size_t offset = 0;
+            memcpy(&buffer[offset], &guid.Data1, sizeof(guid.Data1));
+            offset += sizeof(guid.Data1);
+            memcpy(&buffer[offset], &guid.Data2, sizeof(guid.Data2));
+            offset += sizeof(guid.Data2);
+            memcpy(&buffer[offset], &guid.Data3, sizeof(guid.Data3));
+            offset += sizeof(guid.Data3);
+            memcpy(&buffer[offset], guid.Data4, sizeof(guid.Data4));
+        }
+
+        static GUID Read(const BYTE* buffer)
+        {
+            GUID guid;
+            size_t offset = 0;
+            memcpy(&guid.Data1, &buffer[offset], sizeof(guid.Data1));
+            offset += sizeof(guid.Data1);
+            memcpy(&guid.Data2, &buffer[offset], sizeof(guid.Data2));
+            offset += sizeof(guid.Data2);
+            memcpy(&guid.Data3, &buffer[offset], sizeof(guid.Data3));
+            offset += sizeof(guid.Data3);
+            memcpy(guid.Data4, &buffer[offset], sizeof(guid.Data4));
+            return guid;
+        }
+};
+
+/// <summary>
+/// Strict weak ordering of GUIDs so they can be used as keys of ordered containers.
+/// </summary>
+struct GuidLess
+{
+    bool operator()(const GUID& left, const GUID& right) const
+    {
+        BYTE leftBytes[GuidUtilities::FlatSize];
+        BYTE rightBytes[GuidUtilities::FlatSize];
+        GuidUtilities::Write(left, leftBytes);
+        GuidUtilities::Write(right, rightBytes);
+        return memcmp(leftBytes, rightBytes, GuidUtilities::FlatSize) < 0;
+    }
+};
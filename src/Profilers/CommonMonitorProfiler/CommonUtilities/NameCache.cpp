@@ -4,6 +4,8 @@
 #include "NameCache.h"
 #include "macros.h"
 #include "corhlpr.h"
+#include "GuidUtilities.h"
+#include <unordered_set>
 
 const tstring NameCache::CompositeClassName = _T("_CompositeClass_");
 const tstring NameCache::ArrayClassName = _T("_ArrayClass_");
@@ -45,6 +47,138 @@ void NameCache::AddModuleData(ModuleID moduleId, tstring&& name, GUID mvid)
     _moduleNames.emplace(moduleId, std::make_shared<ModuleData>(std::move(name), mvid));
 }
 
+void NameCache::Merge(const NameCache& other)
+{
+    // Cached data is immutable once added, so entries can be shared between caches.
+    for (auto& entry : other._functionNames)
+    {
+        _functionNames[entry.first] = entry.second;
+    }
+    _classNames.insert(other._classNames.begin(), other._classNames.end());
+    _moduleNames.insert(other._moduleNames.begin(), other._moduleNames.end());
+    _names.insert(other._names.begin(), other._names.end());
+}
+
+void NameCache::CopyFunctionNames(NameCache& source, FunctionID id)
+{
+    std::shared_ptr<FunctionData> functionData;
+    if (_functionNames.find(id) != _functionNames.end() || !source.TryGetFunctionData(id, functionData))
+    {
+        return;
+    }
+
+    // Cached data is immutable once added, so entries can be shared between caches.
+    _functionNames.emplace(id, functionData);
+
+    CopyModuleNames(source, functionData->GetModuleId());
+    if (functionData->GetClass() != 0)
+    {
+        CopyClassNames(source, functionData->GetClass());
+    }
+    else
+    {
+        CopyTypeNames(source, functionData->GetModuleId(), functionData->GetClassToken());
+    }
+
+    for (UINT64 typeArg : functionData->GetTypeArgs())
+    {
+        CopyClassNames(source, static_cast<ClassID>(typeArg));
+    }
+}
+
+void NameCache::CopyClassNames(NameCache& source, ClassID id)
+{
+    std::shared_ptr<ClassData> classData;
+    if (_classNames.find(id) != _classNames.end() || !source.TryGetClassData(id, classData))
+    {
+        return;
+    }
+
+    _classNames.emplace(id, classData);
+
+    CopyModuleNames(source, classData->GetModuleId());
+    CopyTypeNames(source, classData->GetModuleId(), classData->GetToken());
+
+    for (UINT64 typeArg : classData->GetTypeArgs())
+    {
+        CopyClassNames(source, static_cast<ClassID>(typeArg));
+    }
+}
+
+void NameCache::CopyModuleNames(NameCache& source, ModuleID moduleId)
+{
+    std::shared_ptr<ModuleData> moduleData;
+    if (_moduleNames.find(moduleId) == _moduleNames.end() && source.TryGetModuleData(moduleId, moduleData))
+    {
+        _moduleNames.emplace(moduleId, moduleData);
+    }
+}
+
+void NameCache::CopyTypeNames(NameCache& source, ModuleID moduleId, mdTypeDef token)
+{
+    // Nested types name their enclosing types as well.
+    while (token != 0)
+    {
+        std::pair<ModuleID, mdTypeDef> key = std::make_pair(moduleId, token);
+        std::shared_ptr<TokenData> tokenData;
+        if (_names.find(key) != _names.end() || !source.TryGetTokenData(moduleId, token, tokenData))
+        {
+            return;
+        }
+
+        _names.emplace(key, tokenData);
+        token = tokenData->GetOuterToken();
+    }
+}
+
+void NameCache::RemoveModule(ModuleID moduleId)
+{
+    _moduleNames.erase(moduleId);
+
+    for (auto it = _names.begin(); it != _names.end();)
+    {
+        it = it->first.first == moduleId ? _names.erase(it) : ++it;
+    }
+
+    // Classes are collected first, since a class or function instantiated over a removed class goes with it.
+    std::unordered_set<ClassID> removedClasses;
+    bool removed = true;
+    while (removed)
+    {
+        removed = false;
+        for (auto it = _classNames.begin(); it != _classNames.end();)
+        {
+            bool instantiatedOverRemoved = false;
+            for (UINT64 typeArg : it->second->GetTypeArgs())
+            {
+                instantiatedOverRemoved |= removedClasses.find(static_cast<ClassID>(typeArg)) != removedClasses.end();
+            }
+
+            if (it->second->GetModuleId() == moduleId || instantiatedOverRemoved)
+            {
+                removedClasses.insert(it->first);
+                it = _classNames.erase(it);
+                removed = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (auto it = _functionNames.begin(); it != _functionNames.end();)
+    {
+        bool instantiatedOverRemoved = removedClasses.find(it->second->GetClass()) != removedClasses.end();
+        for (UINT64 typeArg : it->second->GetTypeArgs())
+        {
+            instantiatedOverRemoved |= removedClasses.find(static_cast<ClassID>(typeArg)) != removedClasses.end();
+        }
+
+        it = (it->second->GetModuleId() == moduleId || instantiatedOverRemoved) ? _functionNames.erase(it) : ++it;
+    }
+}
+
 HRESULT NameCache::GetFullyQualifiedName(FunctionID id, tstring& name)
 {
     HRESULT hr;
@@ -173,6 +307,76 @@ HRESULT NameCache::GetGenericParameterNames(const std::vector<UINT64>& typeArgs,
     return S_OK;
 }
 
+GUID NameCache::GetModuleVersionId(ModuleID moduleId)
+{
+    std::shared_ptr<ModuleData> moduleData;
+    if (TryGetModuleData(moduleId, moduleData))
+    {
+        return moduleData->GetMvid();
+    }
+
+    GUID empty = { 0 };
+    return empty;
+}
+
+UINT64 NameCache::GetInstantiationHash(const std::vector<UINT64>& typeArgs)
+{
+    if (typeArgs.size() == 0)
+    {
+        return 0;
+    }
+
+    // FNV-1a offset basis
+    UINT64 hash = 0xcbf29ce484222325ULL;
+    for (const UINT64& typeArg : typeArgs)
+    {
+        UINT64 classHash = GetClassHash(static_cast<ClassID>(typeArg));
+        hash = HashBytes(hash, &classHash, sizeof(classHash));
+    }
+
+    return hash;
+}
+
+UINT64 NameCache::GetClassHash(ClassID classId)
+{
+    UINT64 hash = 0xcbf29ce484222325ULL;
+
+    std::shared_ptr<ClassData> classData;
+    if (!TryGetClassData(classId, classData))
+    {
+        // Without its metadata the class can only be told apart by its ClassID, which is not stable across
+        // processes but keeps different unresolved instantiations from colliding.
+        UINT64 id = static_cast<UINT64>(classId);
+        return HashBytes(hash, &id, sizeof(id));
+    }
+
+    BYTE mvid[GuidUtilities::FlatSize];
+    GuidUtilities::Write(GetModuleVersionId(classData->GetModuleId()), mvid);
+    UINT32 token = classData->GetToken();
+    UINT32 flags = static_cast<UINT32>(classData->GetFlags());
+
+    hash = HashBytes(hash, mvid, sizeof(mvid));
+    hash = HashBytes(hash, &token, sizeof(token));
+    hash = HashBytes(hash, &flags, sizeof(flags));
+
+    UINT64 instantiationHash = GetInstantiationHash(classData->GetTypeArgs());
+    hash = HashBytes(hash, &instantiationHash, sizeof(instantiationHash));
+
+    return hash;
+}
+
+UINT64 NameCache::HashBytes(UINT64 hash, const void* data, size_t size)
+{
+    // FNV-1a, chosen because it is simple and produces the same result on every platform and process.
+    const BYTE* bytes = static_cast<const BYTE*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 const std::unordered_map<ClassID, std::shared_ptr<ClassData>>& NameCache::GetClasses()
 {
     return _classNames;
@@ -193,14 +397,14 @@ const std::unordered_map<std::pair<ModuleID, mdTypeDef>, std::shared_ptr<TokenDa
     return _names;
 }
 
-void NameCache::AddFunctionData(ModuleID moduleId, FunctionID id, tstring&& name, ClassID parent, mdToken methodToken, mdTypeDef parentToken, ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden)
+void NameCache::AddFunctionData(ModuleID moduleId, FunctionID id, tstring&& name, ClassID parent, mdToken methodToken, mdTypeDef parentToken, const ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden)
 {
     std::shared_ptr<FunctionData> functionData = std::make_shared<FunctionData>(moduleId, parent, std::move(name), methodToken, parentToken, stackTraceHidden);
     for (int i = 0; i < typeArgsCount; i++)
     {
         functionData->AddTypeArg(typeArgs[i]);
     }
-    _functionNames.emplace(id, functionData);
+    _functionNames[id] = functionData;
 }
 
 void NameCache::AddClassData(ModuleID moduleId, ClassID id, mdTypeDef typeDef, ClassFlags flags, ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden)
@@ -25,15 +25,34 @@ public:
     bool TryGetTokenData(ModuleID modId, mdTypeDef token, std::shared_ptr<TokenData>& data);
 
     void AddModuleData(ModuleID moduleId, tstring&& name, GUID mvid);
-    void AddFunctionData(ModuleID moduleId, FunctionID id, tstring&& name, ClassID parent, mdToken methodToken, mdTypeDef parentToken, ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden);
+    void AddFunctionData(ModuleID moduleId, FunctionID id, tstring&& name, ClassID parent, mdToken methodToken, mdTypeDef parentToken, const ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden);
     void AddClassData(ModuleID moduleId, ClassID id, mdTypeDef typeDef, ClassFlags flags, ClassID* typeArgs, int typeArgsCount, bool stackTraceHidden);
     void AddTokenData(ModuleID moduleId, mdTypeDef typeDef, mdTypeDef outerToken, tstring&& name, tstring&& Namespace, bool stackTraceHidden);
 
+    // Adds the entries of other that are not already present. Used to combine caches that were filled on separate threads.
+    // Functions in other replace those already present, since a function is only resolved again for a more exact
+    // instantiation than the one cached (see TypeNameUtilities::CacheNames).
+    void Merge(const NameCache& other);
+
+    // Copy from source only what is needed to name the function or class: its own entry, the module, the type names
+    // of its declaring and nested types, and the classes of its type arguments. Ids source has not resolved are skipped.
+    void CopyFunctionNames(NameCache& source, FunctionID id);
+    void CopyClassNames(NameCache& source, ClassID id);
+
+    // Removes everything that belongs to the module, along with classes and functions instantiated over its classes,
+    // so that ids reused after a collectible module unloads do not resolve to stale names.
+    void RemoveModule(ModuleID moduleId);
+
     HRESULT GetFullyQualifiedName(FunctionID id, tstring& name);
     HRESULT GetFullyQualifiedTypeName(ClassID classId, tstring& name);
     HRESULT GetFullyQualifiedTypeName(ModuleID moduleId, mdTypeDef token, tstring& name);
     HRESULT GetGenericParameterNames(const std::vector<UINT64>& typeArgs, tstring& name);
 
+    // Stable identity across processes: ModuleVersionId of the declaring module and a hash of the generic instantiation
+    // computed from the ModuleVersionId and token of each type argument, rather than their runtime ids.
+    GUID GetModuleVersionId(ModuleID moduleId);
+    UINT64 GetInstantiationHash(const std::vector<UINT64>& typeArgs);
+
     const std::unordered_map<ClassID, std::shared_ptr<ClassData>>& GetClasses();
     const std::unordered_map<FunctionID, std::shared_ptr<FunctionData>>& GetFunctions();
     const std::unordered_map<ModuleID, std::shared_ptr<ModuleData>>& GetModules();
@@ -51,8 +70,13 @@ private:
     static const tstring GenericSeparator;
     static const tstring GenericEnd;
 
+    UINT64 GetClassHash(ClassID classId);
+    void CopyModuleNames(NameCache& source, ModuleID moduleId);
+    void CopyTypeNames(NameCache& source, ModuleID moduleId, mdTypeDef token);
+    static UINT64 HashBytes(UINT64 hash, const void* data, size_t size);
+
     template<typename T, typename U>
-    bool GetData(std::unordered_map<T, std::shared_ptr<U>> map, T id, std::shared_ptr<U>& name);
+    bool GetData(const std::unordered_map<T, std::shared_ptr<U>>& map, T id, std::shared_ptr<U>& name);
 
     std::unordered_map<ClassID, std::shared_ptr<ClassData>> _classNames;
     std::unordered_map<FunctionID, std::shared_ptr<FunctionData>> _functionNames;
@@ -61,9 +85,9 @@ private:
 };
 
 template<typename T, typename U>
-bool NameCache::GetData(std::unordered_map<T, std::shared_ptr<U>> map, T id, std::shared_ptr<U>& name)
+bool NameCache::GetData(const std::unordered_map<T, std::shared_ptr<U>>& map, T id, std::shared_ptr<U>& name)
 {
-    typename std::unordered_map<T, std::shared_ptr<U>>::iterator it = map.find(id);
+    typename std::unordered_map<T, std::shared_ptr<U>>::const_iterator it = map.find(id);
 
     if (it != map.end())
     {
@@ -0,0 +1,227 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "SymbolTableWriter.h"
+#include "GuidUtilities.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <algorithm>
+#include <cstdio>
+#include <errno.h>
+#include <string.h>
+
+using namespace SymbolTable;
+
+namespace
+{
+    size_t AlignUp(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    template<typename T>
+    void CopyTable(std::vector<BYTE>& buffer, UINT64 offset, const std::vector<T>& table)
+    {
+        if (table.size() > 0)
+        {
+            memcpy(&buffer[static_cast<size_t>(offset)], table.data(), table.size() * sizeof(T));
+        }
+    }
+
+    UINT32 AddTypeArgs(std::vector<UINT64>& typeArgsTable, const std::vector<UINT64>& typeArgs)
+    {
+        UINT32 index = static_cast<UINT32>(typeArgsTable.size());
+        typeArgsTable.insert(typeArgsTable.end(), typeArgs.begin(), typeArgs.end());
+        return index;
+    }
+}
+
+StringRef SymbolTableWriter::StringPool::Add(const tstring& value)
+{
+    auto const& it = _offsets.find(value);
+    if (it != _offsets.end())
+    {
+        return it->second;
+    }
+
+    StringRef ref;
+    ref.Offset = static_cast<UINT32>(_data.size());
+    ref.Length = static_cast<UINT32>(value.size());
+
+    size_t byteCount = value.size() * sizeof(WCHAR);
+    _data.resize(_data.size() + byteCount);
+    if (byteCount > 0)
+    {
+        memcpy(&_data[ref.Offset], value.data(), byteCount);
+    }
+
+    _offsets.emplace(value, ref);
+    return ref;
+}
+
+HRESULT SymbolTableWriter::Serialize(NameCache& nameCache, std::vector<BYTE>& buffer)
+{
+    StringPool strings;
+    std::vector<UINT64> typeArgs;
+
+    std::vector<ModuleRecord> modules;
+    std::vector<TokenRecord> tokens;
+    std::vector<ClassRecord> classes;
+    std::vector<FunctionRecord> functions;
+
+    START_NO_OOM_THROW_REGION;
+
+    modules.reserve(nameCache.GetModules().size());
+    for (auto& entry : nameCache.GetModules())
+    {
+        ModuleRecord record;
+        memset(&record, 0, sizeof(record));
+        record.ModuleId = static_cast<UINT64>(entry.first);
+        GuidUtilities::Write(entry.second->GetMvid(), record.ModuleVersionId);
+        record.Name = strings.Add(entry.second->GetName());
+        modules.push_back(record);
+    }
+
+    tokens.reserve(nameCache.GetTypeNames().size());
+    for (auto& entry : nameCache.GetTypeNames())
+    {
+        TokenRecord record;
+        memset(&record, 0, sizeof(record));
+        record.ModuleId = static_cast<UINT64>(entry.first.first);
+        record.Token = entry.first.second;
+        record.OuterToken = entry.second->GetOuterToken();
+        record.Name = strings.Add(entry.second->GetName());
+        record.Namespace = strings.Add(entry.second->GetNamespace());
+        record.StackTraceHidden = entry.second->GetStackTraceHidden() ? 1 : 0;
+        tokens.push_back(record);
+    }
+
+    classes.reserve(nameCache.GetClasses().size());
+    for (auto& entry : nameCache.GetClasses())
+    {
+        ClassRecord record;
+        memset(&record, 0, sizeof(record));
+        record.ClassId = static_cast<UINT64>(entry.first);
+        record.ModuleId = static_cast<UINT64>(entry.second->GetModuleId());
+        record.InstantiationHash = nameCache.GetInstantiationHash(entry.second->GetTypeArgs());
+        record.Token = entry.second->GetToken();
+        record.Flags = static_cast<UINT32>(entry.second->GetFlags());
+        record.TypeArgsIndex = AddTypeArgs(typeArgs, entry.second->GetTypeArgs());
+        record.TypeArgsCount = static_cast<UINT32>(entry.second->GetTypeArgs().size());
+        record.StackTraceHidden = entry.second->GetStackTraceHidden() ? 1 : 0;
+        classes.push_back(record);
+    }
+
+    functions.reserve(nameCache.GetFunctions().size());
+    for (auto& entry : nameCache.GetFunctions())
+    {
+        FunctionRecord record;
+        memset(&record, 0, sizeof(record));
+        record.FunctionId = static_cast<UINT64>(entry.first);
+        record.ClassId = static_cast<UINT64>(entry.second->GetClass());
+        record.ModuleId = static_cast<UINT64>(entry.second->GetModuleId());
+        record.InstantiationHash = nameCache.GetInstantiationHash(entry.second->GetTypeArgs());
+        record.MethodToken = entry.second->GetMethodToken();
+        record.ClassToken = entry.second->GetClassToken();
+        record.Name = strings.Add(entry.second->GetName());
+        record.TypeArgsIndex = AddTypeArgs(typeArgs, entry.second->GetTypeArgs());
+        record.TypeArgsCount = static_cast<UINT32>(entry.second->GetTypeArgs().size());
+        record.ParameterTypesIndex = AddTypeArgs(typeArgs, entry.second->GetParameterTypes());
+        record.ParameterTypesCount = static_cast<UINT32>(entry.second->GetParameterTypes().size());
+        record.StackTraceHidden = entry.second->GetStackTraceHidden() ? 1 : 0;
+        functions.push_back(record);
+    }
+
+    std::sort(modules.begin(), modules.end(), [](const ModuleRecord& left, const ModuleRecord& right) { return left.ModuleId < right.ModuleId; });
+    std::sort(tokens.begin(), tokens.end(), [](const TokenRecord& left, const TokenRecord& right)
+    {
+        return left.ModuleId < right.ModuleId || (left.ModuleId == right.ModuleId && left.Token < right.Token);
+    });
+    std::sort(classes.begin(), classes.end(), [](const ClassRecord& left, const ClassRecord& right) { return left.ClassId < right.ClassId; });
+    std::sort(functions.begin(), functions.end(), [](const FunctionRecord& left, const FunctionRecord& right) { return left.FunctionId < right.FunctionId; });
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = SymbolTable::Magic;
+    header.Version = SymbolTable::CurrentVersion;
+    header.HeaderSize = sizeof(Header);
+
+    size_t offset = sizeof(Header);
+    header.ModuleTableOffset = offset;
+    header.ModuleCount = modules.size();
+    offset = AlignUp(offset + modules.size() * sizeof(ModuleRecord));
+    header.TokenTableOffset = offset;
+    header.TokenCount = tokens.size();
+    offset = AlignUp(offset + tokens.size() * sizeof(TokenRecord));
+    header.ClassTableOffset = offset;
+    header.ClassCount = classes.size();
+    offset = AlignUp(offset + classes.size() * sizeof(ClassRecord));
+    header.FunctionTableOffset = offset;
+    header.FunctionCount = functions.size();
+    offset = AlignUp(offset + functions.size() * sizeof(FunctionRecord));
+    header.TypeArgsOffset = offset;
+    header.TypeArgsCount = typeArgs.size();
+    offset = AlignUp(offset + typeArgs.size() * sizeof(UINT64));
+    header.StringPoolOffset = offset;
+    header.StringPoolSize = strings.GetData().size();
+    offset += strings.GetData().size();
+
+    buffer.assign(offset, 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    CopyTable(buffer, header.ModuleTableOffset, modules);
+    CopyTable(buffer, header.TokenTableOffset, tokens);
+    CopyTable(buffer, header.ClassTableOffset, classes);
+    CopyTable(buffer, header.FunctionTableOffset, functions);
+    CopyTable(buffer, header.TypeArgsOffset, typeArgs);
+    CopyTable(buffer, header.StringPoolOffset, strings.GetData());
+
+    END_NO_OOM_THROW_REGION;
+
+    return S_OK;
+}
+
+HRESULT SymbolTableWriter::WriteFile(NameCache& nameCache, const std::string& path)
+{
+    HRESULT hr;
+
+    std::vector<BYTE> buffer;
+    IfFailRet(Serialize(nameCache, buffer));
+
+    std::string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return HRESULT_FROM_ERRNO(errno);
+    }
+
+    size_t written = fwrite(buffer.data(), 1, buffer.size(), file);
+    int closeResult = fclose(file);
+    if (written != buffer.size() || closeResult != 0)
+    {
+        std::remove(tempPath.c_str());
+        return E_FAIL;
+    }
+
+#if TARGET_WINDOWS
+    // rename does not replace an existing file on Windows.
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        hr = HRESULT_FROM_ERRNO(errno);
+        std::remove(tempPath.c_str());
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT SymbolTableWriter::RemoveFile(const std::string& path)
+{
+    if (std::remove(path.c_str()) != 0 && errno != ENOENT)
+    {
+        return HRESULT_FROM_ERRNO(errno);
+    }
+
+    return S_OK;
+}
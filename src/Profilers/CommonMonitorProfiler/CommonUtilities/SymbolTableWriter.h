@@ -0,0 +1,135 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "tstring.h"
+#include "NameCache.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Binary symbol table layout. All values are little endian and every table starts on an 8 byte boundary,
+// so a reader can map the file and use the records in place.
+//
+// [SymbolTableHeader][ModuleRecord...][TokenRecord...][ClassRecord...][FunctionRecord...][UINT64 TypeArgs...][String pool]
+//
+// Each record table is sorted by its key (ModuleId; ModuleId then Token; ClassId; FunctionId) to allow binary search.
+// Strings are stored in the pool as UTF-16 code units without terminators and are referenced by byte offset into the pool
+// and length in code units. Type arguments and parameter types are ClassIDs referenced by index into the TypeArgs table and count.
+//
+namespace SymbolTable
+{
+    static constexpr UINT32 Magic = 0x54534d44; // "DMST"
+    static constexpr UINT32 CurrentVersion = 1;
+
+    struct Header
+    {
+        UINT32 Magic;
+        UINT32 Version;
+        UINT32 HeaderSize;
+        UINT32 Reserved;
+        UINT64 ModuleTableOffset;
+        UINT64 ModuleCount;
+        UINT64 TokenTableOffset;
+        UINT64 TokenCount;
+        UINT64 ClassTableOffset;
+        UINT64 ClassCount;
+        UINT64 FunctionTableOffset;
+        UINT64 FunctionCount;
+        UINT64 TypeArgsOffset;
+        UINT64 TypeArgsCount;
+        UINT64 StringPoolOffset;
+        UINT64 StringPoolSize;
+    };
+
+    struct StringRef
+    {
+        UINT32 Offset;
+        UINT32 Length;
+    };
+
+    struct ModuleRecord
+    {
+        UINT64 ModuleId;
+        BYTE ModuleVersionId[16];
+        StringRef Name;
+    };
+
+    struct TokenRecord
+    {
+        UINT64 ModuleId;
+        UINT32 Token;
+        UINT32 OuterToken;
+        StringRef Name;
+        StringRef Namespace;
+        UINT32 StackTraceHidden;
+        UINT32 Reserved;
+    };
+
+    struct ClassRecord
+    {
+        UINT64 ClassId;
+        UINT64 ModuleId;
+        UINT64 InstantiationHash;
+        UINT32 Token;
+        UINT32 Flags;
+        UINT32 TypeArgsIndex;
+        UINT32 TypeArgsCount;
+        UINT32 StackTraceHidden;
+        UINT32 Reserved;
+    };
+
+    struct FunctionRecord
+    {
+        UINT64 FunctionId;
+        UINT64 ClassId;
+        UINT64 ModuleId;
+        UINT64 InstantiationHash;
+        UINT32 MethodToken;
+        UINT32 ClassToken;
+        StringRef Name;
+        UINT32 TypeArgsIndex;
+        UINT32 TypeArgsCount;
+        UINT32 ParameterTypesIndex;
+        UINT32 ParameterTypesCount;
+        UINT32 StackTraceHidden;
+        UINT32 Reserved;
+    };
+
+    static_assert(sizeof(Header) == 112, "SymbolTable::Header layout changed");
+    static_assert(sizeof(ModuleRecord) == 32, "SymbolTable::ModuleRecord layout changed");
+    static_assert(sizeof(TokenRecord) == 40, "SymbolTable::TokenRecord layout changed");
+    static_assert(sizeof(ClassRecord) == 48, "SymbolTable::ClassRecord layout changed");
+    static_assert(sizeof(FunctionRecord) == 72, "SymbolTable::FunctionRecord layout changed");
+}
+
+/// <summary>
+/// Serializes the contents of a NameCache into the binary symbol table format described above.
+/// </summary>
+class SymbolTableWriter
+{
+    public:
+        static HRESULT Serialize(NameCache& nameCache, std::vector<BYTE>& buffer);
+
+        // Writes to a temporary file and renames it over path so readers never observe a partially written table.
+        static HRESULT WriteFile(NameCache& nameCache, const std::string& path);
+
+        // Removes a table written by WriteFile. A table that was never written is not an error.
+        static HRESULT RemoveFile(const std::string& path);
+
+    private:
+        class StringPool
+        {
+            public:
+                SymbolTable::StringRef Add(const tstring& value);
+                const std::vector<BYTE>& GetData() const { return _data; }
+            private:
+                std::vector<BYTE> _data;
+                // Namespaces and names repeat frequently, so identical strings share storage.
+                std::unordered_map<tstring, SymbolTable::StringRef> _offsets;
+        };
+};
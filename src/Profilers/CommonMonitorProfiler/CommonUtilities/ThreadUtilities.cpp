@@ -5,6 +5,11 @@
 #if TARGET_UNIX
 #include <time.h>
 #include <errno.h>
+#if TARGET_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #else
 #include <Windows.h>
 #endif
@@ -34,3 +39,14 @@ void ThreadUtilities::Sleep(unsigned int milliseconds)
 
 #endif
 }
+
+void ThreadUtilities::LowerCurrentThreadPriority()
+{
+#if TARGET_WINDOWS
+    ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif TARGET_LINUX
+    // On Linux the nice value is a per-thread attribute when addressed by thread id.
+    const int LowPriorityNiceValue = 10;
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), LowPriorityNiceValue);
+#endif
+}
@@ -7,4 +7,7 @@ class ThreadUtilities
 {
     public:
         static void Sleep(unsigned int milliseconds);
+
+        // Best-effort request to schedule the calling thread behind application threads.
+        static void LowerCurrentThreadPriority();
 };
@@ -3,11 +3,21 @@
 
 #include "TypeNameUtilities.h"
 #include "corhlpr.h"
+#include <algorithm>
+
+constexpr size_t TypeNameUtilities::InitialNameBufferLength;
 
 TypeNameUtilities::TypeNameUtilities(ICorProfilerInfo12* profilerInfo) : _profilerInfo(profilerInfo)
 {
 }
 
+std::vector<WCHAR>& TypeNameUtilities::GetNameBuffer()
+{
+    // Kept per thread and never shrunk, so after the first long name on a thread no further allocations are needed.
+    static thread_local std::vector<WCHAR> nameBuffer(InitialNameBufferLength);
+    return nameBuffer;
+}
+
 HRESULT TypeNameUtilities::CacheModuleNames(NameCache& nameCache, ModuleID moduleId)
 {
     std::shared_ptr<ModuleData> moduleData;
@@ -35,34 +45,94 @@ HRESULT TypeNameUtilities::CacheNames(NameCache& nameCache, FunctionID functionI
     std::shared_ptr<FunctionData> functionData;
     if (!nameCache.TryGetFunctionData(functionId, functionData))
     {
-        return GetFunctionInfo(nameCache, functionId, frameInfo);
+        HRESULT hr;
+        FunctionInstance instance;
+        IfFailRet(GetFunctionInstance(functionId, frameInfo, instance));
+        return GetFunctionInfo(nameCache, instance);
+    }
+
+    return S_OK;
+}
+
+HRESULT TypeNameUtilities::CacheNames(NameCache& nameCache, const FunctionInstance& instance)
+{
+    std::shared_ptr<FunctionData> functionData;
+    if (!nameCache.TryGetFunctionData(instance.FunctionId, functionData) || !IsSameInstantiation(*functionData, instance))
+    {
+        return GetFunctionInfo(nameCache, instance);
     }
 
     return S_OK;
 }
 
-HRESULT TypeNameUtilities::GetFunctionInfo(NameCache& nameCache, FunctionID id, COR_PRF_FRAME_INFO frameInfo)
+bool TypeNameUtilities::IsSameInstantiation(const FunctionData& functionData, const FunctionInstance& instance)
+{
+    const std::vector<UINT64>& typeArgs = functionData.GetTypeArgs();
+    if (functionData.GetClass() != instance.ClassId || typeArgs.size() != instance.TypeArgs.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < typeArgs.size(); i++)
+    {
+        if (typeArgs[i] != static_cast<UINT64>(instance.TypeArgs[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+HRESULT TypeNameUtilities::GetFunctionInstance(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, FunctionInstance& instance)
 {
-    if (id == 0)
+    if (functionId == 0)
     {
         return E_INVALIDARG;
     }
 
-    ClassID classId = 0;
-    ModuleID moduleId = 0;
-    mdToken token = mdTokenNil;
     ULONG32 typeArgsCount = 0;
-    ClassID typeArgs[32];
     HRESULT hr;
 
-    IfFailRet(_profilerInfo->GetFunctionInfo2(id,
+    instance.FunctionId = functionId;
+    instance.ClassId = 0;
+    instance.ModuleId = 0;
+    instance.Token = mdTokenNil;
+    instance.TypeArgs.clear();
+
+    IfFailRet(_profilerInfo->GetFunctionInfo2(functionId,
         frameInfo,
-        &classId,
-        &moduleId,
-        &token,
-        sizeof(typeArgs) / sizeof(ClassID),
+        &instance.ClassId,
+        &instance.ModuleId,
+        &instance.Token,
+        0,
         &typeArgsCount,
-        typeArgs));
+        nullptr));
+
+    if (typeArgsCount > 0)
+    {
+        IfOomRetMem(instance.TypeArgs.resize(typeArgsCount));
+        IfFailRet(_profilerInfo->GetFunctionInfo2(functionId,
+            frameInfo,
+            nullptr,
+            nullptr,
+            nullptr,
+            typeArgsCount,
+            &typeArgsCount,
+            instance.TypeArgs.data()));
+        instance.TypeArgs.resize(std::min<size_t>(typeArgsCount, instance.TypeArgs.size()));
+    }
+
+    return S_OK;
+}
+
+HRESULT TypeNameUtilities::GetFunctionInfo(NameCache& nameCache, const FunctionInstance& instance)
+{
+    FunctionID id = instance.FunctionId;
+    ClassID classId = instance.ClassId;
+    ModuleID moduleId = instance.ModuleId;
+    mdToken token = instance.Token;
+    HRESULT hr;
 
     ComPtr<IMetaDataImport> pIMDImport;
     IfFailRet(_profilerInfo->GetModuleMetaData(moduleId,
@@ -70,25 +140,27 @@ HRESULT TypeNameUtilities::GetFunctionInfo(NameCache& nameCache, FunctionID id,
         IID_IMetaDataImport,
         (IUnknown**)&pIMDImport));
 
-    //TODO Convert this to dynamically allocate the needed size.
-    WCHAR funcName[256];
+    tstring funcName;
     mdTypeDef classToken = mdTypeDefNil;
-    IfFailRet(pIMDImport->GetMethodProps(token,
-        &classToken,
-        funcName,
-        256,
-        0,
-        0,
-        NULL,
-        NULL,
-        NULL,
-        NULL));
+    IfFailRet(GetName([&](WCHAR* buffer, ULONG bufferLength, ULONG* nameLength)
+    {
+        return pIMDImport->GetMethodProps(token,
+            &classToken,
+            buffer,
+            bufferLength,
+            nameLength,
+            0,
+            NULL,
+            NULL,
+            NULL,
+            NULL);
+    }, funcName));
 
     IfFailRet(GetModuleInfo(nameCache, moduleId));
 
     bool stackTraceHidden = ShouldHideFromStackTrace(moduleId, token);
 
-    nameCache.AddFunctionData(moduleId, id, tstring(funcName), classId, token, classToken, typeArgs, typeArgsCount, stackTraceHidden);
+    nameCache.AddFunctionData(moduleId, id, std::move(funcName), classId, token, classToken, instance.TypeArgs.data(), static_cast<int>(instance.TypeArgs.size()), stackTraceHidden);
 
     // If the ClassID returned from GetFunctionInfo is 0, then the function is a shared generic function.
     if (classId != 0)
@@ -100,11 +172,11 @@ HRESULT TypeNameUtilities::GetFunctionInfo(NameCache& nameCache, FunctionID id,
         IfFailRet(GetTypeDefName(nameCache, moduleId, classToken));
     }
 
-    for (ULONG32 i = 0; i < typeArgsCount; i++)
+    for (ClassID typeArg : instance.TypeArgs)
     {
-        if (typeArgs[i] != 0)
+        if (typeArg != 0)
         {
-            IfFailRet(GetClassInfo(nameCache, typeArgs[i]));
+            IfFailRet(GetClassInfo(nameCache, typeArg));
         }
     }
 
@@ -127,7 +199,7 @@ HRESULT TypeNameUtilities::GetClassInfo(NameCache& nameCache, ClassID classId)
     ModuleID modId = 0;
     mdTypeDef classToken = mdTokenNil;
     ULONG32 typeArgsCount = 0;
-    ClassID typeArgs[32];
+    std::vector<ClassID> typeArgs;
     HRESULT hr = S_OK;
     ClassFlags flags = ClassFlags::None;
 
@@ -135,9 +207,22 @@ HRESULT TypeNameUtilities::GetClassInfo(NameCache& nameCache, ClassID classId)
         &modId,
         &classToken,
         nullptr,
-        32,
+        0,
         &typeArgsCount,
-        typeArgs));
+        nullptr));
+
+    if (typeArgsCount > 0)
+    {
+        IfOomRetMem(typeArgs.resize(typeArgsCount));
+        IfFailRet(_profilerInfo->GetClassIDInfo2(classId,
+            nullptr,
+            nullptr,
+            nullptr,
+            typeArgsCount,
+            &typeArgsCount,
+            typeArgs.data()));
+        typeArgsCount = std::min<ULONG32>(typeArgsCount, static_cast<ULONG32>(typeArgs.size()));
+    }
 
     if (CORPROF_E_CLASSID_IS_ARRAY == hr)
     {
@@ -173,7 +258,7 @@ HRESULT TypeNameUtilities::GetClassInfo(NameCache& nameCache, ClassID classId)
 
     bool stackTraceHidden = ShouldHideFromStackTrace(modId, classToken);
 
-    nameCache.AddClassData(modId, classId, classToken, flags, typeArgs, typeArgsCount, stackTraceHidden);
+    nameCache.AddClassData(modId, classId, classToken, flags, typeArgs.data(), typeArgsCount, stackTraceHidden);
 
     return S_OK;
 }
@@ -199,19 +284,20 @@ HRESULT TypeNameUtilities::GetTypeDefName(NameCache& nameCache, ModuleID moduleI
 
         bool stackTraceHidden = ShouldHideFromStackTrace(moduleId, tokenToProcess);
 
-        WCHAR wName[256];
-
         DWORD dwTypeDefFlags = 0;
-        IfFailRet(pMDImport->GetTypeDefProps(tokenToProcess,
-            wName,
-            256,
-            NULL,
-            &dwTypeDefFlags,
-            NULL));
+        tstring wNameString;
+        IfFailRet(GetName([&](WCHAR* buffer, ULONG bufferLength, ULONG* nameLength)
+        {
+            return pMDImport->GetTypeDefProps(tokenToProcess,
+                buffer,
+                bufferLength,
+                nameLength,
+                &dwTypeDefFlags,
+                NULL);
+        }, wNameString));
 
         mdTypeDef outerTokenType = mdTokenNil;
 
-        tstring wNameString = tstring(wName);
         tstring wNamespaceString = tstring();
 
         if (IsTdNested(dwTypeDefFlags))
@@ -220,7 +306,7 @@ HRESULT TypeNameUtilities::GetTypeDefName(NameCache& nameCache, ModuleID moduleI
         }
         else
         {
-            std::string::size_type found = tstring(wName).find_last_of(_T('.'));
+            std::string::size_type found = wNameString.find_last_of(_T('.'));
 
             if (found != std::string::npos)
             {
@@ -228,7 +314,7 @@ HRESULT TypeNameUtilities::GetTypeDefName(NameCache& nameCache, ModuleID moduleI
                 wNameString = wNameString.substr(found + 1);
             }
         }
-        nameCache.AddTokenData(moduleId, tokenToProcess, outerTokenType, tstring(wNameString), tstring(wNamespaceString), stackTraceHidden);
+        nameCache.AddTokenData(moduleId, tokenToProcess, outerTokenType, std::move(wNameString), std::move(wNamespaceString), stackTraceHidden);
         tokenToProcess = outerTokenType;
     }
 
@@ -256,33 +342,26 @@ HRESULT TypeNameUtilities::GetModuleInfo(NameCache& nameCache, ModuleID moduleId
         IID_IMetaDataImport,
         (IUnknown**)&pIMDImport));
 
-    WCHAR moduleFullName[256];
-    ULONG nameLength = 0;
+    tstring moduleFullName;
     GUID mvid = {0};
-    IfFailRet(pIMDImport->GetScopeProps(
-        moduleFullName,
-        256,
-        &nameLength,
-        &mvid));
-
-    int pathSeparatorIndex = nameLength - 1;
-    while (pathSeparatorIndex >= 0)
+    IfFailRet(GetName([&](WCHAR* buffer, ULONG bufferLength, ULONG* nameLength)
     {
-        if (moduleFullName[pathSeparatorIndex] == '\\' || moduleFullName[pathSeparatorIndex] == '/')
-        {
-            break;
-        }
-        pathSeparatorIndex--;
-    }
+        return pIMDImport->GetScopeProps(
+            buffer,
+            bufferLength,
+            nameLength,
+            &mvid);
+    }, moduleFullName));
 
     tstring moduleName;
-    if (pathSeparatorIndex < 0)
+    tstring::size_type pathSeparatorIndex = moduleFullName.find_last_of(_T("\\/"));
+    if (pathSeparatorIndex == tstring::npos)
     {
-        moduleName = moduleFullName;
+        moduleName = std::move(moduleFullName);
     }
     else
     {
-        moduleName = tstring(moduleFullName, pathSeparatorIndex + 1, nameLength - pathSeparatorIndex - 1);
+        moduleName = moduleFullName.substr(pathSeparatorIndex + 1);
     }
 
     nameCache.AddModuleData(moduleId, std::move(moduleName), mvid);
@@ -8,6 +8,22 @@
 #include "com.h"
 #include "tstring.h"
 #include "NameCache.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <vector>
+
+/// <summary>
+/// The runtime identity of a function as seen on a particular frame. Capturing it only requires GetFunctionInfo2,
+/// so it can be done while the runtime is suspended and the metadata lookups deferred until after it resumes.
+/// </summary>
+struct FunctionInstance
+{
+    FunctionID FunctionId;
+    ClassID ClassId;
+    ModuleID ModuleId;
+    mdToken Token;
+    std::vector<ClassID> TypeArgs;
+};
 
 /// <summary>
 /// Retrieves the names of functions and stores them into a cache.
@@ -18,9 +34,17 @@ class TypeNameUtilities
         TypeNameUtilities(ICorProfilerInfo12* profilerInfo);
         HRESULT CacheNames(NameCache& nameCache, ClassID classId);
         HRESULT CacheNames(NameCache& nameCache, FunctionID functionId, COR_PRF_FRAME_INFO frameInfo);
+        // Also replaces a cached entry that names a different instantiation, such as the canonical one cached for shared
+        // generic code that was resolved without frame info.
+        HRESULT CacheNames(NameCache& nameCache, const FunctionInstance& instance);
+        HRESULT GetFunctionInstance(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo, FunctionInstance& instance);
+
+        // Shared generic code resolves to a different instantiation depending on the frame it was seen on.
+        static bool IsGeneric(const FunctionData& functionData) { return functionData.GetClass() == 0 || !functionData.GetTypeArgs().empty(); }
+        static bool IsSameInstantiation(const FunctionData& functionData, const FunctionInstance& instance);
         HRESULT CacheModuleNames(NameCache& nameCache, ModuleID moduleId);
     private:
-        HRESULT GetFunctionInfo(NameCache& nameCache, FunctionID id, COR_PRF_FRAME_INFO frameInfo);
+        HRESULT GetFunctionInfo(NameCache& nameCache, const FunctionInstance& instance);
         HRESULT GetClassInfo(NameCache& nameCache, ClassID classId);
         HRESULT GetModuleInfo(NameCache& nameCache, ModuleID moduleId);
         HRESULT GetTypeDefName(NameCache& nameCache, ModuleID moduleId, mdTypeDef classToken);
@@ -28,6 +52,35 @@ class TypeNameUtilities
         // A wrapper around HasStackTraceHiddenAttribute to ensure consistent behavior when checking for the attribute
         // encounters errors.
         bool ShouldHideFromStackTrace(ModuleID moduleId, mdToken token);
+
+        // Calls getName(buffer, bufferLength, &nameLength) with a thread local buffer, growing it and calling again only when
+        // the name did not fit. nameLength must include the null terminator, as with the metadata APIs.
+        template<typename TGetName>
+        static HRESULT GetName(TGetName getName, tstring& name);
+        static std::vector<WCHAR>& GetNameBuffer();
     private:
+        static constexpr size_t InitialNameBufferLength = 256;
+
         ComPtr<ICorProfilerInfo12> _profilerInfo;
 };
+
+template<typename TGetName>
+HRESULT TypeNameUtilities::GetName(TGetName getName, tstring& name)
+{
+    HRESULT hr;
+
+    std::vector<WCHAR>& buffer = GetNameBuffer();
+    ULONG nameLength = 0;
+    IfFailRet(getName(buffer.data(), static_cast<ULONG>(buffer.size()), &nameLength));
+
+    // The metadata APIs truncate the name and return CLDB_S_TRUNCATION, which is a success code.
+    if (nameLength > buffer.size())
+    {
+        IfOomRetMem(buffer.resize(nameLength));
+        IfFailRet(getName(buffer.data(), static_cast<ULONG>(buffer.size()), &nameLength));
+    }
+
+    name.assign(buffer.data(), nameLength > 0 ? nameLength - 1 : 0);
+
+    return S_OK;
+}
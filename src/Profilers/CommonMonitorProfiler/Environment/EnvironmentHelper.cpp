@@ -133,4 +133,32 @@ HRESULT EnvironmentHelper::GetIsFeatureEnabled(const LPCWSTR featureName, bool&
 
 
     return S_OK;
-}
\ No newline at end of file
+}
+
+HRESULT EnvironmentHelper::GetUInt32(const LPCWSTR envVarName, UINT32& value)
+{
+    HRESULT hr;
+
+    tstring envValue;
+    hr = _environment->GetEnvironmentVariable(envVarName, envValue);
+    if (FAILED(hr))
+    {
+        if (hr != HRESULT_FROM_WIN32(ERROR_ENVVAR_NOT_FOUND))
+        {
+            return hr;
+        }
+        return S_OK;
+    }
+
+    std::string narrowValue = to_string(envValue);
+    char* end = nullptr;
+    unsigned long long parsedValue = strtoull(narrowValue.c_str(), &end, 10);
+    if (narrowValue.empty() || end == nullptr || *end != '\0' || parsedValue > UINT32_MAX)
+    {
+        return E_INVALIDARG;
+    }
+
+    value = static_cast<UINT32>(parsedValue);
+
+    return S_OK;
+}
@@ -65,4 +65,9 @@ public:
     HRESULT GetTempFolder(tstring& tempFolder);
 
     HRESULT GetIsFeatureEnabled(const LPCWSTR featureName, bool& isEnabled);
+
+    /// <summary>
+    /// Gets an unsigned integer setting from the environment. If the variable is not set, value is left unchanged.
+    /// </summary>
+    HRESULT GetUInt32(const LPCWSTR envVarName, UINT32& value);
 };
@@ -7,76 +7,65 @@
 #include "corprof.h"
 #include "com.h"
 #include "tstring.h"
+#include <array>
+#include <type_traits>
 #include <vector>
 #include <string>
 
 /// <summary>
-/// Helper class to convert types to COR_PRF_EVENTPIPE_PARAM_DESC representations
-/// TODO: Need to map out remaining types, which are not used for the current data.
+/// Helper class to convert types to COR_PRF_EVENTPIPE_PARAM_DESC representations.
+/// Type and ElementType are compile time constants so that ProfilerEvent can build its descriptor table as a constexpr array.
 /// </summary>
 template <typename T>
 class EventTypeMapping
 {
-public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        // If we got here, it means we do not know how to convert the type to a COR_PRF_EVENTPIPE_PARAM_DESC
-        // We are not allowed to say static_assert(false), even if we never bind to this specialization.
-        static_assert(sizeof(T) != sizeof(T), "Invalid type");
-    }
+    // If we got here, it means we do not know how to convert the type to a COR_PRF_EVENTPIPE_PARAM_DESC
+    // We are not allowed to say static_assert(false), even if we never bind to this specialization.
+    static_assert(sizeof(T) != sizeof(T), "Invalid type");
 };
 
-template<>
-class EventTypeMapping<UINT32>
-{
-public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        descriptor.type = COR_PRF_EVENTPIPE_UINT32;
-        descriptor.elementType = 0;
-    }
+#define DEFINE_EVENT_TYPE_MAPPING(cppType, eventType) \
+template<> \
+class EventTypeMapping<cppType> \
+{ \
+public: \
+    static constexpr UINT32 Type = eventType; \
+    static constexpr UINT32 ElementType = 0; \
 };
 
-template<>
-class EventTypeMapping<UINT64>
-{
-public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        descriptor.type = COR_PRF_EVENTPIPE_UINT64;
-        descriptor.elementType = 0;
-    }
-};
+// Written as a 4 byte value, matching the EventPipe BOOLEAN encoding.
+DEFINE_EVENT_TYPE_MAPPING(bool, COR_PRF_EVENTPIPE_BOOLEAN)
+DEFINE_EVENT_TYPE_MAPPING(BYTE, COR_PRF_EVENTPIPE_BYTE)
+DEFINE_EVENT_TYPE_MAPPING(INT32, COR_PRF_EVENTPIPE_INT32)
+DEFINE_EVENT_TYPE_MAPPING(UINT32, COR_PRF_EVENTPIPE_UINT32)
+DEFINE_EVENT_TYPE_MAPPING(INT64, COR_PRF_EVENTPIPE_INT64)
+DEFINE_EVENT_TYPE_MAPPING(UINT64, COR_PRF_EVENTPIPE_UINT64)
+DEFINE_EVENT_TYPE_MAPPING(double, COR_PRF_EVENTPIPE_DOUBLE)
+DEFINE_EVENT_TYPE_MAPPING(tstring, COR_PRF_EVENTPIPE_STRING)
+DEFINE_EVENT_TYPE_MAPPING(GUID, COR_PRF_EVENTPIPE_GUID)
 
-template<>
-class EventTypeMapping<tstring>
+#undef DEFINE_EVENT_TYPE_MAPPING
+
+/// <summary>
+/// Arrays are serialized by copying their elements, so only fixed size numeric element types are supported.
+/// std::vector&lt;BYTE&gt; is used for byte blobs.
+/// </summary>
+template<typename T>
+class EventArrayElementMapping
 {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Array elements must be numeric");
 public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        descriptor.type = COR_PRF_EVENTPIPE_STRING;
-        descriptor.elementType = 0;
-    }
+    static constexpr UINT32 Type = COR_PRF_EVENTPIPE_ARRAY;
+    static constexpr UINT32 ElementType = EventTypeMapping<T>::Type;
 };
 
-template<>
-class EventTypeMapping<GUID>
+template<typename T>
+class EventTypeMapping<std::vector<T>> : public EventArrayElementMapping<T>
 {
-public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        descriptor.type = COR_PRF_EVENTPIPE_GUID;
-        descriptor.elementType = 0;
-    }
 };
 
-template<>
-class EventTypeMapping<std::vector<UINT64>>
+// Fixed size arrays use the same encoding as std::vector, including the element count.
+template<typename T, size_t N>
+class EventTypeMapping<std::array<T, N>> : public EventArrayElementMapping<T>
 {
-public:
-    void GetType(COR_PRF_EVENTPIPE_PARAM_DESC& descriptor)
-    {
-        descriptor.type = COR_PRF_EVENTPIPE_ARRAY;
-        descriptor.elementType = COR_PRF_EVENTPIPE_UINT64;
-    }
 };
@@ -7,13 +7,38 @@
 #include "corprof.h"
 #include "com.h"
 #include "EventTypeMapping.h"
+#include "ProfilerEventEnablement.h"
+#include "../CommonUtilities/GuidUtilities.h"
 #include <vector>
 #include <string>
 #include <memory>
+#include <array>
+
+// Arrays are encoded with a UINT16 element count, which is what EventPipe consumers expect.
+// Callers with more elements than this must split them over several events.
+static constexpr size_t MaxEventArrayLength = 0xFFFF;
+
+/// <summary>
+/// Per thread scratch space used to serialize array payloads. It is reused for every event written on the thread,
+/// so once it has grown to the largest payload seen, writing an event does not allocate.
+/// </summary>
+class ProfilerEventScratchBuffer
+{
+public:
+    static BYTE* Acquire(size_t size)
+    {
+        static thread_local std::vector<BYTE> buffer;
+        if (buffer.size() < size)
+        {
+            buffer.resize(size);
+        }
+        return buffer.data();
+    }
+};
 
 /// <summary>
 /// Helper class used to write EventSource data.
-/// Initialize is used to declare the data types and fill the COR_PRF_EVENTPIPE_PARAM_DESC structure.
+/// Descriptors is the compile time table of COR_PRF_EVENTPIPE_PARAM_DESC types; Initialize copies it and adds the names.
 /// WritePayload is used to create COR_PRF_EVENT_DATA and write the actual data.
 /// We rely on variadic templates and template specialization for both of the above.
 ///
@@ -25,180 +50,264 @@ class ProfilerEvent
 {
     friend class ProfilerEventProvider;
 public:
+    // Does nothing if the event is not enabled.
     HRESULT WritePayload(const Args&... args);
 
+    // Lets callers skip gathering the data for a payload when nobody is listening.
+    bool IsEnabled() const { return _enablement->IsEnabled(_keywords, _level); }
+
 private:
-    ProfilerEvent(ICorProfilerInfo12* profilerInfo);
+    ProfilerEvent(ICorProfilerInfo12* profilerInfo, const std::shared_ptr<ProfilerEventEnablement>& enablement, UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level);
 
-    template<size_t index, typename T, typename... TArgs>
-    HRESULT Initialize(const WCHAR* (&names)[sizeof...(Args)]);
-
-    template<size_t index>
     HRESULT Initialize(const WCHAR* (&names)[sizeof...(Args)]);
 
+    // Arguments are passed by reference through the recursion; only array payloads are copied, into the scratch buffer.
     template<size_t index, typename T, typename... TArgs>
-    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, const T& first, TArgs... rest);
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const T& first, const TArgs&... rest);
 
     // In order to specialize with variadic templates, all the overloads have to declare their template parameters
     template<size_t index, typename T = tstring, typename... TArgs>
-    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, const tstring& first, TArgs... rest);
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const tstring& first, const TArgs&... rest);
 
     template<size_t index, typename T = GUID, typename... TArgs>
-    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, const GUID& first, TArgs... rest);
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const GUID& first, const TArgs&... rest);
+
+    template<size_t index, typename T = bool, typename... TArgs>
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const bool& first, const TArgs&... rest);
+
+    template<size_t index, typename T, typename... TArgs>
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const std::vector<typename T::value_type>& first, const TArgs&... rest);
 
     template<size_t index, typename T, typename... TArgs>
-    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, const std::vector<typename T::value_type>& first, TArgs... rest);
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const std::array<typename T::value_type, std::tuple_size<T>::value>& first, const TArgs&... rest);
+
+    template<size_t index, typename... TArgs>
+    HRESULT WriteArrayPayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, size_t size, const TArgs&... rest);
+
+    template<size_t index>
+    HRESULT WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer);
 
+    // Number of scratch buffer bytes needed to serialize a payload argument.
     template<typename T>
-    static std::vector<BYTE> GetEventBuffer(const std::vector<T>& data);
+    static size_t GetBufferSize(const T& value);
 
     template<typename T>
-    static void WriteToBuffer(BYTE* pBuffer, size_t* pOffset, const T& value);
+    static size_t GetBufferSize(const std::vector<T>& value);
 
-    template<size_t index>
-    HRESULT WritePayload(COR_PRF_EVENT_DATA* data);
+    template<typename T, size_t N>
+    static size_t GetBufferSize(const std::array<T, N>& value);
+
+    // Writes the UINT16 element count followed by the elements, which EventTypeMapping limits to numeric types.
+    template<typename T>
+    static size_t WriteEventBuffer(BYTE* buffer, const T* elements, size_t count);
+
+    template<typename T>
+    static void WriteToBuffer(BYTE* pBuffer, size_t* pOffset, const T& value);
 
 private:
 
     //TODO We don't have a way of modeling data with no payload. 0 sized arrays are not allowed.
+    static constexpr COR_PRF_EVENTPIPE_PARAM_DESC Descriptors[sizeof...(Args)] =
+        { { EventTypeMapping<Args>::Type, EventTypeMapping<Args>::ElementType, nullptr }... };
+
     COR_PRF_EVENTPIPE_PARAM_DESC _descriptor[sizeof...(Args)];
 
     // Note this field is set by ProfilerEventProvider.
     EVENTPIPE_EVENT _event;
     ComPtr<ICorProfilerInfo12> _profilerInfo;
+    std::shared_ptr<ProfilerEventEnablement> _enablement;
+    UINT64 _keywords;
+    COR_PRF_EVENTPIPE_LEVEL _level;
 };
 
 template<typename... Args>
-ProfilerEvent<Args...>::ProfilerEvent(ICorProfilerInfo12* profilerInfo) : _event(0), _profilerInfo(profilerInfo)
+ProfilerEvent<Args...>::ProfilerEvent(ICorProfilerInfo12* profilerInfo, const std::shared_ptr<ProfilerEventEnablement>& enablement, UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level) :
+    _event(0),
+    _profilerInfo(profilerInfo),
+    _enablement(enablement),
+    _keywords(keywords),
+    _level(level)
 {
     memset(_descriptor, 0, sizeof(_descriptor));
 }
 
 template<typename... Args>
-template<size_t index, typename T, typename... TArgs>
-HRESULT ProfilerEvent<Args...>::Initialize(const WCHAR* (&names)[sizeof...(Args)])
-{
-    _descriptor[index].name = names[index];
-    EventTypeMapping<T> typeMapper;
-    typeMapper.GetType(_descriptor[index]);
-    return Initialize<index + 1, TArgs...>(names);
-}
+constexpr COR_PRF_EVENTPIPE_PARAM_DESC ProfilerEvent<Args...>::Descriptors[sizeof...(Args)];
 
 template<typename... Args>
-template<size_t index>
 HRESULT ProfilerEvent<Args...>::Initialize(const WCHAR* (&names)[sizeof...(Args)])
 {
     //CONSIDER An alternate design is to make each event call DefineEvent instead of leaving this responsibility on the provider.
+    for (size_t i = 0; i < sizeof...(Args); i++)
+    {
+        _descriptor[i] = Descriptors[i];
+        _descriptor[i].name = names[i];
+    }
     return S_OK;
 }
 
 template<typename... Args>
 HRESULT ProfilerEvent<Args...>::WritePayload(const Args&... args)
 {
+    if (!IsEnabled())
+    {
+        return S_OK;
+    }
+
     COR_PRF_EVENT_DATA data[sizeof...(Args)];
-    return WritePayload<0, Args...>(data, args...);
+
+    size_t argumentSizes[] = { GetBufferSize(args)... };
+    size_t bufferSize = 0;
+    for (size_t argumentSize : argumentSizes)
+    {
+        bufferSize += argumentSize;
+    }
+
+    // The buffer is sized up front since the addresses handed to COR_PRF_EVENT_DATA must not move until the event is written.
+    BYTE* buffer = ProfilerEventScratchBuffer::Acquire(bufferSize);
+
+    return WritePayload<0, Args...>(data, buffer, args...);
 }
 
 template<typename... Args>
 template<size_t index, typename T, typename... TArgs>
-HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, const T& first, TArgs... rest)
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const T& first, const TArgs&... rest)
 {
     data[index].ptr = reinterpret_cast<UINT64>(&first);
     data[index].size = static_cast<UINT32>(sizeof(T));
     data[index].reserved = 0;
-    return WritePayload<index + 1, TArgs...>(data, rest...);
+    return WritePayload<index + 1, TArgs...>(data, buffer, rest...);
 }
 
 template<typename... Args>
 template<size_t index, typename T, typename... TArgs>
-HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, const tstring& first, TArgs... rest)
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const tstring& first, const TArgs&... rest)
 {
     //Note this works for empty strings.
     data[index].ptr = reinterpret_cast<UINT64>(first.c_str());
     data[index].size = static_cast<UINT32>((first.size() + 1) * sizeof(WCHAR)); // + 1 for null terminator.
     data[index].reserved = 0;
-    return WritePayload<index + 1, TArgs...>(data, rest...);
-}
-
- template<typename... Args>
- template<size_t index, typename T, typename... TArgs>
- HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, const std::vector<typename T::value_type>& first, TArgs... rest)
- {
-     // This value must stay in scope during all the WritePayload functions.
-     std::vector<BYTE> buffer(0);
-
-     if (first.size() == 0)
-     {
-         data[index].ptr = 0;
-         data[index].size = 0;
-         data[index].reserved = 0;
-     }
-     else
-     {
-         buffer = std::move(GetEventBuffer(first));
-         data[index].ptr = reinterpret_cast<UINT64>(buffer.data());
-         data[index].size = static_cast<UINT32>(buffer.size());
-         data[index].reserved = 0;
-     }
-     return WritePayload<index + 1, TArgs...>(data, rest...);
- }
+    return WritePayload<index + 1, TArgs...>(data, buffer, rest...);
+}
+
+template<typename... Args>
+template<size_t index, typename T, typename... TArgs>
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const std::vector<typename T::value_type>& first, const TArgs&... rest)
+{
+    if (first.size() > MaxEventArrayLength)
+    {
+        // Fail rather than writing a truncated count that would corrupt the rest of the payload.
+        return COR_E_OVERFLOW;
+    }
+
+    size_t size = first.size() == 0 ? 0 : WriteEventBuffer(buffer, first.data(), first.size());
+    return WriteArrayPayload<index, TArgs...>(data, buffer, size, rest...);
+}
+
+template<typename... Args>
+template<size_t index, typename T, typename... TArgs>
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const std::array<typename T::value_type, std::tuple_size<T>::value>& first, const TArgs&... rest)
+{
+    static_assert(std::tuple_size<T>::value <= MaxEventArrayLength, "Array is too large for a single event");
+
+    size_t size = first.size() == 0 ? 0 : WriteEventBuffer(buffer, first.data(), first.size());
+    return WriteArrayPayload<index, TArgs...>(data, buffer, size, rest...);
+}
+
+template<typename... Args>
+template<size_t index, typename... TArgs>
+HRESULT ProfilerEvent<Args...>::WriteArrayPayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, size_t size, const TArgs&... rest)
+{
+    // Empty arrays are written with no data at all.
+    data[index].ptr = size == 0 ? 0 : reinterpret_cast<UINT64>(buffer);
+    data[index].size = static_cast<UINT32>(size);
+    data[index].reserved = 0;
+    return WritePayload<index + 1, TArgs...>(data, buffer + size, rest...);
+}
 
 template<typename... Args>
 template<size_t index, typename T, typename... TArgs>
-HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, const GUID& first, TArgs... rest)
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const GUID& first, const TArgs&... rest)
 {
     // Manually copy the GUID into a buffer and pass the buffer address.
     // We can't pass the GUID address directly (or use sizeof(GUID)) because the GUID may have padding between its different data segments.
-    const int GUID_FLAT_SIZE = sizeof(INT32) + sizeof(INT16) + sizeof(INT16) + sizeof(INT64);
-    static_assert(GUID_FLAT_SIZE == 128 / 8, "Incorrect flat GUID size.");
-
-    BYTE buffer[GUID_FLAT_SIZE] = {0};
-    int offset = 0;
-
-    memcpy(&buffer[offset], &first.Data1, sizeof(INT32));
-    offset += sizeof(INT32);
-    memcpy(&buffer[offset], &first.Data2, sizeof(INT16));
-    offset += sizeof(INT16);
-    memcpy(&buffer[offset], &first.Data3, sizeof(INT16));
-    offset += sizeof(INT16);
-    memcpy(&buffer[offset], first.Data4, sizeof(INT64));
-
-    data[index].ptr = reinterpret_cast<UINT64>(buffer);
-    data[index].size = static_cast<UINT32>(GUID_FLAT_SIZE);
+    static_assert(GuidUtilities::FlatSize == 128 / 8, "Incorrect flat GUID size.");
+
+    BYTE guidBuffer[GuidUtilities::FlatSize] = {0};
+    GuidUtilities::Write(first, guidBuffer);
+
+    data[index].ptr = reinterpret_cast<UINT64>(guidBuffer);
+    data[index].size = static_cast<UINT32>(GuidUtilities::FlatSize);
+    data[index].reserved = 0;
+
+    return WritePayload<index + 1, TArgs...>(data, buffer, rest...);
+}
+
+template<typename... Args>
+template<size_t index, typename T, typename... TArgs>
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer, const bool& first, const TArgs&... rest)
+{
+    // EventPipe booleans are 4 bytes wide. Like the GUID buffer, this stays in scope until the event is written.
+    UINT32 value = first ? 1 : 0;
+
+    data[index].ptr = reinterpret_cast<UINT64>(&value);
+    data[index].size = static_cast<UINT32>(sizeof(value));
     data[index].reserved = 0;
 
-    return WritePayload<index + 1, TArgs...>(data, rest...);
+    return WritePayload<index + 1, TArgs...>(data, buffer, rest...);
+}
+
+template<typename... Args>
+template<size_t index>
+HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data, BYTE* buffer)
+{
+    return _profilerInfo->EventPipeWriteEvent(_event, sizeof...(Args), data, nullptr, nullptr);
 }
 
 template<typename... Args>
 template<typename T>
-std::vector<BYTE> ProfilerEvent<Args...>::GetEventBuffer(const std::vector<T>& data)
+size_t ProfilerEvent<Args...>::GetBufferSize(const T& value)
 {
-    size_t offset = 0;
-    //2 byte length prefix
-    size_t bufferSize = sizeof(UINT16) + (data.size() * sizeof(T));
-    std::vector<BYTE> buffer = std::vector<BYTE>(bufferSize);
-    WriteToBuffer<UINT16>(buffer.data(), &offset, (UINT16)data.size());
+    return 0;
+}
 
-    for (const T& element : data)
+template<typename... Args>
+template<typename T>
+size_t ProfilerEvent<Args...>::GetBufferSize(const std::vector<T>& value)
+{
+    if (value.size() == 0)
     {
-        WriteToBuffer<T>(buffer.data(), &offset, element);
+        return 0;
     }
 
-    return buffer;
+    //2 byte length prefix
+    return sizeof(UINT16) + (value.size() * sizeof(T));
+}
+
+template<typename... Args>
+template<typename T, size_t N>
+size_t ProfilerEvent<Args...>::GetBufferSize(const std::array<T, N>& value)
+{
+    return N == 0 ? 0 : sizeof(UINT16) + (N * sizeof(T));
 }
 
 template<typename... Args>
 template<typename T>
-void ProfilerEvent<Args...>::WriteToBuffer(BYTE* pBuffer, size_t* pOffset, const T& value)
+size_t ProfilerEvent<Args...>::WriteEventBuffer(BYTE* buffer, const T* elements, size_t count)
 {
-    *(T*)(pBuffer + *pOffset) = value;
-    *pOffset += sizeof(T);
+    size_t offset = 0;
+    WriteToBuffer<UINT16>(buffer, &offset, (UINT16)count);
+
+    memcpy(buffer + offset, elements, count * sizeof(T));
+
+    return offset + (count * sizeof(T));
 }
 
 template<typename... Args>
-template<size_t index>
-HRESULT ProfilerEvent<Args...>::WritePayload(COR_PRF_EVENT_DATA* data)
+template<typename T>
+void ProfilerEvent<Args...>::WriteToBuffer(BYTE* pBuffer, size_t* pOffset, const T& value)
 {
-    return _profilerInfo->EventPipeWriteEvent(_event, sizeof...(Args), data, nullptr, nullptr);
+    // The buffer is not necessarily aligned for T.
+    memcpy(pBuffer + *pOffset, &value, sizeof(T));
+    *pOffset += sizeof(T);
 }
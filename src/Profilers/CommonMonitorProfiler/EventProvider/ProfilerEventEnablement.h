@@ -0,0 +1,64 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include <atomic>
+
+/// <summary>
+/// Which events of a provider should be written, using EventPipe keyword and level semantics.
+/// ICorProfilerInfo12 has no way to query EventPipe session state, so this is set by the component that knows
+/// which sessions are listening. All events are enabled by default.
+/// Checks are lock free so that events can test it before building their payload.
+/// </summary>
+class ProfilerEventEnablement
+{
+public:
+    ProfilerEventEnablement() :
+        _enabled(true),
+        _keywords(~static_cast<UINT64>(0)),
+        _level(COR_PRF_EVENTPIPE_VERBOSE),
+        _sessionId(0)
+    {
+    }
+
+    void Enable(UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level)
+    {
+        _keywords.store(keywords, std::memory_order_relaxed);
+        _level.store(static_cast<UINT32>(level), std::memory_order_relaxed);
+        _enabled.store(true, std::memory_order_release);
+        _sessionId.fetch_add(1, std::memory_order_release);
+    }
+
+    void Disable()
+    {
+        _enabled.store(false, std::memory_order_release);
+    }
+
+    // Changes with each Enable, including one that immediately follows the previous session, so that state built
+    // for what earlier sessions received can be reset.
+    UINT32 GetSessionId() const
+    {
+        return _sessionId.load(std::memory_order_acquire);
+    }
+
+    bool IsEnabled(UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level) const
+    {
+        if (!_enabled.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        // Lower levels are more severe. Events without keywords are enabled at any keyword mask.
+        return static_cast<UINT32>(level) <= _level.load(std::memory_order_relaxed) &&
+            (keywords == 0 || (keywords & _keywords.load(std::memory_order_relaxed)) != 0);
+    }
+
+private:
+    std::atomic_bool _enabled;
+    std::atomic<UINT64> _keywords;
+    std::atomic<UINT32> _level;
+    std::atomic<UINT32> _sessionId;
+};
@@ -15,6 +15,9 @@ HRESULT ProfilerEventProvider::CreateProvider(const WCHAR* providerName, ICorPro
     return S_OK;
 }
 
-ProfilerEventProvider::ProfilerEventProvider(ICorProfilerInfo12* profilerInfo, EVENTPIPE_PROVIDER provider) : _provider(provider), _profilerInfo(profilerInfo)
+ProfilerEventProvider::ProfilerEventProvider(ICorProfilerInfo12* profilerInfo, EVENTPIPE_PROVIDER provider) :
+    _provider(provider),
+    _profilerInfo(profilerInfo),
+    _enablement(std::make_shared<ProfilerEventEnablement>())
 {
 }
@@ -15,35 +15,49 @@ class ProfilerEventProvider
     public:
         static HRESULT CreateProvider(const WCHAR* providerName, ICorProfilerInfo12* profilerInfo, std::unique_ptr<ProfilerEventProvider>& provider);
 
+        // Defines an event that is written whenever the provider is enabled.
         template<typename... TArgs>
         HRESULT DefineEvent(const WCHAR* eventName, std::unique_ptr<ProfilerEvent<TArgs...>>& profilerEventDescriptor, const WCHAR* (&names)[sizeof...(TArgs)]);
 
+        template<typename... TArgs>
+        HRESULT DefineEvent(const WCHAR* eventName, UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level, std::unique_ptr<ProfilerEvent<TArgs...>>& profilerEventDescriptor, const WCHAR* (&names)[sizeof...(TArgs)]);
+
         EVENTPIPE_PROVIDER GetProvider() { return _provider; }
 
+        // Controls which of the events defined by this provider are written.
+        ProfilerEventEnablement& GetEnablement() { return *_enablement; }
+
     private:
         ProfilerEventProvider(ICorProfilerInfo12* profilerInfo, EVENTPIPE_PROVIDER provider);
         EVENTPIPE_PROVIDER _provider = 0;
         int _currentEventId = 1;
         ComPtr<ICorProfilerInfo12> _profilerInfo;
+        std::shared_ptr<ProfilerEventEnablement> _enablement;
 };
 
 template<typename... TArgs>
 HRESULT ProfilerEventProvider::DefineEvent(const WCHAR* eventName, typename std::unique_ptr<ProfilerEvent<TArgs...>>& profilerEventDescriptor, const WCHAR* (&names)[sizeof...(TArgs)])
+{
+    return DefineEvent(eventName, 0, COR_PRF_EVENTPIPE_LOGALWAYS, profilerEventDescriptor, names);
+}
+
+template<typename... TArgs>
+HRESULT ProfilerEventProvider::DefineEvent(const WCHAR* eventName, UINT64 keywords, COR_PRF_EVENTPIPE_LEVEL level, typename std::unique_ptr<ProfilerEvent<TArgs...>>& profilerEventDescriptor, const WCHAR* (&names)[sizeof...(TArgs)])
 {
     EVENTPIPE_EVENT event = 0;
     HRESULT hr;
 
-    auto newEvent = typename std::unique_ptr<ProfilerEvent<TArgs...>>(new ProfilerEvent<TArgs...>(_profilerInfo));
-    hr = newEvent->template Initialize<0, TArgs...>(names);
+    auto newEvent = typename std::unique_ptr<ProfilerEvent<TArgs...>>(new ProfilerEvent<TArgs...>(_profilerInfo, _enablement, keywords, level));
+    hr = newEvent->Initialize(names);
     IfFailRet(hr);
 
     IfFailRet(_profilerInfo->EventPipeDefineEvent(
         _provider,
         eventName,
         _currentEventId,
-        0, //We not use keywords
+        keywords,
         1, // eventVersion
-        COR_PRF_EVENTPIPE_LOGALWAYS,
+        level,
         0, //We not use opcodes
         FALSE, //No need for stacks
         sizeof...(TArgs),
@@ -2,8 +2,10 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include "CommandServer.h"
+#include <algorithm>
 #include <thread>
 #include "Logging/Logger.h"
+#include "macros.h"
 
 CommandServer::CommandServer(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
     _shutdown(false),
@@ -15,7 +17,7 @@ CommandServer::CommandServer(const std::shared_ptr<ILogger>& logger, ICorProfile
 
 HRESULT CommandServer::Start(
     const std::string& path,
-    std::function<HRESULT(const IpcMessage& message)> callback,
+    IpcMessageCallback callback,
     std::function<HRESULT(const IpcMessage& message)> validateMessageCallback,
     std::function<HRESULT(unsigned short commandSet, bool& unmanagedOnly)> unmanagedOnlyCallback)
 {
@@ -39,9 +41,29 @@ HRESULT CommandServer::Start(
     _unmanagedOnlyCallback = unmanagedOnlyCallback;
 
     IfFailLogRet_(_logger, _server.Bind(path));
-    _listeningThread = std::thread(&CommandServer::ListeningThread, this);
-    _clientThread = std::thread(&CommandServer::ProcessingThread, this, std::ref(_clientQueue));
+    IfFailLogRet_(_logger, StartClientWorkers());
     _unmanagedOnlyThread = std::thread(&CommandServer::ProcessingThread, this, std::ref(_unmanagedOnlyQueue));
+    _listeningThread = std::thread(&CommandServer::ListeningThread, this);
+    return S_OK;
+}
+
+HRESULT CommandServer::StartClientWorkers()
+{
+    IfOomRetMem(_clientQueues.reserve(_clientWorkerCount));
+    IfOomRetMem(_clientThreads.reserve(_clientWorkerCount));
+
+    for (UINT32 i = 0; i < _clientWorkerCount; i++)
+    {
+        std::unique_ptr<CallbackQueue> queue(new (std::nothrow) CallbackQueue());
+        IfNullRet(queue);
+        _clientQueues.push_back(std::move(queue));
+    }
+
+    for (std::unique_ptr<CallbackQueue>& queue : _clientQueues)
+    {
+        _clientThreads.emplace_back(&CommandServer::ProcessingThread, this, std::ref(*queue));
+    }
+
     return S_OK;
 }
 
@@ -50,123 +72,277 @@ void CommandServer::Shutdown()
     bool shutdown = false;
     if (_shutdown.compare_exchange_strong(shutdown, true))
     {
-        _clientQueue.Complete();
+        for (std::unique_ptr<CallbackQueue>& queue : _clientQueues)
+        {
+            queue->Complete();
+        }
         _unmanagedOnlyQueue.Complete();
         _server.Shutdown();
 
-        _listeningThread.join();
-        _clientThread.join();
-        _unmanagedOnlyThread.join();
+        if (_listeningThread.joinable())
+        {
+            _listeningThread.join();
+        }
+        for (std::thread& thread : _clientThreads)
+        {
+            thread.join();
+        }
+        if (_unmanagedOnlyThread.joinable())
+        {
+            _unmanagedOnlyThread.join();
+        }
     }
 }
 
 void CommandServer::ListeningThread()
 {
     // TODO: Handle oom scenarios
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
+    HRESULT hr = _server.Run([this](const std::shared_ptr<IpcCommClient>& client, IpcMessage& message)
+    {
+        HandleMessage(message, client);
+    });
 
-    while (true)
+    if (FAILED(hr))
     {
-        std::shared_ptr<IpcCommClient> client;
-        HRESULT hr = _server.Accept(client);
-        if (FAILED(hr))
-        {
-            break;
-        }
+        _logger->Log(LogLevel::Error, _LS("Command server stopped unexpectedly: 0x%08x"), hr);
+    }
+}
 
-        IpcMessage message;
+void CommandServer::HandleConnectionMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+{
+    HRESULT hr;
 
-        //Note this can timeout if the client doesn't send anything
-        hr = ReceiveMessage(client, message);
-        if (FAILED(hr))
-        {
-            // Best-effort shutdown, ignore the result.
-            client->Shutdown();
-            continue;
-        }
+    switch (static_cast<ConnectionCommand>(message.Command))
+    {
+    case ConnectionCommand::Multiplex:
+        hr = OpenConnection(message, client);
+        break;
+    case ConnectionCommand::GetSharedRingBuffer:
+        hr = SendSharedRingBuffer(message, client);
+        break;
+    default:
+        hr = E_NOT_SUPPORTED;
+        break;
+    }
 
-        bool doEnqueueMessage = true;
-        hr = _validateMessageCallback(message);
-        if (FAILED(hr))
-        {
-            _logger->Log(LogLevel::Error, _LS("Failed to validate message: 0x%08x"), hr);
-            *reinterpret_cast<HRESULT*>(response.Payload.data()) = hr;
-            SendMessage(client, response);
-            Shutdown(client);
-            continue;
-        }
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Error, _LS("Failed to process connection command %hu: 0x%08x"), message.Command, hr);
+        SendResponse(client, message.RequestId, hr);
+    }
+}
 
-        if (!IsControlCommand(message))
-        {
-            ProcessMessage(message, client);
-        }
-        else
-        {
-            ProcessResetMessage(message, client);
-        }
+HRESULT CommandServer::OpenConnection(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+{
+    HRESULT hr;
+
+    UINT32 flags = static_cast<UINT32>(ConnectionFlags::None);
+    if (message.Payload.size() == sizeof(flags))
+    {
+        memcpy(&flags, message.Payload.data(), sizeof(flags));
+    }
+    else if (message.Payload.size() != 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    if ((flags & ~static_cast<UINT32>(ConnectionFlags::CompletionResponses)) != 0)
+    {
+        return E_NOT_SUPPORTED;
+    }
+
+    // The acknowledgement is the last message sent with single message framing.
+    IfFailRet(SendStatus(client, message.RequestId, S_OK));
+    client->SetMultiplexed(true);
+    client->SetConnectionFlags(flags);
+
+    return S_OK;
+}
+
+void CommandServer::HandleMessage(IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+{
+    HRESULT hr;
+
+    if (message.CommandSet == static_cast<unsigned short>(CommandSet::Connection))
+    {
+        HandleConnectionMessage(message, client);
+        return;
+    }
+
+    // Lets callbacks reject requests whose results the client would never receive.
+    message.ClientFlags = client->GetConnectionFlags();
+
+    hr = _validateMessageCallback(message);
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Error, _LS("Failed to validate message: 0x%08x"), hr);
+        SendResponse(client, message.RequestId, hr);
+        return;
+    }
+
+    if (!IsControlCommand(message))
+    {
+        ProcessMessage(message, client);
+    }
+    else
+    {
+        ProcessResetMessage(message, client);
     }
 }
 
-void CommandServer::ProcessMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
+void CommandServer::ProcessMessage(IpcMessage& message, std::shared_ptr<IpcCommClient> client)
 {
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
+    HRESULT hr;
 
-    *reinterpret_cast<HRESULT*>(response.Payload.data()) = S_OK;
-    SendMessage(client, response);
-    Shutdown(client);
+    UINT32 requestId = message.RequestId;
+    bool coalesced = IsCoalescedCommand(message);
 
     CallbackInfo info;
-    info.Message = message;
+    info.Message = std::move(message);
+
+    bool completionResponses = client->HasConnectionFlag(ConnectionFlags::CompletionResponses);
+    if (completionResponses)
+    {
+        info.ResponseClient = client;
+        info.RequestId = requestId;
+    }
+
     bool unmanagedOnly = false;
-    if (SUCCEEDED(_unmanagedOnlyCallback(info.Message.CommandSet, unmanagedOnly)) && unmanagedOnly)
+    if (FAILED(_unmanagedOnlyCallback(info.Message.CommandSet, unmanagedOnly)))
+    {
+        unmanagedOnly = false;
+    }
+
+    if (coalesced)
     {
-        _unmanagedOnlyQueue.Enqueue(info);
+        hr = EnqueueCoalesced(info, unmanagedOnly);
     }
     else
     {
-        _clientQueue.Enqueue(info);
+        hr = Enqueue(info, unmanagedOnly);
+    }
+
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Warning, _LS("Unable to queue message: 0x%08x"), hr);
+        SendResponse(client, requestId, hr);
+    }
+    else if (!completionResponses)
+    {
+        SendResponse(client, requestId, S_OK);
     }
 }
 
 void CommandServer::ProcessResetMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
 {
-    IpcMessage response;
-    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
-    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
-    response.Payload.resize(sizeof(HRESULT));
-
     HRESULT hr = S_OK;
 
+    // The response is sent by the processing thread once the command completes, so that the
+    // listening thread can keep servicing other clients in the meantime.
     if (message.CommandSet == static_cast<unsigned short>(CommandSet::Profiler))
     {
         CallbackInfo nativeCallbackInfo;
 
-        CreateControlMessage(CommandSet::Profiler, message.Command, nativeCallbackInfo);
-
-        _unmanagedOnlyQueue.Enqueue(nativeCallbackInfo);
+        hr = CreateControlMessage(CommandSet::Profiler, message.Command, nativeCallbackInfo);
+        if (SUCCEEDED(hr))
+        {
+            nativeCallbackInfo.ResponseClient = client;
+            nativeCallbackInfo.RequestId = message.RequestId;
 
-        hr = nativeCallbackInfo.CompletionPromise->get_future().get();
+            hr = Enqueue(nativeCallbackInfo, true);
+        }
     }
     if (message.CommandSet == static_cast<unsigned short>(CommandSet::StartupHook))
     {
         CallbackInfo managedCallbackInfo;
 
-        CreateControlMessage(CommandSet::StartupHook, message.Command, managedCallbackInfo);
+        hr = CreateControlMessage(CommandSet::StartupHook, message.Command, managedCallbackInfo);
+        if (SUCCEEDED(hr))
+        {
+            managedCallbackInfo.ResponseClient = client;
+            managedCallbackInfo.RequestId = message.RequestId;
 
-        _clientQueue.Enqueue(managedCallbackInfo);
+            hr = Enqueue(managedCallbackInfo, false);
+        }
+    }
 
-        hr = managedCallbackInfo.CompletionPromise->get_future().get();
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Warning, _LS("Unable to queue message: 0x%08x"), hr);
+        SendResponse(client, message.RequestId, hr);
     }
+}
+
+HRESULT CommandServer::Enqueue(CallbackInfo& info, bool unmanagedOnly)
+{
+    CallbackQueue& queue = unmanagedOnly ? _unmanagedOnlyQueue : *_clientQueues[info.Message.CommandSet % _clientQueues.size()];
 
-    *reinterpret_cast<HRESULT*>(response.Payload.data()) = hr;
-    SendMessage(client, response);
-    Shutdown(client);
+    HRESULT hr = queue.TryEnqueue(std::move(info));
+    return hr == S_FALSE ? E_BUSY : hr;
+}
+
+HRESULT CommandServer::EnqueueCoalesced(CallbackInfo& info, bool unmanagedOnly)
+{
+    HRESULT hr;
+
+    CoalescingKey key(info.Message.CommandSet, info.Message.Command, info.Message.Payload);
+
+    std::lock_guard<std::mutex> lock(_coalescingMutex);
+
+    auto const& it = _queuedRequests.find(key);
+    if (it != _queuedRequests.end())
+    {
+        // Clients without completion responses have already been answered, so there is nothing to add.
+        if (info.ResponseClient)
+        {
+            IfOomRetMem(it->second->Responses.emplace_back(info.ResponseClient, info.RequestId));
+        }
+        return S_OK;
+    }
+
+    std::shared_ptr<CoalescedRequest> request;
+    IfOomRetMem(request = std::make_shared<CoalescedRequest>());
+    if (info.ResponseClient)
+    {
+        IfOomRetMem(request->Responses.emplace_back(std::move(info.ResponseClient), info.RequestId));
+    }
+    info.Coalesced = request;
+
+    IfOomRetMem(_queuedRequests.emplace(key, request));
+    hr = Enqueue(info, unmanagedOnly);
+    if (FAILED(hr))
+    {
+        _queuedRequests.erase(key);
+        return hr;
+    }
+
+    return S_OK;
+}
+
+void CommandServer::TakeCoalescedResponses(CallbackInfo& info, std::vector<std::pair<std::shared_ptr<IpcCommClient>, UINT32>>& responses)
+{
+    std::lock_guard<std::mutex> lock(_coalescingMutex);
+
+    // Only one request per key is queued at a time, so the entry is this one.
+    _queuedRequests.erase(CoalescingKey(info.Message.CommandSet, info.Message.Command, info.Message.Payload));
+    responses = std::move(info.Coalesced->Responses);
+}
+
+bool CommandServer::IsCoalescedCommand(const IpcMessage& message)
+{
+    switch (message.CommandSet) {
+        case static_cast<int>(CommandSet::Profiler):
+            switch (message.Command)
+            {
+                case static_cast<int>(ProfilerCommand::Callstack):
+                case static_cast<int>(ProfilerCommand::ExportSymbolTable):
+                    return true;
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
 }
 
 bool CommandServer::IsControlCommand(const IpcMessage& message)
@@ -194,23 +370,159 @@ bool CommandServer::IsControlCommand(const IpcMessage& message)
     }
 }
 
-HRESULT CommandServer::ReceiveMessage(std::shared_ptr<IpcCommClient> client, IpcMessage& message)
+HRESULT CommandServer::SendMessage(std::shared_ptr<IpcCommClient> client, const IpcMessage& message)
 {
     HRESULT hr;
-    IfFailLogRet_(_logger, client->Receive(message));
+    IfFailLogRet_(_logger, client->Send(message));
     return S_OK;
 }
 
-HRESULT CommandServer::SendMessage(std::shared_ptr<IpcCommClient> client, const IpcMessage& message)
+HRESULT CommandServer::SendStatus(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status)
+{
+    return SendStatus(client, requestId, status, std::vector<BYTE>());
+}
+
+HRESULT CommandServer::SendSharedRingBuffer(const IpcMessage& message, std::shared_ptr<IpcCommClient> client)
 {
+#if TARGET_UNIX
     HRESULT hr;
-    IfFailLogRet_(_logger, client->Send(message));
+
+    if (!_sharedRingBuffer)
+    {
+        return E_NOT_SUPPORTED;
+    }
+
+    if (!_sharedRingBuffer->TryClaimReader())
+    {
+        // Another client already reads the ring; a second reader would race it on ReadOffset.
+        return E_BUSY;
+    }
+
+    IpcMessage response;
+    hr = CreateStatusMessage(client, message.RequestId, S_OK, std::vector<BYTE>(), 0, response);
+    if (SUCCEEDED(hr))
+    {
+        hr = client->SendWithHandle(response, _sharedRingBuffer->GetHandle());
+    }
+    if (FAILED(hr))
+    {
+        // The client never received the ring, so it can be handed to the next one that asks.
+        _sharedRingBuffer->ReleaseReader();
+        _logger->Log(LogLevel::Error, _LS("Unable to share ring buffer: 0x%08x"), hr);
+        return hr;
+    }
+
+    if (!client->IsMultiplexed())
+    {
+        Shutdown(client);
+    }
+
     return S_OK;
+#else
+    return E_NOT_SUPPORTED;
+#endif
+}
+
+HRESULT CommandServer::CreateStatusMessage(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result, size_t resultOffset, IpcMessage& response)
+{
+    response.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    response.Command = static_cast<unsigned short>(ServerResponseCommand::Status);
+    response.RequestId = requestId;
+    HRESULT hr;
+
+    size_t resultSize = client->HasConnectionFlag(ConnectionFlags::CompletionResponses) ? result.size() - resultOffset : 0;
+    IfFailRet(PayloadBufferPool::Shared().Rent(sizeof(HRESULT) + resultSize, response.Payload));
+    memcpy(response.Payload.data(), &status, sizeof(HRESULT));
+    if (resultSize != 0)
+    {
+        memcpy(response.Payload.data() + sizeof(HRESULT), result.data() + resultOffset, resultSize);
+    }
+
+    return S_OK;
+}
+
+HRESULT CommandServer::SendStatus(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result)
+{
+    HRESULT hr;
+
+    if (result.size() > MaxStatusResultSize && client->HasConnectionFlag(ConnectionFlags::CompletionResponses))
+    {
+        hr = SendLargeResult(client, requestId, status, result);
+        if (FAILED(hr))
+        {
+            // The client cannot tell where the partial result ends, so the connection is no longer usable.
+            _logger->Log(LogLevel::Error, _LS("Failed to send result: 0x%08x"), hr);
+            client->Shutdown();
+        }
+        return hr;
+    }
+
+    IpcMessage response;
+    IfFailRet(CreateStatusMessage(client, requestId, status, result, 0, response));
+
+    hr = SendMessage(client, response);
+    PayloadBufferPool::Shared().Return(response.Payload);
+
+    return hr;
+}
+
+HRESULT CommandServer::SendLargeResult(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result)
+{
+    HRESULT hr;
+
+    IpcMessage message;
+    message.CommandSet = static_cast<unsigned short>(CommandSet::ServerResponse);
+    message.Command = static_cast<unsigned short>(ServerResponseCommand::Data);
+    message.RequestId = requestId;
+
+    // Whatever is left once it fits is sent with the status.
+    hr = S_OK;
+    size_t resultOffset = 0;
+    while (SUCCEEDED(hr) && result.size() - resultOffset > MaxStatusResultSize)
+    {
+        size_t size = std::min(result.size() - resultOffset, static_cast<size_t>(IpcCommClient::MaxPayloadSize));
+        hr = PayloadBufferPool::Shared().Rent(size, message.Payload);
+        if (FAILED(hr))
+        {
+            break;
+        }
+        memcpy(message.Payload.data(), result.data() + resultOffset, size);
+
+        hr = client->SendDeferred(message);
+        resultOffset += size;
+    }
+
+    PayloadBufferPool::Shared().Return(message.Payload);
+    IfFailRet(hr);
+
+    IfFailRet(CreateStatusMessage(client, requestId, status, result, resultOffset, message));
+    hr = client->SendDeferred(message);
+    PayloadBufferPool::Shared().Return(message.Payload);
+
+    return hr;
+}
+
+HRESULT CommandServer::SendResponse(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status)
+{
+    return SendResponse(client, requestId, status, std::vector<BYTE>());
+}
+
+HRESULT CommandServer::SendResponse(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result)
+{
+    HRESULT hr = SendStatus(client, requestId, status, result);
+
+    // Without a Multiplex request, connections carry a single message.
+    if (!client->IsMultiplexed())
+    {
+        Shutdown(client);
+    }
+
+    return hr;
 }
 
 HRESULT CommandServer::Shutdown(std::shared_ptr<IpcCommClient> client)
 {
-    HRESULT hr = client->Shutdown();
+    HRESULT hr = client->ShutdownAfterSend();
     if (FAILED(hr))
     {
         _logger->Log(LogLevel::Warning, _LS("Unexpected error during shutdown: 0x%08x"), hr);
@@ -219,7 +531,7 @@ HRESULT CommandServer::Shutdown(std::shared_ptr<IpcCommClient> client)
     return S_OK;
 }
 
-void CommandServer::ProcessingThread(BlockingQueue<CallbackInfo>& queue)
+void CommandServer::ProcessingThread(CallbackQueue& queue)
 {
     HRESULT hr = _profilerInfo->InitializeCurrentThread();
 
@@ -229,25 +541,43 @@ void CommandServer::ProcessingThread(BlockingQueue<CallbackInfo>& queue)
         return;
     }
 
+    std::vector<CallbackInfo> batch;
     while (true)
     {
-        CallbackInfo info;
-        hr = queue.BlockingDequeue(info);
+        hr = queue.BlockingDequeue(batch, DequeueBatchSize);
         if (hr != S_OK)
         {
             //We are complete, discard all messages
             break;
         }
 
-        hr = _callback(info.Message);
-        if (hr != S_OK)
+        for (CallbackInfo& info : batch)
         {
-            _logger->Log(LogLevel::Warning, _LS("IpcMessage callback failed: 0x%08x"), hr);
-        }
+            std::vector<std::pair<std::shared_ptr<IpcCommClient>, UINT32>> responses;
+            if (info.Coalesced)
+            {
+                TakeCoalescedResponses(info, responses);
+            }
+            else if (info.ResponseClient)
+            {
+                responses.emplace_back(info.ResponseClient, info.RequestId);
+            }
 
-        if (info.CompletionPromise)
-        {
-            info.CompletionPromise->set_value(hr);
+            std::vector<BYTE> result;
+            hr = _callback(info.Message, result);
+            if (FAILED(hr))
+            {
+                _logger->Log(LogLevel::Warning, _LS("IpcMessage callback failed: 0x%08x"), hr);
+            }
+
+            for (auto& response : responses)
+            {
+                SendResponse(response.first, response.second, hr, result);
+            }
+
+            // The message and the result are done with, so their buffers can take the next request or result.
+            PayloadBufferPool::Shared().Return(info.Message.Payload);
+            PayloadBufferPool::Shared().Return(result);
         }
     }
 }
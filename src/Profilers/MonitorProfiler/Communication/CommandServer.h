@@ -5,16 +5,21 @@
 
 #include "IpcCommServer.h"
 #include "Messages.h"
+#include "PayloadBufferPool.h"
+#include "SharedRingBuffer.h"
 #include "cor.h"
 #include "corprof.h"
 #include "com.h"
 #include <functional>
+#include <map>
+#include <mutex>
 #include <string>
 #include <atomic>
 #include <thread>
-#include <future>
+#include <tuple>
 #include "Logging/Logger.h"
-#include "CommonUtilities/BlockingQueue.h"
+#include "CommonUtilities/BoundedQueue.h"
+#include "macros.h"
 
 class CommandServer final
 {
@@ -22,60 +27,134 @@ public:
     CommandServer(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo);
     HRESULT Start(
         const std::string& path,
-        std::function<HRESULT (const IpcMessage& message)> callback,
+        IpcMessageCallback callback,
         std::function<HRESULT (const IpcMessage& message)> validateMessageCallback,
         std::function<HRESULT (unsigned short commandSet, bool& unmanagedOnly)> unmanagedOnlyCallback);
     void Shutdown();
+    // Shares the ring with clients through ConnectionCommand::GetSharedRingBuffer. Must be called before Start.
+    void SetSharedRingBuffer(const std::shared_ptr<SharedRingBuffer>& ring) { _sharedRingBuffer = ring; }
+    // Threads that run callbacks for command sets that are not unmanaged only. Must be called before Start.
+    void SetClientWorkerCount(UINT32 count) { _clientWorkerCount = count > 0 ? count : 1; }
+
+    static constexpr UINT32 DefaultClientWorkerCount = 2;
 
 private:
+    class CoalescedRequest
+    {
+        public:
+            // Clients waiting for the status of the shared callback, with the request id to answer each with.
+            std::vector<std::pair<std::shared_ptr<IpcCommClient>, UINT32>> Responses;
+    };
+
     class CallbackInfo
     {
         public:
             IpcMessage Message;
-            std::shared_ptr<std::promise<HRESULT>> CompletionPromise;
+            // Set when the status is sent once the callback completes: for control commands, and for all commands
+            // on connections with ConnectionFlags::CompletionResponses.
+            std::shared_ptr<IpcCommClient> ResponseClient;
+            UINT32 RequestId = 0;
+            // Set for commands that identical requests can share while this one is queued. See IsCoalescedCommand.
+            std::shared_ptr<CoalescedRequest> Coalesced;
     };
 
+    // Keyed by command set, command and payload.
+    typedef std::tuple<unsigned short, unsigned short, std::vector<BYTE>> CoalescingKey;
+
     void ListeningThread();
-    void ProcessMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    // Connection commands are handled on the listening thread rather than dispatched to a callback.
+    void HandleConnectionMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    HRESULT OpenConnection(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    HRESULT SendSharedRingBuffer(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+
+    // Validates the message, queues it and sends the status response. Responses carry the request id of the message.
+    // Runs on the listening thread, so it must not block.
+    // Queued messages are moved from.
+    void HandleMessage(IpcMessage& message, std::shared_ptr<IpcCommClient> client);
+    void ProcessMessage(IpcMessage& message, std::shared_ptr<IpcCommClient> client);
     void ProcessResetMessage(const IpcMessage& message, std::shared_ptr<IpcCommClient> client);
     bool IsControlCommand(const IpcMessage& message);
+    // Commands without side effects beyond their result, so that identical requests that arrive while one is queued
+    // can share its callback. Requests are not joined once the callback has started, since EventPipe clients could
+    // otherwise miss events written before their request.
+    bool IsCoalescedCommand(const IpcMessage& message);
+    // Joins an identical queued request, or queues this one for others to join.
+    HRESULT EnqueueCoalesced(CallbackInfo& info, bool unmanagedOnly);
+    // Stops further requests from joining and returns the clients that joined.
+    void TakeCoalescedResponses(CallbackInfo& info, std::vector<std::pair<std::shared_ptr<IpcCommClient>, UINT32>>& responses);
 
     template<typename TCommand>
-    void CreateControlMessage(CommandSet commandSet, TCommand command, CallbackInfo& info)
+    HRESULT CreateControlMessage(CommandSet commandSet, TCommand command, CallbackInfo& info)
     {
+        HRESULT hr;
+
         info.Message.CommandSet = static_cast<unsigned short>(commandSet);
         info.Message.Command = static_cast<unsigned short>(command);
         // Currently the managed payload always uses json deserialization
         // The native payload ignores this
-        info.Message.Payload = std::vector<BYTE>({ (BYTE)'{', (BYTE)'}' });
-        info.CompletionPromise = std::make_shared<std::promise<HRESULT>>();
+        IfFailRet(PayloadBufferPool::Shared().Rent(2, info.Message.Payload));
+        info.Message.Payload[0] = (BYTE)'{';
+        info.Message.Payload[1] = (BYTE)'}';
+
+        return S_OK;
     }
 
     // Wrapper methods for sending and logging
-    HRESULT ReceiveMessage(std::shared_ptr<IpcCommClient> client, IpcMessage& message);
     HRESULT SendMessage(std::shared_ptr<IpcCommClient> client, const IpcMessage& message);
+    // Includes the result from resultOffset on.
+    HRESULT CreateStatusMessage(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result, size_t resultOffset, IpcMessage& response);
+    HRESULT SendStatus(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status);
+    // The result is only included for clients with ConnectionFlags::CompletionResponses. Results that do not fit in
+    // the status are sent with SendLargeResult.
+    HRESULT SendStatus(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result);
+    // Sends ServerResponseCommand::Data messages followed by the status. They are deferred to the IpcCommServer, which writes
+    // them as the client reads, so a client that is slow to read does not hold up the queue that ran the command.
+    HRESULT SendLargeResult(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result);
+    // Sends the status and closes connections that are not multiplexed.
+    HRESULT SendResponse(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status);
+    HRESULT SendResponse(std::shared_ptr<IpcCommClient> client, UINT32 requestId, HRESULT status, const std::vector<BYTE>& result);
     HRESULT Shutdown(std::shared_ptr<IpcCommClient> client);
 
-    void ProcessingThread(BlockingQueue<CallbackInfo>& queue);
+    // Requests beyond this are rejected with E_BUSY rather than buffered, since the listening thread cannot wait.
+    static constexpr size_t QueueCapacity = 256;
+    // Messages taken from the queue at once.
+    static constexpr size_t DequeueBatchSize = 16;
+    typedef BoundedQueue<CallbackInfo, QueueCapacity> CallbackQueue;
+
+    // Returns E_BUSY when the queue is full.
+    HRESULT Enqueue(CallbackInfo& info, bool unmanagedOnly);
+    HRESULT StartClientWorkers();
+    void ProcessingThread(CallbackQueue& queue);
+
+    // Keeps room for the HRESULT in the status that follows the data.
+    static constexpr size_t MaxStatusResultSize = IpcCommClient::MaxPayloadSize - sizeof(HRESULT);
 
     std::atomic_bool _shutdown;
 
-    std::function<HRESULT(const IpcMessage& message)> _callback;
+    IpcMessageCallback _callback;
     std::function<HRESULT(const IpcMessage& message)> _validateMessageCallback;
     std::function<HRESULT(unsigned short commandSet, bool& unmanagedOnly)> _unmanagedOnlyCallback;
 
     IpcCommServer _server;
 
-    // We allocates two queues and two threads to process messages.
     // UnmanagedOnlyQueue is dedicated to ICorProfiler api calls that cannot be called on threads that have previously invoked managed code, such as StackSnapshot.
     // Other command sets such as StartupHook call managed code and therefore interfere with StackSnapshot calls.
-    BlockingQueue<CallbackInfo> _clientQueue;
-    BlockingQueue<CallbackInfo> _unmanagedOnlyQueue;
+    // They are spread over a pool of client queues, each with its own thread. A command set always uses the same queue,
+    // so its commands run in order, while a slow command only delays the command sets that share its queue.
+    std::vector<std::unique_ptr<CallbackQueue>> _clientQueues;
+    CallbackQueue _unmanagedOnlyQueue;
+    UINT32 _clientWorkerCount = DefaultClientWorkerCount;
 
     std::shared_ptr<ILogger> _logger;
 
+    std::shared_ptr<SharedRingBuffer> _sharedRingBuffer;
+
+    // Coalesced requests that are queued but have not started.
+    std::mutex _coalescingMutex;
+    std::map<CoalescingKey, std::shared_ptr<CoalescedRequest>> _queuedRequests;
+
     std::thread _listeningThread;
-    std::thread _clientThread;
+    std::vector<std::thread> _clientThreads;
     std::thread _unmanagedOnlyThread;
 
     ComPtr<ICorProfilerInfo12> _profilerInfo;
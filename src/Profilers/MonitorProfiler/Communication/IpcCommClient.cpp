@@ -2,12 +2,34 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include "IpcCommClient.h"
+#include "PayloadBufferPool.h"
 #include <memory>
 #include "corhlpr.h"
 #include "macros.h"
 #include "assert.h"
 
+#if TARGET_LINUX
+// Disconnected clients should fail the send rather than raise SIGPIPE.
+#define IPC_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define IPC_SEND_FLAGS 0
+#endif
+
 HRESULT IpcCommClient::Receive(IpcMessage& message)
+{
+    HRESULT hr;
+    IfFailRet(TryReceive(message));
+
+    // Blocking sockets only come up short when the receive timeout expires.
+    if (hr == S_FALSE)
+    {
+        return HRESULT_FROM_WIN32(WAIT_TIMEOUT);
+    }
+
+    return S_OK;
+}
+
+HRESULT IpcCommClient::TryReceive(IpcMessage& message)
 {
     HRESULT hr;
 
@@ -21,62 +43,89 @@ HRESULT IpcCommClient::Receive(IpcMessage& message)
     }
 
     //CONSIDER It is generally more performant to read and buffer larger chunks, in this case we are not expecting very frequent communication.
-    char headersBuffer[sizeof(UINT16) + sizeof(UINT16) + sizeof(INT32)];
-    IfFailRet(ReceiveFixedBuffer(
-        headersBuffer,
-        sizeof(headersBuffer)
-    ));
+    int headersSize = GetHeadersSize();
+    if (_headersReceived < headersSize)
+    {
+        int received = 0;
+        hr = ReceiveAvailable(&_headersBuffer[_headersReceived], headersSize - _headersReceived, received);
+        _headersReceived += received;
+        IfFailRet(hr);
+        if (hr == S_FALSE)
+        {
+            return S_FALSE;
+        }
 
-    int headerOffset = 0;
+        int headerOffset = 0;
 
-    message.CommandSet = *reinterpret_cast<UINT16*>(&headersBuffer[headerOffset]);
-    headerOffset += sizeof(UINT16);
+        _receivedMessage.CommandSet = *reinterpret_cast<UINT16*>(&_headersBuffer[headerOffset]);
+        headerOffset += sizeof(UINT16);
 
-    message.Command = *reinterpret_cast<UINT16*>(&headersBuffer[headerOffset]);
-    headerOffset += sizeof(UINT16);
+        _receivedMessage.Command = *reinterpret_cast<UINT16*>(&_headersBuffer[headerOffset]);
+        headerOffset += sizeof(UINT16);
 
-    int payloadSize = *reinterpret_cast<INT32*>(&headersBuffer[headerOffset]);
-    headerOffset += sizeof(INT32);
+        int payloadSize = *reinterpret_cast<INT32*>(&_headersBuffer[headerOffset]);
+        headerOffset += sizeof(INT32);
 
-    assert(headerOffset == sizeof(headersBuffer));
+        _receivedMessage.RequestId = 0;
+        if (IsMultiplexed())
+        {
+            _receivedMessage.RequestId = *reinterpret_cast<UINT32*>(&_headersBuffer[headerOffset]);
+            headerOffset += sizeof(UINT32);
+        }
 
-    if (payloadSize < 0 || payloadSize > MaxPayloadSize)
-    {
-        return E_FAIL;
+        assert(headerOffset == headersSize);
+
+        if (payloadSize < 0 || payloadSize > MaxPayloadSize)
+        {
+            return E_FAIL;
+        }
+
+        IfFailRet(PayloadBufferPool::Shared().Rent(payloadSize, _receivedMessage.Payload));
     }
 
-    if (payloadSize != 0)
+    int payloadSize = static_cast<int>(_receivedMessage.Payload.size());
+    if (_payloadReceived < payloadSize)
     {
-        IfOomRetMem(message.Payload.resize(payloadSize));
-        IfFailRet(ReceiveFixedBuffer(
-            reinterpret_cast<char*>(message.Payload.data()),
-            payloadSize
-        ));
+        int received = 0;
+        hr = ReceiveAvailable(
+            reinterpret_cast<char*>(&_receivedMessage.Payload[_payloadReceived]),
+            payloadSize - _payloadReceived,
+            received);
+        _payloadReceived += received;
+        IfFailRet(hr);
+        if (hr == S_FALSE)
+        {
+            return S_FALSE;
+        }
     }
 
+    message = std::move(_receivedMessage);
+    _receivedMessage = IpcMessage();
+    _headersReceived = 0;
+    _payloadReceived = 0;
+
     return S_OK;
 }
 
-HRESULT IpcCommClient::ReceiveFixedBuffer(char* pBuffer, int bufferSize)
+int IpcCommClient::GetHeadersSize() const
+{
+    return IsMultiplexed() ? sizeof(_headersBuffer) : sizeof(_headersBuffer) - sizeof(UINT32);
+}
+
+HRESULT IpcCommClient::ReceiveAvailable(char* pBuffer, int bufferSize, int& received)
 {
     ExpectedPtr(pBuffer);
 
-    if (bufferSize == 0)
-    {
-        return S_OK;
-    }
+    received = 0;
 
     if (bufferSize < 0)
     {
         return E_FAIL;
     }
 
-    int read = 0;
-    int offset = 0;
-
-    do
+    while (received < bufferSize)
     {
-        int read = recv(_socket, &pBuffer[offset], bufferSize - offset, 0);
+        int read = recv(_socket, &pBuffer[received], bufferSize - received, 0);
         if (read == 0)
         {
             return E_ABORT;
@@ -90,16 +139,36 @@ HRESULT IpcCommClient::ReceiveFixedBuffer(char* pBuffer, int bufferSize)
                 continue;
             }
 #endif
+            if (SocketWrapper::IsWouldBlock())
+            {
+                return S_FALSE;
+            }
             return SocketWrapper::GetSocketError();
         }
-        offset += read;
-
-    } while (offset < bufferSize);
+        received += read;
+    }
 
     return S_OK;
 }
 
 HRESULT IpcCommClient::Send(const IpcMessage& message)
+{
+    return SendInternal(message, NoHandle);
+}
+
+#if TARGET_UNIX
+HRESULT IpcCommClient::SendWithHandle(const IpcMessage& message, int handle)
+{
+    if (handle == NoHandle)
+    {
+        return E_INVALIDARG;
+    }
+
+    return SendInternal(message, handle);
+}
+#endif
+
+HRESULT IpcCommClient::SendDeferred(const IpcMessage& message)
 {
     HRESULT hr;
 
@@ -117,58 +186,229 @@ HRESULT IpcCommClient::Send(const IpcMessage& message)
         return E_FAIL;
     }
 
-    char headersBuffer[sizeof(UINT16) + sizeof(UINT16) + sizeof(INT32)];
+    std::lock_guard<std::mutex> lock(_sendMutex);
 
+    if (_shutdownAfterSend)
+    {
+        return E_UNEXPECTED;
+    }
+
+    IfFailRet(QueueDeferred(message));
+
+    // The server only flushes once the socket becomes writable again, so a socket that already has room is written here.
+    IfFailRet(FlushPending());
+
+    return S_OK;
+}
+
+int IpcCommClient::WriteHeaders(const IpcMessage& message, char* pBuffer) const
+{
     int bufferOffset = 0;
 
-    *reinterpret_cast<UINT16*>(&headersBuffer[bufferOffset]) = message.CommandSet;
+    *reinterpret_cast<UINT16*>(&pBuffer[bufferOffset]) = message.CommandSet;
     bufferOffset += sizeof(UINT16);
 
-    *reinterpret_cast<UINT16*>(&headersBuffer[bufferOffset]) = message.Command;
+    *reinterpret_cast<UINT16*>(&pBuffer[bufferOffset]) = message.Command;
     bufferOffset += sizeof(UINT16);
 
-    int payloadSize = static_cast<int>(message.Payload.size());
-    *reinterpret_cast<INT32*>(&headersBuffer[bufferOffset]) = payloadSize;
+    *reinterpret_cast<INT32*>(&pBuffer[bufferOffset]) = static_cast<INT32>(message.Payload.size());
     bufferOffset += sizeof(INT32);
 
-    assert(bufferOffset == sizeof(headersBuffer));
+    if (IsMultiplexed())
+    {
+        *reinterpret_cast<UINT32*>(&pBuffer[bufferOffset]) = message.RequestId;
+        bufferOffset += sizeof(UINT32);
+    }
+
+    assert(bufferOffset == GetHeadersSize());
+
+    return bufferOffset;
+}
+
+HRESULT IpcCommClient::QueueDeferred(const IpcMessage& message)
+{
+    size_t size = GetHeadersSize() + message.Payload.size();
+    if (_deferredSendSize + size > MaxDeferredSendSize)
+    {
+        return E_OUTOFMEMORY;
+    }
 
-    IfFailRet(SendFixedBuffer(
-        headersBuffer,
-        sizeof(headersBuffer)));
+    std::vector<char> buffer;
+    IfOomRetMem(buffer.resize(size));
+    int headersSize = WriteHeaders(message, buffer.data());
+    if (!message.Payload.empty())
+    {
+        memcpy(&buffer[headersSize], message.Payload.data(), message.Payload.size());
+    }
 
-    IfFailRet(SendFixedBuffer(
-        reinterpret_cast<const char*>(message.Payload.data()),
-        payloadSize));
+    IfOomRetMem(_deferredSend.push_back(std::move(buffer)));
+    _deferredSendSize += size;
 
     return S_OK;
 }
 
-HRESULT IpcCommClient::SendFixedBuffer(const char* pBuffer, int bufferSize)
+HRESULT IpcCommClient::SendInternal(const IpcMessage& message, int handle)
 {
-    ExpectedPtr(pBuffer);
+    HRESULT hr;
 
-    if (bufferSize == 0)
+    if (_shutdown.load())
     {
-        return S_OK;
+        return E_UNEXPECTED;
+    }
+    if (!_socket.Valid())
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (message.Payload.size() > MaxPayloadSize)
+    {
+        return E_FAIL;
+    }
+
+    char headersBuffer[sizeof(_headersBuffer)];
+    int headersSize = WriteHeaders(message, headersBuffer);
+
+    int payloadSize = static_cast<int>(message.Payload.size());
+    const char* pPayload = reinterpret_cast<const char*>(message.Payload.data());
+
+    std::lock_guard<std::mutex> lock(_sendMutex);
+
+    if (_shutdownAfterSend)
+    {
+        return E_UNEXPECTED;
+    }
+
+    // Messages stay in the order they were sent, so they wait behind deferred ones.
+    if (!_deferredSend.empty())
+    {
+        if (handle != NoHandle)
+        {
+            return E_PENDING;
+        }
+        return QueueDeferred(message);
     }
 
+    int headersSent = 0;
+    int payloadSent = 0;
+
+    // Data can only be written directly when nothing is queued ahead of it.
+    if (_pendingSend.size() == _pendingSendOffset)
+    {
+#if TARGET_UNIX
+        if (handle != NoHandle)
+        {
+            // The handle travels with the first byte, so that byte cannot be left for Flush.
+            IfFailRet(SendHandle(headersBuffer, headersSize, handle, headersSent));
+            if (headersSent == 0)
+            {
+                return E_PENDING;
+            }
+        }
+#endif
+
+        int sent = 0;
+        IfFailRet(SendAvailable(&headersBuffer[headersSent], headersSize - headersSent, sent));
+        headersSent += sent;
+        if (hr == S_OK && payloadSize != 0)
+        {
+            IfFailRet(SendAvailable(pPayload, payloadSize, payloadSent));
+        }
+    }
+    else if (handle != NoHandle)
+    {
+        return E_PENDING;
+    }
+
+    size_t remaining = (headersSize - headersSent) + (payloadSize - payloadSent);
+    if (remaining != 0)
+    {
+        if (_pendingSend.size() - _pendingSendOffset + remaining > MaxPendingSendSize)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        IfOomRetMem(_pendingSend.insert(_pendingSend.end(), &headersBuffer[headersSent], &headersBuffer[headersSize]));
+        if (payloadSize != 0)
+        {
+            IfOomRetMem(_pendingSend.insert(_pendingSend.end(), &pPayload[payloadSent], &pPayload[payloadSize]));
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT IpcCommClient::Flush()
+{
+    std::lock_guard<std::mutex> lock(_sendMutex);
+    return FlushPending();
+}
+
+HRESULT IpcCommClient::FlushPending()
+{
+    HRESULT hr;
+
+    while (true)
+    {
+        if (_pendingSend.size() != _pendingSendOffset)
+        {
+            int sent = 0;
+            hr = SendAvailable(&_pendingSend[_pendingSendOffset], static_cast<int>(_pendingSend.size() - _pendingSendOffset), sent);
+            _pendingSendOffset += sent;
+            IfFailRet(hr);
+            if (hr == S_FALSE)
+            {
+                return S_FALSE;
+            }
+        }
+
+        _pendingSend.clear();
+        _pendingSendOffset = 0;
+
+        if (_deferredSend.empty())
+        {
+            break;
+        }
+
+        // Each deferred message becomes the pending data once everything ahead of it has been written.
+        _pendingSend = std::move(_deferredSend.front());
+        _deferredSend.pop_front();
+        _deferredSendSize -= _pendingSend.size();
+    }
+
+    if (_shutdownAfterSend)
+    {
+        IfFailRet(ShutdownSocket());
+    }
+
+    return S_OK;
+}
+
+bool IpcCommClient::HasPendingSend()
+{
+    std::lock_guard<std::mutex> lock(_sendMutex);
+    return _pendingSend.size() != _pendingSendOffset || !_deferredSend.empty();
+}
+
+HRESULT IpcCommClient::SendAvailable(const char* pBuffer, int bufferSize, int& sent)
+{
+    ExpectedPtr(pBuffer);
+
+    sent = 0;
+
     if (bufferSize < 0)
     {
         return E_FAIL;
     }
 
-    int sent = 0;
-    int offset = 0;
-    do
+    while (sent < bufferSize)
     {
-        sent = send(_socket, &pBuffer[offset], bufferSize - offset, 0);
+        int written = send(_socket, &pBuffer[sent], bufferSize - sent, IPC_SEND_FLAGS);
 
-        if (sent == 0)
+        if (written == 0)
         {
             return E_ABORT;
         }
-        if (sent < 0)
+        if (written < 0)
         {
 #if TARGET_UNIX
             if (errno == EINTR)
@@ -177,15 +417,93 @@ HRESULT IpcCommClient::SendFixedBuffer(const char* pBuffer, int bufferSize)
                 continue;
             }
 #endif
+            if (SocketWrapper::IsWouldBlock())
+            {
+                return S_FALSE;
+            }
             return SocketWrapper::GetSocketError();
         }
-        offset += sent;
-    } while (offset < bufferSize);
+        sent += written;
+    }
 
     return S_OK;
 }
 
+#if TARGET_UNIX
+HRESULT IpcCommClient::SendHandle(const char* pBuffer, int bufferSize, int handle, int& sent)
+{
+    ExpectedPtr(pBuffer);
+
+    sent = 0;
+
+    iovec data;
+    data.iov_base = const_cast<char*>(pBuffer);
+    data.iov_len = bufferSize;
+
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control.buffer;
+    header.msg_controllen = sizeof(control.buffer);
+
+    cmsghdr* controlHeader = CMSG_FIRSTHDR(&header);
+    controlHeader->cmsg_level = SOL_SOCKET;
+    controlHeader->cmsg_type = SCM_RIGHTS;
+    controlHeader->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(controlHeader), &handle, sizeof(int));
+
+    while (true)
+    {
+        ssize_t written = sendmsg(_socket, &header, IPC_SEND_FLAGS);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                //Signal can interrupt operations. Try again.
+                continue;
+            }
+            if (SocketWrapper::IsWouldBlock())
+            {
+                return S_FALSE;
+            }
+            return SocketWrapper::GetSocketError();
+        }
+
+        sent = static_cast<int>(written);
+        return sent == bufferSize ? S_OK : S_FALSE;
+    }
+}
+#endif
+
 HRESULT IpcCommClient::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(_sendMutex);
+    return ShutdownSocket();
+}
+
+HRESULT IpcCommClient::ShutdownAfterSend()
+{
+    std::lock_guard<std::mutex> lock(_sendMutex);
+
+    _shutdownAfterSend = true;
+    if (_pendingSend.size() == _pendingSendOffset && _deferredSend.empty())
+    {
+        return ShutdownSocket();
+    }
+
+    // Flush shuts down the socket once the pending data is written.
+    return S_OK;
+}
+
+HRESULT IpcCommClient::ShutdownSocket()
 {
     _shutdown.store(true);
     int result = shutdown(_socket,
@@ -203,6 +521,15 @@ HRESULT IpcCommClient::Shutdown()
     return S_OK;
 }
 
-IpcCommClient::IpcCommClient(SOCKET socket) : _socket(socket), _shutdown(false)
+IpcCommClient::IpcCommClient(SOCKET socket) :
+    _socket(socket),
+    _shutdown(false),
+    _multiplexed(false),
+    _connectionFlags(0),
+    _headersReceived(0),
+    _payloadReceived(0),
+    _pendingSendOffset(0),
+    _deferredSendSize(0),
+    _shutdownAfterSend(false)
 {
 }
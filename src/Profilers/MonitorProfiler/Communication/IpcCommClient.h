@@ -6,24 +6,86 @@
 #include "SocketWrapper.h"
 #include "Messages.h"
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 class IpcCommClient
 {
     friend class IpcCommServer;
 public:
     HRESULT Receive(IpcMessage& message);
+    // Receives without waiting for more data than the socket already has. Returns S_FALSE when the message is incomplete;
+    // the partial message is kept and the next call resumes it.
+    HRESULT TryReceive(IpcMessage& message);
+    // Sends the message, or as much as the socket accepts; the rest is written by Flush.
+    // Messages sent from different threads are never interleaved.
     HRESULT Send(const IpcMessage& message);
+#if TARGET_UNIX
+    // Sends the message with a duplicate of handle attached as SCM_RIGHTS ancillary data.
+    // Returns E_PENDING when earlier messages have not been flushed yet, since the handle cannot be queued.
+    HRESULT SendWithHandle(const IpcMessage& message, int handle);
+#endif
+    // Writes data left over from Send, followed by deferred messages. Returns S_FALSE when the socket still cannot accept all of it.
+    HRESULT Flush();
+    // Queues the message behind everything sent before it and returns without waiting for the socket. Flush, called by
+    // the IpcCommServer as the client reads, moves each deferred message to the socket once the data ahead of it is written.
+    // Returns E_OUTOFMEMORY when more than MaxDeferredSendSize would be queued.
+    HRESULT SendDeferred(const IpcMessage& message);
     HRESULT Shutdown();
+    // Shuts down once all sent data has been flushed.
+    HRESULT ShutdownAfterSend();
+    // Multiplexed connections carry a request id after each message header. See ConnectionCommand::Multiplex.
+    void SetMultiplexed(bool multiplexed) { _multiplexed.store(multiplexed); }
+    bool IsMultiplexed() const { return _multiplexed.load(); }
+    // ConnectionFlags requested by the client. Interpreted by the CommandServer; they do not affect framing.
+    void SetConnectionFlags(UINT32 flags) { _connectionFlags.store(flags); }
+    bool HasConnectionFlag(ConnectionFlags flag) const { return (_connectionFlags.load() & static_cast<UINT32>(flag)) != 0; }
+    UINT32 GetConnectionFlags() const { return _connectionFlags.load(); }
     IpcCommClient(SOCKET socket);
 
+    static constexpr int MaxPayloadSize = 4 * 1024 * 1024; // 4 MiB
+
 private:
-    HRESULT ReceiveFixedBuffer(char* pBuffer, int bufferSize);
-    HRESULT SendFixedBuffer(const char* pBuffer, int bufferSize);
+    int GetHeadersSize() const;
+    bool HasPendingSend();
+    // Returns the size of the headers written to pBuffer, which must hold sizeof(_headersBuffer) bytes.
+    int WriteHeaders(const IpcMessage& message, char* pBuffer) const;
+    // The callers below hold _sendMutex.
+    HRESULT QueueDeferred(const IpcMessage& message);
+    HRESULT FlushPending();
+    HRESULT ReceiveAvailable(char* pBuffer, int bufferSize, int& received);
+    HRESULT SendInternal(const IpcMessage& message, int handle);
+    HRESULT SendAvailable(const char* pBuffer, int bufferSize, int& sent);
+#if TARGET_UNIX
+    HRESULT SendHandle(const char* pBuffer, int bufferSize, int handle, int& sent);
+#endif
+    HRESULT ShutdownSocket();
 
 private:
     SocketWrapper _socket;
     std::atomic_bool _shutdown;
+    std::atomic_bool _multiplexed;
+    std::atomic<UINT32> _connectionFlags;
+
+    // State of a partially received message.
+    char _headersBuffer[sizeof(UINT16) + sizeof(UINT16) + sizeof(INT32) + sizeof(UINT32)];
+    int _headersReceived;
+    int _payloadReceived;
+    IpcMessage _receivedMessage;
+
+    std::mutex _sendMutex;
+    std::vector<char> _pendingSend;
+    size_t _pendingSendOffset;
+    // Serialized messages from SendDeferred, and those sent after them.
+    std::deque<std::vector<char>> _deferredSend;
+    size_t _deferredSendSize;
+    bool _shutdownAfterSend;
 
 private:
-    static constexpr int MaxPayloadSize = 4 * 1024 * 1024; // 4 MiB
+    static constexpr int NoHandle = -1;
+    // Clients that stop reading responses are disconnected rather than buffered indefinitely.
+    static constexpr size_t MaxPendingSendSize = 2 * MaxPayloadSize;
+    // Deferred results are not waited on, so the limit leaves room for several large results.
+    static constexpr size_t MaxDeferredSendSize = 16 * MaxPayloadSize;
 };
@@ -6,12 +6,31 @@
 #include "Logging/Logger.h"
 #include "CommonUtilities/StringUtilities.h"
 
+#if TARGET_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#elif TARGET_WINDOWS
+#define poll WSAPoll
+#endif
+
 IpcCommServer::IpcCommServer(const std::shared_ptr<ILogger>& logger) : _shutdown(false), _logger(logger)
 {
 }
 
 IpcCommServer::~IpcCommServer()
 {
+    _clients.clear();
+#if TARGET_LINUX
+    if (_epollFd >= 0)
+    {
+        close(_epollFd);
+    }
+    if (_wakeFd >= 0)
+    {
+        close(_wakeFd);
+    }
+#endif
+
     //We explicitly run the destructor first so that it can call closesocket prior to deletion of the path.
     _domainSocket.~SocketWrapper();
     std::remove(_rootAddress.c_str());
@@ -63,51 +82,140 @@ HRESULT IpcCommServer::Bind(const std::string& rootAddress)
         return SocketWrapper::GetSocketError();
     }
 
+#if TARGET_LINUX
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0)
+    {
+        return SocketWrapper::GetSocketError();
+    }
+
+    // Written by Shutdown to wake the loop immediately.
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeFd < 0)
+    {
+        return SocketWrapper::GetSocketError();
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = _wakeFd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &event) != 0)
+    {
+        return SocketWrapper::GetSocketError();
+    }
+
+    // Edge triggered, so AcceptClients accepts until the backlog is empty.
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = _domainSocket;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _domainSocket, &event) != 0)
+    {
+        return SocketWrapper::GetSocketError();
+    }
+#endif
+
     return S_OK;
 }
 
-HRESULT IpcCommServer::Accept(std::shared_ptr<IpcCommClient>& client)
+HRESULT IpcCommServer::Run(const MessageCallback& callback)
 {
-    if (_shutdown.load())
-    {
-        return E_UNEXPECTED;
-    }
+    HRESULT hr = S_OK;
+
     if (!_domainSocket.Valid())
     {
         return E_UNEXPECTED;
     }
 
-    int result = 0;
-
-    do
+    while (!_shutdown.load())
     {
-#if TARGET_WINDOWS
+        hr = S_OK;
+
+#if TARGET_LINUX
+        const int MaxEvents = 64;
+        epoll_event events[MaxEvents];
+
+        int count = epoll_wait(_epollFd, events, MaxEvents, GetWaitTimeout());
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            hr = SocketWrapper::GetSocketError();
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            SOCKET socket = events[i].data.fd;
+            if (socket == _wakeFd)
+            {
+                continue;
+            }
+            if (socket == _domainSocket)
+            {
+                hr = AcceptClients();
+                if (FAILED(hr))
+                {
+                    break;
+                }
+                continue;
+            }
 
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(_domainSocket, &set);
+            auto const& it = _clients.find(socket);
+            if (it == _clients.end())
+            {
+                continue;
+            }
 
-        TIMEVAL timeout;
-        timeout.tv_sec = AcceptTimeoutSeconds;
-        timeout.tv_usec = 0;
-        result = select(0, &set, nullptr, nullptr, &timeout);
+            ClientState& state = it->second;
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0)
+            {
+                RemoveClient(socket);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) != 0 && FAILED(state.Client->Flush()))
+            {
+                RemoveClient(socket);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) != 0 && state.Receiving && !state.Ready)
+            {
+                state.Ready = true;
+                _readyClients.push_back(socket);
+            }
+        }
 #else
         //select has limitations on Linux; any descriptor value over 1024 is ignored.
+        std::vector<pollfd> set;
+        set.reserve(_clients.size() + 1);
 
-        pollfd set[1];
-        set[0].fd = _domainSocket;
-        set[0].events = POLLIN;
-        set[0].revents = 0;
+        pollfd listener;
+        listener.fd = _domainSocket;
+        listener.events = POLLIN;
+        listener.revents = 0;
+        set.push_back(listener);
 
-        result = poll(set, 1, AcceptTimeoutSeconds * 1000);
-#endif
-        if (_shutdown.load())
+        for (auto& client : _clients)
         {
-            return E_ABORT;
+            pollfd entry;
+            entry.fd = client.first;
+            entry.events = 0;
+            entry.revents = 0;
+            if (client.second.Receiving && !client.second.Ready)
+            {
+                entry.events |= POLLIN;
+            }
+            if (client.second.Client->HasPendingSend())
+            {
+                entry.events |= POLLOUT;
+            }
+            set.push_back(entry);
         }
 
-        //0 indicates timeout
-        if (result < 0)
+        int timeout = _readyClients.empty() ? PollIntervalMilliseconds : 0;
+        int count = poll(set.data(), static_cast<ULONG>(set.size()), timeout);
+        if (count < 0)
         {
 #if TARGET_UNIX
             if (errno == EINTR)
@@ -115,41 +223,231 @@ HRESULT IpcCommServer::Accept(std::shared_ptr<IpcCommClient>& client)
                 continue;
             }
 #endif
-            return SocketWrapper::GetSocketError();
+            hr = SocketWrapper::GetSocketError();
+            break;
         }
-    } while (result <= 0);
 
-    SocketWrapper clientSocket = SocketWrapper(accept(_domainSocket, nullptr, nullptr));
-    if (!clientSocket.Valid())
-    {
-        return SocketWrapper::GetSocketError();
+        if ((set[0].revents & POLLIN) != 0)
+        {
+            hr = AcceptClients();
+        }
+
+        for (size_t i = 1; i < set.size(); i++)
+        {
+            if (set[i].revents == 0)
+            {
+                continue;
+            }
+
+            SOCKET socket = set[i].fd;
+            ClientState& state = _clients[socket];
+            if ((set[i].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0 && (set[i].revents & POLLIN) == 0)
+            {
+                RemoveClient(socket);
+                continue;
+            }
+            if ((set[i].revents & POLLOUT) != 0 && FAILED(state.Client->Flush()))
+            {
+                RemoveClient(socket);
+                continue;
+            }
+            if ((set[i].revents & POLLIN) != 0 && !state.Ready)
+            {
+                state.Ready = true;
+                _readyClients.push_back(socket);
+            }
+        }
+#endif
+
+        if (FAILED(hr))
+        {
+            _logger->Log(LogLevel::Error, _LS("Failed to accept client: 0x%08x"), hr);
+            break;
+        }
+
+        // Give each ready client a turn. Clients that still have data after their turn go to the back of the line.
+        std::vector<SOCKET> readyClients;
+        readyClients.swap(_readyClients);
+        for (SOCKET socket : readyClients)
+        {
+            auto const& it = _clients.find(socket);
+            if (it == _clients.end())
+            {
+                continue;
+            }
+
+            ClientState& state = it->second;
+            state.Ready = false;
+            if (FAILED(ReceiveMessages(state, callback)))
+            {
+                RemoveClient(socket);
+            }
+            else if (state.Ready)
+            {
+                _readyClients.push_back(socket);
+            }
+        }
+
+        ExpireClients();
     }
 
-#if TARGET_WINDOWS
-    DWORD receiveTimeout = ReceiveTimeoutMilliseconds;
+    RemoveAllClients();
 
-    HRESULT hr;
+    return _shutdown.load() ? S_OK : hr;
+}
 
-    //Windows sockets inherit non-blocking
-    IfFailRet(clientSocket.SetBlocking(true));
+HRESULT IpcCommServer::AcceptClients()
+{
+    HRESULT hr;
 
+    while (true)
+    {
+#if TARGET_LINUX
+        SocketWrapper clientSocket = SocketWrapper(accept4(_domainSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
 #else
-    TIMEVAL receiveTimeout;
-    receiveTimeout.tv_sec = ReceiveTimeoutMilliseconds / 1000;
-    receiveTimeout.tv_usec = 0;
+        SocketWrapper clientSocket = SocketWrapper(accept(_domainSocket, nullptr, nullptr));
+#endif
+        if (!clientSocket.Valid())
+        {
+            if (SocketWrapper::IsWouldBlock())
+            {
+                return S_OK;
+            }
+#if TARGET_UNIX
+            // The client disconnected before it was accepted, or a signal interrupted the call.
+            if (errno == ECONNABORTED || errno == EINTR)
+            {
+                continue;
+            }
 #endif
+            return SocketWrapper::GetSocketError();
+        }
 
-    if (setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&receiveTimeout), sizeof(receiveTimeout)) != 0)
-    {
-        return SocketWrapper::GetSocketError();
+#if !TARGET_LINUX
+        //Windows sockets inherit non-blocking, but other platforms do not
+        IfFailRet(clientSocket.SetBlocking(false));
+#endif
+
+        SOCKET socket = clientSocket;
+
+#if TARGET_LINUX
+        // Edge triggered, so each notification is followed by reading or writing until the socket would block.
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = socket;
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, socket, &event) != 0)
+        {
+            return SocketWrapper::GetSocketError();
+        }
+#endif
+
+        ClientState state;
+        state.Client = std::make_shared<IpcCommClient>(clientSocket.Release());
+        state.ReceiveDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ReceiveTimeoutMilliseconds);
+        _clients[socket] = std::move(state);
     }
+}
 
-    client = std::make_shared<IpcCommClient>(clientSocket.Release());
+HRESULT IpcCommServer::ReceiveMessages(ClientState& state, const MessageCallback& callback)
+{
+    HRESULT hr;
+
+    for (int i = 0; i < MaxMessagesPerTurn && state.Receiving; i++)
+    {
+        IpcMessage message;
+        IfFailRet(state.Client->TryReceive(message));
+        if (hr == S_FALSE)
+        {
+            return S_OK;
+        }
 
+        // Messages no longer need to arrive within the timeout once the client has sent one.
+        state.ReceiveDeadline = std::chrono::steady_clock::time_point::max();
+
+        callback(state.Client, message);
+
+        // The callback switches connections that stay open to multiplexed framing.
+        state.Receiving = state.Client->IsMultiplexed();
+    }
+
+    state.Ready = state.Receiving;
     return S_OK;
 }
 
+void IpcCommServer::RemoveClient(SOCKET socket)
+{
+    auto const& it = _clients.find(socket);
+    if (it == _clients.end())
+    {
+        return;
+    }
+
+#if TARGET_LINUX
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, socket, nullptr);
+#endif
+
+    // Best-effort shutdown, ignore the result. The socket stays open until all references to the client are released.
+    it->second.Client->Shutdown();
+    _clients.erase(it);
+}
+
+void IpcCommServer::RemoveAllClients()
+{
+    while (!_clients.empty())
+    {
+        RemoveClient(_clients.begin()->first);
+    }
+    _readyClients.clear();
+}
+
+void IpcCommServer::ExpireClients()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    std::vector<SOCKET> expired;
+    for (auto& client : _clients)
+    {
+        if (now >= client.second.ReceiveDeadline)
+        {
+            expired.push_back(client.first);
+        }
+    }
+
+    for (SOCKET socket : expired)
+    {
+        _logger->Log(LogLevel::Warning, _LS("Closing connection that did not send a message in time."));
+        RemoveClient(socket);
+    }
+}
+
+int IpcCommServer::GetWaitTimeout() const
+{
+    if (!_readyClients.empty())
+    {
+        return 0;
+    }
+
+    // Only clients that have not sent a message yet can expire.
+    for (auto& client : _clients)
+    {
+        if (client.second.ReceiveDeadline != std::chrono::steady_clock::time_point::max())
+        {
+            return ExpirationIntervalMilliseconds;
+        }
+    }
+
+    return -1;
+}
+
 void IpcCommServer::Shutdown()
 {
     _shutdown.store(true);
+
+#if TARGET_LINUX
+    if (_wakeFd >= 0)
+    {
+        eventfd_write(_wakeFd, 1);
+    }
+#endif
 }
@@ -6,25 +6,72 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 #include "SocketWrapper.h"
 #include "IpcCommClient.h"
 #include "Logging/Logger.h"
 
+/// <summary>
+/// Services all clients from a single thread using non-blocking sockets; epoll on Linux and poll elsewhere.
+/// Partially received messages and unsent responses are kept per client, so a slow client never holds up the others.
+/// </summary>
 class IpcCommServer
 {
 public:
+    // Invoked on the Run thread for each received message. Must not block, since it holds up every client.
+    // The callback may move from the message.
+    typedef std::function<void (const std::shared_ptr<IpcCommClient>& client, IpcMessage& message)> MessageCallback;
+
     IpcCommServer(const std::shared_ptr<ILogger>& logger);
     ~IpcCommServer();
     HRESULT Bind(const std::string& rootAddress);
-    HRESULT Accept(std::shared_ptr<IpcCommClient>& client);
+    // Accepts clients and dispatches their messages until Shutdown is called.
+    HRESULT Run(const MessageCallback& callback);
     void Shutdown();
+
+private:
+    class ClientState
+    {
+        public:
+            std::shared_ptr<IpcCommClient> Client;
+            // Connections that are not multiplexed are only read until their single message arrives.
+            bool Receiving = true;
+            // Set when the client may have more data than was read during its last turn.
+            bool Ready = false;
+            std::chrono::steady_clock::time_point ReceiveDeadline;
+    };
+
+    HRESULT AcceptClients();
+    HRESULT ReceiveMessages(ClientState& state, const MessageCallback& callback);
+    void RemoveClient(SOCKET socket);
+    void RemoveAllClients();
+    void ExpireClients();
+    int GetWaitTimeout() const;
+
 private:
     const int ReceiveTimeoutMilliseconds = 10000;
-    const int AcceptTimeoutSeconds = 3;
+    const int ExpirationIntervalMilliseconds = 1000;
+#if !TARGET_LINUX
+    // poll cannot be woken by another thread, so unsent data and shutdown are checked at this interval.
+    const int PollIntervalMilliseconds = 50;
+#endif
+    // Limits how long one client can keep the loop busy before others are serviced.
+    const int MaxMessagesPerTurn = 16;
     const int Backlog = 20;
     std::string _rootAddress;
     SocketWrapper _domainSocket = 0;
+#if TARGET_LINUX
+    int _epollFd = -1;
+    int _wakeFd = -1;
+#endif
     std::atomic_bool _shutdown;
     std::shared_ptr<ILogger> _logger;
+
+    // Only accessed from the Run thread.
+    std::unordered_map<SOCKET, ClientState> _clients;
+    std::vector<SOCKET> _readyClients;
 };
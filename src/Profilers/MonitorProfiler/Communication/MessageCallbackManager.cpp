@@ -2,66 +2,107 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include "MessageCallbackManager.h"
+#include "corhlpr.h"
+#include "macros.h"
 
-bool MessageCallbackManager::IsRegistered(unsigned short commandSet)
+MessageCallbackManager::MessageCallbackManager() :
+    m_callbacks(std::make_shared<const CallbackTable>())
 {
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+}
 
-    std::function<HRESULT (const IpcMessage& message)> existingCallback;
-    return TryGetCallback(commandSet, existingCallback);
+bool MessageCallbackManager::IsRegistered(unsigned short commandSet)
+{
+    std::shared_ptr<CallbackEntry> entry;
+    return TryGetEntry(commandSet, entry);
 }
 
 bool MessageCallbackManager::TryRegister(unsigned short commandSet, ManagedMessageCallback pCallback)
 {
-    return TryRegister(commandSet, [pCallback](const IpcMessage& message)-> HRESULT
+    return TryRegister(commandSet, [pCallback](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT
     {
         return pCallback(message.Command, message.Payload.data(), message.Payload.size());
     }, false);
 }
 
-bool MessageCallbackManager::TryRegister(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)> callback, bool unmanagedOnly)
+bool MessageCallbackManager::TryRegister(unsigned short commandSet, IpcMessageCallback callback, bool unmanagedOnly)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+    return Register(commandSet, callback, unmanagedOnly) == S_OK;
+}
 
-    std::function<HRESULT (const IpcMessage& message)> existingCallback;
-    if (TryGetCallback(commandSet, existingCallback))
+HRESULT MessageCallbackManager::Register(unsigned short commandSet, IpcMessageCallback callback, bool unmanagedOnly)
+{
+    std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+
+    std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+    if (callbacks->find(commandSet) != callbacks->end())
     {
-        return false;
+        return S_FALSE;
     }
 
-    m_callbacks[commandSet] = CallbackInfo(unmanagedOnly, callback);
-    return true;
+    std::shared_ptr<CallbackTable> updatedCallbacks;
+    IfOomRetMem(updatedCallbacks = std::make_shared<CallbackTable>(*callbacks));
+    IfOomRetMem((*updatedCallbacks)[commandSet] = std::make_shared<CallbackEntry>(CallbackInfo(unmanagedOnly, callback)));
+
+    std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackTable>(std::move(updatedCallbacks)));
+    return S_OK;
 }
 
-HRESULT MessageCallbackManager::DispatchMessage(const IpcMessage& message)
+HRESULT MessageCallbackManager::DispatchMessage(const IpcMessage& message, std::vector<BYTE>& result)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-
-    std::function<HRESULT (const IpcMessage& message)> callback;
-    if (!TryGetCallback(message.CommandSet, callback))
+    std::shared_ptr<CallbackEntry> entry;
+    if (!TryGetEntry(message.CommandSet, entry) || !entry->TryBeginDispatch())
     {
         return E_FAIL;
     }
 
-    return callback(message);
+    HRESULT hr = entry->Info.Callback(message, result);
+    entry->EndDispatch();
+
+    return hr;
 }
 
 void MessageCallbackManager::Unregister(unsigned short commandSet)
 {
-    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+    std::shared_ptr<CallbackEntry> entry;
+    if (!TryGetEntry(commandSet, entry))
+    {
+        return;
+    }
 
-    m_callbacks.erase(commandSet);
+    // Without memory for a new table the entry stays registered, but still stops dispatching.
+    RemoveEntry(commandSet, entry);
+
+    // Dispatches that found the entry before it was removed may still be running it.
+    entry->Unregister();
 }
 
-bool MessageCallbackManager::TryGetCallback(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)>& callback)
+HRESULT MessageCallbackManager::RemoveEntry(unsigned short commandSet, const std::shared_ptr<CallbackEntry>& entry)
 {
-    // Do not lock here, this method is private and it's the responsibility of the caller to lock
-    auto const& it = m_callbacks.find(commandSet);
-    if (it != m_callbacks.end())
+    std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+
+    // The entry may have been removed, and even replaced, since it was looked up.
+    std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+    auto const& it = callbacks->find(commandSet);
+    if (it == callbacks->end() || it->second != entry)
     {
-        callback = it->second.Callback;
+        return S_FALSE;
+    }
+
+    std::shared_ptr<CallbackTable> updatedCallbacks;
+    IfOomRetMem(updatedCallbacks = std::make_shared<CallbackTable>(*callbacks));
+    updatedCallbacks->erase(commandSet);
+
+    std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackTable>(std::move(updatedCallbacks)));
+    return S_OK;
+}
+
+bool MessageCallbackManager::TryGetEntry(unsigned short commandSet, std::shared_ptr<CallbackEntry>& entry)
+{
+    std::shared_ptr<const CallbackTable> callbacks = std::atomic_load(&m_callbacks);
+    auto const& it = callbacks->find(commandSet);
+    if (it != callbacks->end())
+    {
+        entry = it->second;
         return true;
     }
 
@@ -70,13 +111,41 @@ bool MessageCallbackManager::TryGetCallback(unsigned short commandSet, std::func
 
 HRESULT MessageCallbackManager::UnmanagedOnly(unsigned short commandSet, bool& unmanagedOnly)
 {
-    std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
-
-    auto const& it = m_callbacks.find(commandSet);
-    if (it != m_callbacks.end())
+    std::shared_ptr<CallbackEntry> entry;
+    if (TryGetEntry(commandSet, entry))
     {
-        unmanagedOnly = it->second.UnmanagedOnly;
+        unmanagedOnly = entry->Info.UnmanagedOnly;
         return S_OK;
     }
     return E_FAIL;
 }
+
+bool MessageCallbackManager::CallbackEntry::TryBeginDispatch()
+{
+    // Pairs with Unregister: either the flag is seen here, or the dispatch is seen there.
+    ActiveDispatches.fetch_add(1);
+    if (Unregistered.load())
+    {
+        EndDispatch();
+        return false;
+    }
+
+    return true;
+}
+
+void MessageCallbackManager::CallbackEntry::EndDispatch()
+{
+    if (ActiveDispatches.fetch_sub(1) == 1 && Unregistered.load())
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        DispatchesCompleted.notify_all();
+    }
+}
+
+void MessageCallbackManager::CallbackEntry::Unregister()
+{
+    Unregistered.store(true);
+
+    std::unique_lock<std::mutex> lock(Mutex);
+    DispatchesCompleted.wait(lock, [this]() { return ActiveDispatches.load() == 0; });
+}
@@ -3,9 +3,12 @@
 
 #pragma once
 
-#include <unordered_map>
-#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "cor.h"
 #include "corprof.h"
 #include "Messages.h"
@@ -15,35 +18,67 @@ typedef HRESULT (STDMETHODCALLTYPE *ManagedMessageCallback)(UINT16, const BYTE*,
 struct CallbackInfo
 {
     CallbackInfo() = default;
-    CallbackInfo(bool unmanagedOnly, std::function<HRESULT (const IpcMessage& message)> callback) 
+    CallbackInfo(bool unmanagedOnly, IpcMessageCallback callback) 
         : UnmanagedOnly(unmanagedOnly), Callback(callback)
     {
     }
 
     bool UnmanagedOnly = false;
-    std::function<HRESULT (const IpcMessage& message)> Callback;
+    IpcMessageCallback Callback;
 };
 
 class MessageCallbackManager
 {
     public:
-        HRESULT DispatchMessage(const IpcMessage& message);
+        MessageCallbackManager();
+
+        // Command sets dispatch concurrently; a callback only holds up other messages for its own command set.
+        HRESULT DispatchMessage(const IpcMessage& message, std::vector<BYTE>& result);
         bool IsRegistered(unsigned short commandSet);
 
         // Some callbacks, such as the profiler, must run on their own thread due to ICorProfiler API restrictions.
         // Setting unmanagedOnly to true will queue the work from the command set to a separate thread.
-        bool TryRegister(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)> callback, bool unmanagedOnly);
+        bool TryRegister(unsigned short commandSet, IpcMessageCallback callback, bool unmanagedOnly);
         bool TryRegister(unsigned short commandSet, ManagedMessageCallback pCallback);
+        // Waits for dispatches already running the callback, so that it can be freed once this returns.
+        // Must not be called from the callback itself.
         void Unregister(unsigned short commandSet);
         HRESULT UnmanagedOnly(unsigned short commandSet, bool& unmanagedOnly);
     private:
-        bool TryGetCallback(unsigned short commandSet, std::function<HRESULT (const IpcMessage& message)>& callback);
-        std::unordered_map<unsigned short, CallbackInfo> m_callbacks;
+        class CallbackEntry
+        {
+            public:
+                CallbackEntry(const CallbackInfo& info) : Info(info), ActiveDispatches(0), Unregistered(false)
+                {
+                }
+
+                // Returns false once the entry is unregistered. Successful calls must be paired with EndDispatch.
+                bool TryBeginDispatch();
+                void EndDispatch();
+                void Unregister();
+
+                const CallbackInfo Info;
+
+            private:
+                std::atomic<int> ActiveDispatches;
+                std::atomic_bool Unregistered;
+                std::mutex Mutex;
+                std::condition_variable DispatchesCompleted;
+        };
+
+        typedef std::unordered_map<unsigned short, std::shared_ptr<CallbackEntry>> CallbackTable;
+
+        // Returns S_FALSE when the command set already has a callback.
+        HRESULT Register(unsigned short commandSet, IpcMessageCallback callback, bool unmanagedOnly);
+        HRESULT RemoveEntry(unsigned short commandSet, const std::shared_ptr<CallbackEntry>& entry);
+        bool TryGetEntry(unsigned short commandSet, std::shared_ptr<CallbackEntry>& entry);
+
         //
-        // Ideally we would use a single std::shared_mutex instead, but we are targeting C++11 without
-        // an easy way to upgrade to C++17 at this time, so we use two separate mutexes instead to
-        // allow for IsRegistered to be used while a DispatchMessage call is in progress.
+        // The table is never modified once published. Registration copies it and swaps in the copy, so that
+        // lookups and dispatches never wait for each other or for registration.
+        // Accessed with std::atomic_load and std::atomic_store, since std::atomic<std::shared_ptr> requires C++20.
         //
-        std::mutex m_dispatchMutex;
-        std::mutex m_lookupMutex;
+        std::shared_ptr<const CallbackTable> m_callbacks;
+        // Serializes registration.
+        std::mutex m_registrationMutex;
 };
@@ -3,10 +3,20 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 
+//
+// dotnet-monitor sends Callstack with an empty payload, StopAllFeatures, StartAllFeatures and the StartupHook commands,
+// each on its own connection. Everything else in this file is implemented by the profiler but has no managed sender yet:
+// ConnectionCommand (and with it ConnectionFlags, multiplexed framing and ServerResponseCommand::Data), the Binary and
+// SharedRingBuffer callstack formats, SetKnownModuleVersionIds, ExportSymbolTable, ExceptionCounts,
+// EnableExceptionEvents and DisableExceptionEvents. They are exercised by the native tests in src/Profilers/Tests.
+//
+
 enum class ProfilerCommand : unsigned short
 {
+    // Payload is either empty or a UINT32 of CallstackFormat.
     Callstack,
 
     // Indicate that any outstanding collection should be stopped and all data should be flushed
@@ -16,6 +26,49 @@ enum class ProfilerCommand : unsigned short
     // Indicate that collection should resume again
     // Currently a no-op
     StartAllFeatures,
+
+    // Payload is a list of 16 byte ModuleVersionIds whose symbols the client already has.
+    // Names for these modules are omitted from subsequent callstack descriptor events.
+    SetKnownModuleVersionIds,
+
+    // Writes the names resolved so far to a binary symbol table next to the command socket (<instance id>.symbols).
+    // See CommonUtilities/SymbolTableWriter.h for the format. The result is the UTF-8 path of the file, which is removed
+    // when the profiler shuts down.
+    ExportSymbolTable,
+
+    // Result is the cumulative count of exceptions by type and throw site. See ExceptionAggregator::Serialize for the format.
+    ExceptionCounts,
+
+    // Optional. Exception events are written to EventPipe from startup, and EventPipe drops them when no session listens.
+    // A client sends this when it starts a session that includes DotnetMonitorExceptionsEventProvider, to narrow which
+    // events are built to the keywords and level of that session, and so that stacks written to earlier sessions are
+    // described again rather than referred to by id.
+    // Payload is the UINT64 keywords of the session followed by a UINT32 COR_PRF_EVENTPIPE_LEVEL.
+    EnableExceptionEvents,
+
+    // Optional. Stops building exception events until the next EnableExceptionEvents.
+    DisableExceptionEvents,
+};
+
+enum class CallstackFormat : UINT32
+{
+    // Stacks and their descriptors are written as events to the MonitorProfiler EventPipe provider.
+    EventPipe = 0,
+
+    // Stacks are returned as the command result. See Stacks/StackStreamWriter.h for the format.
+    // The result is only returned on connections with ConnectionFlags::CompletionResponses.
+    Binary = 1,
+    // Stacks are written to the SharedRingBuffer as a single SharedRingRecordType::StackStream record, in the same
+    // format as Binary. Fails with E_NOT_SUPPORTED when no client has received the ring. The result is S_FALSE when
+    // the record was dropped because the reader has not freed enough space.
+    SharedRingBuffer = 2,
+};
+
+// Types of the records the profiler writes to its SharedRingBuffer.
+enum class SharedRingRecordType : UINT32
+{
+    // See Stacks/StackStreamWriter.h for the format.
+    StackStream = 1,
 };
 
 enum class StartupHookCommand : unsigned short
@@ -35,7 +88,35 @@ enum class StartupHookCommand : unsigned short
 
 enum class ServerResponseCommand : unsigned short
 {
-    Status
+    Status,
+
+    // Part of a result too large to fit in a single Status message. Any number of Data messages with the request id
+    // are sent before its Status; the result is their payloads in order followed by the result in the Status.
+    Data
+};
+
+// Handled by the CommandServer itself rather than dispatched to a callback.
+enum class ConnectionCommand : unsigned short
+{
+    // Keeps the connection open after the status response and switches both directions to multiplexed framing,
+    // where the header is followed by a UINT32 request id. Any number of requests may then be sent on the connection;
+    // each response carries the id of the request it answers.
+    // Payload is either empty or a UINT32 of ConnectionFlags.
+    Multiplex,
+
+    // The status response carries the descriptor of the profiler's SharedRingBuffer as SCM_RIGHTS ancillary data.
+    // Fails with E_NOT_SUPPORTED when the ring is disabled or the platform cannot share it. The ring has a single
+    // reader, so only the first client to ask receives it; later requests fail with E_BUSY.
+    GetSharedRingBuffer,
+};
+
+enum class ConnectionFlags : UINT32
+{
+    None = 0,
+
+    // Status responses are sent once the command has been processed rather than when it is queued.
+    // The payload is the HRESULT returned by the command, followed by any result the command produced.
+    CompletionResponses = 0x1,
 };
 
 //
@@ -46,12 +127,29 @@ enum class CommandSet : unsigned short
 {
     ServerResponse,
     Profiler,
-    StartupHook
+    StartupHook,
+    Connection
 };
 
 struct IpcMessage
 {
+    IpcMessage() = default;
+    IpcMessage(IpcMessage&&) = default;
+    IpcMessage& operator=(IpcMessage&&) = default;
+    // Payloads can be large, so messages are moved from the socket to the callback rather than copied.
+    IpcMessage(const IpcMessage&) = delete;
+    IpcMessage& operator=(const IpcMessage&) = delete;
+
     unsigned short CommandSet;
     unsigned short Command;
+    // Only transmitted on multiplexed connections; 0 otherwise.
+    UINT32 RequestId = 0;
     std::vector<BYTE> Payload;
+    // ConnectionFlags of the connection the message arrived on. Set by the CommandServer rather than transmitted.
+    UINT32 ClientFlags = 0;
+
+    bool HasClientFlag(ConnectionFlags flag) const { return (ClientFlags & static_cast<UINT32>(flag)) != 0; }
 };
+
+// Commands that produce a result write it to result. It is only returned to clients that opted in with ConnectionFlags::CompletionResponses.
+typedef std::function<HRESULT (const IpcMessage& message, std::vector<BYTE>& result)> IpcMessageCallback;
@@ -0,0 +1,99 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "PayloadBufferPool.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <new>
+
+PayloadBufferPool::PayloadBufferPool()
+{
+    // Return runs on paths that cannot fail, so the slots for every class are allocated up front.
+    // If that fails the pool keeps nothing and every Rent allocates.
+    try
+    {
+        for (std::vector<std::vector<BYTE>>& buffers : _buffers)
+        {
+            buffers.reserve(MaxBuffersPerClass);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+    }
+}
+
+PayloadBufferPool& PayloadBufferPool::Shared()
+{
+    static PayloadBufferPool pool;
+    return pool;
+}
+
+size_t PayloadBufferPool::GetRentClass(size_t size)
+{
+    size_t index = 0;
+    while (index < ClassCount && GetClassSize(index) < size)
+    {
+        index++;
+    }
+    return index;
+}
+
+size_t PayloadBufferPool::GetReturnClass(size_t capacity)
+{
+    if (capacity < GetClassSize(0))
+    {
+        return ClassCount;
+    }
+
+    size_t index = 0;
+    while (index + 1 < ClassCount && GetClassSize(index + 1) <= capacity)
+    {
+        index++;
+    }
+    return index;
+}
+
+HRESULT PayloadBufferPool::Rent(size_t size, std::vector<BYTE>& buffer)
+{
+    size_t index = GetRentClass(size);
+    if (index == ClassCount)
+    {
+        IfOomRetMem(buffer.resize(size));
+        return S_OK;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_buffers[index].empty())
+        {
+            buffer = std::move(_buffers[index].back());
+            _buffers[index].pop_back();
+        }
+    }
+
+    // Reserving the whole class lets the buffer return to the class it was rented from. Pooled buffers already have
+    // that capacity, so resizing them neither allocates nor touches more than the bytes they grow by.
+    IfOomRetMem(buffer.reserve(GetClassSize(index)));
+    IfOomRetMem(buffer.resize(size));
+
+    return S_OK;
+}
+
+void PayloadBufferPool::Return(std::vector<BYTE>& buffer)
+{
+    std::vector<BYTE> returned = std::move(buffer);
+    buffer.clear();
+
+    size_t index = GetReturnClass(returned.capacity());
+    if (index == ClassCount)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Staying within the reserved capacity means push_back never allocates, so it cannot throw.
+    if (_buffers[index].size() < MaxBuffersPerClass && _buffers[index].size() < _buffers[index].capacity())
+    {
+        _buffers[index].push_back(std::move(returned));
+    }
+}
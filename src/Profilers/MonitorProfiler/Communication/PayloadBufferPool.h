@@ -0,0 +1,41 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include <mutex>
+#include <vector>
+
+/// <summary>
+/// Reuses message payload buffers, so that receiving or responding with a large payload does not allocate
+/// and zero fresh memory each time. Buffers are kept per power of 2 size class, with a few retained per class.
+/// </summary>
+class PayloadBufferPool final
+{
+public:
+    PayloadBufferPool();
+
+    static PayloadBufferPool& Shared();
+
+    // Replaces buffer with one of the given size. The contents are unspecified.
+    HRESULT Rent(size_t size, std::vector<BYTE>& buffer);
+    // Takes the storage of buffer for reuse and leaves buffer empty. The storage is freed when its class is full.
+    void Return(std::vector<BYTE>& buffer);
+
+private:
+    static size_t GetClassSize(size_t index) { return static_cast<size_t>(1) << (MinClassShift + index); }
+
+    // Smallest class that holds size, or ClassCount when size is larger than any class.
+    static size_t GetRentClass(size_t size);
+    // Largest class that fits in capacity, or ClassCount when capacity is smaller than any class.
+    static size_t GetReturnClass(size_t capacity);
+
+    static constexpr size_t MinClassShift = 6; // 64 bytes
+    static constexpr size_t ClassCount = 17; // Up to 4 MiB, the largest payload
+    // Large buffers are only worth keeping for the few requests that are in progress at once.
+    static constexpr size_t MaxBuffersPerClass = 4;
+
+    std::mutex _mutex;
+    std::vector<std::vector<BYTE>> _buffers[ClassCount];
+};
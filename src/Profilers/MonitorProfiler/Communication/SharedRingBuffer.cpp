@@ -0,0 +1,248 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "SharedRingBuffer.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <new>
+#include <string.h>
+
+#if TARGET_LINUX
+#include <linux/memfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace SharedRing;
+
+static_assert(sizeof(Header) <= HeaderSize, "Header must fit in HeaderSize");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Offsets are shared between processes and must be lock free");
+
+namespace
+{
+    UINT64 AlignRecordSize(UINT64 size)
+    {
+        return (size + RecordAlignment - 1) & ~static_cast<UINT64>(RecordAlignment - 1);
+    }
+}
+
+HRESULT SharedRingBuffer::Create(const char* name, UINT64 capacity, std::unique_ptr<SharedRingBuffer>& ring)
+{
+#if TARGET_LINUX
+    HRESULT hr;
+
+    if (capacity < MinCapacity || (capacity & (capacity - 1)) != 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Called through syscall since glibc only added a wrapper in 2.27.
+    int handle = static_cast<int>(syscall(SYS_memfd_create, name, MFD_CLOEXEC));
+    if (handle < 0)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    size_t mappingSize = static_cast<size_t>(HeaderSize + capacity);
+    if (ftruncate(handle, static_cast<off_t>(mappingSize)) != 0)
+    {
+        hr = HRESULT_FROM_WIN32(errno);
+        close(handle);
+        return hr;
+    }
+
+    BYTE* mapping = nullptr;
+    hr = Map(handle, mappingSize, mapping);
+    if (FAILED(hr))
+    {
+        close(handle);
+        return hr;
+    }
+
+    Header* header = new (mapping) Header();
+    header->Magic = Magic;
+    header->Version = CurrentVersion;
+    header->Capacity = capacity;
+    header->WriteOffset.store(0, std::memory_order_relaxed);
+    header->ReadOffset.store(0, std::memory_order_relaxed);
+    header->DroppedRecords.store(0, std::memory_order_relaxed);
+
+    ring.reset(new (std::nothrow) SharedRingBuffer(handle, mapping, mappingSize));
+    if (!ring)
+    {
+        munmap(mapping, mappingSize);
+        close(handle);
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+HRESULT SharedRingBuffer::Open(int handle, std::unique_ptr<SharedRingBuffer>& ring)
+{
+#if TARGET_LINUX
+    HRESULT hr;
+
+    struct stat status;
+    if (fstat(handle, &status) != 0)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    size_t mappingSize = static_cast<size_t>(status.st_size);
+    if (mappingSize < HeaderSize + MinCapacity)
+    {
+        return E_INVALIDARG;
+    }
+
+    BYTE* mapping = nullptr;
+    IfFailRet(Map(handle, mappingSize, mapping));
+
+    Header* header = reinterpret_cast<Header*>(mapping);
+    if (header->Magic != Magic || header->Version != CurrentVersion || HeaderSize + header->Capacity != mappingSize)
+    {
+        munmap(mapping, mappingSize);
+        return E_INVALIDARG;
+    }
+
+    ring.reset(new (std::nothrow) SharedRingBuffer(handle, mapping, mappingSize));
+    if (!ring)
+    {
+        munmap(mapping, mappingSize);
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+HRESULT SharedRingBuffer::Map(int handle, size_t mappingSize, BYTE*& mapping)
+{
+#if TARGET_LINUX
+    void* address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+    if (address == MAP_FAILED)
+    {
+        return HRESULT_FROM_WIN32(errno);
+    }
+
+    mapping = static_cast<BYTE*>(address);
+    return S_OK;
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+SharedRingBuffer::SharedRingBuffer(int handle, BYTE* mapping, size_t mappingSize) :
+    _handle(handle),
+    _mapping(mapping),
+    _mappingSize(mappingSize),
+    _header(reinterpret_cast<Header*>(mapping)),
+    _data(mapping + HeaderSize),
+    _readerClaimed(false)
+{
+}
+
+SharedRingBuffer::~SharedRingBuffer()
+{
+#if TARGET_LINUX
+    munmap(_mapping, _mappingSize);
+    close(_handle);
+#endif
+}
+
+HRESULT SharedRingBuffer::TryWrite(UINT32 type, const BYTE* data, UINT32 size)
+{
+    if (type == PaddingRecordType)
+    {
+        return E_INVALIDARG;
+    }
+
+    UINT64 capacity = _header->Capacity;
+    UINT64 recordSize = AlignRecordSize(sizeof(RecordHeader) + static_cast<UINT64>(size));
+    if (recordSize > capacity)
+    {
+        return E_INVALIDARG;
+    }
+
+    UINT64 writeOffset = _header->WriteOffset.load(std::memory_order_relaxed);
+    // Acquire so that the reader is done with the space it released.
+    UINT64 readOffset = _header->ReadOffset.load(std::memory_order_acquire);
+
+    UINT64 position = writeOffset & (capacity - 1);
+    UINT64 remaining = capacity - position;
+    UINT64 padding = remaining < recordSize ? remaining : 0;
+
+    if (writeOffset + padding + recordSize - readOffset > capacity)
+    {
+        _header->DroppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return S_FALSE;
+    }
+
+    if (padding != 0)
+    {
+        // Offsets are always aligned, so there is room for at least a record header.
+        RecordHeader paddingHeader = { static_cast<UINT32>(padding - sizeof(RecordHeader)), PaddingRecordType };
+        memcpy(&_data[position], &paddingHeader, sizeof(RecordHeader));
+        writeOffset += padding;
+        position = 0;
+    }
+
+    RecordHeader recordHeader = { size, type };
+    memcpy(&_data[position], &recordHeader, sizeof(RecordHeader));
+    if (size != 0)
+    {
+        memcpy(&_data[position + sizeof(RecordHeader)], data, size);
+    }
+
+    // Release so that the reader sees the record before the new offset.
+    _header->WriteOffset.store(writeOffset + recordSize, std::memory_order_release);
+
+    return S_OK;
+}
+
+HRESULT SharedRingBuffer::TryRead(UINT32& type, std::vector<BYTE>& data)
+{
+    UINT64 capacity = _header->Capacity;
+    UINT64 readOffset = _header->ReadOffset.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        // Acquire so that records written before the offset are visible.
+        UINT64 writeOffset = _header->WriteOffset.load(std::memory_order_acquire);
+        if (readOffset == writeOffset)
+        {
+            _header->ReadOffset.store(readOffset, std::memory_order_release);
+            return S_FALSE;
+        }
+
+        UINT64 position = readOffset & (capacity - 1);
+        RecordHeader recordHeader;
+        memcpy(&recordHeader, &_data[position], sizeof(RecordHeader));
+
+        UINT64 recordSize = AlignRecordSize(sizeof(RecordHeader) + static_cast<UINT64>(recordHeader.Size));
+        if (recordSize > capacity - position || recordSize > writeOffset - readOffset)
+        {
+            return E_UNEXPECTED;
+        }
+
+        if (recordHeader.Type == PaddingRecordType)
+        {
+            readOffset += recordSize;
+            continue;
+        }
+
+        IfOomRetMem(data.assign(&_data[position + sizeof(RecordHeader)], &_data[position + sizeof(RecordHeader) + recordHeader.Size]));
+        type = recordHeader.Type;
+
+        // Release so that the writer does not reuse the space before the record has been copied.
+        _header->ReadOffset.store(readOffset + recordSize, std::memory_order_release);
+        return S_OK;
+    }
+}
@@ -0,0 +1,90 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//
+// Shared memory layout. All values are little endian.
+//
+// [Header, padded to HeaderSize][Data, Capacity bytes]
+//
+// WriteOffset and ReadOffset are byte offsets that only ever increase; their position in the data is the offset modulo
+// Capacity. The writer only stores WriteOffset and the reader only stores ReadOffset, so neither waits on the other:
+// a write that does not fit is dropped and counted in DroppedRecords.
+//
+// Each record is a RecordHeader followed by Size bytes, padded to RecordAlignment. Records never wrap; when a record does
+// not fit before the end of the data, the rest of the data is filled with a PaddingRecordType record and the record starts
+// at the beginning of the data.
+//
+namespace SharedRing
+{
+    static constexpr UINT32 Magic = 0x52534d44; // "DMSR"
+    static constexpr UINT32 CurrentVersion = 1;
+    static constexpr UINT32 HeaderSize = 4096;
+    static constexpr UINT32 RecordAlignment = 8;
+    static constexpr UINT32 PaddingRecordType = 0xFFFFFFFF;
+
+    struct Header
+    {
+        UINT32 Magic;
+        UINT32 Version;
+        UINT64 Capacity;
+        // Kept on separate cache lines so that the reader and writer do not contend.
+        alignas(64) std::atomic<UINT64> WriteOffset;
+        alignas(64) std::atomic<UINT64> ReadOffset;
+        alignas(64) std::atomic<UINT64> DroppedRecords;
+    };
+
+    struct RecordHeader
+    {
+        UINT32 Size;
+        UINT32 Type;
+    };
+}
+
+/// <summary>
+/// Single producer, single consumer ring of framed records in a memfd, which is shared with dotnet-monitor
+/// by passing its descriptor over the command socket. See ConnectionCommand::GetSharedRingBuffer.
+/// </summary>
+class SharedRingBuffer final
+{
+public:
+    // Capacity must be a power of 2 and at least MinCapacity.
+    static HRESULT Create(const char* name, UINT64 capacity, std::unique_ptr<SharedRingBuffer>& ring);
+    // Maps a ring created by another SharedRingBuffer.
+    static HRESULT Open(int handle, std::unique_ptr<SharedRingBuffer>& ring);
+    ~SharedRingBuffer();
+
+    int GetHandle() const { return _handle; }
+    UINT64 GetCapacity() const { return _header->Capacity; }
+    UINT64 GetDroppedRecords() const { return _header->DroppedRecords.load(std::memory_order_relaxed); }
+
+    // The ring has a single consumer, so it is handed to the first client that asks for it. Returns false afterwards,
+    // until ReleaseReader.
+    bool TryClaimReader() { return !_readerClaimed.exchange(true); }
+    void ReleaseReader() { _readerClaimed.store(false); }
+    bool HasReader() const { return _readerClaimed.load(); }
+
+    // Never blocks. Returns S_FALSE, and counts the record as dropped, when the reader has not freed enough space.
+    HRESULT TryWrite(UINT32 type, const BYTE* data, UINT32 size);
+    // Never blocks. Returns S_FALSE when there is no record to read.
+    HRESULT TryRead(UINT32& type, std::vector<BYTE>& data);
+
+    static constexpr UINT64 MinCapacity = 4096;
+
+private:
+    SharedRingBuffer(int handle, BYTE* mapping, size_t mappingSize);
+    static HRESULT Map(int handle, size_t mappingSize, BYTE*& mapping);
+
+    int _handle;
+    BYTE* _mapping;
+    size_t _mappingSize;
+    SharedRing::Header* _header;
+    BYTE* _data;
+    std::atomic_bool _readerClaimed;
+};
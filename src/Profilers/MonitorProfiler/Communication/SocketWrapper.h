@@ -56,7 +56,7 @@ public:
             return SocketWrapper::GetSocketError();
         }
 #else
-        int flags = fcntl(_socket, F_GETFD);
+        int flags = fcntl(_socket, F_GETFL);
         if (flags < 0)
         {
             return SocketWrapper::GetSocketError();
@@ -70,7 +70,7 @@ public:
             flags |= O_NONBLOCK;
         }
 
-        if (fcntl(_socket, F_SETFD, flags) != 0)
+        if (fcntl(_socket, F_SETFL, flags) != 0)
         {
             return SocketWrapper::GetSocketError();
         }
@@ -79,6 +79,16 @@ public:
         return S_OK;
     }
 
+    // True when the last operation on a non-blocking socket failed only because it would have blocked.
+    static bool IsWouldBlock()
+    {
+#if TARGET_UNIX
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+    }
+
     static HRESULT GetSocketError()
     {
 #if TARGET_UNIX
@@ -0,0 +1,343 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "ExceptionAggregator.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <algorithm>
+#include <string.h>
+#include <utility>
+
+constexpr UINT32 ExceptionAggregator::DefaultWriteIntervalMilliseconds;
+constexpr size_t ExceptionAggregator::MaxSitesPerShard;
+constexpr UINT32 ExceptionAggregator::UnknownILOffset;
+
+ExceptionAggregator::ExceptionAggregator(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, NameCachePrewarmer* nameCachePrewarmer) :
+    _logger(logger),
+    _profilerInfo(profilerInfo),
+    _nameCachePrewarmer(nameCachePrewarmer)
+{
+}
+
+ExceptionAggregator::~ExceptionAggregator()
+{
+    Shutdown();
+}
+
+void ExceptionAggregator::AddProfilerEventMask(DWORD& eventsLow)
+{
+    eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_EXCEPTIONS | COR_PRF_MONITOR::COR_PRF_ENABLE_STACK_SNAPSHOT;
+}
+
+size_t ExceptionAggregator::SiteKeyHash::operator()(const SiteKey& key) const
+{
+    // FNV-1a over the key.
+    UINT64 hash = 14695981039346656037ULL;
+    hash = (hash ^ static_cast<UINT64>(key.ClassId)) * 1099511628211ULL;
+    hash = (hash ^ static_cast<UINT64>(key.FunctionId)) * 1099511628211ULL;
+    hash = (hash ^ static_cast<UINT64>(key.Ip)) * 1099511628211ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+HRESULT ExceptionAggregator::ExceptionThrown(ThreadID threadId, ObjectID objectId)
+{
+    HRESULT hr;
+
+    ClassID classId;
+    IfFailRet(_profilerInfo->GetClassFromObject(objectId, &classId));
+
+    // Only the innermost managed frame is needed, so the walk stops there.
+    SiteKey site = { classId, 0, 0 };
+    hr = _profilerInfo->DoStackSnapshot(threadId, DoStackSnapshotCallback, COR_PRF_SNAPSHOT_DEFAULT, &site, nullptr, 0);
+    if (FAILED(hr) && hr != CORPROF_E_STACKSNAPSHOT_ABORTED)
+    {
+        // Typically fails due to lack of managed frames; counted without a throw site.
+        site.FunctionId = 0;
+        site.Ip = 0;
+    }
+
+    return Record(site.ClassId, site.FunctionId, site.Ip);
+}
+
+HRESULT __stdcall ExceptionAggregator::DoStackSnapshotCallback(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData)
+{
+    //FunctionId of 0 indicates a native frame.
+    if (functionId == 0)
+    {
+        return S_OK;
+    }
+
+    SiteKey* site = reinterpret_cast<SiteKey*>(clientData);
+    site->FunctionId = functionId;
+    site->Ip = ip;
+
+    // Anything other than S_OK stops the walk.
+    return S_FALSE;
+}
+
+HRESULT ExceptionAggregator::Record(ClassID classId, FunctionID functionId, UINT_PTR ip)
+{
+    SiteKey site = { classId, functionId, ip };
+    size_t hash = SiteKeyHash()(site);
+    // The low bits select the bucket within the shard's map, so the shard is chosen from the high bits.
+    Shard& shard = _shards[(hash >> 24) % ShardCount];
+
+    {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto const& it = shard.Counts.find(site);
+        if (it != shard.Counts.end())
+        {
+            it->second++;
+            return S_OK;
+        }
+
+        if (shard.Counts.size() >= MaxSitesPerShard)
+        {
+            // The overflow site may take each shard one past the limit.
+            site = { 0, 0, 0 };
+        }
+
+        IfOomRetMem(shard.Counts[site]++);
+    }
+
+    // Only reached the first time a site is seen, or when counting past the limit, so the prewarmer is not asked
+    // about the same names for every exception.
+    if (_nameCachePrewarmer != nullptr && site.ClassId != 0)
+    {
+        _nameCachePrewarmer->ClassReferenced(site.ClassId);
+        if (site.FunctionId != 0)
+        {
+            _nameCachePrewarmer->FunctionCompiled(site.FunctionId);
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT ExceptionAggregator::GetCounts(std::vector<ExceptionSiteCount>& counts)
+{
+    HRESULT hr;
+
+    counts.clear();
+
+    std::vector<std::pair<SiteKey, UINT64>> sites;
+    for (Shard& shard : _shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        IfOomRetMem(sites.insert(sites.end(), shard.Counts.begin(), shard.Counts.end()));
+    }
+
+    // Sites are mapped after the shard locks are released, so throwing threads never wait on the runtime.
+    // Tiered and OSR versions of a function throw from different native code, and are combined here.
+    std::unordered_map<SiteKey, size_t, SiteKeyHash> indices;
+    IfOomRetMem(counts.reserve(sites.size()));
+    for (auto const& site : sites)
+    {
+        UINT32 ilOffset = 0;
+        IfFailRet(GetILOffset(site.first.FunctionId, site.first.Ip, ilOffset));
+
+        SiteKey key = { site.first.ClassId, site.first.FunctionId, static_cast<UINT_PTR>(ilOffset) };
+        START_NO_OOM_THROW_REGION;
+        auto const& inserted = indices.emplace(key, counts.size());
+        if (inserted.second)
+        {
+            ExceptionSiteCount count = { key.ClassId, key.FunctionId, ilOffset, 0 };
+            counts.push_back(count);
+        }
+        counts[inserted.first->second].Count += site.second;
+        END_NO_OOM_THROW_REGION;
+    }
+
+    return S_OK;
+}
+
+HRESULT ExceptionAggregator::GetILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset)
+{
+    // Exceptions without a managed frame, and the overflow site, have nothing to map.
+    if (functionId == 0)
+    {
+        ilOffset = 0;
+        return S_OK;
+    }
+
+    SiteKey key = { 0, functionId, ip };
+    {
+        std::lock_guard<std::mutex> lock(_ilOffsetsMutex);
+        auto const& it = _ilOffsets.find(key);
+        if (it != _ilOffsets.end())
+        {
+            ilOffset = it->second;
+            return S_OK;
+        }
+    }
+
+    if (FAILED(MapILOffset(functionId, ip, ilOffset)))
+    {
+        // Such as when the code has been unloaded; the site is still counted against its function.
+        ilOffset = UnknownILOffset;
+    }
+
+    std::lock_guard<std::mutex> lock(_ilOffsetsMutex);
+    IfOomRetMem(_ilOffsets.emplace(key, ilOffset));
+
+    return S_OK;
+}
+
+HRESULT ExceptionAggregator::MapILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset)
+{
+    HRESULT hr;
+
+    // The ip of the throwing frame is the return address of the call that threw, so the call itself is the byte before.
+    UINT_PTR callIp = ip > 0 ? ip - 1 : ip;
+
+    FunctionID ipFunctionId = 0;
+    ReJITID reJitId = 0;
+    IfFailRet(_profilerInfo->GetFunctionFromIP3(reinterpret_cast<LPCBYTE>(callIp), &ipFunctionId, &reJitId));
+
+    ULONG32 startCount = 0;
+    IfFailRet(_profilerInfo->GetNativeCodeStartAddresses(functionId, reJitId, 0, &startCount, nullptr));
+    std::vector<UINT_PTR> starts;
+    IfOomRetMem(starts.resize(startCount));
+    IfFailRet(_profilerInfo->GetNativeCodeStartAddresses(functionId, reJitId, startCount, &startCount, starts.data()));
+
+    for (size_t i = 0; i < std::min<size_t>(startCount, starts.size()); i++)
+    {
+        ULONG32 codeInfoCount = 0;
+        IfFailRet(_profilerInfo->GetCodeInfo4(starts[i], 0, &codeInfoCount, nullptr));
+        std::vector<COR_PRF_CODE_INFO> codeInfos;
+        IfOomRetMem(codeInfos.resize(codeInfoCount));
+        IfFailRet(_profilerInfo->GetCodeInfo4(starts[i], codeInfoCount, &codeInfoCount, codeInfos.data()));
+
+        // Native offsets in the IL to native map run through the regions of the code in order.
+        ULONG32 regionOffset = 0;
+        for (size_t j = 0; j < std::min<size_t>(codeInfoCount, codeInfos.size()); j++)
+        {
+            const COR_PRF_CODE_INFO& codeInfo = codeInfos[j];
+            if (callIp >= codeInfo.startAddress && callIp < codeInfo.startAddress + codeInfo.size)
+            {
+                return MapNativeOffset(starts[i], regionOffset + static_cast<ULONG32>(callIp - codeInfo.startAddress), ilOffset);
+            }
+            regionOffset += static_cast<ULONG32>(codeInfo.size);
+        }
+    }
+
+    return E_FAIL;
+}
+
+HRESULT ExceptionAggregator::MapNativeOffset(UINT_PTR codeStart, ULONG32 nativeOffset, UINT32& ilOffset)
+{
+    HRESULT hr;
+
+    ULONG32 mapCount = 0;
+    IfFailRet(_profilerInfo->GetILToNativeMapping3(codeStart, 0, &mapCount, nullptr));
+    std::vector<COR_DEBUG_IL_TO_NATIVE_MAP> map;
+    IfOomRetMem(map.resize(mapCount));
+    IfFailRet(_profilerInfo->GetILToNativeMapping3(codeStart, mapCount, &mapCount, map.data()));
+
+    for (size_t i = 0; i < std::min<size_t>(mapCount, map.size()); i++)
+    {
+        if (nativeOffset >= map[i].nativeStartOffset && nativeOffset < map[i].nativeEndOffset)
+        {
+            ilOffset = static_cast<UINT32>(map[i].ilOffset);
+            return S_OK;
+        }
+    }
+
+    return E_FAIL;
+}
+
+HRESULT ExceptionAggregator::Serialize(std::vector<BYTE>& buffer)
+{
+    HRESULT hr;
+
+    std::vector<ExceptionSiteCount> counts;
+    IfFailRet(GetCounts(counts));
+
+    const size_t SiteSize = 4 * sizeof(UINT64);
+    IfOomRetMem(buffer.resize(sizeof(UINT32) + counts.size() * SiteSize));
+
+    BYTE* position = buffer.data();
+    UINT32 siteCount = static_cast<UINT32>(counts.size());
+    memcpy(position, &siteCount, sizeof(siteCount));
+    position += sizeof(siteCount);
+
+    for (const ExceptionSiteCount& count : counts)
+    {
+        UINT64 values[4] = { static_cast<UINT64>(count.ClassId), static_cast<UINT64>(count.FunctionId), static_cast<UINT64>(count.ILOffset), count.Count };
+        memcpy(position, values, SiteSize);
+        position += SiteSize;
+    }
+
+    return S_OK;
+}
+
+HRESULT ExceptionAggregator::Start(const std::shared_ptr<ExceptionsEventProvider>& eventProvider, UINT32 intervalMilliseconds)
+{
+    if (_writeThread.joinable() || intervalMilliseconds == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    _eventProvider = eventProvider;
+    _writeIntervalMilliseconds = intervalMilliseconds;
+    _writeThread = std::thread(&ExceptionAggregator::WriteThread, this);
+
+    return S_OK;
+}
+
+void ExceptionAggregator::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(_shutdownMutex);
+        _shutdown = true;
+    }
+    _shutdownCondition.notify_all();
+
+    if (_writeThread.joinable())
+    {
+        _writeThread.join();
+    }
+}
+
+HRESULT ExceptionAggregator::WriteCounts()
+{
+    HRESULT hr;
+
+    std::vector<ExceptionSiteCount> counts;
+    IfFailRet(GetCounts(counts));
+
+    for (const ExceptionSiteCount& count : counts)
+    {
+        IfFailRet(_eventProvider->WriteSiteCount(count.ClassId, count.FunctionId, count.ILOffset, count.Count));
+    }
+
+    return S_OK;
+}
+
+void ExceptionAggregator::WriteThread()
+{
+    HRESULT hr = _profilerInfo->InitializeCurrentThread();
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Error, _LS("Unable to initialize thread: 0x%08x"), hr);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_shutdownMutex);
+    while (!_shutdownCondition.wait_for(lock, std::chrono::milliseconds(_writeIntervalMilliseconds), [this]() { return _shutdown; }))
+    {
+        if (!_eventProvider->IsSiteCountEnabled())
+        {
+            continue;
+        }
+
+        lock.unlock();
+        hr = WriteCounts();
+        if (FAILED(hr))
+        {
+            _logger->Log(LogLevel::Error, _LS("Unable to write exception counts: 0x%08x"), hr);
+        }
+        lock.lock();
+    }
+}
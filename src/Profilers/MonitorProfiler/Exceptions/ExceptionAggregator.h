@@ -0,0 +1,124 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "com.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Logging/Logger.h"
+#include "ExceptionsEventProvider.h"
+#include "../Stacks/NameCachePrewarmer.h"
+
+struct ExceptionSiteCount
+{
+    ClassID ClassId;
+    // Innermost managed frame at the throw, or 0 when there is none.
+    FunctionID FunctionId;
+    // IL offset of the throw site, which every native code version of the function (tiers, OSR) shares.
+    // ExceptionAggregator::UnknownILOffset when the site could not be mapped, and 0 when FunctionId is 0.
+    UINT32 ILOffset;
+    UINT64 Count;
+};
+
+/// <summary>
+/// Counts every thrown exception by its type and throw site, so that frequent exceptions cost a counter increment
+/// rather than an event each. Counts are cumulative; they are read with GetCounts or ProfilerCommand::ExceptionCounts,
+/// and written periodically as ExceptionSiteCount events while a session is listening.
+/// Sites are spread over independently locked shards by their hash. They are recorded by native instruction pointer,
+/// which is all the throwing thread has, and combined by IL offset when the counts are read.
+/// The names of each new site are resolved by the NameCachePrewarmer, when there is one, so that the counts can be
+/// described with ProfilerCommand::ExportSymbolTable.
+/// </summary>
+class ExceptionAggregator final
+{
+public:
+    static constexpr UINT32 DefaultWriteIntervalMilliseconds = 10000;
+    // Past this, exceptions at new sites are counted together under a ClassId, FunctionId and ILOffset of 0.
+    static constexpr size_t MaxSitesPerShard = 1024;
+    // Same as the runtime's NO_MAPPING.
+    static constexpr UINT32 UnknownILOffset = 0xFFFFFFFF;
+
+    // nameCachePrewarmer may be null, and must outlive the aggregator otherwise.
+    ExceptionAggregator(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, NameCachePrewarmer* nameCachePrewarmer);
+    ~ExceptionAggregator();
+
+    static void AddProfilerEventMask(DWORD& eventsLow);
+
+    HRESULT ExceptionThrown(ThreadID threadId, ObjectID objectId);
+    HRESULT Record(ClassID classId, FunctionID functionId, UINT_PTR ip);
+
+    HRESULT GetCounts(std::vector<ExceptionSiteCount>& counts);
+
+    /// <summary>
+    /// Result of ProfilerCommand::ExceptionCounts: a UINT32 count of sites, then for each site its
+    /// ClassId, FunctionId, ILOffset and Count as UINT64s.
+    /// </summary>
+    HRESULT Serialize(std::vector<BYTE>& buffer);
+
+    /// <summary>
+    /// Starts a background thread that writes the counts every intervalMilliseconds while a session listening for
+    /// ExceptionsEventProvider::SiteCountKeyword is enabled with ProfilerCommand::EnableExceptionEvents.
+    /// </summary>
+    HRESULT Start(const std::shared_ptr<ExceptionsEventProvider>& eventProvider, UINT32 intervalMilliseconds);
+    void Shutdown();
+
+private:
+    struct SiteKey
+    {
+        ClassID ClassId;
+        FunctionID FunctionId;
+        UINT_PTR Ip;
+
+        bool operator==(const SiteKey& other) const
+        {
+            return ClassId == other.ClassId && FunctionId == other.FunctionId && Ip == other.Ip;
+        }
+    };
+
+    struct SiteKeyHash
+    {
+        size_t operator()(const SiteKey& key) const;
+    };
+
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::unordered_map<SiteKey, UINT64, SiteKeyHash> Counts;
+    };
+
+    // Maps the native ip to an IL offset within functionId, remembering the result so the runtime is asked once per site.
+    HRESULT GetILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset);
+    HRESULT MapILOffset(FunctionID functionId, UINT_PTR ip, UINT32& ilOffset);
+    HRESULT MapNativeOffset(UINT_PTR codeStart, ULONG32 nativeOffset, UINT32& ilOffset);
+
+    static HRESULT __stdcall DoStackSnapshotCallback(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData);
+
+    HRESULT WriteCounts();
+    void WriteThread();
+
+    static constexpr size_t ShardCount = 16;
+
+    Shard _shards[ShardCount];
+    std::shared_ptr<ILogger> _logger;
+    ComPtr<ICorProfilerInfo12> _profilerInfo;
+    NameCachePrewarmer* _nameCachePrewarmer;
+
+    // Keyed by FunctionId and native Ip, with a ClassId of 0.
+    std::mutex _ilOffsetsMutex;
+    std::unordered_map<SiteKey, UINT32, SiteKeyHash> _ilOffsets;
+
+    std::shared_ptr<ExceptionsEventProvider> _eventProvider;
+    UINT32 _writeIntervalMilliseconds = DefaultWriteIntervalMilliseconds;
+    std::thread _writeThread;
+    std::mutex _shutdownMutex;
+    std::condition_variable _shutdownCondition;
+    bool _shutdown = false;
+};
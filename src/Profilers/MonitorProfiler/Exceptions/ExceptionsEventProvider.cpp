@@ -0,0 +1,50 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "ExceptionsEventProvider.h"
+#include "corhlpr.h"
+#include "cor.h"
+
+constexpr UINT64 ExceptionsEventProvider::ExceptionKeyword;
+constexpr UINT64 ExceptionsEventProvider::SiteCountKeyword;
+
+const WCHAR* ExceptionsEventProvider::ProviderName = _T("DotnetMonitorExceptionsEventProvider");
+
+HRESULT ExceptionsEventProvider::CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ExceptionsEventProvider>& eventProvider)
+{
+    std::unique_ptr<ProfilerEventProvider> provider;
+    HRESULT hr;
+
+    IfFailRet(ProfilerEventProvider::CreateProvider(ProviderName, profilerInfo, provider));
+
+    eventProvider = std::unique_ptr<ExceptionsEventProvider>(new ExceptionsEventProvider(provider));
+    IfFailRet(eventProvider->DefineEvents());
+
+    return S_OK;
+}
+
+HRESULT ExceptionsEventProvider::DefineEvents()
+{
+    HRESULT hr;
+
+    IfFailRet(_provider->DefineEvent(_T("FirstChanceException"), ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL, _exceptionEvent, ExceptionPayloads));
+    IfFailRet(_provider->DefineEvent(_T("ExceptionStack"), ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL, _stackEvent, StackPayloads));
+    IfFailRet(_provider->DefineEvent(_T("ExceptionSiteCount"), SiteCountKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL, _siteCountEvent, SiteCountPayloads));
+
+    return S_OK;
+}
+
+HRESULT ExceptionsEventProvider::WriteException(ClassID classId, UINT32 stackId, UINT32 threadId, UINT64 timestamp)
+{
+    return _exceptionEvent->WritePayload(static_cast<UINT64>(classId), stackId, threadId, timestamp);
+}
+
+HRESULT ExceptionsEventProvider::WriteStack(UINT32 stackId, const Stack& stack)
+{
+    return _stackEvent->WritePayload(stackId, stack.GetFunctionIds(), stack.GetOffsets());
+}
+
+HRESULT ExceptionsEventProvider::WriteSiteCount(ClassID classId, FunctionID functionId, UINT32 ilOffset, UINT64 count)
+{
+    return _siteCountEvent->WritePayload(static_cast<UINT64>(classId), static_cast<UINT64>(functionId), ilOffset, count);
+}
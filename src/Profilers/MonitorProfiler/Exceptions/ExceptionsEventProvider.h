@@ -0,0 +1,59 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "EventProvider/ProfilerEventProvider.h"
+#include <memory>
+#include "../Stacks/Stack.h"
+
+/// <summary>
+/// First chance exceptions. Each exception refers to its throw site stack by id; the frames of a stack are written
+/// once, in an ExceptionStack event before the first exception that refers to it. Names are not written; FunctionIds
+/// and ClassIds are resolved into the shared NameCache, which is exported with ProfilerCommand::ExportSymbolTable.
+/// ExceptionSiteCount events carry the cumulative number of exceptions of a type thrown at a site.
+/// Events are written whenever the provider is enabled, which it is from startup; a client can narrow them to the
+/// keywords and level of its session with ProfilerCommand::EnableExceptionEvents, or turn them off with DisableExceptionEvents.
+/// </summary>
+class ExceptionsEventProvider
+{
+    public:
+        // FirstChanceException and ExceptionStack events.
+        static constexpr UINT64 ExceptionKeyword = 0x1;
+        // ExceptionSiteCount events.
+        static constexpr UINT64 SiteCountKeyword = 0x2;
+
+        static HRESULT CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<ExceptionsEventProvider>& eventProvider);
+
+        // Set from the keywords and level of ProfilerCommand::EnableExceptionEvents.
+        ProfilerEventEnablement& GetEnablement() { return _provider->GetEnablement(); }
+
+        bool IsEnabled() const { return _exceptionEvent->IsEnabled(); }
+        bool IsSiteCountEnabled() const { return _siteCountEvent->IsEnabled(); }
+
+        // Timestamp is UTC, in 100 ns ticks since the Unix epoch.
+        HRESULT WriteException(ClassID classId, UINT32 stackId, UINT32 threadId, UINT64 timestamp);
+        HRESULT WriteStack(UINT32 stackId, const Stack& stack);
+        HRESULT WriteSiteCount(ClassID classId, FunctionID functionId, UINT32 ilOffset, UINT64 count);
+
+    private:
+        ExceptionsEventProvider(std::unique_ptr<ProfilerEventProvider>& eventProvider) :
+            _provider(std::move(eventProvider))
+        {
+        }
+
+        static const WCHAR* ProviderName;
+
+        HRESULT DefineEvents();
+
+        std::unique_ptr<ProfilerEventProvider> _provider;
+
+        const WCHAR* ExceptionPayloads[4] = { _T("ExceptionClassId"), _T("StackId"), _T("ThreadId"), _T("Timestamp") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT32, UINT64>> _exceptionEvent;
+
+        const WCHAR* StackPayloads[3] = { _T("StackId"), _T("FunctionIds"), _T("IpOffsets") };
+        std::unique_ptr<ProfilerEvent<UINT32, std::vector<UINT64>, std::vector<UINT64>>> _stackEvent;
+
+        const WCHAR* SiteCountPayloads[4] = { _T("ExceptionClassId"), _T("FunctionId"), _T("ILOffset"), _T("Count") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT64, UINT32, UINT64>> _siteCountEvent;
+};
@@ -0,0 +1,123 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "FirstChanceExceptionMonitor.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <chrono>
+
+constexpr UINT32 FirstChanceExceptionMonitor::DefaultSampleRate;
+constexpr size_t FirstChanceExceptionMonitor::MaxFrames;
+
+FirstChanceExceptionMonitor::FirstChanceExceptionMonitor(
+    const std::shared_ptr<ILogger>& logger,
+    ICorProfilerInfo12* profilerInfo,
+    const std::shared_ptr<ExceptionsEventProvider>& eventProvider,
+    NameCachePrewarmer* nameCachePrewarmer,
+    UINT32 sampleRate) :
+    _logger(logger),
+    _profilerInfo(profilerInfo),
+    _eventProvider(eventProvider),
+    _nameCachePrewarmer(nameCachePrewarmer),
+    _sampleRate(sampleRate > 0 ? sampleRate : DefaultSampleRate)
+{
+}
+
+void FirstChanceExceptionMonitor::AddProfilerEventMask(DWORD& eventsLow)
+{
+    eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_EXCEPTIONS | COR_PRF_MONITOR::COR_PRF_ENABLE_STACK_SNAPSHOT;
+}
+
+HRESULT FirstChanceExceptionMonitor::ExceptionThrown(ThreadID threadId, ObjectID objectId)
+{
+    HRESULT hr;
+
+    if (!_eventProvider->IsEnabled())
+    {
+        return S_OK;
+    }
+
+    if (_sampleRate > 1)
+    {
+        static thread_local UINT32 exceptionCount = 0;
+        if (++exceptionCount < _sampleRate)
+        {
+            return S_OK;
+        }
+        exceptionCount = 0;
+    }
+
+    ClassID classId;
+    IfFailRet(_profilerInfo->GetClassFromObject(objectId, &classId));
+
+    DWORD osThreadId;
+    IfFailRet(_profilerInfo->GetThreadInfo(threadId, &osThreadId));
+
+    UINT32 stackId;
+    IfFailRet(GetThrowSiteStackId(threadId, stackId));
+
+    if (_nameCachePrewarmer != nullptr)
+    {
+        _nameCachePrewarmer->ClassReferenced(classId);
+    }
+
+    UINT64 timestamp = static_cast<UINT64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() / 100);
+
+    return _eventProvider->WriteException(classId, stackId, osThreadId, timestamp);
+}
+
+HRESULT FirstChanceExceptionMonitor::GetThrowSiteStackId(ThreadID threadId, UINT32& stackId)
+{
+    HRESULT hr;
+
+    stackId = 0;
+
+    // Reused so that walking the stack does not allocate once the thread has seen a deep enough stack.
+    static thread_local Stack stack;
+    stack.Clear();
+
+    hr = _profilerInfo->DoStackSnapshot(threadId, DoStackSnapshotCallback, COR_PRF_SNAPSHOT_DEFAULT, &stack, nullptr, 0);
+    if (FAILED(hr) && hr != CORPROF_E_STACKSNAPSHOT_ABORTED)
+    {
+        // Typically fails due to lack of managed frames. The exception is still reported, without a stack.
+        _logger->Log(LogLevel::Debug, _LS("Unable to walk the stack of a thrown exception: 0x%08x"), hr);
+        return S_OK;
+    }
+
+    if (stack.GetFunctionIds().empty())
+    {
+        return S_OK;
+    }
+
+    // Stacks are described again to each new session, which has not seen the earlier ones.
+    UINT32 sessionId = _eventProvider->GetEnablement().GetSessionId();
+    IfFailRet(_stacks.Intern(stack, sessionId, [this](UINT32 addedStackId) { return _eventProvider->WriteStack(addedStackId, stack); }, stackId));
+    if (hr == S_FALSE)
+    {
+        return S_OK;
+    }
+
+    if (_nameCachePrewarmer != nullptr)
+    {
+        for (UINT64 functionId : stack.GetFunctionIds())
+        {
+            // FunctionId of 0 indicates a native frame.
+            if (functionId != 0)
+            {
+                _nameCachePrewarmer->FunctionCompiled(static_cast<FunctionID>(functionId));
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT __stdcall FirstChanceExceptionMonitor::DoStackSnapshotCallback(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData)
+{
+    Stack* stack = reinterpret_cast<Stack*>(clientData);
+    IfOomRetMem(stack->AddFrame(functionId, ip));
+
+    // Anything other than S_OK stops the walk.
+    return stack->GetFunctionIds().size() < MaxFrames ? S_OK : S_FALSE;
+}
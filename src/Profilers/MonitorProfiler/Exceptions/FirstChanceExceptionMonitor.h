@@ -0,0 +1,53 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "com.h"
+#include <memory>
+#include "Logging/Logger.h"
+#include "ExceptionsEventProvider.h"
+#include "../Stacks/NameCachePrewarmer.h"
+#include "../Stacks/StackInterner.h"
+
+/// <summary>
+/// Writes an event for each sampled first chance exception: its type, the interned stack of the throw site, the thread and the time.
+/// The stack is walked on the throwing thread from within the ExceptionThrown callback, so the runtime is not suspended.
+/// Names of exception types and throw site functions are resolved by the NameCachePrewarmer, when there is one.
+/// </summary>
+class FirstChanceExceptionMonitor final
+{
+public:
+    static constexpr UINT32 DefaultSampleRate = 1;
+    // Frames past this, towards the root of the stack, are not recorded.
+    static constexpr size_t MaxFrames = 64;
+
+    /// <summary>
+    /// Records one of every sampleRate exceptions thrown on each thread. nameCachePrewarmer may be null, and must outlive the monitor otherwise.
+    /// </summary>
+    FirstChanceExceptionMonitor(
+        const std::shared_ptr<ILogger>& logger,
+        ICorProfilerInfo12* profilerInfo,
+        const std::shared_ptr<ExceptionsEventProvider>& eventProvider,
+        NameCachePrewarmer* nameCachePrewarmer,
+        UINT32 sampleRate);
+
+    static void AddProfilerEventMask(DWORD& eventsLow);
+
+    HRESULT ExceptionThrown(ThreadID threadId, ObjectID objectId);
+
+private:
+    static HRESULT __stdcall DoStackSnapshotCallback(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData);
+
+    // Interns the stack of the current thread, writing its frames the first time it is seen. stackId is 0 when there are no managed frames.
+    HRESULT GetThrowSiteStackId(ThreadID threadId, UINT32& stackId);
+
+    std::shared_ptr<ILogger> _logger;
+    ComPtr<ICorProfilerInfo12> _profilerInfo;
+    std::shared_ptr<ExceptionsEventProvider> _eventProvider;
+    NameCachePrewarmer* _nameCachePrewarmer;
+    UINT32 _sampleRate;
+    StackInterner _stacks;
+};
@@ -3,8 +3,8 @@
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
 #include "ExceptionTracker.h"
-#include "../Utilities/NameCache.h"
-#include "../Utilities/TypeNameUtilities.h"
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
 
 using namespace std;
 
@@ -48,14 +48,24 @@ using namespace std;
     - ExceptionUnwindFunctionEnter: If the exception was not handled (ExceptionSearchCatcherFound was not invoked),
       then the exception is unhandled at this point. Do some extra bookkeeping in the case when the exception is
       handled so that the exception is cleared once the frame with the corresponding catching FunctionID is encountered.
+    - ExceptionSearchFilterEnter/Leave, ExceptionUnwindFinallyEnter/Leave: Record how many exceptions are being
+      processed when a filter or finally block starts, and discard any thrown inside it that are left once it returns.
+
+    Nested exceptions:
+    - Exceptions thrown within exception filters or finally blocks are seen as a new set of callback invocations
+      starting with throwing, searching, and unwinding while the original exception is still being processed.
+      Each thread keeps a stack of exceptions: ExceptionThrown pushes a new exception, the catcher and unwind
+      callbacks apply to the innermost one, and clearing a caught exception resumes the one it interrupted.
+    - An exception that escapes an exception filter is swallowed by the runtime, which then leaves the filter,
+      so it is discarded by ExceptionSearchFilterLeave and the search for the outer exception's catcher resumes.
+    - An exception that escapes a finally block supersedes the original exception, and the finally block is never
+      left. Once the new exception unwinds the function that contains the finally block without being caught there,
+      it replaces the original exception on the stack.
 
     Current pitfalls:
-    - Algorithm doesn't account for exceptions thrown within exception filters. These will be seen as a new set of
-      callback invocations starting with throwing, searching, and unwinding, however, the callstack does not unwind
-      out of the exception filter and the original exception processing is resumed.
-    - Algorithm doesn't account for exceptions thrown within finally blocks. Presumably, these will be seen as new set
-      of callback invocations starting with throwing, searching, and unwinding. The original exception processing is
-      superceded by the new set of callbacks for the new exception.
+    - An exception that escapes a finally block and is caught by the same function leaves the original exception
+      on the stack. Exceptions left on the stack this way are dropped once more than ThreadData::MaxNestedExceptions
+      are nested.
 */
 
 
@@ -129,6 +139,7 @@ HRESULT ExceptionTracker::ExceptionUnwindFunctionEnter(ThreadID threadId, Functi
 
     bool hasException = false;
     FunctionID catcherFunctionId = ThreadData::NoFunctionId;
+    IfFailLogRet(_threadDataManager->SupersedeEscapedException(threadId, functionId));
     IfFailLogRet(_threadDataManager->GetException(threadId, &hasException, &catcherFunctionId));
     IfFalseLogRet(hasException, E_UNEXPECTED);
 
@@ -158,6 +169,42 @@ HRESULT ExceptionTracker::ExceptionUnwindFunctionEnter(ThreadID threadId, Functi
     return S_OK;
 }
 
+HRESULT ExceptionTracker::ExceptionSearchFilterEnter(ThreadID threadId, FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_threadDataManager->EnterExceptionHandler(threadId, functionId, false));
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::ExceptionSearchFilterLeave(ThreadID threadId)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_threadDataManager->LeaveExceptionHandler(threadId));
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::ExceptionUnwindFinallyEnter(ThreadID threadId, FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_threadDataManager->EnterExceptionHandler(threadId, functionId, true));
+
+    return S_OK;
+}
+
+HRESULT ExceptionTracker::ExceptionUnwindFinallyLeave(ThreadID threadId)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_threadDataManager->LeaveExceptionHandler(threadId));
+
+    return S_OK;
+}
+
 HRESULT ExceptionTracker::GetFullyQualifiedTypeName(ClassID classId, tstring& fullTypeName)
 {
     HRESULT hr = S_OK;
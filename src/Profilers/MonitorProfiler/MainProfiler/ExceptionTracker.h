@@ -5,7 +5,7 @@
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
 #include <memory>
-#include "../Logging/Logger.h"
+#include "Logging/Logger.h"
 #include "ThreadDataManager.h"
 #include "com.h"
 
@@ -34,6 +34,10 @@ public:
     HRESULT ExceptionThrown(ThreadID threadId, ObjectID objectId);
     HRESULT ExceptionSearchCatcherFound(ThreadID threadId, FunctionID functionId);
     HRESULT ExceptionUnwindFunctionEnter(ThreadID threadId, FunctionID functionId);
+    HRESULT ExceptionSearchFilterEnter(ThreadID threadId, FunctionID functionId);
+    HRESULT ExceptionSearchFilterLeave(ThreadID threadId);
+    HRESULT ExceptionUnwindFinallyEnter(ThreadID threadId, FunctionID functionId);
+    HRESULT ExceptionUnwindFinallyLeave(ThreadID threadId);
 
 private:
     // Method and type name utilities
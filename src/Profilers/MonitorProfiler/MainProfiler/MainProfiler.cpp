@@ -6,13 +6,18 @@
 #include "Environment/EnvironmentHelper.h"
 #include "Environment/ProfilerEnvironment.h"
 #include "Logging/LoggerFactory.h"
+#include "CommonUtilities/SymbolTableWriter.h"
 #include "CommonUtilities/ThreadUtilities.h"
 #include "../Stacks/StacksEventProvider.h"
 #include "../Stacks/StackSampler.h"
+#include "../Stacks/StackStreamWriter.h"
 #include "corhlpr.h"
 #include "macros.h"
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -46,15 +51,88 @@ STDMETHODIMP MainProfiler::Initialize(IUnknown *pICorProfilerInfoUnk)
 
 STDMETHODIMP MainProfiler::Shutdown()
 {
-    m_pLogger.reset();
+    _isShutdown.store(true);
+
     m_pEnvironment.reset();
 
     _commandServer->Shutdown();
     _commandServer.reset();
 
+    if (_exceptionAggregator)
+    {
+        _exceptionAggregator->Shutdown();
+    }
+
+    if (_nameCachePrewarmer)
+    {
+        _nameCachePrewarmer->Shutdown();
+    }
+
+    if (_nameResolver)
+    {
+        _nameResolver->Shutdown();
+    }
+
+    // The table is only useful to clients of this instance.
+    if (!_symbolTablePath.empty())
+    {
+        HRESULT hr = SymbolTableWriter::RemoveFile(_symbolTablePath);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Warning, _LS("Unable to remove the symbol table: 0x%08x"), hr);
+        }
+    }
+
     g_MessageCallbacks.Unregister(static_cast<unsigned short>(CommandSet::Profiler));
 
-    return ProfilerBase::Shutdown();
+    // m_pCorProfilerInfo, the logger and the exception features are released with the profiler rather than by
+    // ProfilerBase::Shutdown, since callbacks that started before Shutdown may still be using them.
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::ModuleLoadFinished(ModuleID moduleId, HRESULT hrStatus)
+{
+    if (_isShutdown.load())
+    {
+        return S_OK;
+    }
+
+    if (_nameCachePrewarmer && SUCCEEDED(hrStatus))
+    {
+        _nameCachePrewarmer->ModuleLoaded(moduleId);
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::ModuleUnloadFinished(ModuleID moduleId, HRESULT hrStatus)
+{
+    if (_isShutdown.load())
+    {
+        return S_OK;
+    }
+
+    if (_nameCachePrewarmer)
+    {
+        _nameCachePrewarmer->ModuleUnloaded(moduleId);
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::JITCompilationFinished(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock)
+{
+    if (_isShutdown.load())
+    {
+        return S_OK;
+    }
+
+    if (_nameCachePrewarmer && SUCCEEDED(hrStatus))
+    {
+        _nameCachePrewarmer->FunctionCompiled(functionId);
+    }
+
+    return S_OK;
 }
 
 STDMETHODIMP MainProfiler::ThreadCreated(ThreadID threadId)
@@ -95,10 +173,30 @@ STDMETHODIMP MainProfiler::ExceptionThrown(ObjectID thrownObjectId)
 {
     HRESULT hr = S_OK;
 
-#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    if (_isShutdown.load())
+    {
+        return S_OK;
+    }
+
     ThreadID threadId;
     IfFailLogRet(m_pCorProfilerInfo->GetCurrentThreadID(&threadId));
 
+    if (_exceptionAggregator)
+    {
+        // Logged rather than returned, so that a failure to count does not also hide the exception from the monitor.
+        hr = _exceptionAggregator->ExceptionThrown(threadId, thrownObjectId);
+        if (FAILED(hr))
+        {
+            m_pLogger->Log(LogLevel::Error, _LS("Unable to count exception: 0x%08x"), hr);
+        }
+    }
+
+    if (_firstChanceExceptionMonitor)
+    {
+        IfFailLogRet(_firstChanceExceptionMonitor->ExceptionThrown(threadId, thrownObjectId));
+    }
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
     IfFailLogRet(_exceptionTracker->ExceptionThrown(threadId, thrownObjectId));
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
 
@@ -133,6 +231,62 @@ STDMETHODIMP MainProfiler::ExceptionUnwindFunctionEnter(FunctionID functionId)
     return S_OK;
 }
 
+STDMETHODIMP MainProfiler::ExceptionSearchFilterEnter(FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    ThreadID threadId;
+    IfFailLogRet(m_pCorProfilerInfo->GetCurrentThreadID(&threadId));
+
+    IfFailLogRet(_exceptionTracker->ExceptionSearchFilterEnter(threadId, functionId));
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::ExceptionSearchFilterLeave()
+{
+    HRESULT hr = S_OK;
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    ThreadID threadId;
+    IfFailLogRet(m_pCorProfilerInfo->GetCurrentThreadID(&threadId));
+
+    IfFailLogRet(_exceptionTracker->ExceptionSearchFilterLeave(threadId));
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::ExceptionUnwindFinallyEnter(FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    ThreadID threadId;
+    IfFailLogRet(m_pCorProfilerInfo->GetCurrentThreadID(&threadId));
+
+    IfFailLogRet(_exceptionTracker->ExceptionUnwindFinallyEnter(threadId, functionId));
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
+    return S_OK;
+}
+
+STDMETHODIMP MainProfiler::ExceptionUnwindFinallyLeave()
+{
+    HRESULT hr = S_OK;
+
+#ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+    ThreadID threadId;
+    IfFailLogRet(m_pCorProfilerInfo->GetCurrentThreadID(&threadId));
+
+    IfFailLogRet(_exceptionTracker->ExceptionUnwindFinallyLeave(threadId));
+#endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
+
+    return S_OK;
+}
+
 STDMETHODIMP MainProfiler::InitializeForAttach(IUnknown* pCorProfilerInfoUnk, void* pvClientData, UINT cbClientData)
 {
     HRESULT hr = S_OK;
@@ -193,6 +347,30 @@ HRESULT MainProfiler::InitializeCommon()
 
     _threadNameCache = make_shared<ThreadNameCache>();
 
+    IfFailLogRet(InitializeNameResolutionWorkers());
+
+    bool prewarmEnabled = false;
+    IfFailLogRet(InitializeNameCachePrewarmer(prewarmEnabled));
+    if (prewarmEnabled)
+    {
+        NameCachePrewarmer::AddProfilerEventMask(eventsLow);
+    }
+
+    // Created after the prewarmer, which resolves the names it refers to.
+    bool firstChanceExceptionsEnabled = false;
+    IfFailLogRet(InitializeFirstChanceExceptionMonitor(firstChanceExceptionsEnabled));
+    if (firstChanceExceptionsEnabled)
+    {
+        FirstChanceExceptionMonitor::AddProfilerEventMask(eventsLow);
+    }
+
+    bool exceptionCountsEnabled = false;
+    IfFailLogRet(InitializeExceptionAggregator(exceptionCountsEnabled));
+    if (exceptionCountsEnabled)
+    {
+        ExceptionAggregator::AddProfilerEventMask(eventsLow);
+    }
+
     IfFailRet(m_pCorProfilerInfo->SetEventMask2(
         eventsLow,
         COR_PRF_HIGH_MONITOR::COR_PRF_HIGH_MONITOR_NONE));
@@ -200,6 +378,16 @@ HRESULT MainProfiler::InitializeCommon()
     //Initialize this last. The CommandServer creates secondary threads, which will be difficult to cleanup if profiler initialization fails.
     IfFailLogRet(InitializeCommandServer());
 
+    if (_nameCachePrewarmer)
+    {
+        IfFailLogRet(_nameCachePrewarmer->Start(_nameCachePrewarmerBatchSize, _nameCachePrewarmerBatchDelay));
+    }
+
+    if (_exceptionAggregator && _exceptionCountsInterval > 0)
+    {
+        IfFailLogRet(_exceptionAggregator->Start(_exceptionsEventProvider, _exceptionCountsInterval));
+    }
+
     return S_OK;
 }
 
@@ -239,9 +427,17 @@ HRESULT MainProfiler::InitializeCommandServer()
     IfFailRet(_environmentHelper->GetSharedPath(sharedPath));
 
     _commandServer = std::unique_ptr<CommandServer>(new CommandServer(m_pLogger, m_pCorProfilerInfo));
+    IfFailLogRet(InitializeSharedRingBuffer(instanceId));
+    _commandServer->SetSharedRingBuffer(_sharedRingBuffer);
+
+    UINT32 commandWorkers = CommandServer::DefaultClientWorkerCount;
+    IfFailLogRet(_environmentHelper->GetUInt32(CommandWorkersEnvVar, commandWorkers));
+    _commandServer->SetClientWorkerCount(commandWorkers);
+
     tstring socketPath = sharedPath + separator + instanceId + _T(".sock");
+    _symbolTablePath = to_string(sharedPath + separator + instanceId + _T(".symbols"));
 
-    if (!g_MessageCallbacks.TryRegister(static_cast<unsigned short>(CommandSet::Profiler), [this](const IpcMessage& message)-> HRESULT { return this->ProfilerCommandSetCallback(message); }, true))
+    if (!g_MessageCallbacks.TryRegister(static_cast<unsigned short>(CommandSet::Profiler), [this](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT { return this->ProfilerCommandSetCallback(message, result); }, true))
     {
         m_pLogger->Log(LogLevel::Error, _LS("Unable to register Profiler CommandSet callback."));
         return E_FAIL;
@@ -249,7 +445,7 @@ HRESULT MainProfiler::InitializeCommandServer()
 
     hr = _commandServer->Start(
         to_string(socketPath),
-        [this](const IpcMessage& message)-> HRESULT { return this->MessageCallback(message); },
+        [this](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT { return this->MessageCallback(message, result); },
         [this](const IpcMessage& message)-> HRESULT { return this->ValidateMessage(message); },
         [](unsigned short commandSet, bool& unmanagedOnly)-> HRESULT { return g_MessageCallbacks.UnmanagedOnly(commandSet, unmanagedOnly);});
     if (FAILED(hr))
@@ -261,28 +457,213 @@ HRESULT MainProfiler::InitializeCommandServer()
     return S_OK;
 }
 
-HRESULT MainProfiler::MessageCallback(const IpcMessage& message)
+HRESULT MainProfiler::InitializeNameCachePrewarmer(bool& enabled)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(EnableNameCachePrewarmEnvVar, enabled));
+    if (!enabled)
+    {
+        // Exception events refer to classes and functions by id, and only the prewarmer resolves their names.
+        bool exceptionsEnabled = false;
+        IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(EnableFirstChanceExceptionsEnvVar, exceptionsEnabled));
+        if (!exceptionsEnabled)
+        {
+            IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(EnableExceptionCountsEnvVar, exceptionsEnabled));
+        }
+        if (!exceptionsEnabled)
+        {
+            return S_OK;
+        }
+        enabled = true;
+    }
+
+    UINT32 batchSize = NameCachePrewarmer::DefaultBatchSize;
+    UINT32 batchDelay = NameCachePrewarmer::DefaultBatchDelayMilliseconds;
+    IfFailLogRet(_environmentHelper->GetUInt32(NameCachePrewarmBatchSizeEnvVar, batchSize));
+    IfFailLogRet(_environmentHelper->GetUInt32(NameCachePrewarmBatchDelayEnvVar, batchDelay));
+
+    _nameCachePrewarmer.reset(new (nothrow) NameCachePrewarmer(m_pLogger, m_pCorProfilerInfo, make_shared<NameCache>()));
+    IfNullRet(_nameCachePrewarmer);
+    _nameCachePrewarmerBatchSize = batchSize;
+    _nameCachePrewarmerBatchDelay = batchDelay;
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::InitializeFirstChanceExceptionMonitor(bool& enabled)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(EnableFirstChanceExceptionsEnvVar, enabled));
+    if (!enabled)
+    {
+        return S_OK;
+    }
+
+    UINT32 sampleRate = FirstChanceExceptionMonitor::DefaultSampleRate;
+    IfFailLogRet(_environmentHelper->GetUInt32(FirstChanceExceptionsSampleRateEnvVar, sampleRate));
+
+    std::shared_ptr<ExceptionsEventProvider> eventProvider;
+    IfFailLogRet(GetExceptionsEventProvider(eventProvider));
+
+    _firstChanceExceptionMonitor.reset(new (nothrow) FirstChanceExceptionMonitor(
+        m_pLogger,
+        m_pCorProfilerInfo,
+        eventProvider,
+        _nameCachePrewarmer.get(),
+        sampleRate));
+    IfNullRet(_firstChanceExceptionMonitor);
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::InitializeExceptionAggregator(bool& enabled)
+{
+    HRESULT hr = S_OK;
+
+    IfFailLogRet(_environmentHelper->GetIsFeatureEnabled(EnableExceptionCountsEnvVar, enabled));
+    if (!enabled)
+    {
+        return S_OK;
+    }
+
+    UINT32 interval = ExceptionAggregator::DefaultWriteIntervalMilliseconds;
+    IfFailLogRet(_environmentHelper->GetUInt32(ExceptionCountsIntervalEnvVar, interval));
+    if (interval > 0)
+    {
+        std::shared_ptr<ExceptionsEventProvider> eventProvider;
+        IfFailLogRet(GetExceptionsEventProvider(eventProvider));
+    }
+
+    _exceptionAggregator.reset(new (nothrow) ExceptionAggregator(m_pLogger, m_pCorProfilerInfo, _nameCachePrewarmer.get()));
+    IfNullRet(_exceptionAggregator);
+    _exceptionCountsInterval = interval;
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::GetExceptionsEventProvider(std::shared_ptr<ExceptionsEventProvider>& eventProvider)
+{
+    HRESULT hr = S_OK;
+
+    // Shared by the exception features, so that one session listens to all of them.
+    if (!_exceptionsEventProvider)
+    {
+        std::unique_ptr<ExceptionsEventProvider> provider;
+        IfFailLogRet(ExceptionsEventProvider::CreateProvider(m_pCorProfilerInfo, provider));
+        _exceptionsEventProvider = std::move(provider);
+    }
+
+    eventProvider = _exceptionsEventProvider;
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::InitializeNameResolutionWorkers()
+{
+    HRESULT hr = S_OK;
+
+    // hardware_concurrency may return 0 when it cannot be determined.
+    UINT32 workers = std::min<UINT32>(std::thread::hardware_concurrency(), ParallelNameResolver::DefaultMaxWorkers);
+    IfFailLogRet(_environmentHelper->GetUInt32(NameResolutionWorkersEnvVar, workers));
+
+    _nameResolver = make_shared<ParallelNameResolver>(m_pLogger, m_pCorProfilerInfo, workers > 0 ? workers : 1);
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::InitializeSharedRingBuffer(const tstring& instanceId)
+{
+    HRESULT hr = S_OK;
+
+    UINT32 size = 0;
+    IfFailLogRet(_environmentHelper->GetUInt32(SharedRingBufferSizeEnvVar, size));
+    if (size == 0)
+    {
+        return S_OK;
+    }
+
+    std::unique_ptr<SharedRingBuffer> ring;
+    hr = SharedRingBuffer::Create(to_string(_T("dotnet-monitor-") + instanceId).c_str(), size, ring);
+    if (FAILED(hr))
+    {
+        // The ring is optional; commands are still served without it.
+        m_pLogger->Log(LogLevel::Error, _LS("Unable to create shared ring buffer of %u bytes, continuing without it: 0x%08x"), size, hr);
+        return S_OK;
+    }
+    _sharedRingBuffer = std::move(ring);
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::MessageCallback(const IpcMessage& message, std::vector<BYTE>& result)
 {
     m_pLogger->Log(LogLevel::Debug, _LS("Message received from client %hu:%hu"), message.CommandSet, message.Command);
-    return g_MessageCallbacks.DispatchMessage(message);
+    return g_MessageCallbacks.DispatchMessage(message, result);
 }
 
 HRESULT MainProfiler::ValidateMessage(const IpcMessage& message)
 {
-    if (g_MessageCallbacks.IsRegistered(message.CommandSet))
+    HRESULT hr;
+
+    if (!g_MessageCallbacks.IsRegistered(message.CommandSet))
     {
-        return S_OK;
+        return E_NOT_SUPPORTED;
+    }
+
+    if (message.CommandSet == static_cast<unsigned short>(CommandSet::Profiler) &&
+        message.Command == static_cast<unsigned short>(ProfilerCommand::Callstack))
+    {
+        // Binary callstacks are returned as the result, which only clients with completion responses receive.
+        // Rejected here, so that the runtime is not suspended for a result that would be dropped.
+        CallstackFormat format;
+        IfFailRet(GetCallstackFormat(message, format));
+        if (format == CallstackFormat::Binary && !message.HasClientFlag(ConnectionFlags::CompletionResponses))
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::GetCallstackFormat(const IpcMessage& message, CallstackFormat& format)
+{
+    format = CallstackFormat::EventPipe;
+    if (message.Payload.size() == sizeof(format))
+    {
+        memcpy(&format, message.Payload.data(), sizeof(format));
+    }
+    else if (message.Payload.size() != 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (format != CallstackFormat::EventPipe && format != CallstackFormat::Binary && format != CallstackFormat::SharedRingBuffer)
+    {
+        return E_NOT_SUPPORTED;
     }
 
-    return E_NOT_SUPPORTED;
+    return S_OK;
 }
 
-HRESULT MainProfiler::ProfilerCommandSetCallback(const IpcMessage& message)
+HRESULT MainProfiler::ProfilerCommandSetCallback(const IpcMessage& message, std::vector<BYTE>& result)
 {
     switch (static_cast<ProfilerCommand>(message.Command))
     {
     case ProfilerCommand::Callstack:
-        return ProcessCallstackMessage();
+        return ProcessCallstackMessage(message, result);
+    case ProfilerCommand::SetKnownModuleVersionIds:
+        return ProcessSetKnownModuleVersionIdsMessage(message);
+    case ProfilerCommand::ExportSymbolTable:
+        return ProcessExportSymbolTableMessage(result);
+    case ProfilerCommand::ExceptionCounts:
+        return ProcessExceptionCountsMessage(result);
+    case ProfilerCommand::EnableExceptionEvents:
+        return ProcessEnableExceptionEventsMessage(message);
+    case ProfilerCommand::DisableExceptionEvents:
+        return ProcessDisableExceptionEventsMessage();
     case ProfilerCommand::StartAllFeatures:
     case ProfilerCommand::StopAllFeatures:
         // TODO We don't do anything here now, but we could interrupt the current stack walk with CORPROF_E_STACKSNAPSHOT_ABORT in the snapshot callback.
@@ -292,37 +673,75 @@ HRESULT MainProfiler::ProfilerCommandSetCallback(const IpcMessage& message)
     }
 }
 
-HRESULT MainProfiler::ProcessCallstackMessage()
+HRESULT MainProfiler::ProcessCallstackMessage(const IpcMessage& message, std::vector<BYTE>& result)
 {
     HRESULT hr;
 
-    StackSampler stackSampler(m_pCorProfilerInfo);
-    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
-    std::shared_ptr<NameCache> nameCache;
+    CallstackFormat format;
+    IfFailRet(GetCallstackFormat(message, format));
 
-    IfFailLogRet(stackSampler.CreateCallstack(stackStates, nameCache, _threadNameCache));
+    // Checked before the runtime is suspended, since there would be nowhere to write the stacks.
+    if (format == CallstackFormat::SharedRingBuffer && !(_sharedRingBuffer && _sharedRingBuffer->HasReader()))
+    {
+        return E_NOT_SUPPORTED;
+    }
 
-    std::unique_ptr<StacksEventProvider> eventProvider;
-    IfFailLogRet(StacksEventProvider::CreateProvider(m_pCorProfilerInfo, eventProvider));
+    StackSampler stackSampler(m_pCorProfilerInfo, _nameResolver);
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    std::shared_ptr<NameCache> nameCache;
 
-    for (auto& entry : nameCache->GetFunctions())
+    if (_nameCachePrewarmer)
     {
-        IfFailLogRet(eventProvider->WriteFunctionData(entry.first, *entry.second.get()));
+        // Missing names are resolved into the long lived cache, and only the names the stacks reference are copied out of it.
+        // Events and binary dumps then describe what was captured rather than everything resolved so far, and the prewarmer
+        // is not held up while they are written.
+        std::lock_guard<std::mutex> nameCacheLock(_nameCachePrewarmer->GetCacheLock());
+        std::shared_ptr<NameCache> prewarmedCache = _nameCachePrewarmer->GetNameCache();
+        IfFailLogRet(stackSampler.CreateCallstack(stackStates, prewarmedCache, _threadNameCache));
+
+        nameCache = make_shared<NameCache>();
+        IfFailLogRet(StackSampler::CopyReferencedNames(stackStates, *prewarmedCache, *nameCache));
     }
-    for (auto& entry : nameCache->GetClasses())
+    else
     {
-        IfFailLogRet(eventProvider->WriteClassData(entry.first, *entry.second.get()));
+        IfFailLogRet(stackSampler.CreateCallstack(stackStates, nameCache, _threadNameCache));
+        _lastSnapshotNameCache = nameCache;
     }
-    for (auto& entry : nameCache->GetModules())
+
+    if (format == CallstackFormat::Binary)
     {
-        IfFailLogRet(eventProvider->WriteModuleData(entry.first, *entry.second.get()));
+        // Returned directly to the client, so there is no EventPipe session to wait on.
+        IfFailLogRet(StackStreamWriter::Serialize(*nameCache, stackStates, result));
     }
-    for (auto& entry : nameCache->GetTypeNames())
+    else if (format == CallstackFormat::SharedRingBuffer)
     {
-        //first: (Module,TypeDef)
-        IfFailLogRet(eventProvider->WriteTokenData(entry.first.first, entry.first.second, *entry.second.get()));
+        // Callstack commands only run on the unmanaged only command thread, so this is the ring's single producer.
+        std::vector<BYTE> stream;
+        IfFailLogRet(StackStreamWriter::Serialize(*nameCache, stackStates, stream));
+        if (stream.size() > (std::numeric_limits<UINT32>::max)())
+        {
+            return E_INVALIDARG;
+        }
+        IfFailLogRet(_sharedRingBuffer->TryWrite(static_cast<UINT32>(SharedRingRecordType::StackStream), stream.data(), static_cast<UINT32>(stream.size())));
+        return hr;
+    }
+    else
+    {
+        IfFailLogRet(WriteCallstackEvents(stackStates, *nameCache));
     }
 
+    return S_OK;
+}
+
+HRESULT MainProfiler::WriteCallstackEvents(std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& nameCache)
+{
+    HRESULT hr;
+
+    std::unique_ptr<StacksEventProvider> eventProvider;
+    IfFailLogRet(StacksEventProvider::CreateProvider(m_pCorProfilerInfo, eventProvider));
+
+    IfFailLogRet(WriteNameCache(*eventProvider, nameCache));
+
     for (std::unique_ptr<StackSamplerState>& stackState : stackStates)
     {
         IfFailLogRet(eventProvider->WriteCallstack(stackState->GetStack()));
@@ -338,6 +757,136 @@ HRESULT MainProfiler::ProcessCallstackMessage()
     return S_OK;
 }
 
+HRESULT MainProfiler::ProcessExportSymbolTableMessage(std::vector<BYTE>& result)
+{
+    HRESULT hr;
+
+    if (_nameCachePrewarmer)
+    {
+        std::lock_guard<std::mutex> nameCacheLock(_nameCachePrewarmer->GetCacheLock());
+        IfFailLogRet(SymbolTableWriter::WriteFile(*_nameCachePrewarmer->GetNameCache(), _symbolTablePath));
+    }
+    else
+    {
+        // Nothing has been resolved yet; still write an empty table so the client does not wait on a missing file.
+        std::shared_ptr<NameCache> nameCache = _lastSnapshotNameCache ? _lastSnapshotNameCache : make_shared<NameCache>();
+        IfFailLogRet(SymbolTableWriter::WriteFile(*nameCache, _symbolTablePath));
+    }
+
+    IfOomRetMem(result.assign(_symbolTablePath.begin(), _symbolTablePath.end()));
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::ProcessExceptionCountsMessage(std::vector<BYTE>& result)
+{
+    if (!_exceptionAggregator)
+    {
+        return E_NOT_SUPPORTED;
+    }
+
+    return _exceptionAggregator->Serialize(result);
+}
+
+HRESULT MainProfiler::ProcessEnableExceptionEventsMessage(const IpcMessage& message)
+{
+    if (!_exceptionsEventProvider)
+    {
+        return E_NOT_SUPPORTED;
+    }
+
+    UINT64 keywords = 0;
+    UINT32 level = 0;
+    if (message.Payload.size() != sizeof(keywords) + sizeof(level))
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Invalid exception event enablement payload."));
+        return E_INVALIDARG;
+    }
+
+    memcpy(&keywords, message.Payload.data(), sizeof(keywords));
+    memcpy(&level, message.Payload.data() + sizeof(keywords), sizeof(level));
+    if (level > COR_PRF_EVENTPIPE_VERBOSE)
+    {
+        return E_INVALIDARG;
+    }
+
+    _exceptionsEventProvider->GetEnablement().Enable(keywords, static_cast<COR_PRF_EVENTPIPE_LEVEL>(level));
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::ProcessDisableExceptionEventsMessage()
+{
+    if (!_exceptionsEventProvider)
+    {
+        return E_NOT_SUPPORTED;
+    }
+
+    _exceptionsEventProvider->GetEnablement().Disable();
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::WriteNameCache(StacksEventProvider& eventProvider, NameCache& nameCache)
+{
+    HRESULT hr;
+
+    for (auto& entry : nameCache.GetFunctions())
+    {
+        GUID moduleVersionId = nameCache.GetModuleVersionId(entry.second->GetModuleId());
+        bool includeName = _knownModuleVersionIds.find(moduleVersionId) == _knownModuleVersionIds.end();
+        IfFailLogRet(eventProvider.WriteFunctionData(
+            entry.first,
+            *entry.second.get(),
+            moduleVersionId,
+            nameCache.GetInstantiationHash(entry.second->GetTypeArgs()),
+            includeName));
+    }
+    for (auto& entry : nameCache.GetClasses())
+    {
+        IfFailLogRet(eventProvider.WriteClassData(
+            entry.first,
+            *entry.second.get(),
+            nameCache.GetModuleVersionId(entry.second->GetModuleId()),
+            nameCache.GetInstantiationHash(entry.second->GetTypeArgs())));
+    }
+    for (auto& entry : nameCache.GetModules())
+    {
+        IfFailLogRet(eventProvider.WriteModuleData(entry.first, *entry.second.get()));
+    }
+    for (auto& entry : nameCache.GetTypeNames())
+    {
+        //first: (Module,TypeDef)
+        GUID moduleVersionId = nameCache.GetModuleVersionId(entry.first.first);
+        if (_knownModuleVersionIds.find(moduleVersionId) != _knownModuleVersionIds.end())
+        {
+            // The client can already name (ModuleVersionId, TypeDef).
+            continue;
+        }
+        IfFailLogRet(eventProvider.WriteTokenData(entry.first.first, entry.first.second, *entry.second.get(), moduleVersionId));
+    }
+
+    return S_OK;
+}
+
+HRESULT MainProfiler::ProcessSetKnownModuleVersionIdsMessage(const IpcMessage& message)
+{
+    if (message.Payload.size() % GuidUtilities::FlatSize != 0)
+    {
+        m_pLogger->Log(LogLevel::Error, _LS("Invalid known ModuleVersionId payload."));
+        return E_INVALIDARG;
+    }
+
+    // The list replaces any previous list so that clients can also forget modules.
+    _knownModuleVersionIds.clear();
+    for (size_t offset = 0; offset < message.Payload.size(); offset += GuidUtilities::FlatSize)
+    {
+        _knownModuleVersionIds.insert(GuidUtilities::Read(&message.Payload[offset]));
+    }
+
+    return S_OK;
+}
+
 STDAPI DLLEXPORT RegisterMonitorMessageCallback(
     UINT16 commandSet,
     ManagedMessageCallback pCallback)
@@ -4,13 +4,22 @@
 #pragma once
 
 #include "../Communication/CommandServer.h"
+#include "../Exceptions/ExceptionAggregator.h"
+#include "../Exceptions/FirstChanceExceptionMonitor.h"
+#include "../Stacks/NameCachePrewarmer.h"
+#include "../Stacks/ParallelNameResolver.h"
 
 #include "ProfilerBase.h"
 #include "Environment/Environment.h"
 #include "Environment/EnvironmentHelper.h"
 #include "Logging/Logger.h"
 #include "CommonUtilities/ThreadNameCache.h"
+#include "CommonUtilities/GuidUtilities.h"
+#include "../Stacks/StacksEventProvider.h"
+#include "../Stacks/StackSampler.h"
+#include <atomic>
 #include <memory>
+#include <set>
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
 #include "ThreadDataManager.h"
@@ -22,12 +31,33 @@ class MainProfiler final :
 {
 private:
     static constexpr LPCWSTR ProfilerVersionEnvVar = _T("DotnetMonitor_MonitorProfiler_ProductVersion");
+    static constexpr LPCWSTR EnableNameCachePrewarmEnvVar = _T("DotnetMonitor_MonitorProfiler_NameCachePrewarm_Enable");
+    static constexpr LPCWSTR NameCachePrewarmBatchSizeEnvVar = _T("DotnetMonitor_MonitorProfiler_NameCachePrewarm_BatchSize");
+    static constexpr LPCWSTR NameCachePrewarmBatchDelayEnvVar = _T("DotnetMonitor_MonitorProfiler_NameCachePrewarm_BatchDelayMs");
+    static constexpr LPCWSTR NameResolutionWorkersEnvVar = _T("DotnetMonitor_MonitorProfiler_NameResolutionWorkers");
+    static constexpr LPCWSTR EnableFirstChanceExceptionsEnvVar = _T("DotnetMonitor_MonitorProfiler_Exceptions_Enable");
+    // Records one of every N exceptions thrown on each thread. Defaults to 1, every exception.
+    static constexpr LPCWSTR FirstChanceExceptionsSampleRateEnvVar = _T("DotnetMonitor_MonitorProfiler_Exceptions_SampleRate");
+    static constexpr LPCWSTR EnableExceptionCountsEnvVar = _T("DotnetMonitor_MonitorProfiler_ExceptionCounts_Enable");
+    // How often counts are written to a listening EventPipe session. 0 leaves them to ProfilerCommand::ExceptionCounts.
+    static constexpr LPCWSTR ExceptionCountsIntervalEnvVar = _T("DotnetMonitor_MonitorProfiler_ExceptionCounts_IntervalMs");
+    static constexpr LPCWSTR CommandWorkersEnvVar = _T("DotnetMonitor_MonitorProfiler_CommandWorkers");
+    // Size in bytes of the SharedRingBuffer offered to dotnet-monitor; must be a power of 2. 0, the default, disables it.
+    static constexpr LPCWSTR SharedRingBufferSizeEnvVar = _T("DotnetMonitor_MonitorProfiler_SharedRingBuffer_Size");
 
 private:
     std::shared_ptr<IEnvironment> m_pEnvironment;
     std::shared_ptr<EnvironmentHelper> _environmentHelper;
     std::shared_ptr<ILogger> m_pLogger;
     std::shared_ptr<ThreadNameCache> _threadNameCache;
+    std::unique_ptr<NameCachePrewarmer> _nameCachePrewarmer;
+    UINT32 _nameCachePrewarmerBatchSize = NameCachePrewarmer::DefaultBatchSize;
+    UINT32 _nameCachePrewarmerBatchDelay = NameCachePrewarmer::DefaultBatchDelayMilliseconds;
+    std::shared_ptr<ParallelNameResolver> _nameResolver;
+    std::shared_ptr<ExceptionsEventProvider> _exceptionsEventProvider;
+    std::unique_ptr<FirstChanceExceptionMonitor> _firstChanceExceptionMonitor;
+    std::unique_ptr<ExceptionAggregator> _exceptionAggregator;
+    UINT32 _exceptionCountsInterval = ExceptionAggregator::DefaultWriteIntervalMilliseconds;
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
     std::shared_ptr<ThreadDataManager> _threadDataManager;
     std::unique_ptr<ExceptionTracker> _exceptionTracker;
@@ -39,12 +69,19 @@ public:
 
     STDMETHOD(Initialize)(IUnknown* pICorProfilerInfoUnk) override;
     STDMETHOD(Shutdown)() override;
+    STDMETHOD(ModuleLoadFinished)(ModuleID moduleId, HRESULT hrStatus) override;
+    STDMETHOD(ModuleUnloadFinished)(ModuleID moduleId, HRESULT hrStatus) override;
+    STDMETHOD(JITCompilationFinished)(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock) override;
     STDMETHOD(ThreadCreated)(ThreadID threadId) override;
     STDMETHOD(ThreadDestroyed)(ThreadID threadId) override;
     STDMETHOD(ThreadNameChanged)(ThreadID threadId, ULONG cchName, WCHAR name[]) override;
     STDMETHOD(ExceptionThrown)(ObjectID thrownObjectId) override;
     STDMETHOD(ExceptionSearchCatcherFound)(FunctionID functionId) override;
     STDMETHOD(ExceptionUnwindFunctionEnter)(FunctionID functionId) override;
+    STDMETHOD(ExceptionSearchFilterEnter)(FunctionID functionId) override;
+    STDMETHOD(ExceptionSearchFilterLeave)() override;
+    STDMETHOD(ExceptionUnwindFinallyEnter)(FunctionID functionId) override;
+    STDMETHOD(ExceptionUnwindFinallyLeave)() override;
     STDMETHOD(InitializeForAttach)(IUnknown* pCorProfilerInfoUnk, void* pvClientData, UINT cbClientData) override;
     STDMETHOD(LoadAsNotificationOnly)(BOOL *pbNotificationOnly) override;
 
@@ -53,11 +90,35 @@ private:
     HRESULT InitializeEnvironment();
     HRESULT InitializeEnvironmentHelper();
     HRESULT InitializeCommandServer();
-    HRESULT MessageCallback(const IpcMessage& message);
+    HRESULT InitializeNameCachePrewarmer(bool& enabled);
+    HRESULT InitializeNameResolutionWorkers();
+    HRESULT InitializeFirstChanceExceptionMonitor(bool& enabled);
+    HRESULT InitializeExceptionAggregator(bool& enabled);
+    HRESULT GetExceptionsEventProvider(std::shared_ptr<ExceptionsEventProvider>& eventProvider);
+    HRESULT InitializeSharedRingBuffer(const tstring& instanceId);
+    HRESULT MessageCallback(const IpcMessage& message, std::vector<BYTE>& result);
     HRESULT ValidateMessage(const IpcMessage& message);
-    HRESULT ProfilerCommandSetCallback(const IpcMessage& message);
-    HRESULT ProcessCallstackMessage();
+    static HRESULT GetCallstackFormat(const IpcMessage& message, CallstackFormat& format);
+    HRESULT ProfilerCommandSetCallback(const IpcMessage& message, std::vector<BYTE>& result);
+    HRESULT ProcessCallstackMessage(const IpcMessage& message, std::vector<BYTE>& result);
+    HRESULT ProcessSetKnownModuleVersionIdsMessage(const IpcMessage& message);
+    HRESULT ProcessExportSymbolTableMessage(std::vector<BYTE>& result);
+    HRESULT ProcessExceptionCountsMessage(std::vector<BYTE>& result);
+    HRESULT ProcessEnableExceptionEventsMessage(const IpcMessage& message);
+    HRESULT ProcessDisableExceptionEventsMessage();
+    HRESULT WriteCallstackEvents(std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& nameCache);
+    HRESULT WriteNameCache(StacksEventProvider& eventProvider, NameCache& nameCache);
 private:
+    // Set first thing in Shutdown. Runtime callbacks already in progress on other threads may still use the members
+    // below, so they are shut down but only released with the profiler.
+    std::atomic_bool _isShutdown{ false };
     std::unique_ptr<CommandServer> _commandServer;
+    std::shared_ptr<SharedRingBuffer> _sharedRingBuffer;
+
+    // Only accessed from the unmanaged only command thread.
+    std::set<GUID, GuidLess> _knownModuleVersionIds;
+    // Names from the most recent snapshot, exported when there is no prewarmed cache. Only accessed from the unmanaged only command thread.
+    std::shared_ptr<NameCache> _lastSnapshotNameCache;
+    std::string _symbolTablePath;
 };
 
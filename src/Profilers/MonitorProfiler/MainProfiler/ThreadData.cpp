@@ -10,16 +10,25 @@ using namespace std;
 #define IfFalseLogRet(EXPR, hr) IfFalseLogRet_(_logger, EXPR, hr)
 
 ThreadData::ThreadData(const shared_ptr<ILogger>& logger) :
-    _exceptionCatcherFunctionId(NoFunctionId),
-    _hasException(false),
+    _exceptionCount(0),
+    _handlerCount(0),
     _logger(logger)
 {
 }
 
 void ThreadData::ClearException()
 {
-    _exceptionCatcherFunctionId = NoFunctionId;
-    _hasException = false;
+    if (_exceptionCount > 0)
+    {
+        _exceptionCount--;
+        ClearStaleHandlers();
+    }
+}
+
+void ThreadData::ClearAllExceptions()
+{
+    _exceptionCount = 0;
+    _handlerCount = 0;
 }
 
 HRESULT ThreadData::GetException(bool* hasException, FunctionID* catcherFunctionId)
@@ -27,18 +36,33 @@ HRESULT ThreadData::GetException(bool* hasException, FunctionID* catcherFunction
     ExpectedPtr(hasException);
     ExpectedPtr(catcherFunctionId);
 
-    *hasException = _hasException;
-    *catcherFunctionId = _exceptionCatcherFunctionId;
+    *hasException = _exceptionCount > 0;
+    *catcherFunctionId = _exceptionCount > 0 ? _exceptions[_exceptionCount - 1].CatcherFunctionId : NoFunctionId;
 
     return S_OK;
 }
 
 HRESULT ThreadData::SetHasException()
 {
-    IfFalseLogRet(!_hasException, E_UNEXPECTED);
-    IfFalseLogRet(NoFunctionId == _exceptionCatcherFunctionId, E_UNEXPECTED);
+    if (_exceptionCount == MaxNestedExceptions)
+    {
+        for (UINT32 i = 1; i < MaxNestedExceptions; i++)
+        {
+            _exceptions[i - 1] = _exceptions[i];
+        }
+        _exceptionCount--;
 
-    _hasException = true;
+        for (UINT32 i = 0; i < _handlerCount; i++)
+        {
+            if (_handlers[i].ExceptionCount > 0)
+            {
+                _handlers[i].ExceptionCount--;
+            }
+        }
+    }
+
+    _exceptions[_exceptionCount].CatcherFunctionId = NoFunctionId;
+    _exceptionCount++;
 
     return S_OK;
 }
@@ -46,10 +70,80 @@ HRESULT ThreadData::SetHasException()
 HRESULT ThreadData::SetExceptionCatcherFunction(FunctionID functionId)
 {
     IfFalseLogRet(NoFunctionId != functionId, E_INVALIDARG);
-    IfFalseLogRet(_hasException, E_UNEXPECTED);
+    IfFalseLogRet(_exceptionCount > 0, E_UNEXPECTED);
+
+    _exceptions[_exceptionCount - 1].CatcherFunctionId = functionId;
+
+    return S_OK;
+}
+
+HRESULT ThreadData::EnterExceptionHandler(FunctionID functionId, bool isFinally)
+{
+    IfFalseLogRet(NoFunctionId != functionId, E_INVALIDARG);
+
+    if (_handlerCount == MaxNestedHandlers)
+    {
+        for (UINT32 i = 1; i < MaxNestedHandlers; i++)
+        {
+            _handlers[i - 1] = _handlers[i];
+        }
+        _handlerCount--;
+    }
 
-    _exceptionCatcherFunctionId = functionId;
+    HandlerState& handler = _handlers[_handlerCount];
+    handler.ExceptionCount = _exceptionCount;
+    handler.FunctionId = functionId;
+    handler.IsFinally = isFinally;
+    _handlerCount++;
 
     return S_OK;
 }
+
+void ThreadData::LeaveExceptionHandler()
+{
+    if (_handlerCount == 0)
+    {
+        return;
+    }
+
+    _handlerCount--;
+    if (_exceptionCount > _handlers[_handlerCount].ExceptionCount)
+    {
+        _exceptionCount = _handlers[_handlerCount].ExceptionCount;
+    }
+}
+
+void ThreadData::SupersedeEscapedException(FunctionID functionId)
+{
+    if (_handlerCount == 0)
+    {
+        return;
+    }
+
+    const HandlerState& handler = _handlers[_handlerCount - 1];
+    if (!handler.IsFinally || handler.FunctionId != functionId || _exceptionCount <= handler.ExceptionCount)
+    {
+        return;
+    }
+    if (_exceptions[_exceptionCount - 1].CatcherFunctionId == functionId)
+    {
+        return;
+    }
+
+    // The innermost exception takes the place of the one that ran the finally block.
+    if (handler.ExceptionCount > 0)
+    {
+        _exceptions[handler.ExceptionCount - 1] = _exceptions[_exceptionCount - 1];
+        _exceptionCount = handler.ExceptionCount;
+    }
+    _handlerCount--;
+}
+
+void ThreadData::ClearStaleHandlers()
+{
+    while (_handlerCount > 0 && _handlers[_handlerCount - 1].ExceptionCount > _exceptionCount)
+    {
+        _handlerCount--;
+    }
+}
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
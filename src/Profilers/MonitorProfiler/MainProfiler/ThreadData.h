@@ -7,28 +7,68 @@
 #include <memory>
 #include "corhlpr.h"
 #include "corprof.h"
-#include "../Logging/Logger.h"
+#include "Logging/Logger.h"
 
 /// <summary>
 /// Class representing common data for a single thread.
+/// Exceptions are kept as a stack: an exception thrown while another is being processed, such as from a filter
+/// or a finally block, is pushed on top of it and the outer exception resumes once the nested one is caught.
+/// Filters and finally blocks record how deep the stack was when they were entered, so that exceptions thrown
+/// inside them that were not caught there can be discarded.
 /// </summary>
 class ThreadData
 {
 public:
     static const FunctionID NoFunctionId = 0;
 
+    // Deeper nesting drops the outermost exception, which is the most likely to have been abandoned.
+    static const UINT32 MaxNestedExceptions = 4;
+    // Deeper nesting of filters and finally blocks likewise drops the outermost.
+    static const UINT32 MaxNestedHandlers = 4;
+
 private:
-    FunctionID _exceptionCatcherFunctionId;
-    bool _hasException;
+    struct ExceptionState
+    {
+        FunctionID CatcherFunctionId;
+    };
+
+    struct HandlerState
+    {
+        // Exceptions being processed when the handler was entered; any beyond these were thrown inside it.
+        UINT32 ExceptionCount;
+        FunctionID FunctionId;
+        bool IsFinally;
+    };
+
+    // Held inline so that throwing does not allocate; _exceptions[_exceptionCount - 1] is the innermost exception.
+    ExceptionState _exceptions[MaxNestedExceptions];
+    UINT32 _exceptionCount;
+    HandlerState _handlers[MaxNestedHandlers];
+    UINT32 _handlerCount;
     std::shared_ptr<ILogger> _logger;
 
 public:
     ThreadData(const std::shared_ptr<ILogger>& logger);
 
     // Exceptions
+    // These apply to the innermost exception, except ClearAllExceptions.
     void ClearException();
+    void ClearAllExceptions();
     HRESULT GetException(bool* hasException, FunctionID* catcherFunctionId);
     HRESULT SetHasException();
     HRESULT SetExceptionCatcherFunction(FunctionID functionId);
+
+    // Filters and finally blocks of functionId that run while exceptions are processed.
+    HRESULT EnterExceptionHandler(FunctionID functionId, bool isFinally);
+    // Discards the exceptions thrown inside the innermost handler, such as one the runtime swallowed as it escaped a filter.
+    void LeaveExceptionHandler();
+    // Called as the innermost exception starts unwinding functionId. The finally block of functionId does not return
+    // if an exception escapes it, so an exception thrown there that unwinds functionId without being caught in it
+    // supersedes the exception that ran the finally block.
+    void SupersedeEscapedException(FunctionID functionId);
+
+private:
+    // Handlers entered while an exception that has since been cleared was processed are over.
+    void ClearStaleHandlers();
 };
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
@@ -11,9 +11,10 @@ using namespace std;
 #define IfFailLogRet(EXPR) IfFailLogRet_(_logger, EXPR)
 #define IfFalseLogRet(EXPR, hr) IfFalseLogRet_(_logger, EXPR, hr)
 
-typedef unordered_map<ThreadID, shared_ptr<ThreadData>>::iterator DataMapIterator;
+atomic<UINT64> ThreadDataManager::s_nextGeneration(1);
 
-ThreadDataManager::ThreadDataManager(const shared_ptr<ILogger>& logger)
+ThreadDataManager::ThreadDataManager(const shared_ptr<ILogger>& logger) :
+    _generation(s_nextGeneration++)
 {
     _logger = logger;
 }
@@ -26,18 +27,18 @@ void ThreadDataManager::AddProfilerEventMask(DWORD& eventsLow)
 
 HRESULT ThreadDataManager::ThreadCreated(ThreadID threadId)
 {
-    lock_guard<mutex> lock(_dataMapMutex);
-
-    _dataMap.insert(make_pair(threadId, make_shared<ThreadData>(_logger)));
-
     return S_OK;
 }
 
 HRESULT ThreadDataManager::ThreadDestroyed(ThreadID threadId)
 {
-    lock_guard<mutex> lock(_dataMapMutex);
-
-    _dataMap.erase(threadId);
+    ThreadDataSlot& slot = GetCurrentSlot();
+    if (slot.ManagerGeneration == _generation && slot.ThreadId == threadId)
+    {
+        slot.ManagerGeneration = 0;
+        slot.ThreadId = 0;
+        slot.Data.reset();
+    }
 
     return S_OK;
 }
@@ -46,7 +47,7 @@ HRESULT ThreadDataManager::ClearException(ThreadID threadId)
 {
     HRESULT hr = S_OK;
 
-    shared_ptr<ThreadData> threadData;
+    ThreadData* threadData = nullptr;
     IfFailLogRet(GetThreadData(threadId, threadData));
 
     threadData->ClearException();
@@ -61,7 +62,7 @@ HRESULT ThreadDataManager::GetException(ThreadID threadId, bool* hasException, F
 
     HRESULT hr = S_OK;
 
-    shared_ptr<ThreadData> threadData;
+    ThreadData* threadData = nullptr;
     IfFailLogRet(GetThreadData(threadId, threadData));
 
     IfFailLogRet(threadData->GetException(hasException, catcherFunctionId));
@@ -73,7 +74,7 @@ HRESULT ThreadDataManager::SetHasException(ThreadID threadId)
 {
     HRESULT hr = S_OK;
 
-    shared_ptr<ThreadData> threadData;
+    ThreadData* threadData = nullptr;
     IfFailLogRet(GetThreadData(threadId, threadData));
 
     IfFailLogRet(threadData->SetHasException());
@@ -85,7 +86,7 @@ HRESULT ThreadDataManager::SetExceptionCatcherFunction(ThreadID threadId, Functi
 {
     HRESULT hr = S_OK;
 
-    shared_ptr<ThreadData> threadData;
+    ThreadData* threadData = nullptr;
     IfFailLogRet(GetThreadData(threadId, threadData));
 
     IfFailLogRet(threadData->SetExceptionCatcherFunction(catcherFunctionId));
@@ -93,14 +94,66 @@ HRESULT ThreadDataManager::SetExceptionCatcherFunction(ThreadID threadId, Functi
     return S_OK;
 }
 
-HRESULT ThreadDataManager::GetThreadData(ThreadID threadId, shared_ptr<ThreadData>& threadData)
+HRESULT ThreadDataManager::EnterExceptionHandler(ThreadID threadId, FunctionID functionId, bool isFinally)
+{
+    HRESULT hr = S_OK;
+
+    ThreadData* threadData = nullptr;
+    IfFailLogRet(GetThreadData(threadId, threadData));
+
+    IfFailLogRet(threadData->EnterExceptionHandler(functionId, isFinally));
+
+    return S_OK;
+}
+
+HRESULT ThreadDataManager::LeaveExceptionHandler(ThreadID threadId)
 {
-    lock_guard<mutex> mapLock(_dataMapMutex);
+    HRESULT hr = S_OK;
+
+    ThreadData* threadData = nullptr;
+    IfFailLogRet(GetThreadData(threadId, threadData));
 
-    DataMapIterator iterator = _dataMap.find(threadId);
-    IfFalseLogRet(iterator != _dataMap.end(), E_UNEXPECTED);
+    threadData->LeaveExceptionHandler();
 
-    threadData = iterator->second;
+    return S_OK;
+}
+
+HRESULT ThreadDataManager::SupersedeEscapedException(ThreadID threadId, FunctionID functionId)
+{
+    HRESULT hr = S_OK;
+
+    ThreadData* threadData = nullptr;
+    IfFailLogRet(GetThreadData(threadId, threadData));
+
+    threadData->SupersedeEscapedException(functionId);
+
+    return S_OK;
+}
+
+ThreadDataManager::ThreadDataSlot& ThreadDataManager::GetCurrentSlot()
+{
+    static thread_local ThreadDataSlot slot;
+    return slot;
+}
+
+HRESULT ThreadDataManager::GetThreadData(ThreadID threadId, ThreadData*& threadData)
+{
+    ThreadDataSlot& slot = GetCurrentSlot();
+
+    if (slot.ManagerGeneration != _generation)
+    {
+        slot.Data.reset(new (nothrow) ThreadData(_logger));
+        IfNullRet(slot.Data);
+        slot.ManagerGeneration = _generation;
+        slot.ThreadId = threadId;
+    }
+    else if (slot.ThreadId != threadId)
+    {
+        slot.Data->ClearAllExceptions();
+        slot.ThreadId = threadId;
+    }
+
+    threadData = slot.Data.get();
 
     return S_OK;
 }
@@ -4,23 +4,35 @@
 #pragma once
 
 #ifdef DOTNETMONITOR_FEATURE_EXCEPTIONS
+#include <atomic>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
 #include "corhlpr.h"
 #include "corprof.h"
 #include "ThreadData.h"
-#include "../Logging/Logger.h"
+#include "Logging/Logger.h"
 
 /// <summary>
 /// Class for managing common thread information.
+/// Thread data is only accessed from its own thread, since the exception callbacks run on the thread that threw,
+/// so it is kept in thread local storage rather than in a map shared by all threads.
 /// </summary>
 class ThreadDataManager
 {
 private:
-    std::unordered_map<ThreadID, std::shared_ptr<ThreadData>> _dataMap;
-    std::mutex _dataMapMutex;
+    struct ThreadDataSlot
+    {
+        // The data is reset when the OS thread is reused for another managed thread or manager.
+        // Managers are told apart by generation rather than address, which a later manager could reuse.
+        UINT64 ManagerGeneration = 0;
+        ThreadID ThreadId = 0;
+        std::unique_ptr<ThreadData> Data;
+    };
+
     std::shared_ptr<ILogger> _logger;
+    UINT64 _generation;
+
+    // 0 is left for slots that no manager has used.
+    static std::atomic<UINT64> s_nextGeneration;
 
 public:
     ThreadDataManager(const std::shared_ptr<ILogger>& logger);
@@ -31,16 +43,23 @@ public:
     static void AddProfilerEventMask(DWORD& eventsLow);
 
     // Threads
+    // Thread data is created on first use; these only release it early when called on the thread itself.
     HRESULT ThreadCreated(ThreadID threadId);
     HRESULT ThreadDestroyed(ThreadID threadId);
 
     // Exceptions
+    // threadId must be the current thread. These apply to the innermost exception being processed on the thread.
     HRESULT ClearException(ThreadID threadId);
     HRESULT GetException(ThreadID threadId, bool* hasException, FunctionID* catcherFunctionId);
     HRESULT SetHasException(ThreadID threadId);
     HRESULT SetExceptionCatcherFunction(ThreadID threadId, FunctionID catcherFunctionId);
+    HRESULT EnterExceptionHandler(ThreadID threadId, FunctionID functionId, bool isFinally);
+    HRESULT LeaveExceptionHandler(ThreadID threadId);
+    HRESULT SupersedeEscapedException(ThreadID threadId, FunctionID functionId);
 
 private:
-    HRESULT GetThreadData(ThreadID threadId, std::shared_ptr<ThreadData>& threadData);
+    static ThreadDataSlot& GetCurrentSlot();
+    // Lock free; the data stays valid until the thread exits or its slot is reset.
+    HRESULT GetThreadData(ThreadID threadId, ThreadData*& threadData);
 };
 #endif // DOTNETMONITOR_FEATURE_EXCEPTIONS
@@ -0,0 +1,144 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "NameCachePrewarmer.h"
+#include "corhlpr.h"
+#include "CommonUtilities/ThreadUtilities.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+
+constexpr UINT32 NameCachePrewarmer::DefaultBatchSize;
+constexpr UINT32 NameCachePrewarmer::DefaultBatchDelayMilliseconds;
+
+NameCachePrewarmer::NameCachePrewarmer(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, const std::shared_ptr<NameCache>& nameCache) :
+    _shutdown(false),
+    _nameCache(nameCache),
+    _logger(logger),
+    _profilerInfo(profilerInfo)
+{
+}
+
+void NameCachePrewarmer::AddProfilerEventMask(DWORD& eventsLow)
+{
+    eventsLow |= COR_PRF_MONITOR::COR_PRF_MONITOR_JIT_COMPILATION | COR_PRF_MONITOR::COR_PRF_MONITOR_MODULE_LOADS;
+}
+
+HRESULT NameCachePrewarmer::Start(UINT32 batchSize, UINT32 batchDelayMilliseconds)
+{
+    if (_shutdown.load())
+    {
+        return E_UNEXPECTED;
+    }
+
+    _batchSize = batchSize > 0 ? batchSize : DefaultBatchSize;
+    _batchDelayMilliseconds = batchDelayMilliseconds;
+
+    _prewarmThread = std::thread(&NameCachePrewarmer::PrewarmThread, this);
+
+    return S_OK;
+}
+
+void NameCachePrewarmer::Shutdown()
+{
+    bool shutdown = false;
+    if (_shutdown.compare_exchange_strong(shutdown, true))
+    {
+        _queue.Complete();
+        if (_prewarmThread.joinable())
+        {
+            _prewarmThread.join();
+        }
+    }
+}
+
+void NameCachePrewarmer::FunctionCompiled(FunctionID functionId)
+{
+    PrewarmRequest request;
+    request.Type = PrewarmRequestType::Function;
+    request.Id = static_cast<UINT_PTR>(functionId);
+
+    // Fails only when the queue is full or after shutdown; either way the name is left to the snapshot.
+    _queue.TryEnqueue(std::move(request));
+}
+
+void NameCachePrewarmer::ModuleLoaded(ModuleID moduleId)
+{
+    PrewarmRequest request;
+    request.Type = PrewarmRequestType::Module;
+    request.Id = static_cast<UINT_PTR>(moduleId);
+
+    _queue.TryEnqueue(std::move(request));
+}
+
+void NameCachePrewarmer::ClassReferenced(ClassID classId)
+{
+    PrewarmRequest request;
+    request.Type = PrewarmRequestType::Class;
+    request.Id = static_cast<UINT_PTR>(classId);
+
+    _queue.TryEnqueue(std::move(request));
+}
+
+void NameCachePrewarmer::ModuleUnloaded(ModuleID moduleId)
+{
+    // Requests for the module's functions that are still queued fail to resolve once it has unloaded.
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _nameCache->RemoveModule(moduleId);
+}
+
+void NameCachePrewarmer::PrewarmThread()
+{
+    HRESULT hr = _profilerInfo->InitializeCurrentThread();
+    if (FAILED(hr))
+    {
+        _logger->Log(LogLevel::Error, _LS("Unable to initialize thread: 0x%08x"), hr);
+        return;
+    }
+
+    ThreadUtilities::LowerCurrentThreadPriority();
+
+    TypeNameUtilities nameUtilities(_profilerInfo);
+    UINT32 resolvedInBatch = 0;
+
+    while (true)
+    {
+        PrewarmRequest request;
+        hr = _queue.BlockingDequeue(request);
+        if (hr != S_OK)
+        {
+            //We are complete, discard all remaining requests
+            break;
+        }
+
+        {
+            // The lock is only held for a single resolution so that a pending stack snapshot is not delayed by the prewarmer.
+            std::lock_guard<std::mutex> lock(_cacheMutex);
+            if (request.Type == PrewarmRequestType::Function)
+            {
+                hr = nameUtilities.CacheNames(*_nameCache, static_cast<FunctionID>(request.Id), 0);
+            }
+            else if (request.Type == PrewarmRequestType::Class)
+            {
+                hr = nameUtilities.CacheNames(*_nameCache, static_cast<ClassID>(request.Id));
+            }
+            else
+            {
+                hr = nameUtilities.CacheModuleNames(*_nameCache, static_cast<ModuleID>(request.Id));
+            }
+        }
+
+        if (FAILED(hr))
+        {
+            // Functions and modules may be unloaded before we get to them; the snapshot will resolve them if they appear on a stack.
+            _logger->Log(LogLevel::Debug, _LS("Unable to prewarm name cache: 0x%08x"), hr);
+        }
+
+        if (++resolvedInBatch >= _batchSize)
+        {
+            resolvedInBatch = 0;
+            if (_batchDelayMilliseconds > 0)
+            {
+                ThreadUtilities::Sleep(_batchDelayMilliseconds);
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "com.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "CommonUtilities/BoundedQueue.h"
+#include "CommonUtilities/NameCache.h"
+#include "Logging/Logger.h"
+
+/// <summary>
+/// Resolves names of newly jitted functions, loaded modules and referenced classes on a low priority background thread
+/// so that stack snapshots find them in the shared NameCache instead of resolving metadata while the runtime is suspended.
+/// The NameCache is not thread safe; all access to it must hold the lock returned by GetCacheLock.
+/// </summary>
+class NameCachePrewarmer final
+{
+public:
+    static constexpr UINT32 DefaultBatchSize = 64;
+    static constexpr UINT32 DefaultBatchDelayMilliseconds = 10;
+
+    NameCachePrewarmer(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, const std::shared_ptr<NameCache>& nameCache);
+
+    /// <summary>
+    /// Starts the background thread. After resolving batchSize names the thread sleeps for batchDelayMilliseconds,
+    /// which bounds the CPU the prewarmer can consume.
+    /// </summary>
+    HRESULT Start(UINT32 batchSize, UINT32 batchDelayMilliseconds);
+    void Shutdown();
+
+    static void AddProfilerEventMask(DWORD& eventsLow);
+
+    void FunctionCompiled(FunctionID functionId);
+    void ModuleLoaded(ModuleID moduleId);
+    void ClassReferenced(ClassID classId);
+    // Evicts the module's names right away, rather than through the queue, so that its ids can be reused.
+    void ModuleUnloaded(ModuleID moduleId);
+
+    std::mutex& GetCacheLock() { return _cacheMutex; }
+    std::shared_ptr<NameCache> GetNameCache() { return _nameCache; }
+
+private:
+    enum class PrewarmRequestType
+    {
+        Function,
+        Module,
+        Class
+    };
+
+    struct PrewarmRequest
+    {
+        PrewarmRequestType Type;
+        UINT_PTR Id;
+    };
+
+    void PrewarmThread();
+
+    std::atomic_bool _shutdown;
+    UINT32 _batchSize = DefaultBatchSize;
+    UINT32 _batchDelayMilliseconds = DefaultBatchDelayMilliseconds;
+
+    // Requests are called from runtime callbacks and must not wait, so they are dropped when the thread falls this far behind.
+    // Names that are dropped are resolved by the snapshot if they appear on a stack.
+    static constexpr size_t QueueCapacity = 4096;
+    BoundedQueue<PrewarmRequest, QueueCapacity> _queue;
+    std::mutex _cacheMutex;
+    std::shared_ptr<NameCache> _nameCache;
+    std::shared_ptr<ILogger> _logger;
+    std::thread _prewarmThread;
+    ComPtr<ICorProfilerInfo12> _profilerInfo;
+};
@@ -0,0 +1,200 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "ParallelNameResolver.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <algorithm>
+#include <exception>
+
+constexpr UINT32 ParallelNameResolver::DefaultMaxWorkers;
+constexpr size_t ParallelNameResolver::MinFunctionsPerWorker;
+
+ParallelNameResolver::ParallelNameResolver(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, UINT32 maxWorkers) :
+    _logger(logger),
+    _profilerInfo(profilerInfo),
+    _maxWorkers(maxWorkers),
+    _nextFunction(0)
+{
+}
+
+ParallelNameResolver::~ParallelNameResolver()
+{
+    Shutdown();
+}
+
+void ParallelNameResolver::Shutdown()
+{
+    std::lock_guard<std::mutex> resolveLock(_resolveMutex);
+
+    StopWorkers();
+    _workersUnavailable = true;
+}
+
+HRESULT ParallelNameResolver::Resolve(NameCache& nameCache, const std::vector<FunctionInstance>& functions)
+{
+    HRESULT hr = S_OK;
+    HRESULT firstFailure = S_OK;
+    size_t nextFunction = 0;
+
+    std::lock_guard<std::mutex> resolveLock(_resolveMutex);
+
+    size_t workerCount = std::min<size_t>(_maxWorkers, functions.size() / MinFunctionsPerWorker);
+    if (workerCount > 1 && StartWorkers() == S_OK)
+    {
+        {
+            std::unique_lock<std::mutex> jobLock(_jobMutex);
+
+            for (std::unique_ptr<NameCache>& workerCache : _workerCaches)
+            {
+                workerCache.reset(new (std::nothrow) NameCache());
+                IfNullRet(workerCache);
+            }
+            std::fill(_workerResults.begin(), _workerResults.end(), S_OK);
+
+            _functions = &functions;
+            _nextFunction.store(0);
+            _busyWorkers = _workers.size();
+            _generation++;
+            _jobStarted.notify_all();
+
+            _jobFinished.wait(jobLock, [this]() { return _busyWorkers == 0; });
+            _functions = nullptr;
+        }
+
+        for (size_t i = 0; i < _workers.size(); i++)
+        {
+            nameCache.Merge(*_workerCaches[i]);
+            _workerCaches[i].reset();
+
+            if (FAILED(_workerResults[i]) && SUCCEEDED(firstFailure))
+            {
+                firstFailure = _workerResults[i];
+            }
+        }
+
+        nextFunction = std::min(_nextFunction.load(), functions.size());
+    }
+
+    // Resolves everything when there are too few functions for workers, and anything left over if none of the workers
+    // could be initialized.
+    TypeNameUtilities nameUtilities(_profilerInfo);
+    for (size_t i = nextFunction; i < functions.size(); i++)
+    {
+        hr = nameUtilities.CacheNames(nameCache, functions[i]);
+        if (FAILED(hr) && SUCCEEDED(firstFailure))
+        {
+            firstFailure = hr;
+        }
+    }
+
+    if (FAILED(firstFailure))
+    {
+        _logger->Log(LogLevel::Warning, _LS("Unable to resolve the names of some functions: 0x%08x"), firstFailure);
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+HRESULT ParallelNameResolver::StartWorkers()
+{
+    if (!_workers.empty())
+    {
+        return S_OK;
+    }
+
+    if (_workersUnavailable)
+    {
+        return S_FALSE;
+    }
+
+    try
+    {
+        _workerCaches.resize(_maxWorkers);
+        _workerResults.resize(_maxWorkers, S_OK);
+        _workers.reserve(_maxWorkers);
+        for (UINT32 i = 0; i < _maxWorkers; i++)
+        {
+            _workers.push_back(std::thread(&ParallelNameResolver::WorkerThread, this, static_cast<size_t>(i)));
+        }
+    }
+    catch (const std::exception&)
+    {
+        // std::thread throws system_error when the thread cannot be created. Threads that did start must be joined
+        // before they are destroyed, and snapshots are resolved on the calling thread from then on.
+        _logger->Log(LogLevel::Warning, _LS("Unable to start name resolution workers, resolving names serially."));
+        StopWorkers();
+        _workersUnavailable = true;
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+void ParallelNameResolver::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> jobLock(_jobMutex);
+        _shutdown = true;
+    }
+    _jobStarted.notify_all();
+
+    for (std::thread& worker : _workers)
+    {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void ParallelNameResolver::WorkerThread(size_t index)
+{
+    // A worker that cannot be initialized still takes part in each job so that Resolve is not left waiting for it,
+    // but leaves the functions to the other workers and the calling thread.
+    HRESULT hr = _profilerInfo->InitializeCurrentThread();
+    bool initialized = SUCCEEDED(hr);
+    if (!initialized)
+    {
+        _logger->Log(LogLevel::Error, _LS("Unable to initialize thread: 0x%08x"), hr);
+    }
+
+    TypeNameUtilities nameUtilities(_profilerInfo);
+    UINT64 generation = 0;
+
+    std::unique_lock<std::mutex> jobLock(_jobMutex);
+    while (true)
+    {
+        _jobStarted.wait(jobLock, [this, generation]() { return _shutdown || _generation != generation; });
+        if (_shutdown)
+        {
+            return;
+        }
+
+        generation = _generation;
+        const std::vector<FunctionInstance>& functions = *_functions;
+        NameCache& workerCache = *_workerCaches[index];
+        HRESULT& result = _workerResults[index];
+        jobLock.unlock();
+
+        if (initialized)
+        {
+            // Functions are handed out one at a time since the cost of resolving each varies widely
+            // depending on how many of its classes and type arguments are already cached.
+            size_t functionIndex;
+            while ((functionIndex = _nextFunction.fetch_add(1)) < functions.size())
+            {
+                hr = nameUtilities.CacheNames(workerCache, functions[functionIndex]);
+                if (FAILED(hr) && SUCCEEDED(result))
+                {
+                    result = hr;
+                }
+            }
+        }
+
+        jobLock.lock();
+        if (--_busyWorkers == 0)
+        {
+            _jobFinished.notify_one();
+        }
+    }
+}
@@ -0,0 +1,70 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "com.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+#include "Logging/Logger.h"
+
+/// <summary>
+/// Resolves the names of functions captured by a stack snapshot on a set of native worker threads.
+/// Each worker fills its own NameCache, and the results are merged into the target cache once all workers finish,
+/// so the target cache is only read while the workers are running.
+/// The workers are started on first use and kept for later snapshots, so each is initialized with the runtime only once.
+/// </summary>
+class ParallelNameResolver final
+{
+public:
+    static constexpr UINT32 DefaultMaxWorkers = 4;
+
+    // Below this many functions per worker the cost of handing them out outweighs the gain, so they are resolved on the calling thread.
+    static constexpr size_t MinFunctionsPerWorker = 32;
+
+    ParallelNameResolver(const std::shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo, UINT32 maxWorkers);
+    ~ParallelNameResolver();
+
+    /// <summary>
+    /// Adds the names of all functions to nameCache. Returns S_FALSE when some functions could not be resolved;
+    /// the first failure is logged and those frames are reported without names.
+    /// </summary>
+    HRESULT Resolve(NameCache& nameCache, const std::vector<FunctionInstance>& functions);
+
+    void Shutdown();
+
+private:
+    // Returns S_FALSE when the workers could not be started; the calling thread then resolves everything.
+    HRESULT StartWorkers();
+    void StopWorkers();
+    void WorkerThread(size_t index);
+
+    std::shared_ptr<ILogger> _logger;
+    ComPtr<ICorProfilerInfo12> _profilerInfo;
+    UINT32 _maxWorkers;
+
+    // Only one snapshot is resolved at a time.
+    std::mutex _resolveMutex;
+    bool _workersUnavailable = false;
+    std::vector<std::thread> _workers;
+
+    // Guards the job below, which is handed to every worker when _generation changes.
+    std::mutex _jobMutex;
+    std::condition_variable _jobStarted;
+    std::condition_variable _jobFinished;
+    UINT64 _generation = 0;
+    size_t _busyWorkers = 0;
+    bool _shutdown = false;
+    const std::vector<FunctionInstance>* _functions = nullptr;
+    std::vector<std::unique_ptr<NameCache>> _workerCaches;
+    std::vector<HRESULT> _workerResults;
+    std::atomic<size_t> _nextFunction;
+};
@@ -6,6 +6,7 @@
 #include <vector>
 #include "cor.h"
 #include "corprof.h"
+#include "tstring.h"
 
 class Stack
 {
@@ -22,6 +23,15 @@ public:
         _functionIds.push_back(functionID);
         _offsets.push_back(offset);
     }
+
+    // Keeps the capacity, so that a reused stack does not allocate again.
+    void Clear()
+    {
+        _tid = 0;
+        _functionIds.clear();
+        _offsets.clear();
+        _name.clear();
+    }
 private:
     UINT32 _tid = 0;
     //We model these as two parallel arrays instead of objects to simplify conversion to the EventSource format of std::vector<BYTE>
@@ -0,0 +1,46 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "StackInterner.h"
+#include "corhlpr.h"
+
+constexpr size_t StackInterner::MaxStacksPerShard;
+
+StackInterner::StackInterner() :
+    _nextStackId(1)
+{
+}
+
+size_t StackInterner::StackKeyHash::operator()(const StackKey& key) const
+{
+    // FNV-1a over the frames.
+    UINT64 hash = 14695981039346656037ULL;
+    for (UINT64 value : key)
+    {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+HRESULT StackInterner::GetShard(const Stack& stack, const StackKey*& key, Shard*& shard)
+{
+    const std::vector<UINT64>& functionIds = stack.GetFunctionIds();
+    const std::vector<UINT64>& offsets = stack.GetOffsets();
+
+    // Reused so that looking up a stack that is already interned does not allocate.
+    static thread_local StackKey threadKey;
+    IfOomRetMem(threadKey.resize(functionIds.size() * 2));
+    for (size_t i = 0; i < functionIds.size(); i++)
+    {
+        threadKey[2 * i] = functionIds[i];
+        threadKey[2 * i + 1] = offsets[i];
+    }
+
+    size_t hash = StackKeyHash()(threadKey);
+    // The low bits select the bucket within the shard's map, so the shard is chosen from the high bits.
+    shard = &_shards[(hash >> 24) % ShardCount];
+    key = &threadKey;
+
+    return S_OK;
+}
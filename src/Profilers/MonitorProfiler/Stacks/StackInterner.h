@@ -0,0 +1,102 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corhlpr.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Stack.h"
+#include "macros.h"
+
+/// <summary>
+/// Assigns ids to stacks, so that a stack seen many times is described once and then referred to by its id.
+/// Safe to call from any thread; stacks are spread over independently locked shards by their hash.
+/// </summary>
+class StackInterner final
+{
+public:
+    StackInterner();
+
+    /// <summary>
+    /// Gets the id of the stack, adding it if it is new or was last described in another session. onAdded(stackId)
+    /// describes the stack and runs while its shard is locked, so no other caller gets the id before it is described.
+    /// Returns S_OK when onAdded ran, and S_FALSE when the stack was already described in this session.
+    /// When onAdded fails, its failure is returned and the stack is described again the next time it is seen.
+    /// </summary>
+    template<typename TCallback>
+    HRESULT Intern(const Stack& stack, UINT32 sessionId, TCallback onAdded, UINT32& stackId)
+    {
+        HRESULT hr;
+
+        const StackKey* key;
+        Shard* shard;
+        IfFailRet(GetShard(stack, key, shard));
+
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+
+        auto const& it = shard->Stacks.find(*key);
+        bool found = it != shard->Stacks.end();
+        if (found && it->second.SessionId == sessionId)
+        {
+            stackId = it->second.StackId;
+            return S_FALSE;
+        }
+
+        // A stack keeps its id across sessions; only the description is repeated.
+        stackId = found ? it->second.StackId : _nextStackId++;
+        IfFailRet(onAdded(stackId));
+
+        if (found)
+        {
+            it->second.SessionId = sessionId;
+            return S_OK;
+        }
+
+        if (shard->Stacks.size() >= MaxStacksPerShard)
+        {
+            shard->Stacks.clear();
+        }
+        IfOomRetMem(shard->Stacks.emplace(*key, StackEntry(stackId, sessionId)));
+
+        return S_OK;
+    }
+
+    // Past this, a shard forgets its stacks rather than growing without bound.
+    static constexpr size_t MaxStacksPerShard = 4096;
+
+private:
+    // Frames as FunctionId, offset pairs.
+    typedef std::vector<UINT64> StackKey;
+
+    struct StackKeyHash
+    {
+        size_t operator()(const StackKey& key) const;
+    };
+
+    struct StackEntry
+    {
+        StackEntry(UINT32 stackId, UINT32 sessionId) : StackId(stackId), SessionId(sessionId) {}
+
+        UINT32 StackId;
+        // Session the stack was last described in.
+        UINT32 SessionId;
+    };
+
+    struct Shard
+    {
+        std::mutex Mutex;
+        std::unordered_map<StackKey, StackEntry, StackKeyHash> Stacks;
+    };
+
+    // Builds the key of the stack in a buffer owned by the calling thread, and selects its shard.
+    HRESULT GetShard(const Stack& stack, const StackKey*& key, Shard*& shard);
+
+    static constexpr size_t ShardCount = 16;
+
+    Shard _shards[ShardCount];
+    std::atomic<UINT32> _nextStackId;
+};
@@ -3,9 +3,11 @@
 
 #include "StackSampler.h"
 #include "corhlpr.h"
+#include "macros.h"
 #include "Stack.h"
 #include <functional>
 #include <memory>
+#include <unordered_set>
 #include "CommonUtilities/TypeNameUtilities.h"
 
 StackSamplerState::StackSamplerState(ICorProfilerInfo12* profilerInfo, std::shared_ptr<NameCache> nameCache)
@@ -28,7 +30,14 @@ ICorProfilerInfo12* StackSamplerState::GetProfilerInfo()
     return _profilerInfo;
 }
 
-StackSampler::StackSampler(ICorProfilerInfo12* profilerInfo) : _profilerInfo(profilerInfo)
+std::vector<FunctionInstance>& StackSamplerState::GetUnresolvedFunctions()
+{
+    return _unresolvedFunctions;
+}
+
+StackSampler::StackSampler(ICorProfilerInfo12* profilerInfo, const std::shared_ptr<ParallelNameResolver>& nameResolver) :
+    _profilerInfo(profilerInfo),
+    _nameResolver(nameResolver)
 {
 }
 
@@ -37,6 +46,23 @@ void StackSampler::AddProfilerEventMask(DWORD& eventsLow)
     eventsLow |= COR_PRF_MONITOR::COR_PRF_ENABLE_STACK_SNAPSHOT | COR_PRF_MONITOR_THREADS;
 }
 
+HRESULT StackSampler::CopyReferencedNames(const std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& source, NameCache& target)
+{
+    for (const std::unique_ptr<StackSamplerState>& stackState : stackStates)
+    {
+        for (UINT64 functionId : stackState->GetStack().GetFunctionIds())
+        {
+            //FunctionId of 0 indicates a native frame.
+            if (functionId != 0)
+            {
+                IfOomRetMem(target.CopyFunctionNames(source, static_cast<FunctionID>(functionId)));
+            }
+        }
+    }
+
+    return S_OK;
+}
+
 HRESULT StackSampler::CreateCallstack(std::vector<std::unique_ptr<StackSamplerState>>& stackStates,
     std::shared_ptr<NameCache>& nameCache,
     std::shared_ptr<ThreadNameCache>& threadNames)
@@ -83,9 +109,35 @@ HRESULT StackSampler::CreateCallstack(std::vector<std::unique_ptr<StackSamplerSt
         }
     }
 
+    // Metadata lookups do not need the runtime to be suspended.
+    resumeRuntimeHandle.reset();
+
+    IfFailRet(ResolveNames(stackStates, *nameCache));
+
     return S_OK;
 }
 
+HRESULT StackSampler::ResolveNames(std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& nameCache)
+{
+    std::vector<FunctionInstance> functions;
+    std::unordered_set<FunctionID> seenFunctions;
+
+    for (std::unique_ptr<StackSamplerState>& stackState : stackStates)
+    {
+        for (FunctionInstance& instance : stackState->GetUnresolvedFunctions())
+        {
+            // The same function commonly appears on many stacks.
+            if (seenFunctions.insert(instance.FunctionId).second)
+            {
+                functions.push_back(std::move(instance));
+            }
+        }
+        stackState->GetUnresolvedFunctions().clear();
+    }
+
+    return _nameResolver->Resolve(nameCache, functions);
+}
+
 HRESULT __stdcall StackSampler::DoStackSnapshotCallbackWrapper(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData)
 {
     HRESULT hr;
@@ -97,9 +149,22 @@ HRESULT __stdcall StackSampler::DoStackSnapshotCallbackWrapper(FunctionID functi
     //FunctionId of 0 indicates a native frame.
     if (functionId != 0)
     {
-        std::shared_ptr<NameCache> nameCache = state->GetNameCache();
-        TypeNameUtilities nameUtilities(state->GetProfilerInfo());
-        IfFailRet(nameUtilities.CacheNames(*nameCache, functionId, frameInfo));
+        std::shared_ptr<FunctionData> functionData;
+        bool cached = state->GetNameCache()->TryGetFunctionData(functionId, functionData);
+        // The prewarmer resolves without frame info, which names the canonical instantiation of shared generic code,
+        // so generic entries are checked against the instantiation on this frame.
+        if (!cached || TypeNameUtilities::IsGeneric(*functionData))
+        {
+            // frameInfo is only valid during the callback, so the exact instantiation is captured now.
+            // Everything else is looked up once the runtime resumes.
+            FunctionInstance instance;
+            TypeNameUtilities nameUtilities(state->GetProfilerInfo());
+            IfFailRet(nameUtilities.GetFunctionInstance(functionId, frameInfo, instance));
+            if (!cached || !TypeNameUtilities::IsSameInstantiation(*functionData, instance))
+            {
+                state->GetUnresolvedFunctions().push_back(std::move(instance));
+            }
+        }
     }
 
     return S_OK;
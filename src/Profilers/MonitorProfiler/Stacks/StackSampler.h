@@ -10,6 +10,10 @@
 #include "Stack.h"
 #include "CommonUtilities/NameCache.h"
 #include "CommonUtilities/ThreadNameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+#include "ParallelNameResolver.h"
+#include <memory>
+#include <vector>
 
 class StackSamplerState
 {
@@ -18,20 +22,27 @@ class StackSamplerState
         Stack& GetStack();
         std::shared_ptr<NameCache> GetNameCache();
         ICorProfilerInfo12* GetProfilerInfo();
+        // Functions seen on this stack that are not yet in the NameCache; resolved after the runtime resumes.
+        std::vector<FunctionInstance>& GetUnresolvedFunctions();
     private:
         ComPtr<ICorProfilerInfo12> _profilerInfo;
         Stack _stack;
         std::shared_ptr<NameCache> _nameCache;
+        std::vector<FunctionInstance> _unresolvedFunctions;
 };
 
 class StackSampler
 {
     public:
-        StackSampler(ICorProfilerInfo12* profilerInfo);
+        StackSampler(ICorProfilerInfo12* profilerInfo, const std::shared_ptr<ParallelNameResolver>& nameResolver);
         HRESULT CreateCallstack(std::vector<std::unique_ptr<StackSamplerState>>& stackStates,
             std::shared_ptr<NameCache>& nameCache,
             std::shared_ptr<ThreadNameCache>& threadNames);
         static void AddProfilerEventMask(DWORD& eventsLow);
+
+        // Copies the names of the functions on the captured stacks from source, so that a snapshot taken with a long lived
+        // cache only describes what it references.
+        static HRESULT CopyReferencedNames(const std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& source, NameCache& target);
     private:
         static HRESULT __stdcall DoStackSnapshotCallbackWrapper(
             FunctionID functionId,
@@ -41,5 +52,8 @@ class StackSampler
             BYTE context[],
             void* clientData);
 
+        HRESULT ResolveNames(std::vector<std::unique_ptr<StackSamplerState>>& stackStates, NameCache& nameCache);
+
         ComPtr<ICorProfilerInfo12> _profilerInfo;
+        std::shared_ptr<ParallelNameResolver> _nameResolver;
 };
@@ -0,0 +1,86 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "StackStreamWriter.h"
+#include "CommonUtilities/SymbolTableWriter.h"
+#include "corhlpr.h"
+#include "macros.h"
+#include <string.h>
+
+using namespace StackStream;
+
+namespace
+{
+    size_t AlignUp(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    size_t GetStackSize(const Stack& stack)
+    {
+        return sizeof(StackRecord) +
+            stack.GetFunctionIds().size() * sizeof(UINT64) +
+            stack.GetOffsets().size() * sizeof(UINT64) +
+            AlignUp(stack.GetName().size() * sizeof(WCHAR));
+    }
+}
+
+HRESULT StackStreamWriter::Serialize(NameCache& nameCache, std::vector<std::unique_ptr<StackSamplerState>>& stackStates, std::vector<BYTE>& buffer)
+{
+    HRESULT hr;
+
+    std::vector<BYTE> symbolTable;
+    IfFailRet(SymbolTableWriter::Serialize(nameCache, symbolTable));
+
+    size_t stacksSize = 0;
+    for (std::unique_ptr<StackSamplerState>& stackState : stackStates)
+    {
+        stacksSize += GetStackSize(stackState->GetStack());
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = StackStream::Magic;
+    header.Version = StackStream::CurrentVersion;
+    header.HeaderSize = sizeof(Header);
+    header.StackCount = static_cast<UINT32>(stackStates.size());
+    header.SymbolTableOffset = sizeof(Header);
+    header.SymbolTableSize = symbolTable.size();
+    header.StacksOffset = AlignUp(sizeof(Header) + symbolTable.size());
+    header.StacksSize = stacksSize;
+
+    IfOomRetMem(buffer.assign(static_cast<size_t>(header.StacksOffset + stacksSize), 0));
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(&buffer[static_cast<size_t>(header.SymbolTableOffset)], symbolTable.data(), symbolTable.size());
+
+    size_t offset = static_cast<size_t>(header.StacksOffset);
+    for (std::unique_ptr<StackSamplerState>& stackState : stackStates)
+    {
+        const Stack& stack = stackState->GetStack();
+        size_t frameCount = stack.GetFunctionIds().size();
+
+        StackRecord record;
+        memset(&record, 0, sizeof(record));
+        record.ThreadId = stack.GetThreadId();
+        record.FrameCount = static_cast<UINT32>(frameCount);
+        record.NameLength = static_cast<UINT32>(stack.GetName().size());
+        memcpy(&buffer[offset], &record, sizeof(record));
+        offset += sizeof(record);
+
+        if (frameCount > 0)
+        {
+            memcpy(&buffer[offset], stack.GetFunctionIds().data(), frameCount * sizeof(UINT64));
+            offset += frameCount * sizeof(UINT64);
+            memcpy(&buffer[offset], stack.GetOffsets().data(), frameCount * sizeof(UINT64));
+            offset += frameCount * sizeof(UINT64);
+        }
+
+        if (record.NameLength > 0)
+        {
+            memcpy(&buffer[offset], stack.GetName().data(), record.NameLength * sizeof(WCHAR));
+        }
+        offset += AlignUp(record.NameLength * sizeof(WCHAR));
+    }
+
+    return S_OK;
+}
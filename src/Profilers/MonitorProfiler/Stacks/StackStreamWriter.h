@@ -0,0 +1,60 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "StackSampler.h"
+#include "CommonUtilities/NameCache.h"
+#include <memory>
+#include <vector>
+
+//
+// Binary stack stream layout, returned by ProfilerCommand::Callstack with CallstackFormat::Binary.
+// All values are little endian and every section starts on an 8 byte boundary.
+//
+// [Header][Symbol table][StackRecord...]
+//
+// The symbol table holds the string table and the module, token, class and function descriptors for the functions on
+// the stacks, in the format described in CommonUtilities/SymbolTableWriter.h.
+// Each StackRecord is followed by FrameCount UINT64 FunctionIds, FrameCount UINT64 IP offsets, and NameLength
+// UTF-16 code units of the thread name, padded to 8 bytes.
+//
+namespace StackStream
+{
+    static constexpr UINT32 Magic = 0x4b534d44; // "DMSK"
+    static constexpr UINT32 CurrentVersion = 1;
+
+    struct Header
+    {
+        UINT32 Magic;
+        UINT32 Version;
+        UINT32 HeaderSize;
+        UINT32 StackCount;
+        UINT64 SymbolTableOffset;
+        UINT64 SymbolTableSize;
+        UINT64 StacksOffset;
+        UINT64 StacksSize;
+    };
+
+    struct StackRecord
+    {
+        UINT32 ThreadId;
+        UINT32 FrameCount;
+        UINT32 NameLength;
+        UINT32 Reserved;
+    };
+
+    static_assert(sizeof(Header) == 48, "StackStream::Header layout changed");
+    static_assert(sizeof(StackRecord) == 16, "StackStream::StackRecord layout changed");
+}
+
+/// <summary>
+/// Serializes sampled stacks, together with the names needed to resolve them, into the binary stack stream format above.
+/// </summary>
+class StackStreamWriter
+{
+    public:
+        static HRESULT Serialize(NameCache& nameCache, std::vector<std::unique_ptr<StackSamplerState>>& stackStates, std::vector<BYTE>& buffer);
+};
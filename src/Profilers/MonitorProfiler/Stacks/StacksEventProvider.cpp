@@ -4,9 +4,12 @@
 #include "StacksEventProvider.h"
 #include "corhlpr.h"
 #include "cor.h"
+#include <algorithm>
 
 const WCHAR* StacksEventProvider::ProviderName = _T("DotnetMonitorStacksEventProvider");
 
+constexpr size_t StacksEventProvider::MaxFramesPerEvent;
+
 HRESULT StacksEventProvider::CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<StacksEventProvider>& eventProvider)
 {
     std::unique_ptr<ProfilerEventProvider> provider;
@@ -30,16 +33,47 @@ HRESULT StacksEventProvider::DefineEvents()
     IfFailRet(_provider->DefineEvent(_T("ModuleDesc"), _moduleEvent, ModulePayloads));
     IfFailRet(_provider->DefineEvent(_T("TokenDesc"), _tokenEvent, TokenPayloads));
     IfFailRet(_provider->DefineEvent(_T("End"), _endEvent, EndPayloads));
+    IfFailRet(_provider->DefineEvent(_T("CallstackContinuation"), _callstackContinuationEvent, CallstackContinuationPayloads));
 
     return S_OK;
 }
 
 HRESULT StacksEventProvider::WriteCallstack(const Stack& stack)
 {
-    return _callstackEvent->WritePayload(stack.GetThreadId(), stack.GetName(), stack.GetFunctionIds(), stack.GetOffsets());
+    HRESULT hr;
+
+    size_t frameCount = stack.GetFunctionIds().size();
+    if (frameCount <= MaxFramesPerEvent || !_callstackEvent->IsEnabled())
+    {
+        return _callstackEvent->WritePayload(stack.GetThreadId(), stack.GetName(), stack.GetFunctionIds(), stack.GetOffsets());
+    }
+
+    for (size_t start = 0; start < frameCount; start += MaxFramesPerEvent)
+    {
+        size_t count = std::min(MaxFramesPerEvent, frameCount - start);
+        IfFailRet(WriteCallstackChunk(stack, start, count, start > 0));
+    }
+
+    return S_OK;
 }
 
-HRESULT StacksEventProvider::WriteClassData(ClassID classId, const ClassData& classData)
+HRESULT StacksEventProvider::WriteCallstackChunk(const Stack& stack, size_t start, size_t count, bool continuation)
+{
+    const std::vector<UINT64>& functionIds = stack.GetFunctionIds();
+    const std::vector<UINT64>& offsets = stack.GetOffsets();
+
+    _chunkFunctionIds.assign(functionIds.begin() + start, functionIds.begin() + start + count);
+    _chunkOffsets.assign(offsets.begin() + start, offsets.begin() + start + count);
+
+    if (continuation)
+    {
+        return _callstackContinuationEvent->WritePayload(stack.GetThreadId(), _chunkFunctionIds, _chunkOffsets);
+    }
+
+    return _callstackEvent->WritePayload(stack.GetThreadId(), stack.GetName(), _chunkFunctionIds, _chunkOffsets);
+}
+
+HRESULT StacksEventProvider::WriteClassData(ClassID classId, const ClassData& classData, const GUID& moduleVersionId, UINT64 instantiationHash)
 {
     return _classEvent->WritePayload(
         static_cast<UINT64>(classId),
@@ -47,11 +81,15 @@ HRESULT StacksEventProvider::WriteClassData(ClassID classId, const ClassData& cl
         classData.GetToken(),
         static_cast<UINT32>(classData.GetFlags()),
         classData.GetStackTraceHidden(),
-        classData.GetTypeArgs());
+        classData.GetTypeArgs(),
+        moduleVersionId,
+        instantiationHash);
 }
 
-HRESULT StacksEventProvider::WriteFunctionData(FunctionID functionId, const FunctionData& functionData)
+HRESULT StacksEventProvider::WriteFunctionData(FunctionID functionId, const FunctionData& functionData, const GUID& moduleVersionId, UINT64 instantiationHash, bool includeName)
 {
+    static const tstring OmittedName;
+
     return _functionEvent->WritePayload(
         static_cast<UINT64>(functionId),
         functionData.GetMethodToken(),
@@ -59,9 +97,11 @@ HRESULT StacksEventProvider::WriteFunctionData(FunctionID functionId, const Func
         functionData.GetClassToken(),
         static_cast<UINT64>(functionData.GetModuleId()),
         functionData.GetStackTraceHidden(),
-        functionData.GetName(),
+        includeName ? functionData.GetName() : OmittedName,
         functionData.GetTypeArgs(),
-        functionData.GetParameterTypes());
+        functionData.GetParameterTypes(),
+        moduleVersionId,
+        instantiationHash);
 }
 
 HRESULT StacksEventProvider::WriteModuleData(ModuleID moduleId, const ModuleData& moduleData)
@@ -72,7 +112,7 @@ HRESULT StacksEventProvider::WriteModuleData(ModuleID moduleId, const ModuleData
         moduleData.GetName());
 }
 
-HRESULT StacksEventProvider::WriteTokenData(ModuleID moduleId, mdTypeDef typeDef, const TokenData& tokenData)
+HRESULT StacksEventProvider::WriteTokenData(ModuleID moduleId, mdTypeDef typeDef, const TokenData& tokenData, const GUID& moduleVersionId)
 {
     return _tokenEvent->WritePayload(
         moduleId,
@@ -80,7 +120,8 @@ HRESULT StacksEventProvider::WriteTokenData(ModuleID moduleId, mdTypeDef typeDef
         tokenData.GetOuterToken(),
         tokenData.GetStackTraceHidden(),
         tokenData.GetName(),
-        tokenData.GetNamespace());
+        tokenData.GetNamespace(),
+        moduleVersionId);
 }
 
 HRESULT StacksEventProvider::WriteEndEvent()
@@ -19,10 +19,11 @@ class StacksEventProvider
         static HRESULT CreateProvider(ICorProfilerInfo12* profilerInfo, std::unique_ptr<StacksEventProvider>& eventProvider);
 
         HRESULT WriteCallstack(const Stack& stack);
-        HRESULT WriteClassData(ClassID classId, const ClassData& classData);
-        HRESULT WriteFunctionData(FunctionID functionId, const FunctionData& classData);
-        HRESULT WriteModuleData(ModuleID moduleId, const ModuleData& classData);
-        HRESULT WriteTokenData(ModuleID moduleId, mdTypeDef typeDef, const TokenData& tokenData);
+        HRESULT WriteClassData(ClassID classId, const ClassData& classData, const GUID& moduleVersionId, UINT64 instantiationHash);
+        // Names may be omitted when the collector already has the symbols for moduleVersionId.
+        HRESULT WriteFunctionData(FunctionID functionId, const FunctionData& functionData, const GUID& moduleVersionId, UINT64 instantiationHash, bool includeName);
+        HRESULT WriteModuleData(ModuleID moduleId, const ModuleData& moduleData);
+        HRESULT WriteTokenData(ModuleID moduleId, mdTypeDef typeDef, const TokenData& tokenData, const GUID& moduleVersionId);
         HRESULT WriteEndEvent();
 
     private:
@@ -34,6 +35,11 @@ class StacksEventProvider
         static const WCHAR* ProviderName;
 
         HRESULT DefineEvents();
+        HRESULT WriteCallstackChunk(const Stack& stack, size_t start, size_t count, bool continuation);
+
+        // EventPipe drops events larger than 64KB, so deep stacks are split into a Callstack event followed by
+        // CallstackContinuation events for the same thread. Each frame takes 16 bytes across the two arrays.
+        static constexpr size_t MaxFramesPerEvent = 2048;
 
         ComPtr<ICorProfilerInfo12> _profilerInfo;
         std::unique_ptr<ProfilerEventProvider> _provider;
@@ -41,16 +47,24 @@ class StacksEventProvider
         const WCHAR* CallstackPayloads[4] = { _T("ThreadId"), _T("ThreadName"), _T("FunctionIds"), _T("IpOffsets")};
         std::unique_ptr<ProfilerEvent<UINT32, tstring, std::vector<UINT64>, std::vector<UINT64>>> _callstackEvent;
 
+        const WCHAR* CallstackContinuationPayloads[3] = { _T("ThreadId"), _T("FunctionIds"), _T("IpOffsets")};
+        std::unique_ptr<ProfilerEvent<UINT32, std::vector<UINT64>, std::vector<UINT64>>> _callstackContinuationEvent;
+
+        // Reused for each chunk of a deep stack.
+        std::vector<UINT64> _chunkFunctionIds;
+        std::vector<UINT64> _chunkOffsets;
+
         //Note we will either send a ClassId or a ClassToken. For Shared generic functions, there is no ClassID.
-        const WCHAR* FunctionPayloads[9] = { _T("FunctionId"), _T("MethodToken"), _T("ClassId"), _T("ClassToken"), _T("ModuleId"), _T("StackTraceHidden"), _T("Name"), _T("TypeArgs"), _T("ParameterTypes") };
-        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT64, UINT32, UINT64, UINT32, tstring, std::vector<UINT64>, std::vector<UINT64>>> _functionEvent;
+        //ModuleVersionId, MethodToken and InstantiationHash identify the function independently of the process.
+        const WCHAR* FunctionPayloads[11] = { _T("FunctionId"), _T("MethodToken"), _T("ClassId"), _T("ClassToken"), _T("ModuleId"), _T("StackTraceHidden"), _T("Name"), _T("TypeArgs"), _T("ParameterTypes"), _T("ModuleVersionId"), _T("InstantiationHash") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT64, UINT32, UINT64, UINT32, tstring, std::vector<UINT64>, std::vector<UINT64>, GUID, UINT64>> _functionEvent;
 
         //We cannot retrieve detailed information for some ClassIds. Flags is used to indicate these conditions.
-        const WCHAR* ClassPayloads[6] = { _T("ClassId"), _T("ModuleId"), _T("Token"), _T("Flags"), _T("StackTraceHidden"), _T("TypeArgs") };
-        std::unique_ptr<ProfilerEvent<UINT64, UINT64, UINT32, UINT32, UINT32, std::vector<UINT64>>> _classEvent;
+        const WCHAR* ClassPayloads[8] = { _T("ClassId"), _T("ModuleId"), _T("Token"), _T("Flags"), _T("StackTraceHidden"), _T("TypeArgs"), _T("ModuleVersionId"), _T("InstantiationHash") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT64, UINT32, UINT32, UINT32, std::vector<UINT64>, GUID, UINT64>> _classEvent;
 
-        const WCHAR* TokenPayloads[6] = { _T("ModuleId"), _T("Token"), _T("OuterToken"), _T("StackTraceHidden"), _T("Name"), _T("Namespace") };
-        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT32, UINT32, tstring, tstring>> _tokenEvent;
+        const WCHAR* TokenPayloads[7] = { _T("ModuleId"), _T("Token"), _T("OuterToken"), _T("StackTraceHidden"), _T("Name"), _T("Namespace"), _T("ModuleVersionId") };
+        std::unique_ptr<ProfilerEvent<UINT64, UINT32, UINT32, UINT32, tstring, tstring, GUID>> _tokenEvent;
 
         const WCHAR* ModulePayloads[3] = { _T("ModuleId"), _T("ModuleVersionId"), _T("Name") };
         std::unique_ptr<ProfilerEvent<UINT64, GUID, tstring>> _moduleEvent;
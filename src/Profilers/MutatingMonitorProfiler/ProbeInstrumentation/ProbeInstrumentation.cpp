@@ -4,7 +4,7 @@
 #include "corhlpr.h"
 #include "macros.h"
 #include "ProbeInstrumentation.h"
-#include "CommonUtilities/BlockingQueue.h"
+#include "CommonUtilities/BoundedQueue.h"
 
 using namespace std;
 
@@ -30,7 +30,7 @@ typedef struct _PROBE_MANAGEMENT_CALLBACKS
 mutex g_probeManagementCallbacksMutex; // guards g_probeManagementCallbacks
 PROBE_MANAGEMENT_CALLBACKS g_probeManagementCallbacks = {};
 
-BlockingQueue<PROBE_WORKER_PAYLOAD> g_probeManagementQueue;
+BoundedQueue<PROBE_WORKER_PAYLOAD, ProbeQueueCapacity> g_probeManagementQueue;
 
 ProbeInstrumentation::ProbeInstrumentation(const shared_ptr<ILogger>& logger, ICorProfilerInfo12* profilerInfo) :
     m_pCorProfilerInfo(profilerInfo),
@@ -150,9 +150,9 @@ void ProbeInstrumentation::WorkerThread()
         return;
     }
 
-    MANAGED_CALLBACK_REQUEST callbackRequest = {};
     while (true)
     {
+        MANAGED_CALLBACK_REQUEST callbackRequest = {};
         PROBE_WORKER_PAYLOAD payload;
         hr = g_probeManagementQueue.BlockingDequeue(payload);
         if (hr != S_OK)
@@ -170,7 +170,7 @@ void ProbeInstrumentation::WorkerThread()
                 m_pLogger->Log(LogLevel::Error, _LS("Failed to register function probe: 0x%08x"), hr);
             }
             callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
+            m_managedCallbackQueue.Enqueue(std::move(callbackRequest));
             break;
 
         case ProbeWorkerInstruction::INSTALL_PROBES:
@@ -180,13 +180,13 @@ void ProbeInstrumentation::WorkerThread()
                 m_pLogger->Log(LogLevel::Error, _LS("Failed to install probes: 0x%08x"), hr);
             }
             callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
+            m_managedCallbackQueue.Enqueue(std::move(callbackRequest));
             break;
 
         case ProbeWorkerInstruction::FAULTING_PROBE:
             m_pLogger->Log(LogLevel::Error, _LS("Function probe faulting in function: 0x%08x"), payload.functionId);
             callbackRequest.payload.functionId = payload.functionId;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
+            m_managedCallbackQueue.Enqueue(std::move(callbackRequest));
             break;
 
         case ProbeWorkerInstruction::UNINSTALL_PROBES:
@@ -196,7 +196,7 @@ void ProbeInstrumentation::WorkerThread()
                 m_pLogger->Log(LogLevel::Error, _LS("Failed to uninstall probes: 0x%08x"), hr);
             }
             callbackRequest.payload.hr = hr;
-            m_managedCallbackQueue.Enqueue(callbackRequest);
+            m_managedCallbackQueue.Enqueue(std::move(callbackRequest));
             break;
 
         default:
@@ -229,7 +229,9 @@ void STDMETHODCALLTYPE ProbeInstrumentation::OnFunctionProbeFault(ULONG64 uniqui
     // If this changes in the future, add a new payload field.
     //
     payload.functionId = static_cast<FunctionID>(uniquifier);
-    g_probeManagementQueue.Enqueue(payload);
+
+    // Called from the faulting probe, so the notification is dropped rather than waiting for the worker to catch up.
+    g_probeManagementQueue.TryEnqueue(std::move(payload));
 }
 
 STDAPI DLLEXPORT RequestFunctionProbeInstallation(
@@ -294,8 +296,8 @@ STDAPI DLLEXPORT RequestFunctionProbeInstallation(
 
     PROBE_WORKER_PAYLOAD payload = {};
     payload.instruction = ProbeWorkerInstruction::INSTALL_PROBES;
-    payload.requests = requests;
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
+    payload.requests = std::move(requests);
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
 
     END_NO_OOM_THROW_REGION;
 
@@ -308,7 +310,7 @@ STDAPI DLLEXPORT RequestFunctionProbeUninstallation()
 
     PROBE_WORKER_PAYLOAD payload = {};
     payload.instruction = ProbeWorkerInstruction::UNINSTALL_PROBES;
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
 
     return S_OK;
 }
@@ -320,7 +322,7 @@ STDAPI DLLEXPORT RequestFunctionProbeRegistration(ULONG64 enterProbeId)
     PROBE_WORKER_PAYLOAD payload = {};
     payload.instruction = ProbeWorkerInstruction::REGISTER_PROBE;
     payload.functionId = static_cast<FunctionID>(enterProbeId);
-    IfFailRet(g_probeManagementQueue.Enqueue(payload));
+    IfFailRet(g_probeManagementQueue.Enqueue(std::move(payload)));
 
     return S_OK;
 }
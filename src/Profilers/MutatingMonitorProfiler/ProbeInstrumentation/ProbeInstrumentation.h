@@ -11,7 +11,7 @@
 #include "CallbackDefinitions.h"
 #include "Logging/Logger.h"
 #include "CommonUtilities/PairHash.h"
-#include "CommonUtilities/BlockingQueue.h"
+#include "CommonUtilities/BoundedQueue.h"
 
 #include <unordered_map>
 #include <vector>
@@ -52,6 +52,9 @@ typedef struct _MANAGED_CALLBACK_REQUEST
     } payload;
 } MANAGED_CALLBACK_REQUEST;
 
+// Requests from managed code wait for space rather than growing the queues without limit.
+static constexpr size_t ProbeQueueCapacity = 64;
+
 class ProbeInstrumentation
 {
     private:
@@ -63,7 +66,7 @@ class ProbeInstrumentation
 
         /* Probe management */
         std::thread m_managedCallbackThread;
-        BlockingQueue<MANAGED_CALLBACK_REQUEST> m_managedCallbackQueue;
+        BoundedQueue<MANAGED_CALLBACK_REQUEST, ProbeQueueCapacity> m_managedCallbackQueue;
 
         std::thread m_probeManagementThread;
         std::unordered_map<std::pair<ModuleID, mdMethodDef>, INSTRUMENTATION_REQUEST, PairHash<ModuleID, mdMethodDef>> m_activeInstrumentationRequests;
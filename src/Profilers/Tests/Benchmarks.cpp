@@ -0,0 +1,137 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "cor.h"
+#include "guids.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Fakes/SyntheticRuntime.h"
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+#include "EventProvider/ProfilerEventProvider.h"
+#include "Logging/NullLogger.h"
+#include "Stacks/StackSampler.h"
+#include "Stacks/StacksEventProvider.h"
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+
+//
+// Microbenchmarks for the stack sampling hot paths, run against FakeCorProfilerInfo so that no runtime is needed.
+// The fake answers lookups from hash maps, so results measure the profiler's own overhead rather than the runtime's.
+//
+// Usage: MonitorProfilerBenchmarks [filter]
+//
+namespace
+{
+    const size_t FunctionCount = 5000;
+    const size_t ThreadCount = 32;
+    const size_t StackDepth = 200;
+
+    template<typename TBody>
+    void RunBenchmark(const char* filter, const char* name, int iterations, size_t operationsPerIteration, TBody body)
+    {
+        if (filter != nullptr && strstr(name, filter) == nullptr)
+        {
+            return;
+        }
+
+        // Warm up thread local buffers and caches.
+        body();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            body();
+        }
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+        double totalNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        double iterationUs = totalNs / iterations / 1000.0;
+        double operationNs = totalNs / iterations / operationsPerIteration;
+        printf("%-44s %12.1f us/iteration %10.1f ns/op\n", name, iterationUs, operationNs);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, FunctionCount, ThreadCount, StackDepth);
+    const std::vector<FunctionID>& functions = runtime.GetFunctions();
+
+    RunBenchmark(filter, "TypeNameUtilities.CacheNames (cold)", 20, functions.size(), [&]()
+    {
+        NameCache nameCache;
+        TypeNameUtilities nameUtilities(profilerInfo);
+        for (FunctionID function : functions)
+        {
+            nameUtilities.CacheNames(nameCache, function, 0);
+        }
+    });
+
+    NameCache warmCache;
+    TypeNameUtilities warmUtilities(profilerInfo);
+    for (FunctionID function : functions)
+    {
+        warmUtilities.CacheNames(warmCache, function, 0);
+    }
+
+    RunBenchmark(filter, "TypeNameUtilities.CacheNames (cached)", 200, functions.size(), [&]()
+    {
+        for (FunctionID function : functions)
+        {
+            warmUtilities.CacheNames(warmCache, function, 0);
+        }
+    });
+
+    RunBenchmark(filter, "NameCache.GetFullyQualifiedName", 20, functions.size(), [&]()
+    {
+        tstring name;
+        for (FunctionID function : functions)
+        {
+            name.clear();
+            warmCache.GetFullyQualifiedName(function, name);
+        }
+    });
+
+    for (UINT32 workers = 1; workers <= 4; workers *= 2)
+    {
+        std::string name = "StackSampler.CreateCallstack (" + std::to_string(workers) + " workers)";
+        std::shared_ptr<ParallelNameResolver> nameResolver = std::make_shared<ParallelNameResolver>(NullLogger::Instance, profilerInfo, workers);
+        RunBenchmark(filter, name.c_str(), 20, ThreadCount, [&]()
+        {
+            std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+            std::shared_ptr<NameCache> nameCache;
+            std::shared_ptr<ThreadNameCache> threadNames = std::make_shared<ThreadNameCache>();
+            StackSampler sampler(profilerInfo, nameResolver);
+            sampler.CreateCallstack(stackStates, nameCache, threadNames);
+        });
+    }
+
+    profilerInfo->SetRecordWrittenEvents(false);
+    std::unique_ptr<StacksEventProvider> stacksProvider;
+    StacksEventProvider::CreateProvider(profilerInfo, stacksProvider);
+    Stack stack;
+    for (size_t i = 0; i < StackDepth; i++)
+    {
+        stack.AddFrame(functions[i % functions.size()], static_cast<UINT_PTR>(i));
+    }
+
+    RunBenchmark(filter, "ProfilerEvent.WritePayload (callstack)", 10000, 1, [&]()
+    {
+        stacksProvider->WriteCallstack(stack);
+    });
+
+    std::shared_ptr<FunctionData> functionData;
+    warmCache.TryGetFunctionData(functions[2], functionData);
+    GUID mvid = warmCache.GetModuleVersionId(functionData->GetModuleId());
+    UINT64 instantiationHash = warmCache.GetInstantiationHash(functionData->GetTypeArgs());
+
+    RunBenchmark(filter, "ProfilerEvent.WritePayload (function)", 10000, 1, [&]()
+    {
+        stacksProvider->WriteFunctionData(functions[2], *functionData, mvid, instantiationHash, true);
+    });
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "CommonUtilities/BoundedQueue.h"
+#include <memory>
+#include <thread>
+
+TEST(BoundedQueue_RejectsWhenFull)
+{
+    BoundedQueue<std::unique_ptr<int>, 4> queue;
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(S_OK, queue.TryEnqueue(std::unique_ptr<int>(new int(i))));
+    }
+
+    // A rejected item stays with the caller.
+    std::unique_ptr<int> rejected(new int(4));
+    ASSERT_EQ(S_FALSE, queue.TryEnqueue(std::move(rejected)));
+    ASSERT_TRUE(rejected != nullptr);
+
+    std::vector<std::unique_ptr<int>> items;
+    ASSERT_EQ(S_OK, queue.BlockingDequeue(items, 3));
+    ASSERT_EQ(static_cast<size_t>(3), items.size());
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(i, *items[i]);
+    }
+
+    ASSERT_EQ(S_OK, queue.TryEnqueue(std::move(rejected)));
+    std::unique_ptr<int> item;
+    ASSERT_EQ(S_OK, queue.BlockingDequeue(item));
+    ASSERT_EQ(3, *item);
+    ASSERT_EQ(S_OK, queue.BlockingDequeue(item));
+    ASSERT_EQ(4, *item);
+}
+
+TEST(BoundedQueue_TransfersFromManyProducers)
+{
+    const int ProducerCount = 4;
+    const int ItemsPerProducer = 50000;
+    BoundedQueue<std::pair<int, int>, 64> queue;
+
+    // Producers wait for space, so every item arrives.
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < ProducerCount; producer++)
+    {
+        producers.emplace_back([&queue, producer]()
+        {
+            for (int i = 0; i < ItemsPerProducer; i++)
+            {
+                queue.Enqueue(std::make_pair(producer, i));
+            }
+        });
+    }
+
+    std::vector<int> next(ProducerCount, 0);
+    bool ordered = true;
+    int received = 0;
+    std::vector<std::pair<int, int>> batch;
+    while (received < ProducerCount * ItemsPerProducer)
+    {
+        ASSERT_EQ(S_OK, queue.BlockingDequeue(batch, 16));
+        ASSERT_TRUE(batch.size() <= 16);
+        for (std::pair<int, int>& item : batch)
+        {
+            ordered &= item.second == next[item.first]++;
+        }
+        received += static_cast<int>(batch.size());
+    }
+
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+
+    // Items from each producer keep their order.
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(ProducerCount * ItemsPerProducer, received);
+}
+
+TEST(BoundedQueue_CompleteReleasesWaiters)
+{
+    BoundedQueue<int, 2> queue;
+    ASSERT_EQ(S_OK, queue.TryEnqueue(1));
+    ASSERT_EQ(S_OK, queue.TryEnqueue(2));
+
+    HRESULT producerResult = S_OK;
+    std::thread producer([&queue, &producerResult]()
+    {
+        producerResult = queue.Enqueue(3);
+    });
+
+    BoundedQueue<int, 2> emptyQueue;
+    HRESULT consumerResult = S_OK;
+    std::thread consumer([&emptyQueue, &consumerResult]()
+    {
+        int item;
+        consumerResult = emptyQueue.BlockingDequeue(item);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Complete();
+    emptyQueue.Complete();
+    producer.join();
+    consumer.join();
+
+    ASSERT_EQ(E_UNEXPECTED, producerResult);
+    ASSERT_EQ(S_FALSE, consumerResult);
+}
@@ -0,0 +1,595 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Communication/CommandServer.h"
+#include "IpcTestClient.h"
+#include "Logging/NullLogger.h"
+#include "macros.h"
+#include <chrono>
+#include <string.h>
+#include <unistd.h>
+
+namespace
+{
+    bool WaitForCount(const std::atomic_int& count, int expected)
+    {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (count.load() < expected)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // Accepts every message and counts the ones delivered to the callback.
+    class TestServer
+    {
+    public:
+        TestServer() :
+            _profilerInfo(new FakeCorProfilerInfo()),
+            _server(NullLogger::Instance, _profilerInfo),
+            CallbackCount(0),
+            StartedCount(0),
+            Paused(false),
+            PausedCommandSet(-1),
+            ValidatedClientFlags(0),
+            CallbackClientFlags(0),
+            UnmanagedOnly(true)
+        {
+        }
+
+        ~TestServer()
+        {
+            Shutdown();
+        }
+
+        void Shutdown()
+        {
+            _server.Shutdown();
+        }
+
+        HRESULT Start(const std::string& path, const std::shared_ptr<SharedRingBuffer>& ring = nullptr)
+        {
+            _server.SetSharedRingBuffer(ring);
+            _server.SetClientWorkerCount(ClientWorkerCount);
+            return _server.Start(
+                path,
+                [this](const IpcMessage& message, std::vector<BYTE>& result) -> HRESULT { return Callback(message, result); },
+                [this](const IpcMessage& message) -> HRESULT
+                {
+                    ValidatedClientFlags.store(message.ClientFlags);
+                    return message.Command != static_cast<unsigned short>(ProfilerCommand::ExportSymbolTable) ? S_OK : E_NOT_SUPPORTED;
+                },
+                [this](unsigned short commandSet, bool& unmanagedOnly) -> HRESULT { unmanagedOnly = UnmanagedOnly; return S_OK; });
+        }
+
+    private:
+        // Echoes the payload as the result; SetKnownModuleVersionIds fails.
+        // StartupHook commands instead return a result of the size in their UINT32 payload.
+        HRESULT Callback(const IpcMessage& message, std::vector<BYTE>& result)
+        {
+            StartedCount++;
+            CallbackClientFlags.store(message.ClientFlags);
+            while (Paused.load() || PausedCommandSet.load() == message.CommandSet)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (message.CommandSet == static_cast<unsigned short>(CommandSet::StartupHook) && message.Payload.size() == sizeof(UINT32))
+            {
+                UINT32 size = 0;
+                memcpy(&size, message.Payload.data(), sizeof(size));
+                result.resize(size);
+                for (UINT32 i = 0; i < size; i++)
+                {
+                    result[i] = static_cast<BYTE>(i);
+                }
+            }
+            else
+            {
+                result = message.Payload;
+            }
+            CallbackCount++;
+            return message.Command != static_cast<unsigned short>(ProfilerCommand::SetKnownModuleVersionIds) ? S_OK : E_FAIL;
+        }
+
+        ComPtr<FakeCorProfilerInfo> _profilerInfo;
+        CommandServer _server;
+
+    public:
+        std::atomic_int CallbackCount;
+        std::atomic_int StartedCount;
+        // While set, callbacks wait, so that requests stay queued.
+        std::atomic_bool Paused;
+        // Callbacks for this command set wait, like Paused.
+        std::atomic_int PausedCommandSet;
+        // ConnectionFlags seen by the last validation and callback.
+        std::atomic<UINT32> ValidatedClientFlags;
+        std::atomic<UINT32> CallbackClientFlags;
+        // Set before Start.
+        bool UnmanagedOnly;
+        UINT32 ClientWorkerCount = CommandServer::DefaultClientWorkerCount;
+    };
+
+}
+
+TEST(CommandServer_HandlesSingleMessageConnections)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::unique_ptr<IpcCommClient> client;
+        ASSERT_SUCCEEDED(Connect(path, client));
+        ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 0)));
+
+        IpcMessage response;
+        ASSERT_SUCCEEDED(client->Receive(response));
+        ASSERT_SUCCEEDED(ReadStatus(response));
+
+        // The server closes single message connections after responding.
+        ASSERT_TRUE(FAILED(client->Receive(response)));
+    }
+
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 2));
+}
+
+TEST(CommandServer_CorrelatesMultiplexedResponses)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(Connect(path, client));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Connection, static_cast<unsigned short>(ConnectionCommand::Multiplex), 0)));
+
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_SUCCEEDED(ReadStatus(response));
+    client->SetMultiplexed(true);
+
+    const UINT32 RequestCount = 8;
+    for (UINT32 requestId = 1; requestId <= RequestCount; requestId++)
+    {
+        // Odd requests are rejected by validation.
+        unsigned short command = static_cast<unsigned short>((requestId % 2 == 0) ? ProfilerCommand::Callstack : ProfilerCommand::ExportSymbolTable);
+        // Distinct payloads keep identical requests from being coalesced.
+        IpcMessage request = CreateMessage(CommandSet::Profiler, command, requestId);
+        request.Payload = { static_cast<BYTE>(requestId) };
+        ASSERT_SUCCEEDED(client->Send(request));
+    }
+
+    for (UINT32 requestId = 1; requestId <= RequestCount; requestId++)
+    {
+        ASSERT_SUCCEEDED(client->Receive(response));
+        ASSERT_EQ(static_cast<unsigned short>(CommandSet::ServerResponse), response.CommandSet);
+        ASSERT_EQ(requestId, response.RequestId);
+        ASSERT_EQ((requestId % 2 == 0) ? S_OK : E_NOT_SUPPORTED, ReadStatus(response));
+    }
+
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, static_cast<int>(RequestCount / 2)));
+}
+
+TEST(CommandServer_RejectsUnknownConnectionCommands)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(Connect(path, client));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Connection, 100, 0)));
+
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(E_NOT_SUPPORTED, ReadStatus(response));
+}
+
+TEST(CommandServer_SlowClientDoesNotStallOthers)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    // Sends only part of a header and then stalls.
+    SOCKET s;
+    ASSERT_SUCCEEDED(ConnectSocket(path, s));
+    SocketWrapper slowClient(s);
+    UINT16 commandSet = static_cast<UINT16>(CommandSet::Profiler);
+    ASSERT_EQ(static_cast<int>(sizeof(commandSet)), static_cast<int>(send(slowClient, &commandSet, sizeof(commandSet), 0)));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(Connect(path, client));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 0)));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_SUCCEEDED(ReadStatus(response));
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
+
+TEST(CommandServer_ServesManyConcurrentClients)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    const int ClientCount = 64;
+    std::vector<std::unique_ptr<IpcCommClient>> clients(ClientCount);
+    for (int i = 0; i < ClientCount; i++)
+    {
+        ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, clients[i]));
+    }
+
+    // Interleave requests across all connections before reading any responses.
+    for (UINT32 requestId = 1; requestId <= 4; requestId++)
+    {
+        for (int i = 0; i < ClientCount; i++)
+        {
+            IpcMessage request = CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), requestId);
+            request.Payload = { static_cast<BYTE>(i), static_cast<BYTE>(requestId) };
+            ASSERT_SUCCEEDED(clients[i]->Send(request));
+        }
+    }
+
+    for (int i = 0; i < ClientCount; i++)
+    {
+        for (UINT32 requestId = 1; requestId <= 4; requestId++)
+        {
+            IpcMessage response;
+            ASSERT_SUCCEEDED(clients[i]->Receive(response));
+            ASSERT_EQ(requestId, response.RequestId);
+            ASSERT_SUCCEEDED(ReadStatus(response));
+        }
+    }
+
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, ClientCount * 4));
+}
+
+TEST(CommandServer_RespondsToControlCommandsAfterCompletion)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::StopAllFeatures), 1)));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 2)));
+
+    // Control commands are answered from the processing thread, so responses can arrive in either order.
+    UINT32 requestIds = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        IpcMessage response;
+        ASSERT_SUCCEEDED(client->Receive(response));
+        ASSERT_SUCCEEDED(ReadStatus(response));
+        requestIds |= response.RequestId;
+    }
+    ASSERT_EQ(static_cast<UINT32>(3), requestIds);
+
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 2));
+}
+
+TEST(CommandServer_ShutsDownPromptly)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    server.Shutdown();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    // Open connections are closed by the server.
+    IpcMessage response;
+    ASSERT_TRUE(FAILED(client->Receive(response)));
+}
+
+TEST(CommandServer_SendsCompletionResponses)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses));
+
+    IpcMessage request = CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 1);
+    request.Payload = { 1, 2, 3 };
+    ASSERT_SUCCEEDED(client->Send(request));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::SetKnownModuleVersionIds), 2)));
+
+    // Responses follow the callback, and carry its HRESULT and result.
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(static_cast<UINT32>(1), response.RequestId);
+    ASSERT_TRUE(server.CallbackCount.load() >= 1);
+    ASSERT_EQ(sizeof(HRESULT) + 3, response.Payload.size());
+    HRESULT status = E_FAIL;
+    memcpy(&status, response.Payload.data(), sizeof(HRESULT));
+    ASSERT_EQ(S_OK, status);
+    ASSERT_EQ(3, response.Payload[sizeof(HRESULT) + 2]);
+
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(static_cast<UINT32>(2), response.RequestId);
+    ASSERT_EQ(E_FAIL, ReadStatus(response));
+}
+
+TEST(CommandServer_PassesConnectionFlagsToCallbacks)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 1)));
+
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(S_OK, ReadStatus(response));
+    ASSERT_EQ(static_cast<UINT32>(ConnectionFlags::CompletionResponses), server.ValidatedClientFlags.load());
+    ASSERT_EQ(static_cast<UINT32>(ConnectionFlags::CompletionResponses), server.CallbackClientFlags.load());
+
+    // Flags belong to the connection rather than the client, so a plain connection has none.
+    ASSERT_SUCCEEDED(Connect(path, client));
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 0)));
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(S_OK, ReadStatus(response));
+    ASSERT_EQ(static_cast<UINT32>(ConnectionFlags::None), server.ValidatedClientFlags.load());
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 2));
+    ASSERT_EQ(static_cast<UINT32>(ConnectionFlags::None), server.CallbackClientFlags.load());
+}
+
+TEST(CommandServer_SendsLargeResultsInChunks)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses));
+
+    // Larger than the data the server writes to a client at once, so most of it is deferred until the client reads.
+    const UINT32 ResultSize = 3 * IpcCommClient::MaxPayloadSize + 100;
+    IpcMessage request = CreateMessage(CommandSet::StartupHook, static_cast<unsigned short>(StartupHookCommand::StartCapturingParameters), 1);
+    request.Payload.resize(sizeof(UINT32));
+    memcpy(request.Payload.data(), &ResultSize, sizeof(UINT32));
+    ASSERT_SUCCEEDED(client->Send(request));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<BYTE> result;
+    IpcMessage response;
+    int dataCount = 0;
+    while (true)
+    {
+        ASSERT_SUCCEEDED(client->Receive(response));
+        ASSERT_EQ(static_cast<UINT32>(1), response.RequestId);
+        if (response.Command != static_cast<unsigned short>(ServerResponseCommand::Data))
+        {
+            break;
+        }
+        result.insert(result.end(), response.Payload.begin(), response.Payload.end());
+        dataCount++;
+    }
+
+    ASSERT_EQ(static_cast<unsigned short>(ServerResponseCommand::Status), response.Command);
+    HRESULT status = E_FAIL;
+    memcpy(&status, response.Payload.data(), sizeof(HRESULT));
+    ASSERT_EQ(S_OK, status);
+    result.insert(result.end(), response.Payload.begin() + sizeof(HRESULT), response.Payload.end());
+
+    ASSERT_EQ(3, dataCount);
+    ASSERT_EQ(static_cast<size_t>(ResultSize), result.size());
+    for (UINT32 i = 0; i < ResultSize; i++)
+    {
+        ASSERT_EQ(static_cast<BYTE>(i), result[i]);
+    }
+}
+
+TEST(CommandServer_SlowReaderDoesNotBlockQueue)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> slowClient;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, slowClient, ConnectionFlags::CompletionResponses));
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses));
+
+    // The slow client never reads its result, which fills its socket.
+    const UINT32 ResultSize = 3 * IpcCommClient::MaxPayloadSize + 100;
+    IpcMessage request = CreateMessage(CommandSet::StartupHook, static_cast<unsigned short>(StartupHookCommand::StartCapturingParameters), 1);
+    request.Payload.resize(sizeof(UINT32));
+    memcpy(request.Payload.data(), &ResultSize, sizeof(UINT32));
+    ASSERT_SUCCEEDED(slowClient->Send(request));
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 1));
+
+    // The same command set runs on the same queue, so the request is only answered if the queue moved on.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    request = CreateMessage(CommandSet::StartupHook, static_cast<unsigned short>(StartupHookCommand::StartCapturingParameters), 2);
+    ASSERT_SUCCEEDED(client->Send(request));
+
+    IpcMessage response;
+    ASSERT_SUCCEEDED(client->Receive(response));
+    ASSERT_EQ(static_cast<UINT32>(2), response.RequestId);
+    ASSERT_EQ(S_OK, ReadStatus(response));
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    // The deferred result is still delivered whole once the slow client reads.
+    size_t received = 0;
+    while (true)
+    {
+        ASSERT_SUCCEEDED(slowClient->Receive(response));
+        ASSERT_EQ(static_cast<UINT32>(1), response.RequestId);
+        if (response.Command != static_cast<unsigned short>(ServerResponseCommand::Data))
+        {
+            break;
+        }
+        received += response.Payload.size();
+    }
+    ASSERT_EQ(static_cast<size_t>(ResultSize), received + response.Payload.size() - sizeof(HRESULT));
+}
+
+TEST(CommandServer_CoalescesQueuedRequests)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path));
+    server.Paused.store(true);
+
+    const int ClientCount = 4;
+    std::vector<std::unique_ptr<IpcCommClient>> clients(ClientCount);
+    for (int i = 0; i < ClientCount; i++)
+    {
+        ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, clients[i], ConnectionFlags::CompletionResponses));
+    }
+
+    // The first request is in flight; the rest are identical except for the last, which has a different payload.
+    ASSERT_SUCCEEDED(clients[0]->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 1)));
+    ASSERT_TRUE(WaitForCount(server.StartedCount, 1));
+    for (int i = 1; i < ClientCount; i++)
+    {
+        IpcMessage request = CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), static_cast<UINT32>(i + 1));
+        if (i == ClientCount - 1)
+        {
+            request.Payload = { 1 };
+        }
+        ASSERT_SUCCEEDED(clients[i]->Send(request));
+    }
+    ASSERT_SUCCEEDED(clients[1]->Send(CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), 10)));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    server.Paused.store(false);
+
+    // Every request is answered, including both from the second client.
+    for (int i = 0; i < ClientCount; i++)
+    {
+        IpcMessage response;
+        ASSERT_SUCCEEDED(clients[i]->Receive(response));
+        ASSERT_EQ(static_cast<UINT32>(i + 1), response.RequestId);
+        HRESULT status = E_FAIL;
+        memcpy(&status, response.Payload.data(), sizeof(HRESULT));
+        ASSERT_EQ(S_OK, status);
+        ASSERT_EQ((i == ClientCount - 1) ? sizeof(HRESULT) + 1 : sizeof(HRESULT), response.Payload.size());
+    }
+    IpcMessage response;
+    ASSERT_SUCCEEDED(clients[1]->Receive(response));
+    ASSERT_EQ(static_cast<UINT32>(10), response.RequestId);
+
+    // One callback for the request in flight, one shared by the identical queued requests, and one for the other payload.
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 3));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(3, server.CallbackCount.load());
+}
+
+TEST(CommandServer_RunsCommandSetsOnSeparateWorkers)
+{
+    std::string path = GetSocketPath();
+    TestServer server;
+    server.UnmanagedOnly = false;
+    server.ClientWorkerCount = 2;
+    server.PausedCommandSet = static_cast<int>(CommandSet::StartupHook);
+    ASSERT_SUCCEEDED(server.Start(path));
+
+    std::unique_ptr<IpcCommClient> client;
+    ASSERT_SUCCEEDED(OpenMultiplexedConnection(path, client));
+
+    // StartupHook and Profiler commands map to different workers, so the paused StartupHook command
+    // does not hold up Profiler commands.
+    ASSERT_SUCCEEDED(client->Send(CreateMessage(CommandSet::StartupHook, 0, 1)));
+    ASSERT_TRUE(WaitForCount(server.StartedCount, 1));
+    for (UINT32 requestId = 2; requestId <= 4; requestId++)
+    {
+        IpcMessage request = CreateMessage(CommandSet::Profiler, static_cast<unsigned short>(ProfilerCommand::Callstack), requestId);
+        request.Payload = { static_cast<BYTE>(requestId) };
+        ASSERT_SUCCEEDED(client->Send(request));
+    }
+
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 3));
+    ASSERT_EQ(1, server.StartedCount.load() - server.CallbackCount.load());
+
+    server.PausedCommandSet = -1;
+    ASSERT_TRUE(WaitForCount(server.CallbackCount, 4));
+}
+
+TEST(CommandServer_SharesRingBufferHandle)
+{
+    std::shared_ptr<SharedRingBuffer> ring;
+    {
+        std::unique_ptr<SharedRingBuffer> created;
+        ASSERT_SUCCEEDED(SharedRingBuffer::Create("test", SharedRingBuffer::MinCapacity, created));
+        ring = std::move(created);
+    }
+
+    std::string path = GetSocketPath();
+    TestServer server;
+    ASSERT_SUCCEEDED(server.Start(path, ring));
+
+    SOCKET s;
+    ASSERT_SUCCEEDED(ConnectSocket(path, s));
+    IpcCommClient client(s);
+    ASSERT_SUCCEEDED(client.Send(CreateMessage(CommandSet::Connection, static_cast<unsigned short>(ConnectionCommand::GetSharedRingBuffer), 0)));
+
+    // Receive the status header along with the descriptor.
+    char headers[sizeof(UINT16) + sizeof(UINT16) + sizeof(INT32)];
+    iovec data = { headers, sizeof(headers) };
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        cmsghdr align;
+    } control;
+    msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control.buffer;
+    header.msg_controllen = sizeof(control.buffer);
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(headers)), recvmsg(s, &header, MSG_WAITALL));
+
+    cmsghdr* controlHeader = CMSG_FIRSTHDR(&header);
+    ASSERT_TRUE(controlHeader != nullptr);
+    ASSERT_EQ(SCM_RIGHTS, controlHeader->cmsg_type);
+    int handle = -1;
+    memcpy(&handle, CMSG_DATA(controlHeader), sizeof(int));
+
+    HRESULT status = E_FAIL;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(status)), recv(s, &status, sizeof(status), MSG_WAITALL));
+    ASSERT_SUCCEEDED(status);
+
+    std::unique_ptr<SharedRingBuffer> reader;
+    ASSERT_SUCCEEDED(SharedRingBuffer::Open(handle, reader));
+    BYTE value = 42;
+    ASSERT_SUCCEEDED(ring->TryWrite(1, &value, sizeof(value)));
+
+    UINT32 type = 0;
+    std::vector<BYTE> record;
+    ASSERT_EQ(S_OK, reader->TryRead(type, record));
+    ASSERT_EQ(static_cast<size_t>(1), record.size());
+    ASSERT_EQ(42, record[0]);
+    ASSERT_TRUE(ring->HasReader());
+
+    // The ring has a single consumer, so a second client is turned away.
+    std::unique_ptr<IpcCommClient> secondClient;
+    ASSERT_SUCCEEDED(Connect(path, secondClient));
+    ASSERT_SUCCEEDED(secondClient->Send(CreateMessage(CommandSet::Connection, static_cast<unsigned short>(ConnectionCommand::GetSharedRingBuffer), 0)));
+    IpcMessage response;
+    ASSERT_SUCCEEDED(secondClient->Receive(response));
+    ASSERT_EQ(E_BUSY, ReadStatus(response));
+}
@@ -0,0 +1,208 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Exceptions/ExceptionAggregator.h"
+#include "Stacks/NameCachePrewarmer.h"
+#include "Logging/NullLogger.h"
+#include <algorithm>
+#include <string.h>
+#include <thread>
+
+namespace
+{
+    const GUID TestMvid = { 0x44444444, 0x4444, 0x4444, { 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44 } };
+
+    UINT64 FindCount(const std::vector<ExceptionSiteCount>& counts, ClassID classId, FunctionID functionId, UINT32 ilOffset)
+    {
+        for (const ExceptionSiteCount& count : counts)
+        {
+            if (count.ClassId == classId && count.FunctionId == functionId && count.ILOffset == ilOffset)
+            {
+                return count.Count;
+            }
+        }
+        return 0;
+    }
+}
+
+TEST(ExceptionAggregator_CountsByTypeAndThrowSite)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ClassID firstClass = profilerInfo->AddClass(0x10, 0x02000002);
+    ClassID secondClass = profilerInfo->AddClass(0x10, 0x02000003);
+    ObjectID firstException = profilerInfo->AddObject(firstClass);
+    ObjectID secondException = profilerInfo->AddObject(secondClass);
+    profilerInfo->AddNativeCode(0x2000, 0x10000, 0x20, { { 0x4, 0x0, 0x14 }, { 0x9, 0x14, 0x20 } });
+    // The native frame at the leaf is skipped; the throw site is the innermost managed frame.
+    ThreadID firstThread = profilerInfo->AddThread(1, { { 0, 0x1 }, { 0x2000, 0x10010 }, { 0x2001, 0x20 } });
+    ThreadID secondThread = profilerInfo->AddThread(2, { { 0x2000, 0x10018 } });
+
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, nullptr);
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_SUCCEEDED(aggregator.ExceptionThrown(firstThread, firstException));
+    }
+    ASSERT_SUCCEEDED(aggregator.ExceptionThrown(firstThread, secondException));
+    ASSERT_SUCCEEDED(aggregator.ExceptionThrown(secondThread, firstException));
+
+    std::vector<ExceptionSiteCount> counts;
+    ASSERT_SUCCEEDED(aggregator.GetCounts(counts));
+    ASSERT_EQ(static_cast<size_t>(3), counts.size());
+    ASSERT_EQ(static_cast<UINT64>(3), FindCount(counts, firstClass, 0x2000, 0x4));
+    ASSERT_EQ(static_cast<UINT64>(1), FindCount(counts, secondClass, 0x2000, 0x4));
+    ASSERT_EQ(static_cast<UINT64>(1), FindCount(counts, firstClass, 0x2000, 0x9));
+
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(aggregator.Serialize(buffer));
+    ASSERT_EQ(sizeof(UINT32) + 3 * 4 * sizeof(UINT64), buffer.size());
+    UINT32 siteCount = 0;
+    memcpy(&siteCount, buffer.data(), sizeof(siteCount));
+    ASSERT_EQ(static_cast<UINT32>(3), siteCount);
+}
+
+TEST(ExceptionAggregator_CombinesCodeVersionsByILOffset)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    // The same throw at IL offset 0x6 in tier 0 and tier 1 code.
+    profilerInfo->AddNativeCode(0x2000, 0x10000, 0x40, { { 0x0, 0x0, 0x20 }, { 0x6, 0x20, 0x40 } });
+    profilerInfo->AddNativeCode(0x2000, 0x20000, 0x10, { { 0x0, 0x0, 0x4 }, { 0x6, 0x4, 0x10 } });
+
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, nullptr);
+    ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000, 0x10028));
+    ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000, 0x10028));
+    ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000, 0x20008));
+    // Not in any version of the function's code.
+    ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000, 0x30008));
+
+    std::vector<ExceptionSiteCount> counts;
+    ASSERT_SUCCEEDED(aggregator.GetCounts(counts));
+    ASSERT_EQ(static_cast<size_t>(2), counts.size());
+    ASSERT_EQ(static_cast<UINT64>(3), FindCount(counts, 0x3000, 0x2000, 0x6));
+    ASSERT_EQ(static_cast<UINT64>(1), FindCount(counts, 0x3000, 0x2000, ExceptionAggregator::UnknownILOffset));
+}
+
+TEST(ExceptionAggregator_CountsConcurrentExceptions)
+{
+    const int ThreadCount = 4;
+    const int ExceptionsPerThread = 16384;
+    const UINT_PTR SiteCount = 64;
+
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, nullptr);
+
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < ThreadCount; thread++)
+    {
+        threads.emplace_back([&aggregator]()
+        {
+            for (int i = 0; i < ExceptionsPerThread; i++)
+            {
+                aggregator.Record(0x3000, 0x2000 + static_cast<FunctionID>(i % SiteCount), 0x10);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<ExceptionSiteCount> counts;
+    ASSERT_SUCCEEDED(aggregator.GetCounts(counts));
+    ASSERT_EQ(static_cast<size_t>(SiteCount), counts.size());
+    for (const ExceptionSiteCount& count : counts)
+    {
+        ASSERT_EQ(static_cast<UINT64>(ThreadCount * ExceptionsPerThread / SiteCount), count.Count);
+    }
+}
+
+TEST(ExceptionAggregator_CountsSitesPastTheLimitTogether)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, nullptr);
+
+    // Enough sites to fill every shard.
+    const UINT_PTR SiteCount = 64 * ExceptionAggregator::MaxSitesPerShard;
+    for (UINT_PTR site = 0; site < SiteCount; site++)
+    {
+        ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000 + static_cast<FunctionID>(site), 0x10));
+    }
+
+    std::vector<ExceptionSiteCount> counts;
+    ASSERT_SUCCEEDED(aggregator.GetCounts(counts));
+    ASSERT_TRUE(counts.size() < static_cast<size_t>(SiteCount));
+
+    // No exception goes uncounted.
+    UINT64 total = 0;
+    for (const ExceptionSiteCount& count : counts)
+    {
+        total += count.Count;
+    }
+    ASSERT_EQ(static_cast<UINT64>(SiteCount), total);
+    ASSERT_TRUE(FindCount(counts, 0, 0, 0) != 0);
+}
+
+TEST(ExceptionAggregator_WritesCountsPeriodically)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<ExceptionsEventProvider> provider;
+    ASSERT_SUCCEEDED(ExceptionsEventProvider::CreateProvider(profilerInfo, provider));
+    ProfilerEventEnablement& enablement = provider->GetEnablement();
+    enablement.Disable();
+
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, nullptr);
+    ASSERT_SUCCEEDED(aggregator.Record(0x3000, 0x2000, 0x10));
+    ASSERT_SUCCEEDED(aggregator.Start(std::move(provider), 10));
+
+    // Nothing is written while disabled.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(static_cast<size_t>(0), profilerInfo->GetWrittenEvents().size());
+
+    enablement.Enable(ExceptionsEventProvider::SiteCountKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents;
+    for (int i = 0; i < 500 && writtenEvents.empty(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        writtenEvents = profilerInfo->GetWrittenEvents();
+    }
+    aggregator.Shutdown();
+
+    ASSERT_TRUE(!writtenEvents.empty());
+    UINT64 count = 0;
+    memcpy(&count, writtenEvents[0].Payload[3].data(), sizeof(count));
+    ASSERT_EQ(static_cast<UINT64>(1), count);
+}
+
+TEST(ExceptionAggregator_ResolvesNamesOfNewSites)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef exceptionType = metadata.AddType(_T("Sample.SampleException"));
+    mdTypeDef programType = metadata.AddType(_T("Sample.Program"));
+    ClassID exceptionClass = profilerInfo->AddClass(module, exceptionType);
+    ClassID programClass = profilerInfo->AddClass(module, programType);
+    FunctionID function = profilerInfo->AddFunction(module, programClass, metadata.AddMethod(programType, _T("Main")));
+
+    std::shared_ptr<NameCache> nameCache = std::make_shared<NameCache>();
+    NameCachePrewarmer prewarmer(NullLogger::Instance, profilerInfo, nameCache);
+    ASSERT_SUCCEEDED(prewarmer.Start(NameCachePrewarmer::DefaultBatchSize, 0));
+
+    ExceptionAggregator aggregator(NullLogger::Instance, profilerInfo, &prewarmer);
+    ASSERT_SUCCEEDED(aggregator.Record(exceptionClass, function, 0x10));
+
+    bool resolved = false;
+    for (int i = 0; i < 500 && !resolved; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lock(prewarmer.GetCacheLock());
+        std::shared_ptr<ClassData> classData;
+        std::shared_ptr<FunctionData> functionData;
+        resolved = nameCache->TryGetClassData(exceptionClass, classData) && nameCache->TryGetFunctionData(function, functionData);
+    }
+    prewarmer.Shutdown();
+
+    ASSERT_TRUE(resolved);
+}
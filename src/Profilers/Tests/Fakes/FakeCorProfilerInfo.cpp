@@ -0,0 +1,463 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "FakeCorProfilerInfo.h"
+#include "corhlpr.h"
+#include <algorithm>
+
+namespace
+{
+    class FakeThreadEnum final :
+        public RefCount,
+        public ICorProfilerThreadEnum
+    {
+    public:
+        FakeThreadEnum(const std::vector<ThreadID>& threads) :
+            _threads(threads),
+            _position(0)
+        {
+        }
+
+        DEFINE_DELEGATED_REFCOUNT_ADDREF(FakeThreadEnum)
+        DEFINE_DELEGATED_REFCOUNT_RELEASE(FakeThreadEnum)
+        BEGIN_COM_MAP(FakeThreadEnum)
+            COM_INTERFACE_ENTRY(IUnknown)
+            COM_INTERFACE_ENTRY(ICorProfilerThreadEnum)
+        END_COM_MAP()
+
+        STDMETHOD(Skip)(ULONG celt) override
+        {
+            _position = std::min(_threads.size(), _position + celt);
+            return _position < _threads.size() ? S_OK : S_FALSE;
+        }
+
+        STDMETHOD(Reset)(void) override
+        {
+            _position = 0;
+            return S_OK;
+        }
+
+        STDMETHOD(Clone)(ICorProfilerThreadEnum **ppEnum) override
+        {
+            FakeThreadEnum* clone = new (std::nothrow) FakeThreadEnum(_threads);
+            IfNullRet(clone);
+            clone->_position = _position;
+            clone->AddRef();
+            *ppEnum = clone;
+            return S_OK;
+        }
+
+        STDMETHOD(GetCount)(ULONG *pcelt) override
+        {
+            *pcelt = static_cast<ULONG>(_threads.size());
+            return S_OK;
+        }
+
+        STDMETHOD(Next)(ULONG celt, ThreadID ids[], ULONG *pceltFetched) override
+        {
+            ULONG fetched = 0;
+            while (fetched < celt && _position < _threads.size())
+            {
+                ids[fetched++] = _threads[_position++];
+            }
+
+            if (pceltFetched != nullptr)
+            {
+                *pceltFetched = fetched;
+            }
+
+            return fetched == celt ? S_OK : S_FALSE;
+        }
+
+    private:
+        std::vector<ThreadID> _threads;
+        size_t _position;
+    };
+}
+
+FakeCorProfilerInfo::~FakeCorProfilerInfo()
+{
+    for (auto& module : _modules)
+    {
+        module.second->Release();
+    }
+}
+
+ModuleID FakeCorProfilerInfo::AddModule(const tstring& path, const GUID& mvid)
+{
+    ModuleID moduleId = static_cast<ModuleID>(_nextId++);
+    FakeMetaDataImport* metadata = new FakeMetaDataImport(path, mvid);
+    metadata->AddRef();
+    _modules.emplace(moduleId, metadata);
+    return moduleId;
+}
+
+FakeMetaDataImport& FakeCorProfilerInfo::GetMetaData(ModuleID moduleId)
+{
+    return *_modules.at(moduleId);
+}
+
+ClassID FakeCorProfilerInfo::AddClass(ModuleID moduleId, mdTypeDef typeDef, const std::vector<ClassID>& typeArgs)
+{
+    ClassID classId = static_cast<ClassID>(_nextId++);
+    FakeClass fakeClass = { moduleId, typeDef, typeArgs };
+    _classes.emplace(classId, fakeClass);
+    return classId;
+}
+
+FunctionID FakeCorProfilerInfo::AddFunction(ModuleID moduleId, ClassID classId, mdMethodDef methodDef, const std::vector<ClassID>& typeArgs)
+{
+    FunctionID functionId = static_cast<FunctionID>(_nextId++);
+    FakeFunction fakeFunction = { moduleId, classId, methodDef, typeArgs };
+    _functions.emplace(functionId, fakeFunction);
+    return functionId;
+}
+
+ThreadID FakeCorProfilerInfo::AddThread(DWORD osThreadId, const std::vector<Frame>& frames)
+{
+    ThreadID threadId = static_cast<ThreadID>(_nextId++);
+    FakeThread fakeThread = { osThreadId, frames };
+    _threads.emplace_back(threadId, fakeThread);
+    return threadId;
+}
+
+ObjectID FakeCorProfilerInfo::AddObject(ClassID classId)
+{
+    ObjectID objectId = static_cast<ObjectID>(_nextId++);
+    _objects.emplace(objectId, classId);
+    return objectId;
+}
+
+void FakeCorProfilerInfo::AddNativeCode(FunctionID functionId, UINT_PTR start, ULONG32 size, const std::vector<COR_DEBUG_IL_TO_NATIVE_MAP>& map)
+{
+    FakeNativeCode nativeCode = { functionId, start, size, map };
+    _nativeCode.push_back(nativeCode);
+}
+
+const FakeCorProfilerInfo::FakeNativeCode* FakeCorProfilerInfo::FindNativeCode(UINT_PTR start) const
+{
+    for (const FakeNativeCode& nativeCode : _nativeCode)
+    {
+        if (nativeCode.Start == start)
+        {
+            return &nativeCode;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<FakeCorProfilerInfo::DefinedEvent> FakeCorProfilerInfo::GetDefinedEvents()
+{
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    return _definedEvents;
+}
+
+std::vector<FakeCorProfilerInfo::WrittenEvent> FakeCorProfilerInfo::GetWrittenEvents()
+{
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    return _writtenEvents;
+}
+
+void FakeCorProfilerInfo::ClearWrittenEvents()
+{
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    _writtenEvents.clear();
+}
+
+HRESULT FakeCorProfilerInfo::CopyTypeArgs(const std::vector<ClassID>& source, ULONG32 count, ULONG32* pCount, ClassID* typeArgs)
+{
+    if (pCount != nullptr)
+    {
+        *pCount = static_cast<ULONG32>(source.size());
+    }
+
+    if (typeArgs != nullptr)
+    {
+        std::copy_n(source.begin(), std::min<size_t>(count, source.size()), typeArgs);
+    }
+
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetFunctionInfo2(FunctionID funcId, COR_PRF_FRAME_INFO frameInfo, ClassID *pClassId, ModuleID *pModuleId, mdToken *pToken, ULONG32 cTypeArgs, ULONG32 *pcTypeArgs, ClassID typeArgs[])
+{
+    auto const& it = _functions.find(funcId);
+    if (it == _functions.end())
+    {
+        return E_INVALIDARG;
+    }
+
+    if (pClassId != nullptr)
+    {
+        *pClassId = it->second.ClassId;
+    }
+
+    if (pModuleId != nullptr)
+    {
+        *pModuleId = it->second.ModuleId;
+    }
+
+    if (pToken != nullptr)
+    {
+        *pToken = it->second.MethodDef;
+    }
+
+    return CopyTypeArgs(it->second.TypeArgs, cTypeArgs, pcTypeArgs, typeArgs);
+}
+
+HRESULT FakeCorProfilerInfo::GetFunctionFromIP3(LPCBYTE ip, FunctionID *functionId, ReJITID *pReJitId)
+{
+    UINT_PTR address = reinterpret_cast<UINT_PTR>(ip);
+    for (const FakeNativeCode& nativeCode : _nativeCode)
+    {
+        if (address >= nativeCode.Start && address < nativeCode.Start + nativeCode.Size)
+        {
+            *functionId = nativeCode.FunctionId;
+            if (pReJitId != nullptr)
+            {
+                *pReJitId = 0;
+            }
+            return S_OK;
+        }
+    }
+
+    return E_FAIL;
+}
+
+HRESULT FakeCorProfilerInfo::GetNativeCodeStartAddresses(FunctionID functionID, ReJITID reJitId, ULONG32 cCodeStartAddresses, ULONG32 *pcCodeStartAddresses, UINT_PTR codeStartAddresses[])
+{
+    ULONG32 count = 0;
+    for (const FakeNativeCode& nativeCode : _nativeCode)
+    {
+        if (nativeCode.FunctionId == functionID)
+        {
+            if (codeStartAddresses != nullptr && count < cCodeStartAddresses)
+            {
+                codeStartAddresses[count] = nativeCode.Start;
+            }
+            count++;
+        }
+    }
+
+    *pcCodeStartAddresses = count;
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetILToNativeMapping3(UINT_PTR pNativeCodeStartAddress, ULONG32 cMap, ULONG32 *pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[])
+{
+    const FakeNativeCode* nativeCode = FindNativeCode(pNativeCodeStartAddress);
+    if (nativeCode == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    *pcMap = static_cast<ULONG32>(nativeCode->Map.size());
+    if (map != nullptr)
+    {
+        std::copy_n(nativeCode->Map.begin(), std::min<size_t>(cMap, nativeCode->Map.size()), map);
+    }
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetCodeInfo4(UINT_PTR pNativeCodeStartAddress, ULONG32 cCodeInfos, ULONG32 *pcCodeInfos, COR_PRF_CODE_INFO codeInfos[])
+{
+    const FakeNativeCode* nativeCode = FindNativeCode(pNativeCodeStartAddress);
+    if (nativeCode == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    *pcCodeInfos = 1;
+    if (codeInfos != nullptr && cCodeInfos > 0)
+    {
+        codeInfos[0].startAddress = nativeCode->Start;
+        codeInfos[0].size = nativeCode->Size;
+    }
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetClassFromObject(ObjectID objectId, ClassID *pClassId)
+{
+    auto const& it = _objects.find(objectId);
+    if (it == _objects.end())
+    {
+        return E_INVALIDARG;
+    }
+
+    *pClassId = it->second;
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetClassIDInfo2(ClassID classId, ModuleID *pModuleId, mdTypeDef *pTypeDefToken, ClassID *pParentClassId, ULONG32 cNumTypeArgs, ULONG32 *pcNumTypeArgs, ClassID typeArgs[])
+{
+    auto const& it = _classes.find(classId);
+    if (it == _classes.end())
+    {
+        return E_INVALIDARG;
+    }
+
+    if (pModuleId != nullptr)
+    {
+        *pModuleId = it->second.ModuleId;
+    }
+
+    if (pTypeDefToken != nullptr)
+    {
+        *pTypeDefToken = it->second.TypeDef;
+    }
+
+    if (pParentClassId != nullptr)
+    {
+        *pParentClassId = 0;
+    }
+
+    return CopyTypeArgs(it->second.TypeArgs, cNumTypeArgs, pcNumTypeArgs, typeArgs);
+}
+
+HRESULT FakeCorProfilerInfo::GetModuleMetaData(ModuleID moduleId, DWORD dwOpenFlags, REFIID riid, IUnknown **ppOut)
+{
+    if (_suspended.load())
+    {
+        _metadataRequestsWhileSuspended++;
+    }
+
+    auto const& it = _modules.find(moduleId);
+    if (it == _modules.end())
+    {
+        return E_INVALIDARG;
+    }
+
+    return it->second->QueryInterface(riid, reinterpret_cast<void**>(ppOut));
+}
+
+HRESULT FakeCorProfilerInfo::SuspendRuntime()
+{
+    if (_suspended.exchange(true))
+    {
+        return CORPROF_E_SUSPENSION_IN_PROGRESS;
+    }
+
+    _suspendCount++;
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::ResumeRuntime()
+{
+    if (!_suspended.exchange(false))
+    {
+        return CORPROF_E_UNSUPPORTED_CALL_SEQUENCE;
+    }
+
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::EnumThreads(ICorProfilerThreadEnum **ppEnum)
+{
+    std::vector<ThreadID> threads;
+    for (auto& thread : _threads)
+    {
+        threads.push_back(thread.first);
+    }
+
+    FakeThreadEnum* threadEnum = new (std::nothrow) FakeThreadEnum(threads);
+    IfNullRet(threadEnum);
+    threadEnum->AddRef();
+    *ppEnum = threadEnum;
+
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::GetThreadInfo(ThreadID threadId, DWORD *pdwWin32ThreadId)
+{
+    for (auto& thread : _threads)
+    {
+        if (thread.first == threadId)
+        {
+            *pdwWin32ThreadId = thread.second.OsThreadId;
+            return S_OK;
+        }
+    }
+
+    return E_INVALIDARG;
+}
+
+HRESULT FakeCorProfilerInfo::DoStackSnapshot(ThreadID thread, StackSnapshotCallback *callback, ULONG32 infoFlags, void *clientData, BYTE context[], ULONG32 contextSize)
+{
+    for (auto& fakeThread : _threads)
+    {
+        if (fakeThread.first != thread)
+        {
+            continue;
+        }
+
+        // Threads without managed frames fail the same way they do in the runtime.
+        if (fakeThread.second.Frames.empty())
+        {
+            return E_FAIL;
+        }
+
+        for (size_t i = 0; i < fakeThread.second.Frames.size(); i++)
+        {
+            const Frame& frame = fakeThread.second.Frames[i];
+            COR_PRF_FRAME_INFO frameInfo = static_cast<COR_PRF_FRAME_INFO>(i + 1);
+            if (callback(frame.FunctionId, frame.Ip, frameInfo, 0, nullptr, clientData) != S_OK)
+            {
+                return CORPROF_E_STACKSNAPSHOT_ABORTED;
+            }
+        }
+
+        return S_OK;
+    }
+
+    return E_INVALIDARG;
+}
+
+HRESULT FakeCorProfilerInfo::InitializeCurrentThread()
+{
+    _initializedThreadCount++;
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::EventPipeCreateProvider(const WCHAR *providerName, EVENTPIPE_PROVIDER *pProvider)
+{
+    *pProvider = static_cast<EVENTPIPE_PROVIDER>(_nextId++);
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::EventPipeDefineEvent(EVENTPIPE_PROVIDER provider, const WCHAR *eventName, UINT32 eventID, UINT64 keywords, UINT32 eventVersion, UINT32 level, UINT8 opcode, BOOL needStack, UINT32 cParamDescs, COR_PRF_EVENTPIPE_PARAM_DESC pParamDescs[], EVENTPIPE_EVENT *pEvent)
+{
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+
+    DefinedEvent definedEvent;
+    definedEvent.Provider = provider;
+    definedEvent.Name = eventName;
+    definedEvent.EventId = eventID;
+    definedEvent.Keywords = keywords;
+    definedEvent.Level = level;
+    definedEvent.Parameters.assign(pParamDescs, pParamDescs + cParamDescs);
+    _definedEvents.push_back(std::move(definedEvent));
+
+    // Event handles are indexes into the defined events, offset so that 0 stays invalid.
+    *pEvent = static_cast<EVENTPIPE_EVENT>(_definedEvents.size());
+    return S_OK;
+}
+
+HRESULT FakeCorProfilerInfo::EventPipeWriteEvent(EVENTPIPE_EVENT event, UINT32 cData, COR_PRF_EVENT_DATA data[], LPCGUID pActivityId, LPCGUID pRelatedActivityId)
+{
+    if (!_recordWrittenEvents.load())
+    {
+        return S_OK;
+    }
+
+    WrittenEvent writtenEvent;
+    writtenEvent.Event = event;
+    for (UINT32 i = 0; i < cData; i++)
+    {
+        const BYTE* ptr = reinterpret_cast<const BYTE*>(data[i].ptr);
+        writtenEvent.Payload.push_back(std::vector<BYTE>(ptr, ptr + data[i].size));
+    }
+
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    _writtenEvents.push_back(std::move(writtenEvent));
+    return S_OK;
+}
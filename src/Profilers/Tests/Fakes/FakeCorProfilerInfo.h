@@ -0,0 +1,175 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "corprof.h"
+#include "com.h"
+#include "refcount.h"
+#include "tstring.h"
+#include "CorProfilerInfoStub.h"
+#include "FakeMetaDataImport.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// In-memory ICorProfilerInfo12 modeling synthetic modules, classes, functions, managed threads and EventPipe.
+/// Build the model first, then hand it to the code under test; lookups are read only and safe from any thread.
+/// Events are recorded with a copy of their payload so tests can decode them after WritePayload returns.
+/// </summary>
+class FakeCorProfilerInfo final :
+    public RefCount,
+    public CorProfilerInfoStub
+{
+public:
+    struct Frame
+    {
+        FunctionID FunctionId;
+        UINT_PTR Ip;
+    };
+
+    struct DefinedEvent
+    {
+        EVENTPIPE_PROVIDER Provider;
+        tstring Name;
+        UINT32 EventId;
+        UINT64 Keywords;
+        UINT32 Level;
+        std::vector<COR_PRF_EVENTPIPE_PARAM_DESC> Parameters;
+    };
+
+    struct WrittenEvent
+    {
+        EVENTPIPE_EVENT Event;
+        std::vector<std::vector<BYTE>> Payload;
+    };
+
+    ~FakeCorProfilerInfo();
+
+    DEFINE_DELEGATED_REFCOUNT_ADDREF(FakeCorProfilerInfo)
+    DEFINE_DELEGATED_REFCOUNT_RELEASE(FakeCorProfilerInfo)
+    BEGIN_COM_MAP(FakeCorProfilerInfo)
+        COM_INTERFACE_ENTRY(IUnknown)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo2)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo3)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo4)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo5)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo6)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo7)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo8)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo9)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo10)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo11)
+        COM_INTERFACE_ENTRY(ICorProfilerInfo12)
+    END_COM_MAP()
+
+    //
+    // Model
+    //
+    ModuleID AddModule(const tstring& path, const GUID& mvid);
+    FakeMetaDataImport& GetMetaData(ModuleID moduleId);
+
+    // A loaded class, optionally an instantiation of a generic type definition.
+    ClassID AddClass(ModuleID moduleId, mdTypeDef typeDef, const std::vector<ClassID>& typeArgs = std::vector<ClassID>());
+    // classId is 0 for shared generic code, in which case the declaring type comes from the method's metadata.
+    FunctionID AddFunction(ModuleID moduleId, ClassID classId, mdMethodDef methodDef, const std::vector<ClassID>& typeArgs = std::vector<ClassID>());
+    // Frames are listed from the leaf to the root, which is the order DoStackSnapshot reports them.
+    ThreadID AddThread(DWORD osThreadId, const std::vector<Frame>& frames);
+    // An instance of the class, such as a thrown exception.
+    ObjectID AddObject(ClassID classId);
+    // A version of the function's native code, such as one tier, as a single region at start.
+    void AddNativeCode(FunctionID functionId, UINT_PTR start, ULONG32 size, const std::vector<COR_DEBUG_IL_TO_NATIVE_MAP>& map);
+
+    //
+    // Observations
+    //
+    bool IsRuntimeSuspended() const { return _suspended.load(); }
+    UINT32 GetSuspendCount() const { return _suspendCount.load(); }
+    UINT32 GetMetaDataRequestsWhileSuspended() const { return _metadataRequestsWhileSuspended.load(); }
+    UINT32 GetInitializedThreadCount() const { return _initializedThreadCount.load(); }
+    std::vector<DefinedEvent> GetDefinedEvents();
+    std::vector<WrittenEvent> GetWrittenEvents();
+    void ClearWrittenEvents();
+    // Benchmarks turn recording off so that copying payloads is not part of the measurement.
+    void SetRecordWrittenEvents(bool record) { _recordWrittenEvents.store(record); }
+
+    //
+    // ICorProfilerInfo12
+    //
+    STDMETHOD(GetClassFromObject)(ObjectID objectId, ClassID *pClassId) override;
+    STDMETHOD(GetFunctionInfo2)(FunctionID funcId, COR_PRF_FRAME_INFO frameInfo, ClassID *pClassId, ModuleID *pModuleId, mdToken *pToken, ULONG32 cTypeArgs, ULONG32 *pcTypeArgs, ClassID typeArgs[]) override;
+    STDMETHOD(GetClassIDInfo2)(ClassID classId, ModuleID *pModuleId, mdTypeDef *pTypeDefToken, ClassID *pParentClassId, ULONG32 cNumTypeArgs, ULONG32 *pcNumTypeArgs, ClassID typeArgs[]) override;
+    STDMETHOD(GetModuleMetaData)(ModuleID moduleId, DWORD dwOpenFlags, REFIID riid, IUnknown **ppOut) override;
+    STDMETHOD(SuspendRuntime)(void) override;
+    STDMETHOD(ResumeRuntime)(void) override;
+    STDMETHOD(EnumThreads)(ICorProfilerThreadEnum **ppEnum) override;
+    STDMETHOD(GetThreadInfo)(ThreadID threadId, DWORD *pdwWin32ThreadId) override;
+    STDMETHOD(DoStackSnapshot)(ThreadID thread, StackSnapshotCallback *callback, ULONG32 infoFlags, void *clientData, BYTE context[], ULONG32 contextSize) override;
+    STDMETHOD(InitializeCurrentThread)(void) override;
+    STDMETHOD(EventPipeCreateProvider)(const WCHAR *providerName, EVENTPIPE_PROVIDER *pProvider) override;
+    STDMETHOD(EventPipeDefineEvent)(EVENTPIPE_PROVIDER provider, const WCHAR *eventName, UINT32 eventID, UINT64 keywords, UINT32 eventVersion, UINT32 level, UINT8 opcode, BOOL needStack, UINT32 cParamDescs, COR_PRF_EVENTPIPE_PARAM_DESC pParamDescs[], EVENTPIPE_EVENT *pEvent) override;
+    STDMETHOD(EventPipeWriteEvent)(EVENTPIPE_EVENT event, UINT32 cData, COR_PRF_EVENT_DATA data[], LPCGUID pActivityId, LPCGUID pRelatedActivityId) override;
+    STDMETHOD(GetFunctionFromIP3)(LPCBYTE ip, FunctionID *functionId, ReJITID *pReJitId) override;
+    STDMETHOD(GetNativeCodeStartAddresses)(FunctionID functionID, ReJITID reJitId, ULONG32 cCodeStartAddresses, ULONG32 *pcCodeStartAddresses, UINT_PTR codeStartAddresses[]) override;
+    STDMETHOD(GetILToNativeMapping3)(UINT_PTR pNativeCodeStartAddress, ULONG32 cMap, ULONG32 *pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[]) override;
+    STDMETHOD(GetCodeInfo4)(UINT_PTR pNativeCodeStartAddress, ULONG32 cCodeInfos, ULONG32 *pcCodeInfos, COR_PRF_CODE_INFO codeInfos[]) override;
+
+private:
+    struct FakeClass
+    {
+        ModuleID ModuleId;
+        mdTypeDef TypeDef;
+        std::vector<ClassID> TypeArgs;
+    };
+
+    struct FakeFunction
+    {
+        ModuleID ModuleId;
+        ClassID ClassId;
+        mdMethodDef MethodDef;
+        std::vector<ClassID> TypeArgs;
+    };
+
+    struct FakeNativeCode
+    {
+        FunctionID FunctionId;
+        UINT_PTR Start;
+        ULONG32 Size;
+        std::vector<COR_DEBUG_IL_TO_NATIVE_MAP> Map;
+    };
+
+    struct FakeThread
+    {
+        DWORD OsThreadId;
+        std::vector<Frame> Frames;
+    };
+
+    static HRESULT CopyTypeArgs(const std::vector<ClassID>& source, ULONG32 count, ULONG32* pCount, ClassID* typeArgs);
+    const FakeNativeCode* FindNativeCode(UINT_PTR start) const;
+
+    // Ids are opaque pointers in the runtime; these only need to be unique and non zero.
+    UINT_PTR _nextId = 0x1000;
+
+    // Each module holds a reference, released when the fake is destroyed. ComPtr is not copyable, so it cannot be a map value.
+    std::unordered_map<ModuleID, FakeMetaDataImport*> _modules;
+    std::unordered_map<ClassID, FakeClass> _classes;
+    std::unordered_map<FunctionID, FakeFunction> _functions;
+    std::vector<std::pair<ThreadID, FakeThread>> _threads;
+    std::unordered_map<ObjectID, ClassID> _objects;
+    std::vector<FakeNativeCode> _nativeCode;
+
+    std::atomic_bool _suspended{ false };
+    std::atomic<UINT32> _suspendCount{ 0 };
+    std::atomic<UINT32> _metadataRequestsWhileSuspended{ 0 };
+    std::atomic<UINT32> _initializedThreadCount{ 0 };
+    std::atomic_bool _recordWrittenEvents{ true };
+
+    std::mutex _eventsMutex;
+    std::vector<DefinedEvent> _definedEvents;
+    std::vector<WrittenEvent> _writtenEvents;
+};
@@ -0,0 +1,130 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "FakeMetaDataImport.h"
+#include "corhlpr.h"
+#include <string.h>
+
+FakeMetaDataImport::FakeMetaDataImport(const tstring& scopeName, const GUID& mvid) :
+    _scopeName(scopeName),
+    _mvid(mvid)
+{
+}
+
+mdTypeDef FakeMetaDataImport::AddType(const tstring& name, mdTypeDef enclosingType, bool stackTraceHidden)
+{
+    mdTypeDef typeDef = TokenFromRid(static_cast<RID>(_types.size() + 1), mdtTypeDef);
+    TypeDefinition definition = { name, enclosingType, stackTraceHidden };
+    _types.emplace(typeDef, definition);
+    return typeDef;
+}
+
+mdMethodDef FakeMetaDataImport::AddMethod(mdTypeDef typeDef, const tstring& name, bool stackTraceHidden)
+{
+    mdMethodDef methodDef = TokenFromRid(static_cast<RID>(_methods.size() + 1), mdtMethodDef);
+    MethodDefinition definition = { name, typeDef, stackTraceHidden };
+    _methods.emplace(methodDef, definition);
+    return methodDef;
+}
+
+HRESULT FakeMetaDataImport::CopyName(const tstring& name, LPWSTR buffer, ULONG bufferLength, ULONG* nameLength)
+{
+    ULONG requiredLength = static_cast<ULONG>(name.size() + 1);
+    if (nameLength != nullptr)
+    {
+        *nameLength = requiredLength;
+    }
+
+    if (buffer == nullptr || bufferLength == 0)
+    {
+        return S_OK;
+    }
+
+    ULONG copyLength = requiredLength <= bufferLength ? requiredLength - 1 : bufferLength - 1;
+    memcpy(buffer, name.c_str(), copyLength * sizeof(WCHAR));
+    buffer[copyLength] = 0;
+
+    return requiredLength <= bufferLength ? S_OK : CLDB_S_TRUNCATION;
+}
+
+HRESULT FakeMetaDataImport::GetScopeProps(LPWSTR szName, ULONG cchName, ULONG *pchName, GUID *pmvid)
+{
+    if (pmvid != nullptr)
+    {
+        *pmvid = _mvid;
+    }
+
+    return CopyName(_scopeName, szName, cchName, pchName);
+}
+
+HRESULT FakeMetaDataImport::GetTypeDefProps(mdTypeDef td, LPWSTR szTypeDef, ULONG cchTypeDef, ULONG *pchTypeDef, DWORD *pdwTypeDefFlags, mdToken *ptkExtends)
+{
+    auto const& it = _types.find(td);
+    if (it == _types.end())
+    {
+        return CLDB_E_RECORD_NOTFOUND;
+    }
+
+    if (pdwTypeDefFlags != nullptr)
+    {
+        *pdwTypeDefFlags = it->second.EnclosingType == mdTypeDefNil ? tdPublic : tdNestedPublic;
+    }
+
+    if (ptkExtends != nullptr)
+    {
+        *ptkExtends = mdTypeRefNil;
+    }
+
+    return CopyName(it->second.Name, szTypeDef, cchTypeDef, pchTypeDef);
+}
+
+HRESULT FakeMetaDataImport::GetMethodProps(mdMethodDef mb, mdTypeDef *pClass, LPWSTR szMethod, ULONG cchMethod, ULONG *pchMethod, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags)
+{
+    auto const& it = _methods.find(mb);
+    if (it == _methods.end())
+    {
+        return CLDB_E_RECORD_NOTFOUND;
+    }
+
+    if (pClass != nullptr)
+    {
+        *pClass = it->second.TypeDef;
+    }
+
+    return CopyName(it->second.Name, szMethod, cchMethod, pchMethod);
+}
+
+HRESULT FakeMetaDataImport::GetNestedClassProps(mdTypeDef tdNestedClass, mdTypeDef *ptdEnclosingClass)
+{
+    auto const& it = _types.find(tdNestedClass);
+    if (it == _types.end() || it->second.EnclosingType == mdTypeDefNil)
+    {
+        return CLDB_E_RECORD_NOTFOUND;
+    }
+
+    *ptdEnclosingClass = it->second.EnclosingType;
+    return S_OK;
+}
+
+HRESULT FakeMetaDataImport::GetCustomAttributeByName(mdToken tkObj, LPCWSTR szName, const void **ppData, ULONG *pcbData)
+{
+    // StackTraceHiddenAttribute is the only attribute that is modeled.
+    if (tstring(szName) != _T("System.Diagnostics.StackTraceHiddenAttribute"))
+    {
+        return S_FALSE;
+    }
+
+    bool hidden = false;
+    if (TypeFromToken(tkObj) == mdtTypeDef)
+    {
+        auto const& it = _types.find(tkObj);
+        hidden = it != _types.end() && it->second.StackTraceHidden;
+    }
+    else if (TypeFromToken(tkObj) == mdtMethodDef)
+    {
+        auto const& it = _methods.find(tkObj);
+        hidden = it != _methods.end() && it->second.StackTraceHidden;
+    }
+
+    return hidden ? S_OK : S_FALSE;
+}
@@ -0,0 +1,65 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+#include "com.h"
+#include "refcount.h"
+#include "tstring.h"
+#include "MetaDataImportStub.h"
+#include <unordered_map>
+
+/// <summary>
+/// In-memory metadata for a single synthetic module. Only the lookups used by TypeNameUtilities are implemented.
+/// Names are returned with the same buffer semantics as the runtime: lengths include the null terminator and
+/// names that do not fit are truncated with CLDB_S_TRUNCATION.
+/// The model must be fully built before it is read, after which it can be read from any number of threads.
+/// </summary>
+class FakeMetaDataImport final :
+    public RefCount,
+    public MetaDataImportStub
+{
+public:
+    FakeMetaDataImport(const tstring& scopeName, const GUID& mvid);
+
+    DEFINE_DELEGATED_REFCOUNT_ADDREF(FakeMetaDataImport)
+    DEFINE_DELEGATED_REFCOUNT_RELEASE(FakeMetaDataImport)
+    BEGIN_COM_MAP(FakeMetaDataImport)
+        COM_INTERFACE_ENTRY(IUnknown)
+        COM_INTERFACE_ENTRY(IMetaDataImport)
+        COM_INTERFACE_ENTRY(IMetaDataImport2)
+    END_COM_MAP()
+
+    // name includes the namespace for top level types, e.g. System.Collections.Generic.List`1.
+    mdTypeDef AddType(const tstring& name, mdTypeDef enclosingType = mdTypeDefNil, bool stackTraceHidden = false);
+    mdMethodDef AddMethod(mdTypeDef typeDef, const tstring& name, bool stackTraceHidden = false);
+
+    STDMETHOD(GetScopeProps)(LPWSTR szName, ULONG cchName, ULONG *pchName, GUID *pmvid) override;
+    STDMETHOD(GetTypeDefProps)(mdTypeDef td, LPWSTR szTypeDef, ULONG cchTypeDef, ULONG *pchTypeDef, DWORD *pdwTypeDefFlags, mdToken *ptkExtends) override;
+    STDMETHOD(GetMethodProps)(mdMethodDef mb, mdTypeDef *pClass, LPWSTR szMethod, ULONG cchMethod, ULONG *pchMethod, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags) override;
+    STDMETHOD(GetNestedClassProps)(mdTypeDef tdNestedClass, mdTypeDef *ptdEnclosingClass) override;
+    STDMETHOD(GetCustomAttributeByName)(mdToken tkObj, LPCWSTR szName, const void **ppData, ULONG *pcbData) override;
+
+private:
+    struct TypeDefinition
+    {
+        tstring Name;
+        mdTypeDef EnclosingType;
+        bool StackTraceHidden;
+    };
+
+    struct MethodDefinition
+    {
+        tstring Name;
+        mdTypeDef TypeDef;
+        bool StackTraceHidden;
+    };
+
+    static HRESULT CopyName(const tstring& name, LPWSTR buffer, ULONG bufferLength, ULONG* nameLength);
+
+    tstring _scopeName;
+    GUID _mvid;
+    std::unordered_map<mdTypeDef, TypeDefinition> _types;
+    std::unordered_map<mdMethodDef, MethodDefinition> _methods;
+};
@@ -0,0 +1,91 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "cor.h"
+
+/// <summary>
+/// IMetaDataImport2 with every method returning E_NOTIMPL. Fakes derive from this and override only what they model.
+/// The declarations mirror cor.h and must be updated along with it.
+/// </summary>
+class MetaDataImportStub :
+    public IMetaDataImport2
+{
+public:
+    virtual ~MetaDataImportStub() {}
+
+    // IMetaDataImport
+    STDMETHOD_(void, CloseEnum)(HCORENUM hEnum) override { }
+    STDMETHOD(CountEnum)(HCORENUM hEnum, ULONG *pulCount) override { return E_NOTIMPL; }
+    STDMETHOD(ResetEnum)(HCORENUM hEnum, ULONG ulPos) override { return E_NOTIMPL; }
+    STDMETHOD(EnumTypeDefs)(HCORENUM *phEnum, mdTypeDef rTypeDefs[], ULONG cMax, ULONG *pcTypeDefs) override { return E_NOTIMPL; }
+    STDMETHOD(EnumInterfaceImpls)(HCORENUM *phEnum, mdTypeDef td, mdInterfaceImpl rImpls[], ULONG cMax, ULONG* pcImpls) override { return E_NOTIMPL; }
+    STDMETHOD(EnumTypeRefs)(HCORENUM *phEnum, mdTypeRef rTypeRefs[], ULONG cMax, ULONG* pcTypeRefs) override { return E_NOTIMPL; }
+    STDMETHOD(FindTypeDefByName)(LPCWSTR szTypeDef, mdToken tkEnclosingClass, mdTypeDef *ptd) override { return E_NOTIMPL; }
+    STDMETHOD(GetScopeProps)(LPWSTR szName, ULONG cchName, ULONG *pchName, GUID *pmvid) override { return E_NOTIMPL; }
+    STDMETHOD(GetModuleFromScope)(mdModule *pmd) override { return E_NOTIMPL; }
+    STDMETHOD(GetTypeDefProps)(mdTypeDef td, LPWSTR szTypeDef, ULONG cchTypeDef, ULONG *pchTypeDef, DWORD *pdwTypeDefFlags, mdToken *ptkExtends) override { return E_NOTIMPL; }
+    STDMETHOD(GetInterfaceImplProps)(mdInterfaceImpl iiImpl, mdTypeDef *pClass, mdToken *ptkIface) override { return E_NOTIMPL; }
+    STDMETHOD(GetTypeRefProps)(mdTypeRef tr, mdToken *ptkResolutionScope, LPWSTR szName, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+    STDMETHOD(ResolveTypeRef)(mdTypeRef tr, REFIID riid, IUnknown **ppIScope, mdTypeDef *ptd) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMembers)(HCORENUM *phEnum, mdTypeDef cl, mdToken rMembers[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMembersWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdToken rMembers[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMethods)(HCORENUM *phEnum, mdTypeDef cl, mdMethodDef rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMethodsWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdMethodDef rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumFields)(HCORENUM *phEnum, mdTypeDef cl, mdFieldDef rFields[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumFieldsWithName)(HCORENUM *phEnum, mdTypeDef cl, LPCWSTR szName, mdFieldDef rFields[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumParams)(HCORENUM *phEnum, mdMethodDef mb, mdParamDef rParams[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMemberRefs)(HCORENUM *phEnum, mdToken tkParent, mdMemberRef rMemberRefs[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMethodImpls)(HCORENUM *phEnum, mdTypeDef td, mdToken rMethodBody[], mdToken rMethodDecl[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(EnumPermissionSets)(HCORENUM *phEnum, mdToken tk, DWORD dwActions, mdPermission rPermission[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(FindMember)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdToken *pmb) override { return E_NOTIMPL; }
+    STDMETHOD(FindMethod)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdMethodDef *pmb) override { return E_NOTIMPL; }
+    STDMETHOD(FindField)(mdTypeDef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdFieldDef *pmb) override { return E_NOTIMPL; }
+    STDMETHOD(FindMemberRef)(mdTypeRef td, LPCWSTR szName, PCCOR_SIGNATURE pvSigBlob, ULONG cbSigBlob, mdMemberRef *pmr) override { return E_NOTIMPL; }
+    STDMETHOD(GetMethodProps)(mdMethodDef mb, mdTypeDef *pClass, LPWSTR szMethod, ULONG cchMethod, ULONG *pchMethod, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags) override { return E_NOTIMPL; }
+    STDMETHOD(GetMemberRefProps)(mdMemberRef mr, mdToken *ptk, LPWSTR szMember, ULONG cchMember, ULONG *pchMember, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pbSig) override { return E_NOTIMPL; }
+    STDMETHOD(EnumProperties)(HCORENUM *phEnum, mdTypeDef td, mdProperty rProperties[], ULONG cMax, ULONG *pcProperties) override { return E_NOTIMPL; }
+    STDMETHOD(EnumEvents)(HCORENUM *phEnum, mdTypeDef td, mdEvent rEvents[], ULONG cMax, ULONG *pcEvents) override { return E_NOTIMPL; }
+    STDMETHOD(GetEventProps)(mdEvent ev, mdTypeDef *pClass, LPCWSTR szEvent, ULONG cchEvent, ULONG *pchEvent, DWORD *pdwEventFlags, mdToken *ptkEventType, mdMethodDef *pmdAddOn, mdMethodDef *pmdRemoveOn, mdMethodDef *pmdFire, mdMethodDef rmdOtherMethod[], ULONG cMax, ULONG *pcOtherMethod) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMethodSemantics)(HCORENUM *phEnum, mdMethodDef mb, mdToken rEventProp[], ULONG cMax, ULONG *pcEventProp) override { return E_NOTIMPL; }
+    STDMETHOD(GetMethodSemantics)(mdMethodDef mb, mdToken tkEventProp, DWORD *pdwSemanticsFlags) override { return E_NOTIMPL; }
+    STDMETHOD(GetClassLayout)(mdTypeDef td, DWORD *pdwPackSize, COR_FIELD_OFFSET rFieldOffset[], ULONG cMax, ULONG *pcFieldOffset, ULONG *pulClassSize) override { return E_NOTIMPL; }
+    STDMETHOD(GetFieldMarshal)(mdToken tk, PCCOR_SIGNATURE *ppvNativeType, ULONG *pcbNativeType) override { return E_NOTIMPL; }
+    STDMETHOD(GetRVA)(mdToken tk, ULONG *pulCodeRVA, DWORD *pdwImplFlags) override { return E_NOTIMPL; }
+    STDMETHOD(GetPermissionSetProps)(mdPermission pm, DWORD *pdwAction, void const **ppvPermission, ULONG *pcbPermission) override { return E_NOTIMPL; }
+    STDMETHOD(GetSigFromToken)(mdSignature mdSig, PCCOR_SIGNATURE *ppvSig, ULONG *pcbSig) override { return E_NOTIMPL; }
+    STDMETHOD(GetModuleRefProps)(mdModuleRef mur, LPWSTR szName, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+    STDMETHOD(EnumModuleRefs)(HCORENUM *phEnum, mdModuleRef rModuleRefs[], ULONG cmax, ULONG *pcModuleRefs) override { return E_NOTIMPL; }
+    STDMETHOD(GetTypeSpecFromToken)(mdTypeSpec typespec, PCCOR_SIGNATURE *ppvSig, ULONG *pcbSig) override { return E_NOTIMPL; }
+    STDMETHOD(GetNameFromToken)(mdToken tk, MDUTF8CSTR *pszUtf8NamePtr) override { return E_NOTIMPL; }
+    STDMETHOD(EnumUnresolvedMethods)(HCORENUM *phEnum, mdToken rMethods[], ULONG cMax, ULONG *pcTokens) override { return E_NOTIMPL; }
+    STDMETHOD(GetUserString)(mdString stk, LPWSTR szString, ULONG cchString, ULONG *pchString) override { return E_NOTIMPL; }
+    STDMETHOD(GetPinvokeMap)(mdToken tk, DWORD *pdwMappingFlags, LPWSTR szImportName, ULONG cchImportName, ULONG *pchImportName, mdModuleRef *pmrImportDLL) override { return E_NOTIMPL; }
+    STDMETHOD(EnumSignatures)(HCORENUM *phEnum, mdSignature rSignatures[], ULONG cmax, ULONG *pcSignatures) override { return E_NOTIMPL; }
+    STDMETHOD(EnumTypeSpecs)(HCORENUM *phEnum, mdTypeSpec rTypeSpecs[], ULONG cmax, ULONG *pcTypeSpecs) override { return E_NOTIMPL; }
+    STDMETHOD(EnumUserStrings)(HCORENUM *phEnum, mdString rStrings[], ULONG cmax, ULONG *pcStrings) override { return E_NOTIMPL; }
+    STDMETHOD(GetParamForMethodIndex)(mdMethodDef md, ULONG ulParamSeq, mdParamDef *ppd) override { return E_NOTIMPL; }
+    STDMETHOD(EnumCustomAttributes)(HCORENUM *phEnum, mdToken tk, mdToken tkType, mdCustomAttribute rCustomAttributes[], ULONG cMax, ULONG *pcCustomAttributes) override { return E_NOTIMPL; }
+    STDMETHOD(GetCustomAttributeProps)(mdCustomAttribute cv, mdToken *ptkObj, mdToken *ptkType, void const **ppBlob, ULONG *pcbSize) override { return E_NOTIMPL; }
+    STDMETHOD(FindTypeRef)(mdToken tkResolutionScope, LPCWSTR szName, mdTypeRef *ptr) override { return E_NOTIMPL; }
+    STDMETHOD(GetMemberProps)(mdToken mb, mdTypeDef *pClass, LPWSTR szMember, ULONG cchMember, ULONG *pchMember, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, ULONG *pulCodeRVA, DWORD *pdwImplFlags, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+    STDMETHOD(GetFieldProps)(mdFieldDef mb, mdTypeDef *pClass, LPWSTR szField, ULONG cchField, ULONG *pchField, DWORD *pdwAttr, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+    STDMETHOD(GetPropertyProps)(mdProperty prop, mdTypeDef *pClass, LPCWSTR szProperty, ULONG cchProperty, ULONG *pchProperty, DWORD *pdwPropFlags, PCCOR_SIGNATURE *ppvSig, ULONG *pbSig, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppDefaultValue, ULONG *pcchDefaultValue, mdMethodDef *pmdSetter, mdMethodDef *pmdGetter, mdMethodDef rmdOtherMethod[], ULONG cMax, ULONG *pcOtherMethod) override { return E_NOTIMPL; }
+    STDMETHOD(GetParamProps)(mdParamDef tk, mdMethodDef *pmd, ULONG *pulSequence, LPWSTR szName, ULONG cchName, ULONG *pchName, DWORD *pdwAttr, DWORD *pdwCPlusTypeFlag, UVCP_CONSTANT *ppValue, ULONG *pcchValue) override { return E_NOTIMPL; }
+    STDMETHOD(GetCustomAttributeByName)(mdToken tkObj, LPCWSTR szName, const void **ppData, ULONG *pcbData) override { return E_NOTIMPL; }
+    STDMETHOD_(BOOL, IsValidToken)(mdToken tk) override { return 0; }
+    STDMETHOD(GetNestedClassProps)(mdTypeDef tdNestedClass, mdTypeDef *ptdEnclosingClass) override { return E_NOTIMPL; }
+    STDMETHOD(GetNativeCallConvFromSig)(void const *pvSig, ULONG cbSig, ULONG *pCallConv) override { return E_NOTIMPL; }
+    STDMETHOD(IsGlobal)(mdToken pd, int *pbGlobal) override { return E_NOTIMPL; }
+
+    // IMetaDataImport2
+    STDMETHOD(EnumGenericParams)(HCORENUM *phEnum, mdToken tk, mdGenericParam rGenericParams[], ULONG cMax, ULONG *pcGenericParams) override { return E_NOTIMPL; }
+    STDMETHOD(GetGenericParamProps)(mdGenericParam gp, ULONG *pulParamSeq, DWORD *pdwParamFlags, mdToken *ptOwner, DWORD *reserved, LPWSTR wzname, ULONG cchName, ULONG *pchName) override { return E_NOTIMPL; }
+    STDMETHOD(GetMethodSpecProps)(mdMethodSpec mi, mdToken *tkParent, PCCOR_SIGNATURE *ppvSigBlob, ULONG *pcbSigBlob) override { return E_NOTIMPL; }
+    STDMETHOD(EnumGenericParamConstraints)(HCORENUM *phEnum, mdGenericParam tk, mdGenericParamConstraint rGenericParamConstraints[], ULONG cMax, ULONG *pcGenericParamConstraints) override { return E_NOTIMPL; }
+    STDMETHOD(GetGenericParamConstraintProps)(mdGenericParamConstraint gpc, mdGenericParam *ptGenericParam, mdToken *ptkConstraintType) override { return E_NOTIMPL; }
+    STDMETHOD(GetPEKind)(DWORD* pdwPEKind, DWORD* pdwMAchine) override { return E_NOTIMPL; }
+    STDMETHOD(GetVersionString)(LPWSTR pwzBuf, DWORD ccBufSize, DWORD *pccBufSize) override { return E_NOTIMPL; }
+    STDMETHOD(EnumMethodSpecs)(HCORENUM *phEnum, mdToken tk, mdMethodSpec rMethodSpecs[], ULONG cMax, ULONG *pcMethodSpecs) override { return E_NOTIMPL; }
+};
@@ -0,0 +1,75 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "SyntheticRuntime.h"
+#include <string>
+
+SyntheticRuntime::SyntheticRuntime(FakeCorProfilerInfo& profilerInfo, size_t functionCount, size_t threadCount, size_t stackDepth)
+{
+    const GUID coreMvid = { 0x11111111, 0x1111, 0x1111, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 } };
+    const GUID appMvid = { 0x22222222, 0x2222, 0x2222, { 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22 } };
+
+    ModuleID coreModule = profilerInfo.AddModule(_T("/usr/share/dotnet/shared/Microsoft.NETCore.App/System.Private.CoreLib.dll"), coreMvid);
+    FakeMetaDataImport& coreMetadata = profilerInfo.GetMetaData(coreModule);
+    mdTypeDef int32Type = coreMetadata.AddType(_T("System.Int32"));
+    mdTypeDef stringType = coreMetadata.AddType(_T("System.String"));
+    mdTypeDef listType = coreMetadata.AddType(_T("System.Collections.Generic.List`1"));
+    mdTypeDef enumeratorType = coreMetadata.AddType(_T("Enumerator"), listType);
+    mdTypeDef dictionaryType = coreMetadata.AddType(_T("System.Collections.Generic.Dictionary`2"));
+
+    ClassID int32Class = profilerInfo.AddClass(coreModule, int32Type);
+    ClassID stringClass = profilerInfo.AddClass(coreModule, stringType);
+    ClassID listOfInt32Class = profilerInfo.AddClass(coreModule, listType, { int32Class });
+    ClassID enumeratorOfStringClass = profilerInfo.AddClass(coreModule, enumeratorType, { stringClass });
+    ClassID dictionaryClass = profilerInfo.AddClass(coreModule, dictionaryType, { stringClass, listOfInt32Class });
+
+    ModuleID appModule = profilerInfo.AddModule(_T("/app/Sample.dll"), appMvid);
+    FakeMetaDataImport& appMetadata = profilerInfo.GetMetaData(appModule);
+    mdTypeDef programType = appMetadata.AddType(_T("Sample.Program"));
+    mdTypeDef workerType = appMetadata.AddType(_T("Sample.Worker`1"));
+    mdTypeDef hiddenType = appMetadata.AddType(_T("Sample.Internal.Dispatcher"), mdTypeDefNil, true);
+
+    ClassID programClass = profilerInfo.AddClass(appModule, programType);
+    ClassID workerOfInt32Class = profilerInfo.AddClass(appModule, workerType, { int32Class });
+    ClassID workerOfDictionaryClass = profilerInfo.AddClass(appModule, workerType, { dictionaryClass });
+    ClassID hiddenClass = profilerInfo.AddClass(appModule, hiddenType);
+
+    for (size_t i = 0; i < functionCount; i++)
+    {
+        tstring name = _T("Method") + to_tstring(std::to_string(i));
+        switch (i % 6)
+        {
+            case 0:
+                _functions.push_back(profilerInfo.AddFunction(appModule, programClass, appMetadata.AddMethod(programType, name)));
+                break;
+            case 1:
+                _functions.push_back(profilerInfo.AddFunction(appModule, workerOfInt32Class, appMetadata.AddMethod(workerType, name)));
+                break;
+            case 2:
+                // Generic method on a generic class.
+                _functions.push_back(profilerInfo.AddFunction(appModule, workerOfDictionaryClass, appMetadata.AddMethod(workerType, name), { stringClass }));
+                break;
+            case 3:
+                // Shared generic code has no ClassID; the declaring type comes from metadata.
+                _functions.push_back(profilerInfo.AddFunction(appModule, 0, appMetadata.AddMethod(workerType, name)));
+                break;
+            case 4:
+                _functions.push_back(profilerInfo.AddFunction(coreModule, enumeratorOfStringClass, coreMetadata.AddMethod(enumeratorType, name)));
+                break;
+            default:
+                _functions.push_back(profilerInfo.AddFunction(appModule, hiddenClass, appMetadata.AddMethod(hiddenType, name)));
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        std::vector<FakeCorProfilerInfo::Frame> frames;
+        for (size_t j = 0; j < stackDepth && functionCount > 0; j++)
+        {
+            FakeCorProfilerInfo::Frame frame = { _functions[(i * 7 + j * 13) % functionCount], static_cast<UINT_PTR>(0x100 + j) };
+            frames.push_back(frame);
+        }
+        _threads.push_back(profilerInfo.AddThread(static_cast<DWORD>(1000 + i), frames));
+    }
+}
@@ -0,0 +1,28 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "FakeCorProfilerInfo.h"
+#include <vector>
+
+/// <summary>
+/// Populates a FakeCorProfilerInfo with a representative runtime: a core library with primitive and generic
+/// collection types (including a nested type), and an application module whose functions are spread over
+/// generic and non generic classes, shared generic code and generic methods.
+/// Used by tests and benchmarks that need a realistic mix of names rather than specific shapes.
+/// </summary>
+class SyntheticRuntime
+{
+public:
+    // Builds functionCount application functions and threadCount threads, each with stackDepth frames
+    // drawn from the functions in a fixed pattern so that frames repeat across and within stacks.
+    SyntheticRuntime(FakeCorProfilerInfo& profilerInfo, size_t functionCount, size_t threadCount, size_t stackDepth);
+
+    const std::vector<FunctionID>& GetFunctions() const { return _functions; }
+    const std::vector<ThreadID>& GetThreads() const { return _threads; }
+
+private:
+    std::vector<FunctionID> _functions;
+    std::vector<ThreadID> _threads;
+};
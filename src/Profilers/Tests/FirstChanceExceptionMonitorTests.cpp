@@ -0,0 +1,192 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Exceptions/FirstChanceExceptionMonitor.h"
+#include "Logging/NullLogger.h"
+#include <string.h>
+#include <thread>
+
+namespace
+{
+    tstring GetEventName(FakeCorProfilerInfo* profilerInfo, EVENTPIPE_EVENT event)
+    {
+        // The fake hands out event handles in definition order, starting at 1.
+        return profilerInfo->GetDefinedEvents()[static_cast<size_t>(event) - 1].Name;
+    }
+
+    template<typename T>
+    T ReadValue(const std::vector<BYTE>& data)
+    {
+        T value;
+        memcpy(&value, data.data(), sizeof(T));
+        return value;
+    }
+
+    std::vector<UINT64> ReadArray(const std::vector<BYTE>& data)
+    {
+        UINT16 count = ReadValue<UINT16>(data);
+        std::vector<UINT64> values(count);
+        memcpy(values.data(), data.data() + sizeof(count), count * sizeof(UINT64));
+        return values;
+    }
+
+    std::unique_ptr<FirstChanceExceptionMonitor> CreateMonitor(FakeCorProfilerInfo* profilerInfo, UINT32 sampleRate)
+    {
+        std::unique_ptr<ExceptionsEventProvider> provider;
+        if (FAILED(ExceptionsEventProvider::CreateProvider(profilerInfo, provider)))
+        {
+            return nullptr;
+        }
+
+        return std::unique_ptr<FirstChanceExceptionMonitor>(
+            new FirstChanceExceptionMonitor(NullLogger::Instance, profilerInfo, std::move(provider), nullptr, sampleRate));
+    }
+}
+
+TEST(FirstChanceExceptionMonitor_WritesEachStackOnce)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ClassID exceptionClass = profilerInfo->AddClass(0x10, 0x02000002);
+    ObjectID exception = profilerInfo->AddObject(exceptionClass);
+    ThreadID threadId = profilerInfo->AddThread(42, { { 0x2000, 0x10 }, { 0x2001, 0x20 } });
+
+    std::unique_ptr<FirstChanceExceptionMonitor> monitor = CreateMonitor(profilerInfo, 1);
+    ASSERT_TRUE(monitor != nullptr);
+
+    ASSERT_SUCCEEDED(monitor->ExceptionThrown(threadId, exception));
+    ASSERT_SUCCEEDED(monitor->ExceptionThrown(threadId, exception));
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(3), writtenEvents.size());
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[0].Event) == _T("ExceptionStack"));
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[1].Event) == _T("FirstChanceException"));
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[2].Event) == _T("FirstChanceException"));
+
+    UINT32 stackId = ReadValue<UINT32>(writtenEvents[0].Payload[0]);
+    ASSERT_TRUE(stackId != 0);
+    ASSERT_TRUE(ReadArray(writtenEvents[0].Payload[1]) == std::vector<UINT64>({ 0x2000, 0x2001 }));
+    ASSERT_TRUE(ReadArray(writtenEvents[0].Payload[2]) == std::vector<UINT64>({ 0x10, 0x20 }));
+
+    for (size_t i = 1; i < writtenEvents.size(); i++)
+    {
+        ASSERT_EQ(static_cast<UINT64>(exceptionClass), ReadValue<UINT64>(writtenEvents[i].Payload[0]));
+        ASSERT_EQ(stackId, ReadValue<UINT32>(writtenEvents[i].Payload[1]));
+        ASSERT_EQ(static_cast<UINT32>(42), ReadValue<UINT32>(writtenEvents[i].Payload[2]));
+        ASSERT_TRUE(ReadValue<UINT64>(writtenEvents[i].Payload[3]) != 0);
+    }
+}
+
+TEST(FirstChanceExceptionMonitor_CapsFrames)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ObjectID exception = profilerInfo->AddObject(profilerInfo->AddClass(0x10, 0x02000002));
+    std::vector<FakeCorProfilerInfo::Frame> frames;
+    for (UINT_PTR i = 0; i < 2 * FirstChanceExceptionMonitor::MaxFrames; i++)
+    {
+        frames.push_back({ 0x2000 + i, i });
+    }
+    ThreadID threadId = profilerInfo->AddThread(42, frames);
+
+    std::unique_ptr<FirstChanceExceptionMonitor> monitor = CreateMonitor(profilerInfo, 1);
+    ASSERT_TRUE(monitor != nullptr);
+    ASSERT_SUCCEEDED(monitor->ExceptionThrown(threadId, exception));
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(2), writtenEvents.size());
+    std::vector<UINT64> functionIds = ReadArray(writtenEvents[0].Payload[1]);
+    ASSERT_EQ(static_cast<size_t>(FirstChanceExceptionMonitor::MaxFrames), functionIds.size());
+    ASSERT_EQ(static_cast<UINT64>(0x2000), functionIds[0]);
+}
+
+TEST(FirstChanceExceptionMonitor_SamplesExceptions)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ObjectID exception = profilerInfo->AddObject(profilerInfo->AddClass(0x10, 0x02000002));
+    // Without managed frames there is no stack to describe, so only the exceptions are written.
+    ThreadID threadId = profilerInfo->AddThread(42, std::vector<FakeCorProfilerInfo::Frame>());
+
+    std::unique_ptr<FirstChanceExceptionMonitor> monitor = CreateMonitor(profilerInfo, 4);
+    ASSERT_TRUE(monitor != nullptr);
+
+    // Runs on a new thread so that the per thread count starts from zero.
+    HRESULT hr = S_OK;
+    std::thread thread([&]()
+    {
+        for (int i = 0; i < 10 && SUCCEEDED(hr); i++)
+        {
+            hr = monitor->ExceptionThrown(threadId, exception);
+        }
+    });
+    thread.join();
+    ASSERT_SUCCEEDED(hr);
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(2), writtenEvents.size());
+    ASSERT_EQ(static_cast<UINT32>(0), ReadValue<UINT32>(writtenEvents[0].Payload[1]));
+}
+
+TEST(FirstChanceExceptionMonitor_FollowsEnablement)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ObjectID exception = profilerInfo->AddObject(profilerInfo->AddClass(0x10, 0x02000002));
+    ThreadID threadId = profilerInfo->AddThread(42, { { 0x2000, 0x10 } });
+
+    std::unique_ptr<ExceptionsEventProvider> provider;
+    ASSERT_SUCCEEDED(ExceptionsEventProvider::CreateProvider(profilerInfo, provider));
+    ProfilerEventEnablement& enablement = provider->GetEnablement();
+    FirstChanceExceptionMonitor monitor(NullLogger::Instance, profilerInfo, std::move(provider), nullptr, 1);
+
+    // Enabled from startup, without any command.
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_EQ(static_cast<size_t>(2), profilerInfo->GetWrittenEvents().size());
+
+    enablement.Disable();
+    profilerInfo->ClearWrittenEvents();
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_EQ(static_cast<size_t>(0), profilerInfo->GetWrittenEvents().size());
+
+    // A session that only asks for counts.
+    enablement.Enable(ExceptionsEventProvider::SiteCountKeyword, COR_PRF_EVENTPIPE_VERBOSE);
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_EQ(static_cast<size_t>(0), profilerInfo->GetWrittenEvents().size());
+
+    enablement.Enable(ExceptionsEventProvider::ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_EQ(static_cast<size_t>(2), profilerInfo->GetWrittenEvents().size());
+}
+
+TEST(FirstChanceExceptionMonitor_DescribesStacksAgainForEachSession)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ObjectID exception = profilerInfo->AddObject(profilerInfo->AddClass(0x10, 0x02000002));
+    ThreadID threadId = profilerInfo->AddThread(42, { { 0x2000, 0x10 } });
+
+    std::unique_ptr<ExceptionsEventProvider> provider;
+    ASSERT_SUCCEEDED(ExceptionsEventProvider::CreateProvider(profilerInfo, provider));
+    ProfilerEventEnablement& enablement = provider->GetEnablement();
+    FirstChanceExceptionMonitor monitor(NullLogger::Instance, profilerInfo, std::move(provider), nullptr, 1);
+
+    enablement.Enable(ExceptionsEventProvider::ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    ASSERT_EQ(static_cast<size_t>(3), profilerInfo->GetWrittenEvents().size());
+
+    // The first session ends and the next starts without an exception in between.
+    enablement.Disable();
+    enablement.Enable(ExceptionsEventProvider::ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    profilerInfo->ClearWrittenEvents();
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(2), writtenEvents.size());
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[0].Event) == _T("ExceptionStack"));
+
+    // A session that starts while the previous one is still listening.
+    enablement.Enable(ExceptionsEventProvider::ExceptionKeyword, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    profilerInfo->ClearWrittenEvents();
+    ASSERT_SUCCEEDED(monitor.ExceptionThrown(threadId, exception));
+    writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(2), writtenEvents.size());
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[0].Event) == _T("ExceptionStack"));
+}
@@ -0,0 +1,348 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "cor.h"
+#include "guids.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Communication/CommandServer.h"
+#include "Logging/NullLogger.h"
+#include "IpcTestClient.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+#include <thread>
+
+//
+// Benchmarks for the command path: a CommandServer with a stub callback, driven by in-process clients over its
+// Unix domain socket. No runtime is needed; results measure the socket layer, framing, queues and response path.
+//
+// Usage: MonitorProfilerIpcBenchmarks [filter]
+//
+namespace
+{
+    // Outside the command sets the profiler uses, so that requests are neither control commands nor coalesced.
+    const unsigned short BenchmarkCommandSet = 100;
+    // Completes without a result.
+    const unsigned short EmptyCommand = 0;
+    // Completes with a result of the size in the UINT32 payload.
+    const unsigned short ResultCommand = 1;
+
+    typedef std::chrono::steady_clock Clock;
+
+    class BenchmarkServer
+    {
+    public:
+        BenchmarkServer() :
+            _profilerInfo(new FakeCorProfilerInfo()),
+            _server(NullLogger::Instance, _profilerInfo)
+        {
+        }
+
+        ~BenchmarkServer()
+        {
+            _server.Shutdown();
+        }
+
+        HRESULT Start(const std::string& path)
+        {
+            return _server.Start(
+                path,
+                [](const IpcMessage& message, std::vector<BYTE>& result) -> HRESULT { return Callback(message, result); },
+                [](const IpcMessage& message) -> HRESULT { return S_OK; },
+                [](unsigned short commandSet, bool& unmanagedOnly) -> HRESULT { unmanagedOnly = false; return S_OK; });
+        }
+
+    private:
+        static HRESULT Callback(const IpcMessage& message, std::vector<BYTE>& result)
+        {
+            if (message.Command == ResultCommand && message.Payload.size() == sizeof(UINT32))
+            {
+                UINT32 size = 0;
+                memcpy(&size, message.Payload.data(), sizeof(size));
+                result.resize(size);
+            }
+            return S_OK;
+        }
+
+        ComPtr<FakeCorProfilerInfo> _profilerInfo;
+        CommandServer _server;
+    };
+
+    // Latencies and failures seen by one or more clients.
+    struct Results
+    {
+        std::vector<double> LatenciesUs;
+        int Errors = 0;
+    };
+
+    // Reads Data messages until the status for requestId arrives.
+    HRESULT ReceiveStatus(IpcCommClient& client, UINT32 requestId, size_t& resultSize)
+    {
+        HRESULT hr;
+
+        resultSize = 0;
+        IpcMessage response;
+        while (true)
+        {
+            IfFailRet(client.Receive(response));
+            if (response.RequestId != requestId)
+            {
+                return E_UNEXPECTED;
+            }
+            if (response.Command != static_cast<unsigned short>(ServerResponseCommand::Data))
+            {
+                break;
+            }
+            resultSize += response.Payload.size();
+        }
+
+        if (response.Payload.size() < sizeof(HRESULT))
+        {
+            return E_UNEXPECTED;
+        }
+        resultSize += response.Payload.size() - sizeof(HRESULT);
+        HRESULT status;
+        memcpy(&status, response.Payload.data(), sizeof(HRESULT));
+        return status;
+    }
+
+    // Sends requests one at a time and records how long each takes to complete.
+    void RunRoundTrips(IpcCommClient& client, const IpcMessage& request, int count, Results& results)
+    {
+        results.LatenciesUs.reserve(results.LatenciesUs.size() + count);
+        for (int i = 0; i < count; i++)
+        {
+            Clock::time_point start = Clock::now();
+            size_t resultSize = 0;
+            if (FAILED(client.Send(request)) || FAILED(ReceiveStatus(client, request.RequestId, resultSize)))
+            {
+                results.Errors++;
+                return;
+            }
+            results.LatenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+    }
+
+    IpcMessage CreateRequest(unsigned short commandSet, unsigned short command, UINT32 requestId, size_t payloadSize)
+    {
+        IpcMessage request = CreateMessage(static_cast<CommandSet>(commandSet), command, requestId);
+        request.Payload.resize(payloadSize);
+        return request;
+    }
+
+    void Report(const char* name, Results& results, Clock::duration elapsed, size_t bytesPerMessage)
+    {
+        std::vector<double>& latencies = results.LatenciesUs;
+        if (latencies.empty())
+        {
+            printf("%-44s failed (%d errors)\n", name, results.Errors);
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double messagesPerSecond = latencies.size() / seconds;
+
+        printf("%-44s %10.0f msg/s  p50 %8.1f us  p99 %8.1f us  max %9.1f us",
+            name,
+            messagesPerSecond,
+            latencies[latencies.size() / 2],
+            latencies[latencies.size() * 99 / 100],
+            latencies.back());
+        if (bytesPerMessage != 0)
+        {
+            printf("  %8.1f MiB/s", messagesPerSecond * bytesPerMessage / (1024.0 * 1024.0));
+        }
+        if (results.Errors != 0)
+        {
+            printf("  (%d errors)", results.Errors);
+        }
+        printf("\n");
+    }
+
+    bool IsSelected(const char* filter, const char* name)
+    {
+        return filter == nullptr || strstr(name, filter) != nullptr;
+    }
+
+    void RunRoundTripBenchmark(const char* filter, const char* name, const std::string& path, ConnectionFlags flags, const IpcMessage& request, int count, size_t bytesPerMessage)
+    {
+        if (!IsSelected(filter, name))
+        {
+            return;
+        }
+
+        std::unique_ptr<IpcCommClient> client;
+        Results results;
+        if (FAILED(OpenMultiplexedConnection(path, client, flags)))
+        {
+            Report(name, results, Clock::duration(), 0);
+            return;
+        }
+
+        // Warm up the server's buffers.
+        RunRoundTrips(*client, request, std::max(1, count / 10), results);
+        results = Results();
+
+        Clock::time_point start = Clock::now();
+        RunRoundTrips(*client, request, count, results);
+        Report(name, results, Clock::now() - start, bytesPerMessage);
+    }
+
+    // Keeps window requests outstanding on one connection.
+    void RunPipelinedBenchmark(const char* filter, const char* name, const std::string& path, UINT32 window, int count)
+    {
+        if (!IsSelected(filter, name))
+        {
+            return;
+        }
+
+        std::unique_ptr<IpcCommClient> client;
+        Results results;
+        if (FAILED(OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses)))
+        {
+            Report(name, results, Clock::duration(), 0);
+            return;
+        }
+
+        std::vector<Clock::time_point> sendTimes(window);
+        IpcMessage request = CreateRequest(BenchmarkCommandSet, EmptyCommand, 0, 0);
+        results.LatenciesUs.reserve(count);
+
+        Clock::time_point start = Clock::now();
+        UINT32 sent = 0;
+        for (UINT32 received = 0; received < static_cast<UINT32>(count); received++)
+        {
+            while (sent < static_cast<UINT32>(count) && sent - received < window)
+            {
+                request.RequestId = sent;
+                sendTimes[sent % window] = Clock::now();
+                if (FAILED(client->Send(request)))
+                {
+                    results.Errors++;
+                    Report(name, results, Clock::now() - start, 0);
+                    return;
+                }
+                sent++;
+            }
+
+            // Responses arrive in order, since there is a single worker for the command set.
+            size_t resultSize = 0;
+            if (FAILED(ReceiveStatus(*client, received, resultSize)))
+            {
+                results.Errors++;
+                break;
+            }
+            results.LatenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sendTimes[received % window]).count());
+        }
+
+        Report(name, results, Clock::now() - start, 0);
+    }
+
+    // Each client sends requests one at a time on its own connection and command set.
+    void RunConcurrentClientsBenchmark(const char* filter, const std::string& path, int clientCount, int totalCount)
+    {
+        std::string name = "Concurrent clients (" + std::to_string(clientCount) + ")";
+        if (!IsSelected(filter, name.c_str()))
+        {
+            return;
+        }
+
+        std::vector<Results> clientResults(clientCount);
+        std::vector<std::thread> threads;
+        std::atomic_int connected(0);
+        std::atomic_bool go(false);
+        int count = totalCount / clientCount;
+
+        for (int i = 0; i < clientCount; i++)
+        {
+            threads.emplace_back([&, i]()
+            {
+                std::unique_ptr<IpcCommClient> client;
+                HRESULT hr = OpenMultiplexedConnection(path, client, ConnectionFlags::CompletionResponses);
+                connected++;
+                while (!go.load())
+                {
+                    std::this_thread::yield();
+                }
+
+                if (FAILED(hr))
+                {
+                    clientResults[i].Errors++;
+                    return;
+                }
+                IpcMessage request = CreateRequest(static_cast<unsigned short>(BenchmarkCommandSet + i), EmptyCommand, 1, 0);
+                RunRoundTrips(*client, request, count, clientResults[i]);
+            });
+        }
+
+        while (connected.load() < clientCount)
+        {
+            std::this_thread::yield();
+        }
+
+        Clock::time_point start = Clock::now();
+        go.store(true);
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        Clock::duration elapsed = Clock::now() - start;
+
+        Results results;
+        for (Results& clientResult : clientResults)
+        {
+            results.LatenciesUs.insert(results.LatenciesUs.end(), clientResult.LatenciesUs.begin(), clientResult.LatenciesUs.end());
+            results.Errors += clientResult.Errors;
+        }
+        Report(name.c_str(), results, elapsed, 0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    std::string path = GetSocketPath();
+    BenchmarkServer server;
+    if (FAILED(server.Start(path)))
+    {
+        fprintf(stderr, "Unable to start the command server on %s\n", path.c_str());
+        return 1;
+    }
+
+    IpcMessage emptyRequest = CreateRequest(BenchmarkCommandSet, EmptyCommand, 1, 0);
+    RunRoundTripBenchmark(filter, "Round trip (queued status)", path, ConnectionFlags::None, emptyRequest, 20000, 0);
+    RunRoundTripBenchmark(filter, "Round trip (completion status)", path, ConnectionFlags::CompletionResponses, emptyRequest, 20000, 0);
+
+    for (UINT32 window = 8; window <= 64; window *= 8)
+    {
+        std::string name = "Pipelined (" + std::to_string(window) + " outstanding)";
+        RunPipelinedBenchmark(filter, name.c_str(), path, window, 100000);
+    }
+
+    for (int clients = 1; clients <= 64; clients *= 8)
+    {
+        RunConcurrentClientsBenchmark(filter, path, clients, 64000);
+    }
+
+    const UINT32 PayloadSizes[] = { 64 * 1024, 1024 * 1024, IpcCommClient::MaxPayloadSize };
+    for (UINT32 size : PayloadSizes)
+    {
+        int count = static_cast<int>(std::max<UINT32>(20, 64 * 1024 * 1024 / size));
+
+        std::string name = "Request payload (" + std::to_string(size / 1024) + " KiB)";
+        IpcMessage uploadRequest = CreateRequest(BenchmarkCommandSet, EmptyCommand, 1, size);
+        RunRoundTripBenchmark(filter, name.c_str(), path, ConnectionFlags::CompletionResponses, uploadRequest, count, size);
+
+        // Results that do not fit in the status arrive as Data messages first.
+        name = "Result (" + std::to_string(size / 1024) + " KiB)";
+        IpcMessage downloadRequest = CreateRequest(BenchmarkCommandSet, ResultCommand, 1, sizeof(UINT32));
+        memcpy(downloadRequest.Payload.data(), &size, sizeof(UINT32));
+        RunRoundTripBenchmark(filter, name.c_str(), path, ConnectionFlags::CompletionResponses, downloadRequest, count, size);
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include "Communication/IpcCommClient.h"
+#include "Communication/Messages.h"
+#include "macros.h"
+#include <memory>
+#include <string>
+#include <string.h>
+#include <unistd.h>
+
+//
+// Client side of the command socket, for tests and benchmarks that run a CommandServer in process.
+//
+
+inline std::string GetSocketPath()
+{
+    return "/tmp/dotnet-monitor-tests-" + std::to_string(getpid()) + ".sock";
+}
+
+inline HRESULT ConnectSocket(const std::string& path, SOCKET& s)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0)
+    {
+        return E_FAIL;
+    }
+
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(s);
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+inline HRESULT Connect(const std::string& path, std::unique_ptr<IpcCommClient>& client)
+{
+    HRESULT hr;
+    SOCKET s;
+    IfFailRet(ConnectSocket(path, s));
+
+    client.reset(new IpcCommClient(s));
+    return S_OK;
+}
+
+inline HRESULT ReadStatus(const IpcMessage& response)
+{
+    HRESULT status = E_FAIL;
+    if (response.Payload.size() == sizeof(HRESULT))
+    {
+        memcpy(&status, response.Payload.data(), sizeof(HRESULT));
+    }
+    return status;
+}
+
+inline HRESULT OpenMultiplexedConnection(const std::string& path, std::unique_ptr<IpcCommClient>& client, ConnectionFlags flags = ConnectionFlags::None)
+{
+    HRESULT hr;
+    IfFailRet(Connect(path, client));
+
+    IpcMessage request;
+    request.CommandSet = static_cast<unsigned short>(CommandSet::Connection);
+    request.Command = static_cast<unsigned short>(ConnectionCommand::Multiplex);
+    if (flags != ConnectionFlags::None)
+    {
+        request.Payload.resize(sizeof(UINT32));
+        *reinterpret_cast<UINT32*>(request.Payload.data()) = static_cast<UINT32>(flags);
+    }
+    IfFailRet(client->Send(request));
+
+    IpcMessage response;
+    IfFailRet(client->Receive(response));
+    IfFailRet(ReadStatus(response));
+    client->SetMultiplexed(true);
+
+    return S_OK;
+}
+
+inline IpcMessage CreateMessage(CommandSet commandSet, unsigned short command, UINT32 requestId)
+{
+    IpcMessage message;
+    message.CommandSet = static_cast<unsigned short>(commandSet);
+    message.Command = command;
+    message.RequestId = requestId;
+    return message;
+}
@@ -0,0 +1,107 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Communication/MessageCallbackManager.h"
+#include <atomic>
+#include <thread>
+
+namespace
+{
+    IpcMessage CreateMessage(unsigned short commandSet)
+    {
+        IpcMessage message;
+        message.CommandSet = commandSet;
+        message.Command = 0;
+        return message;
+    }
+
+    // Registers a callback that runs until released.
+    void RegisterBlockingCallback(MessageCallbackManager& callbacks, unsigned short commandSet, std::atomic_bool& started, std::atomic_bool& release)
+    {
+        callbacks.TryRegister(commandSet, [&started, &release](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT
+        {
+            started.store(true);
+            while (!release.load())
+            {
+                std::this_thread::yield();
+            }
+            return S_OK;
+        }, false);
+    }
+}
+
+TEST(MessageCallbackManager_DispatchesCommandSetsConcurrently)
+{
+    MessageCallbackManager callbacks;
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    RegisterBlockingCallback(callbacks, 1, started, release);
+    ASSERT_TRUE(callbacks.TryRegister(2, [](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT { return S_OK; }, true));
+
+    HRESULT blockedResult = E_FAIL;
+    std::thread blocked([&callbacks, &blockedResult]()
+    {
+        std::vector<BYTE> result;
+        blockedResult = callbacks.DispatchMessage(CreateMessage(1), result);
+    });
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+
+    // Neither dispatch nor registration waits for the running callback.
+    std::vector<BYTE> result;
+    ASSERT_EQ(S_OK, callbacks.DispatchMessage(CreateMessage(2), result));
+    ASSERT_TRUE(callbacks.TryRegister(3, [](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT { return S_OK; }, false));
+    ASSERT_TRUE(!callbacks.TryRegister(2, [](const IpcMessage& message, std::vector<BYTE>& result)-> HRESULT { return S_OK; }, false));
+
+    bool unmanagedOnly = false;
+    ASSERT_SUCCEEDED(callbacks.UnmanagedOnly(2, unmanagedOnly));
+    ASSERT_TRUE(unmanagedOnly);
+
+    release.store(true);
+    blocked.join();
+    ASSERT_EQ(S_OK, blockedResult);
+}
+
+TEST(MessageCallbackManager_UnregisterWaitsForRunningDispatch)
+{
+    MessageCallbackManager callbacks;
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    RegisterBlockingCallback(callbacks, 1, started, release);
+
+    std::thread dispatch([&callbacks]()
+    {
+        std::vector<BYTE> result;
+        callbacks.DispatchMessage(CreateMessage(1), result);
+    });
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+
+    std::atomic_bool unregistered(false);
+    std::thread unregister([&callbacks, &unregistered]()
+    {
+        callbacks.Unregister(1);
+        unregistered.store(true);
+    });
+
+    // The command set is removed right away, but Unregister returns only once the callback completes.
+    while (callbacks.IsRegistered(1))
+    {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(!unregistered.load());
+
+    std::vector<BYTE> result;
+    ASSERT_EQ(E_FAIL, callbacks.DispatchMessage(CreateMessage(1), result));
+
+    release.store(true);
+    dispatch.join();
+    unregister.join();
+    ASSERT_TRUE(unregistered.load());
+}
@@ -0,0 +1,163 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Fakes/SyntheticRuntime.h"
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+
+TEST(NameCache_MergeAddsMissingEntries)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 12, 0, 0);
+    TypeNameUtilities nameUtilities(profilerInfo);
+
+    NameCache first;
+    NameCache second;
+    NameCache combined;
+    const std::vector<FunctionID>& functions = runtime.GetFunctions();
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(i % 2 == 0 ? first : second, functions[i], 0));
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(combined, functions[i], 0));
+    }
+
+    first.Merge(second);
+
+    ASSERT_EQ(combined.GetFunctions().size(), first.GetFunctions().size());
+    ASSERT_EQ(combined.GetClasses().size(), first.GetClasses().size());
+    ASSERT_EQ(combined.GetModules().size(), first.GetModules().size());
+    ASSERT_EQ(combined.GetTypeNames().size(), first.GetTypeNames().size());
+
+    for (FunctionID function : functions)
+    {
+        tstring expected;
+        tstring actual;
+        ASSERT_SUCCEEDED(combined.GetFullyQualifiedName(function, expected));
+        ASSERT_SUCCEEDED(first.GetFullyQualifiedName(function, actual));
+        ASSERT_TRUE(expected == actual);
+    }
+}
+
+TEST(NameCache_InstantiationHashIsIndependentOfRuntimeIds)
+{
+    const GUID mvid = { 0x44444444, 0x4444, 0x4444, { 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44 } };
+    ComPtr<FakeCorProfilerInfo> firstProcess(new FakeCorProfilerInfo());
+    ComPtr<FakeCorProfilerInfo> secondProcess(new FakeCorProfilerInfo());
+
+    // Shifts every id in the second process.
+    secondProcess->AddModule(_T("Unrelated.dll"), mvid);
+
+    std::vector<UINT64> typeArgs[2];
+    NameCache nameCaches[2];
+    FakeCorProfilerInfo* processes[2] = { firstProcess, secondProcess };
+    for (int i = 0; i < 2; i++)
+    {
+        ModuleID module = processes[i]->AddModule(_T("Sample.dll"), mvid);
+        mdTypeDef type = processes[i]->GetMetaData(module).AddType(_T("Sample.Item"));
+        ClassID typeClass = processes[i]->AddClass(module, type);
+        typeArgs[i].push_back(static_cast<UINT64>(typeClass));
+
+        TypeNameUtilities nameUtilities(processes[i]);
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCaches[i], typeClass));
+    }
+
+    ASSERT_TRUE(typeArgs[0] != typeArgs[1]);
+    ASSERT_TRUE(nameCaches[0].GetInstantiationHash(typeArgs[0]) != 0);
+    ASSERT_EQ(nameCaches[0].GetInstantiationHash(typeArgs[0]), nameCaches[1].GetInstantiationHash(typeArgs[1]));
+}
+
+TEST(NameCache_InstantiationHashDistinguishesUnresolvedClasses)
+{
+    NameCache nameCache;
+    std::vector<UINT64> first = { 0x1000 };
+    std::vector<UINT64> second = { 0x2000 };
+
+    ASSERT_TRUE(nameCache.GetInstantiationHash(first) != nameCache.GetInstantiationHash(second));
+    ASSERT_EQ(nameCache.GetInstantiationHash(first), nameCache.GetInstantiationHash(first));
+}
+
+TEST(NameCache_CopyFunctionNamesCopiesOnlyWhatIsReferenced)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 12, 0, 0);
+    TypeNameUtilities nameUtilities(profilerInfo);
+
+    NameCache source;
+    const std::vector<FunctionID>& functions = runtime.GetFunctions();
+    for (FunctionID function : functions)
+    {
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(source, function, 0));
+    }
+
+    NameCache subset;
+    for (size_t i = 0; i < functions.size(); i += 5)
+    {
+        subset.CopyFunctionNames(source, functions[i]);
+    }
+    // Ids the source has not resolved are skipped.
+    subset.CopyFunctionNames(source, 0x1);
+
+    ASSERT_EQ(static_cast<size_t>(3), subset.GetFunctions().size());
+    ASSERT_TRUE(subset.GetClasses().size() <= source.GetClasses().size());
+    ASSERT_TRUE(subset.GetTypeNames().size() < source.GetTypeNames().size());
+
+    for (size_t i = 0; i < functions.size(); i += 5)
+    {
+        tstring expected;
+        tstring actual;
+        ASSERT_SUCCEEDED(source.GetFullyQualifiedName(functions[i], expected));
+        ASSERT_SUCCEEDED(subset.GetFullyQualifiedName(functions[i], actual));
+        ASSERT_TRUE(expected == actual);
+    }
+}
+
+TEST(NameCache_RemoveModuleEvictsItsNamesAndInstantiations)
+{
+    const GUID coreMvid = { 0x11111111, 0x1111, 0x1111, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 } };
+    const GUID pluginMvid = { 0x22222222, 0x2222, 0x2222, { 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22 } };
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+
+    ModuleID coreModule = profilerInfo->AddModule(_T("Core.dll"), coreMvid);
+    FakeMetaDataImport& coreMetadata = profilerInfo->GetMetaData(coreModule);
+    mdTypeDef listType = coreMetadata.AddType(_T("Core.List`1"));
+    mdTypeDef stringType = coreMetadata.AddType(_T("Core.String"));
+    ClassID stringClass = profilerInfo->AddClass(coreModule, stringType);
+
+    // A collectible module, and core code instantiated over its type.
+    ModuleID pluginModule = profilerInfo->AddModule(_T("Plugin.dll"), pluginMvid);
+    FakeMetaDataImport& pluginMetadata = profilerInfo->GetMetaData(pluginModule);
+    mdTypeDef itemType = pluginMetadata.AddType(_T("Plugin.Item"));
+    ClassID itemClass = profilerInfo->AddClass(pluginModule, itemType);
+    ClassID listOfItemClass = profilerInfo->AddClass(coreModule, listType, { itemClass });
+    ClassID listOfStringClass = profilerInfo->AddClass(coreModule, listType, { stringClass });
+
+    FunctionID pluginFunction = profilerInfo->AddFunction(pluginModule, itemClass, pluginMetadata.AddMethod(itemType, _T("Run")));
+    FunctionID listOfItemFunction = profilerInfo->AddFunction(coreModule, listOfItemClass, coreMetadata.AddMethod(listType, _T("Add")));
+    FunctionID listOfStringFunction = profilerInfo->AddFunction(coreModule, listOfStringClass, coreMetadata.AddMethod(listType, _T("Clear")));
+
+    TypeNameUtilities nameUtilities(profilerInfo);
+    NameCache nameCache;
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, pluginFunction, 0));
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, listOfItemFunction, 0));
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, listOfStringFunction, 0));
+
+    nameCache.RemoveModule(pluginModule);
+
+    std::shared_ptr<FunctionData> functionData;
+    std::shared_ptr<ClassData> classData;
+    std::shared_ptr<ModuleData> moduleData;
+    std::shared_ptr<TokenData> tokenData;
+    ASSERT_TRUE(!nameCache.TryGetFunctionData(pluginFunction, functionData));
+    ASSERT_TRUE(!nameCache.TryGetFunctionData(listOfItemFunction, functionData));
+    ASSERT_TRUE(!nameCache.TryGetClassData(itemClass, classData));
+    ASSERT_TRUE(!nameCache.TryGetClassData(listOfItemClass, classData));
+    ASSERT_TRUE(!nameCache.TryGetModuleData(pluginModule, moduleData));
+    ASSERT_TRUE(!nameCache.TryGetTokenData(pluginModule, itemType, tokenData));
+
+    // Names that do not depend on the module remain.
+    tstring name;
+    ASSERT_SUCCEEDED(nameCache.GetFullyQualifiedName(listOfStringFunction, name));
+    ASSERT_TRUE(nameCache.TryGetModuleData(coreModule, moduleData));
+}
@@ -0,0 +1,66 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Communication/PayloadBufferPool.h"
+
+TEST(PayloadBufferPool_ReusesBuffersWithinSizeClass)
+{
+    PayloadBufferPool pool;
+
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(pool.Rent(3000, buffer));
+    ASSERT_EQ(static_cast<size_t>(3000), buffer.size());
+    const BYTE* data = buffer.data();
+
+    pool.Return(buffer);
+    ASSERT_TRUE(buffer.empty());
+
+    // 3000 and 2500 bytes share the 4 KiB class.
+    std::vector<BYTE> reused;
+    ASSERT_SUCCEEDED(pool.Rent(2500, reused));
+    ASSERT_EQ(static_cast<size_t>(2500), reused.size());
+    ASSERT_TRUE(data == reused.data());
+
+    // The class is empty again, so this one is allocated.
+    std::vector<BYTE> allocated;
+    ASSERT_SUCCEEDED(pool.Rent(2500, allocated));
+    ASSERT_TRUE(data != allocated.data());
+}
+
+TEST(PayloadBufferPool_KeepsReturnedBuffersInTheirClass)
+{
+    PayloadBufferPool pool;
+
+    // Too small for any class, so it is not kept.
+    std::vector<BYTE> small(10);
+    pool.Return(small);
+
+    // Buffers from outside the pool go to the largest class their capacity fills.
+    std::vector<BYTE> external(5000);
+    const BYTE* data = external.data();
+    pool.Return(external);
+
+    std::vector<BYTE> larger;
+    ASSERT_SUCCEEDED(pool.Rent(5000, larger));
+    ASSERT_TRUE(data != larger.data());
+
+    std::vector<BYTE> reused;
+    ASSERT_SUCCEEDED(pool.Rent(4096, reused));
+    ASSERT_TRUE(data == reused.data());
+}
+
+TEST(PayloadBufferPool_GrowsReturnedBuffersWithinTheirCapacity)
+{
+    PayloadBufferPool pool;
+
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(pool.Rent(2500, buffer));
+    const BYTE* data = buffer.data();
+    pool.Return(buffer);
+
+    std::vector<BYTE> reused;
+    ASSERT_SUCCEEDED(pool.Rent(4096, reused));
+    ASSERT_EQ(static_cast<size_t>(4096), reused.size());
+    ASSERT_TRUE(data == reused.data());
+}
@@ -0,0 +1,117 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "EventProvider/ProfilerEventProvider.h"
+#include <string.h>
+
+namespace
+{
+    UINT16 ReadCount(const std::vector<BYTE>& data)
+    {
+        UINT16 count = 0;
+        memcpy(&count, data.data(), sizeof(count));
+        return count;
+    }
+}
+
+TEST(ProfilerEvent_DescribesPayload)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<ProfilerEventProvider> provider;
+    ASSERT_SUCCEEDED(ProfilerEventProvider::CreateProvider(_T("TestProvider"), profilerInfo, provider));
+
+    const WCHAR* names[4] = { _T("Id"), _T("Name"), _T("Values"), _T("Flag") };
+    std::unique_ptr<ProfilerEvent<UINT64, tstring, std::vector<UINT32>, bool>> event;
+    ASSERT_SUCCEEDED(provider->DefineEvent(_T("Test"), event, names));
+
+    std::vector<FakeCorProfilerInfo::DefinedEvent> definedEvents = profilerInfo->GetDefinedEvents();
+    ASSERT_EQ(static_cast<size_t>(1), definedEvents.size());
+    const std::vector<COR_PRF_EVENTPIPE_PARAM_DESC>& parameters = definedEvents[0].Parameters;
+    ASSERT_EQ(static_cast<size_t>(4), parameters.size());
+    ASSERT_EQ(static_cast<UINT32>(COR_PRF_EVENTPIPE_UINT64), parameters[0].type);
+    ASSERT_EQ(static_cast<UINT32>(COR_PRF_EVENTPIPE_STRING), parameters[1].type);
+    ASSERT_EQ(static_cast<UINT32>(COR_PRF_EVENTPIPE_ARRAY), parameters[2].type);
+    ASSERT_EQ(static_cast<UINT32>(COR_PRF_EVENTPIPE_UINT32), parameters[2].elementType);
+    ASSERT_EQ(static_cast<UINT32>(COR_PRF_EVENTPIPE_BOOLEAN), parameters[3].type);
+    ASSERT_TRUE(tstring(parameters[2].name) == _T("Values"));
+}
+
+TEST(ProfilerEvent_EncodesPayload)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<ProfilerEventProvider> provider;
+    ASSERT_SUCCEEDED(ProfilerEventProvider::CreateProvider(_T("TestProvider"), profilerInfo, provider));
+
+    const WCHAR* names[6] = { _T("Id"), _T("Name"), _T("Values"), _T("Empty"), _T("Flag"), _T("Guid") };
+    std::unique_ptr<ProfilerEvent<UINT64, tstring, std::vector<UINT64>, std::vector<UINT64>, bool, GUID>> event;
+    ASSERT_SUCCEEDED(provider->DefineEvent(_T("Test"), event, names));
+
+    const GUID guid = { 0x01020304, 0x0506, 0x0708, { 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10 } };
+    std::vector<UINT64> values = { 1, 2, 3 };
+    ASSERT_SUCCEEDED(event->WritePayload(42, _T("Name"), values, std::vector<UINT64>(), true, guid));
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(1), writtenEvents.size());
+    const std::vector<std::vector<BYTE>>& payload = writtenEvents[0].Payload;
+    ASSERT_EQ(static_cast<size_t>(6), payload.size());
+
+    ASSERT_EQ(sizeof(UINT64), payload[0].size());
+    ASSERT_EQ(static_cast<size_t>(5 * sizeof(WCHAR)), payload[1].size());
+
+    // Arrays are prefixed with a UINT16 element count.
+    ASSERT_EQ(sizeof(UINT16) + 3 * sizeof(UINT64), payload[2].size());
+    ASSERT_EQ(static_cast<UINT16>(3), ReadCount(payload[2]));
+    ASSERT_EQ(0, memcmp(payload[2].data() + sizeof(UINT16), values.data(), 3 * sizeof(UINT64)));
+    ASSERT_EQ(static_cast<size_t>(0), payload[3].size());
+
+    // Booleans are 4 bytes and GUIDs are written without padding.
+    UINT32 flag = 0;
+    ASSERT_EQ(sizeof(UINT32), payload[4].size());
+    memcpy(&flag, payload[4].data(), sizeof(flag));
+    ASSERT_EQ(static_cast<UINT32>(1), flag);
+    BYTE expectedGuid[GuidUtilities::FlatSize];
+    GuidUtilities::Write(guid, expectedGuid);
+    ASSERT_EQ(GuidUtilities::FlatSize, payload[5].size());
+    ASSERT_EQ(0, memcmp(expectedGuid, payload[5].data(), GuidUtilities::FlatSize));
+}
+
+TEST(ProfilerEvent_RejectsArraysOverCountLimit)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<ProfilerEventProvider> provider;
+    ASSERT_SUCCEEDED(ProfilerEventProvider::CreateProvider(_T("TestProvider"), profilerInfo, provider));
+
+    const WCHAR* names[1] = { _T("Values") };
+    std::unique_ptr<ProfilerEvent<std::vector<BYTE>>> event;
+    ASSERT_SUCCEEDED(provider->DefineEvent(_T("Test"), event, names));
+
+    ASSERT_SUCCEEDED(event->WritePayload(std::vector<BYTE>(MaxEventArrayLength)));
+    ASSERT_EQ(COR_E_OVERFLOW, event->WritePayload(std::vector<BYTE>(MaxEventArrayLength + 1)));
+    ASSERT_EQ(static_cast<size_t>(1), profilerInfo->GetWrittenEvents().size());
+}
+
+TEST(ProfilerEvent_SkipsDisabledEvents)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<ProfilerEventProvider> provider;
+    ASSERT_SUCCEEDED(ProfilerEventProvider::CreateProvider(_T("TestProvider"), profilerInfo, provider));
+
+    const WCHAR* names[1] = { _T("Value") };
+    std::unique_ptr<ProfilerEvent<UINT32>> alwaysEvent;
+    std::unique_ptr<ProfilerEvent<UINT32>> verboseEvent;
+    ASSERT_SUCCEEDED(provider->DefineEvent(_T("Always"), alwaysEvent, names));
+    ASSERT_SUCCEEDED(provider->DefineEvent(_T("Verbose"), 0x2, COR_PRF_EVENTPIPE_VERBOSE, verboseEvent, names));
+
+    provider->GetEnablement().Enable(0x1, COR_PRF_EVENTPIPE_INFORMATIONAL);
+    ASSERT_TRUE(alwaysEvent->IsEnabled());
+    ASSERT_TRUE(!verboseEvent->IsEnabled());
+    ASSERT_SUCCEEDED(alwaysEvent->WritePayload(1));
+    ASSERT_SUCCEEDED(verboseEvent->WritePayload(2));
+    ASSERT_EQ(static_cast<size_t>(1), profilerInfo->GetWrittenEvents().size());
+
+    provider->GetEnablement().Disable();
+    ASSERT_SUCCEEDED(alwaysEvent->WritePayload(3));
+    ASSERT_EQ(static_cast<size_t>(1), profilerInfo->GetWrittenEvents().size());
+}
@@ -0,0 +1,129 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Communication/SharedRingBuffer.h"
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    std::vector<BYTE> CreateRecord(size_t size, BYTE seed)
+    {
+        std::vector<BYTE> record(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            record[i] = static_cast<BYTE>(seed + i);
+        }
+        return record;
+    }
+}
+
+TEST(SharedRingBuffer_ReadsRecordsThroughSecondMapping)
+{
+    std::unique_ptr<SharedRingBuffer> writer;
+    ASSERT_SUCCEEDED(SharedRingBuffer::Create("test", SharedRingBuffer::MinCapacity, writer));
+
+    // The reader maps the same memory through its own descriptor, as dotnet-monitor would.
+    std::unique_ptr<SharedRingBuffer> reader;
+    ASSERT_SUCCEEDED(SharedRingBuffer::Open(dup(writer->GetHandle()), reader));
+    ASSERT_EQ(writer->GetCapacity(), reader->GetCapacity());
+
+    UINT32 type = 0;
+    std::vector<BYTE> data;
+    ASSERT_EQ(S_FALSE, reader->TryRead(type, data));
+
+    std::vector<BYTE> first = CreateRecord(13, 1);
+    ASSERT_SUCCEEDED(writer->TryWrite(7, first.data(), static_cast<UINT32>(first.size())));
+    ASSERT_SUCCEEDED(writer->TryWrite(8, nullptr, 0));
+
+    ASSERT_EQ(S_OK, reader->TryRead(type, data));
+    ASSERT_EQ(static_cast<UINT32>(7), type);
+    ASSERT_TRUE(data == first);
+    ASSERT_EQ(S_OK, reader->TryRead(type, data));
+    ASSERT_EQ(static_cast<UINT32>(8), type);
+    ASSERT_EQ(static_cast<size_t>(0), data.size());
+    ASSERT_EQ(S_FALSE, reader->TryRead(type, data));
+}
+
+TEST(SharedRingBuffer_WrapsAndDropsWhenFull)
+{
+    std::unique_ptr<SharedRingBuffer> ring;
+    ASSERT_SUCCEEDED(SharedRingBuffer::Create("test", SharedRingBuffer::MinCapacity, ring));
+
+    // Records of 1000 bytes do not divide the capacity evenly, so writes eventually pad to the end and wrap.
+    const size_t RecordSize = 1000;
+    UINT32 type = 0;
+    std::vector<BYTE> data;
+    for (BYTE i = 0; i < 20; i++)
+    {
+        std::vector<BYTE> record = CreateRecord(RecordSize, i);
+        ASSERT_EQ(S_OK, ring->TryWrite(i, record.data(), static_cast<UINT32>(record.size())));
+        ASSERT_EQ(S_OK, ring->TryRead(type, data));
+        ASSERT_EQ(static_cast<UINT32>(i), type);
+        ASSERT_TRUE(data == record);
+    }
+
+    // At most 4 records fit without reading; the rest are dropped rather than waiting for the reader.
+    std::vector<BYTE> record = CreateRecord(RecordSize, 0);
+    int written = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        HRESULT hr = ring->TryWrite(1, record.data(), static_cast<UINT32>(record.size()));
+        ASSERT_SUCCEEDED(hr);
+        written += (hr == S_OK) ? 1 : 0;
+    }
+    ASSERT_TRUE(written < 6);
+    ASSERT_EQ(static_cast<UINT64>(6 - written), ring->GetDroppedRecords());
+
+    for (int i = 0; i < written; i++)
+    {
+        ASSERT_EQ(S_OK, ring->TryRead(type, data));
+    }
+    ASSERT_EQ(S_FALSE, ring->TryRead(type, data));
+
+    ASSERT_EQ(E_INVALIDARG, ring->TryWrite(1, record.data(), static_cast<UINT32>(SharedRingBuffer::MinCapacity)));
+}
+
+TEST(SharedRingBuffer_TransfersBetweenThreads)
+{
+    std::unique_ptr<SharedRingBuffer> ring;
+    ASSERT_SUCCEEDED(SharedRingBuffer::Create("test", SharedRingBuffer::MinCapacity, ring));
+
+    const UINT32 RecordCount = 100000;
+    std::thread writer([&ring]()
+    {
+        for (UINT32 i = 0; i < RecordCount; i++)
+        {
+            // Vary the size so that records wrap at different positions.
+            BYTE record[64];
+            memset(record, static_cast<BYTE>(i), sizeof(record));
+            ring->TryWrite(i, record, (i % sizeof(record)) + 1);
+        }
+    });
+
+    // Records arrive in order and intact; some may be dropped.
+    UINT32 received = 0;
+    INT64 lastType = -1;
+    bool ordered = true;
+    bool intact = true;
+    while (received + ring->GetDroppedRecords() < RecordCount)
+    {
+        UINT32 type = 0;
+        std::vector<BYTE> data;
+        if (ring->TryRead(type, data) != S_OK)
+        {
+            continue;
+        }
+
+        ordered &= static_cast<INT64>(type) > lastType;
+        intact &= data.size() == (type % 64) + 1 && data.back() == static_cast<BYTE>(type);
+        lastType = type;
+        received++;
+    }
+    writer.join();
+
+    ASSERT_TRUE(ordered);
+    ASSERT_TRUE(intact);
+    ASSERT_EQ(static_cast<UINT64>(RecordCount), received + ring->GetDroppedRecords());
+}
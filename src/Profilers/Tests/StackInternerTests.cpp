@@ -0,0 +1,127 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Stacks/StackInterner.h"
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace
+{
+    Stack CreateStack(UINT64 leaf, size_t depth)
+    {
+        Stack stack;
+        for (size_t i = 0; i < depth; i++)
+        {
+            stack.AddFrame(static_cast<FunctionID>(leaf + i), static_cast<UINT_PTR>(i * 4));
+        }
+        return stack;
+    }
+
+    HRESULT Describe(UINT32 stackId)
+    {
+        return S_OK;
+    }
+}
+
+TEST(StackInterner_ReturnsSameIdForSameFrames)
+{
+    StackInterner interner;
+
+    UINT32 firstId = 0;
+    ASSERT_EQ(S_OK, interner.Intern(CreateStack(0x1000, 3), 1, Describe, firstId));
+    ASSERT_TRUE(firstId != 0);
+
+    UINT32 secondId = 0;
+    ASSERT_EQ(S_FALSE, interner.Intern(CreateStack(0x1000, 3), 1, Describe, secondId));
+    ASSERT_EQ(firstId, secondId);
+
+    // A different offset in the same functions is a different throw site.
+    Stack otherOffset = CreateStack(0x1000, 2);
+    otherOffset.AddFrame(0x1002, 0x100);
+    UINT32 otherId = 0;
+    ASSERT_EQ(S_OK, interner.Intern(otherOffset, 1, Describe, otherId));
+    ASSERT_TRUE(otherId != firstId);
+}
+
+TEST(StackInterner_DescribesStacksAgainForNewSessions)
+{
+    StackInterner interner;
+
+    UINT32 firstId = 0;
+    ASSERT_EQ(S_OK, interner.Intern(CreateStack(0x1000, 3), 1, Describe, firstId));
+
+    UINT32 secondId = 0;
+    ASSERT_EQ(S_OK, interner.Intern(CreateStack(0x1000, 3), 2, Describe, secondId));
+    ASSERT_EQ(firstId, secondId);
+    ASSERT_EQ(S_FALSE, interner.Intern(CreateStack(0x1000, 3), 2, Describe, secondId));
+}
+
+TEST(StackInterner_ForgetsStacksThatFailedToBeDescribed)
+{
+    StackInterner interner;
+
+    UINT32 stackId = 0;
+    ASSERT_EQ(E_FAIL, interner.Intern(CreateStack(0x1000, 3), 1, [](UINT32) -> HRESULT { return E_FAIL; }, stackId));
+
+    int describedCount = 0;
+    ASSERT_EQ(S_OK, interner.Intern(CreateStack(0x1000, 3), 1, [&](UINT32) -> HRESULT { describedCount++; return S_OK; }, stackId));
+    ASSERT_EQ(1, describedCount);
+}
+
+TEST(StackInterner_AssignsUniqueIdsAcrossThreads)
+{
+    const int ThreadCount = 4;
+    const UINT64 StackCount = 2000;
+    StackInterner interner;
+
+    // Every thread interns the same stacks, so each stack is added by exactly one of them,
+    // and no thread sees an id before it has been described.
+    std::mutex describedMutex;
+    std::set<UINT32> described;
+    auto describe = [&](UINT32 stackId) -> HRESULT
+    {
+        std::lock_guard<std::mutex> lock(describedMutex);
+        described.insert(stackId);
+        return S_OK;
+    };
+
+    std::vector<std::vector<UINT32>> ids(ThreadCount, std::vector<UINT32>(StackCount));
+    std::vector<int> added(ThreadCount, 0);
+    std::vector<int> undescribed(ThreadCount, 0);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < ThreadCount; thread++)
+    {
+        threads.emplace_back([&, thread]()
+        {
+            for (UINT64 i = 0; i < StackCount; i++)
+            {
+                if (interner.Intern(CreateStack(0x1000 + i * 8, 4), 1, describe, ids[thread][i]) == S_OK)
+                {
+                    added[thread]++;
+                }
+
+                std::lock_guard<std::mutex> lock(describedMutex);
+                if (described.count(ids[thread][i]) == 0)
+                {
+                    undescribed[thread]++;
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    int totalAdded = 0;
+    for (int thread = 0; thread < ThreadCount; thread++)
+    {
+        totalAdded += added[thread];
+        ASSERT_EQ(0, undescribed[thread]);
+        ASSERT_TRUE(ids[thread] == ids[0]);
+    }
+    ASSERT_EQ(static_cast<int>(StackCount), totalAdded);
+}
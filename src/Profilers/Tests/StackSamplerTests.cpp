@@ -0,0 +1,147 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Fakes/SyntheticRuntime.h"
+#include "Logging/NullLogger.h"
+#include "Stacks/StackSampler.h"
+
+namespace
+{
+    HRESULT Sample(FakeCorProfilerInfo* profilerInfo, UINT32 workers, std::vector<std::unique_ptr<StackSamplerState>>& stackStates, std::shared_ptr<NameCache>& nameCache)
+    {
+        std::shared_ptr<ThreadNameCache> threadNames = std::make_shared<ThreadNameCache>();
+        StackSampler sampler(profilerInfo, std::make_shared<ParallelNameResolver>(NullLogger::Instance, profilerInfo, workers));
+        return sampler.CreateCallstack(stackStates, nameCache, threadNames);
+    }
+}
+
+TEST(StackSampler_CapturesDeepStacks)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 500, 2, 5000);
+
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    std::shared_ptr<NameCache> nameCache;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 1, stackStates, nameCache));
+
+    ASSERT_EQ(static_cast<size_t>(2), stackStates.size());
+    const Stack& stack = stackStates[1]->GetStack();
+    ASSERT_EQ(static_cast<UINT32>(1001), stack.GetThreadId());
+    ASSERT_EQ(static_cast<size_t>(5000), stack.GetFunctionIds().size());
+    ASSERT_EQ(static_cast<size_t>(5000), stack.GetOffsets().size());
+    ASSERT_EQ(static_cast<UINT64>(runtime.GetFunctions()[7 % 500]), stack.GetFunctionIds()[0]);
+    ASSERT_EQ(static_cast<UINT64>(0x100 + 4999), stack.GetOffsets()[4999]);
+
+    for (UINT64 functionId : stack.GetFunctionIds())
+    {
+        tstring name;
+        ASSERT_SUCCEEDED(nameCache->GetFullyQualifiedName(static_cast<FunctionID>(functionId), name));
+    }
+}
+
+TEST(StackSampler_ResolvesNamesAfterResumingRuntime)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 200, 4, 100);
+
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    std::shared_ptr<NameCache> nameCache;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 4, stackStates, nameCache));
+
+    ASSERT_EQ(static_cast<UINT32>(1), profilerInfo->GetSuspendCount());
+    ASSERT_TRUE(!profilerInfo->IsRuntimeSuspended());
+    ASSERT_EQ(static_cast<UINT32>(0), profilerInfo->GetMetaDataRequestsWhileSuspended());
+    ASSERT_TRUE(nameCache->GetFunctions().size() > 0);
+}
+
+TEST(StackSampler_SkipsThreadsWithoutManagedFrames)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 10, 1, 10);
+    profilerInfo->AddThread(2000, std::vector<FakeCorProfilerInfo::Frame>());
+
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    std::shared_ptr<NameCache> nameCache;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 1, stackStates, nameCache));
+
+    ASSERT_EQ(static_cast<size_t>(1), stackStates.size());
+    ASSERT_EQ(static_cast<UINT32>(1000), stackStates[0]->GetStack().GetThreadId());
+}
+
+TEST(StackSampler_ParallelResolutionMatchesSerial)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 1000, 8, 400);
+
+    std::vector<std::unique_ptr<StackSamplerState>> serialStates;
+    std::shared_ptr<NameCache> serialCache;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 1, serialStates, serialCache));
+
+    std::vector<std::unique_ptr<StackSamplerState>> parallelStates;
+    std::shared_ptr<NameCache> parallelCache;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 4, parallelStates, parallelCache));
+
+    ASSERT_EQ(serialCache->GetFunctions().size(), parallelCache->GetFunctions().size());
+    ASSERT_EQ(serialCache->GetClasses().size(), parallelCache->GetClasses().size());
+    ASSERT_EQ(serialCache->GetTypeNames().size(), parallelCache->GetTypeNames().size());
+
+    for (auto& entry : serialCache->GetFunctions())
+    {
+        tstring serialName;
+        tstring parallelName;
+        ASSERT_SUCCEEDED(serialCache->GetFullyQualifiedName(entry.first, serialName));
+        ASSERT_SUCCEEDED(parallelCache->GetFullyQualifiedName(entry.first, parallelName));
+        ASSERT_TRUE(serialName == parallelName);
+    }
+}
+
+TEST(StackSampler_ReusesNameResolutionWorkersAcrossSnapshots)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 1000, 8, 400);
+
+    std::shared_ptr<ThreadNameCache> threadNames = std::make_shared<ThreadNameCache>();
+    StackSampler sampler(profilerInfo, std::make_shared<ParallelNameResolver>(NullLogger::Instance, profilerInfo, 4));
+
+    for (int i = 0; i < 3; i++)
+    {
+        std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+        std::shared_ptr<NameCache> nameCache;
+        ASSERT_SUCCEEDED(sampler.CreateCallstack(stackStates, nameCache, threadNames));
+        ASSERT_EQ(static_cast<size_t>(1000), nameCache->GetFunctions().size());
+    }
+
+    // Each worker is initialized with the runtime once, not once per snapshot.
+    ASSERT_EQ(static_cast<UINT32>(4), profilerInfo->GetInitializedThreadCount());
+}
+
+TEST(StackSampler_CopiesOnlyReferencedNamesFromLongLivedCache)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 200, 1, 10);
+
+    // A long lived cache that already holds every function, as after prewarming.
+    std::shared_ptr<NameCache> prewarmedCache = std::make_shared<NameCache>();
+    TypeNameUtilities nameUtilities(profilerInfo);
+    for (FunctionID function : runtime.GetFunctions())
+    {
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(*prewarmedCache, function, 0));
+    }
+
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    ASSERT_SUCCEEDED(Sample(profilerInfo, 1, stackStates, prewarmedCache));
+
+    NameCache snapshotCache;
+    ASSERT_SUCCEEDED(StackSampler::CopyReferencedNames(stackStates, *prewarmedCache, snapshotCache));
+
+    const Stack& stack = stackStates[0]->GetStack();
+    ASSERT_TRUE(snapshotCache.GetFunctions().size() <= stack.GetFunctionIds().size());
+    ASSERT_TRUE(snapshotCache.GetFunctions().size() < prewarmedCache->GetFunctions().size());
+    for (UINT64 functionId : stack.GetFunctionIds())
+    {
+        tstring name;
+        ASSERT_SUCCEEDED(snapshotCache.GetFullyQualifiedName(static_cast<FunctionID>(functionId), name));
+    }
+}
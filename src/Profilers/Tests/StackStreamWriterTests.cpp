@@ -0,0 +1,104 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Fakes/SyntheticRuntime.h"
+#include "Logging/NullLogger.h"
+#include "Stacks/StackStreamWriter.h"
+#include "CommonUtilities/SymbolTableWriter.h"
+#include <string.h>
+
+TEST(StackStreamWriter_WritesSymbolsAndStacks)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 100, 3, 50);
+
+    std::shared_ptr<ThreadNameCache> threadNames = std::make_shared<ThreadNameCache>();
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    std::shared_ptr<NameCache> nameCache;
+    StackSampler sampler(profilerInfo, std::make_shared<ParallelNameResolver>(NullLogger::Instance, profilerInfo, 1));
+    ASSERT_SUCCEEDED(sampler.CreateCallstack(stackStates, nameCache, threadNames));
+    stackStates[0]->GetStack().SetName(_T("Worker"));
+
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(StackStreamWriter::Serialize(*nameCache, stackStates, buffer));
+    ASSERT_TRUE(buffer.size() >= sizeof(StackStream::Header));
+
+    StackStream::Header header;
+    memcpy(&header, buffer.data(), sizeof(header));
+    ASSERT_EQ(StackStream::Magic, header.Magic);
+    ASSERT_EQ(StackStream::CurrentVersion, header.Version);
+    ASSERT_EQ(static_cast<UINT32>(stackStates.size()), header.StackCount);
+    ASSERT_EQ(static_cast<UINT64>(0), header.StacksOffset % 8);
+    ASSERT_EQ(static_cast<UINT64>(buffer.size()), header.StacksOffset + header.StacksSize);
+
+    // The symbol table is embedded unchanged.
+    SymbolTable::Header symbolHeader;
+    memcpy(&symbolHeader, &buffer[static_cast<size_t>(header.SymbolTableOffset)], sizeof(symbolHeader));
+    ASSERT_EQ(SymbolTable::Magic, symbolHeader.Magic);
+    ASSERT_EQ(static_cast<UINT64>(nameCache->GetFunctions().size()), symbolHeader.FunctionCount);
+    ASSERT_EQ(header.SymbolTableSize, symbolHeader.StringPoolOffset + symbolHeader.StringPoolSize);
+
+    size_t offset = static_cast<size_t>(header.StacksOffset);
+    for (std::unique_ptr<StackSamplerState>& stackState : stackStates)
+    {
+        const Stack& stack = stackState->GetStack();
+
+        StackStream::StackRecord record;
+        memcpy(&record, &buffer[offset], sizeof(record));
+        offset += sizeof(record);
+        ASSERT_EQ(stack.GetThreadId(), record.ThreadId);
+        ASSERT_EQ(static_cast<UINT32>(stack.GetFunctionIds().size()), record.FrameCount);
+
+        std::vector<UINT64> functionIds(record.FrameCount);
+        memcpy(functionIds.data(), &buffer[offset], record.FrameCount * sizeof(UINT64));
+        offset += record.FrameCount * sizeof(UINT64);
+        ASSERT_TRUE(functionIds == stack.GetFunctionIds());
+
+        std::vector<UINT64> offsets(record.FrameCount);
+        memcpy(offsets.data(), &buffer[offset], record.FrameCount * sizeof(UINT64));
+        offset += record.FrameCount * sizeof(UINT64);
+        ASSERT_TRUE(offsets == stack.GetOffsets());
+
+        tstring name(reinterpret_cast<const WCHAR*>(&buffer[offset]), record.NameLength);
+        offset += (record.NameLength * sizeof(WCHAR) + 7) & ~static_cast<size_t>(7);
+        ASSERT_TRUE(name == stack.GetName());
+    }
+
+    ASSERT_EQ(buffer.size(), offset);
+}
+
+TEST(StackStreamWriter_EmbedsOnlyReferencedSymbolsFromLongLivedCache)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 300, 1, 10);
+
+    // A long lived cache that already holds every function, as after prewarming.
+    std::shared_ptr<NameCache> prewarmedCache = std::make_shared<NameCache>();
+    TypeNameUtilities nameUtilities(profilerInfo);
+    for (FunctionID function : runtime.GetFunctions())
+    {
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(*prewarmedCache, function, 0));
+    }
+
+    std::shared_ptr<ThreadNameCache> threadNames = std::make_shared<ThreadNameCache>();
+    std::vector<std::unique_ptr<StackSamplerState>> stackStates;
+    StackSampler sampler(profilerInfo, std::make_shared<ParallelNameResolver>(NullLogger::Instance, profilerInfo, 1));
+    ASSERT_SUCCEEDED(sampler.CreateCallstack(stackStates, prewarmedCache, threadNames));
+
+    NameCache snapshotCache;
+    ASSERT_SUCCEEDED(StackSampler::CopyReferencedNames(stackStates, *prewarmedCache, snapshotCache));
+
+    std::vector<BYTE> fullBuffer;
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(StackStreamWriter::Serialize(*prewarmedCache, stackStates, fullBuffer));
+    ASSERT_SUCCEEDED(StackStreamWriter::Serialize(snapshotCache, stackStates, buffer));
+    ASSERT_TRUE(buffer.size() < fullBuffer.size());
+
+    StackStream::Header header;
+    memcpy(&header, buffer.data(), sizeof(header));
+    SymbolTable::Header symbolHeader;
+    memcpy(&symbolHeader, &buffer[static_cast<size_t>(header.SymbolTableOffset)], sizeof(symbolHeader));
+    ASSERT_TRUE(symbolHeader.FunctionCount <= static_cast<UINT64>(stackStates[0]->GetStack().GetFunctionIds().size()));
+}
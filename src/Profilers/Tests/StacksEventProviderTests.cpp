@@ -0,0 +1,80 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Stacks/StacksEventProvider.h"
+#include <string.h>
+
+namespace
+{
+    tstring GetEventName(FakeCorProfilerInfo* profilerInfo, EVENTPIPE_EVENT event)
+    {
+        // The fake hands out event handles in definition order, starting at 1.
+        return profilerInfo->GetDefinedEvents()[static_cast<size_t>(event) - 1].Name;
+    }
+
+    void AppendArray(const std::vector<BYTE>& data, std::vector<UINT64>& values)
+    {
+        UINT16 count = 0;
+        memcpy(&count, data.data(), sizeof(count));
+        size_t start = values.size();
+        values.resize(start + count);
+        memcpy(&values[start], data.data() + sizeof(count), count * sizeof(UINT64));
+    }
+}
+
+TEST(StacksEventProvider_SplitsDeepStacks)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<StacksEventProvider> provider;
+    ASSERT_SUCCEEDED(StacksEventProvider::CreateProvider(profilerInfo, provider));
+
+    Stack stack;
+    stack.SetThreadId(7);
+    for (UINT64 i = 0; i < 5000; i++)
+    {
+        stack.AddFrame(static_cast<FunctionID>(0x1000 + i), static_cast<UINT_PTR>(i));
+    }
+
+    ASSERT_SUCCEEDED(provider->WriteCallstack(stack));
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(3), writtenEvents.size());
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[0].Event) == _T("Callstack"));
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[1].Event) == _T("CallstackContinuation"));
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[2].Event) == _T("CallstackContinuation"));
+
+    std::vector<UINT64> functionIds;
+    std::vector<UINT64> offsets;
+    AppendArray(writtenEvents[0].Payload[2], functionIds);
+    AppendArray(writtenEvents[0].Payload[3], offsets);
+    for (size_t i = 1; i < writtenEvents.size(); i++)
+    {
+        UINT32 threadId = 0;
+        memcpy(&threadId, writtenEvents[i].Payload[0].data(), sizeof(threadId));
+        ASSERT_EQ(static_cast<UINT32>(7), threadId);
+        AppendArray(writtenEvents[i].Payload[1], functionIds);
+        AppendArray(writtenEvents[i].Payload[2], offsets);
+    }
+
+    ASSERT_TRUE(functionIds == stack.GetFunctionIds());
+    ASSERT_TRUE(offsets == stack.GetOffsets());
+}
+
+TEST(StacksEventProvider_WritesShallowStacksInOneEvent)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    std::unique_ptr<StacksEventProvider> provider;
+    ASSERT_SUCCEEDED(StacksEventProvider::CreateProvider(profilerInfo, provider));
+
+    Stack stack;
+    stack.SetThreadId(7);
+    stack.AddFrame(0x1000, 0x10);
+
+    ASSERT_SUCCEEDED(provider->WriteCallstack(stack));
+
+    std::vector<FakeCorProfilerInfo::WrittenEvent> writtenEvents = profilerInfo->GetWrittenEvents();
+    ASSERT_EQ(static_cast<size_t>(1), writtenEvents.size());
+    ASSERT_TRUE(GetEventName(profilerInfo, writtenEvents[0].Event) == _T("Callstack"));
+}
@@ -0,0 +1,58 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "Fakes/SyntheticRuntime.h"
+#include "CommonUtilities/SymbolTableWriter.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+#include <string.h>
+
+TEST(SymbolTableWriter_WritesSortedTables)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    SyntheticRuntime runtime(*profilerInfo, 60, 0, 0);
+
+    NameCache nameCache;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    for (FunctionID function : runtime.GetFunctions())
+    {
+        ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, function, 0));
+    }
+
+    std::vector<BYTE> buffer;
+    ASSERT_SUCCEEDED(SymbolTableWriter::Serialize(nameCache, buffer));
+    ASSERT_TRUE(buffer.size() >= sizeof(SymbolTable::Header));
+
+    SymbolTable::Header header;
+    memcpy(&header, buffer.data(), sizeof(header));
+    ASSERT_EQ(SymbolTable::Magic, header.Magic);
+    ASSERT_EQ(SymbolTable::CurrentVersion, header.Version);
+    ASSERT_EQ(static_cast<UINT64>(nameCache.GetModules().size()), header.ModuleCount);
+    ASSERT_EQ(static_cast<UINT64>(nameCache.GetTypeNames().size()), header.TokenCount);
+    ASSERT_EQ(static_cast<UINT64>(nameCache.GetClasses().size()), header.ClassCount);
+    ASSERT_EQ(static_cast<UINT64>(nameCache.GetFunctions().size()), header.FunctionCount);
+    ASSERT_EQ(static_cast<UINT64>(buffer.size()), header.StringPoolOffset + header.StringPoolSize);
+    ASSERT_EQ(static_cast<UINT64>(0), header.FunctionTableOffset % 8);
+
+    std::vector<SymbolTable::FunctionRecord> functions(static_cast<size_t>(header.FunctionCount));
+    memcpy(functions.data(), &buffer[static_cast<size_t>(header.FunctionTableOffset)], functions.size() * sizeof(SymbolTable::FunctionRecord));
+    for (size_t i = 1; i < functions.size(); i++)
+    {
+        ASSERT_TRUE(functions[i - 1].FunctionId < functions[i].FunctionId);
+    }
+    for (const SymbolTable::FunctionRecord& function : functions)
+    {
+        std::shared_ptr<FunctionData> functionData;
+        ASSERT_TRUE(nameCache.TryGetFunctionData(static_cast<FunctionID>(function.FunctionId), functionData));
+        ASSERT_EQ(static_cast<UINT32>(functionData->GetParameterTypes().size()), function.ParameterTypesCount);
+        ASSERT_TRUE(static_cast<UINT64>(function.ParameterTypesIndex) + function.ParameterTypesCount <= header.TypeArgsCount);
+    }
+
+    // Names are read back from the string pool.
+    std::shared_ptr<FunctionData> functionData;
+    ASSERT_TRUE(nameCache.TryGetFunctionData(static_cast<FunctionID>(functions[0].FunctionId), functionData));
+    const SymbolTable::StringRef& name = functions[0].Name;
+    tstring pooledName(reinterpret_cast<const WCHAR*>(&buffer[static_cast<size_t>(header.StringPoolOffset) + name.Offset]), name.Length);
+    ASSERT_TRUE(pooledName == functionData->GetName());
+}
@@ -0,0 +1,70 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+/// <summary>
+/// Minimal self registering test runner. The profilers are built without a test framework dependency,
+/// so tests only need a function per case and assertions that report the failing expression.
+/// Assertions return from the test on failure, so they may only be used directly in the test body.
+/// </summary>
+class TestRegistry
+{
+public:
+    typedef void (*TestFunction)();
+
+    struct TestCase
+    {
+        const char* Name;
+        TestFunction Function;
+    };
+
+    static std::vector<TestCase>& GetTests()
+    {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    static bool& CurrentTestFailed()
+    {
+        static bool failed = false;
+        return failed;
+    }
+
+    static void ReportFailure(const char* file, int line, const char* expression)
+    {
+        fprintf(stderr, "    %s(%d): assertion failed: %s\n", file, line, expression);
+        CurrentTestFailed() = true;
+    }
+};
+
+class TestRegistration
+{
+public:
+    TestRegistration(const char* name, TestRegistry::TestFunction function)
+    {
+        TestRegistry::TestCase testCase = { name, function };
+        TestRegistry::GetTests().push_back(testCase);
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistration name##_Registration(#name, name); \
+    static void name()
+
+#define ASSERT_TRUE(expression) \
+    do \
+    { \
+        if (!(expression)) \
+        { \
+            TestRegistry::ReportFailure(__FILE__, __LINE__, #expression); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_EQ(expected, actual) ASSERT_TRUE((expected) == (actual))
+#define ASSERT_SUCCEEDED(hr) ASSERT_TRUE(SUCCEEDED(hr))
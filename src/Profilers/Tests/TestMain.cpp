@@ -0,0 +1,41 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "cor.h"
+#include "guids.h"
+#include <string.h>
+
+// Usage: MonitorProfilerTests [filter]
+// Runs every test whose name contains filter, or all tests if no filter is given.
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+
+    for (const TestRegistry::TestCase& testCase : TestRegistry::GetTests())
+    {
+        if (filter != nullptr && strstr(testCase.Name, filter) == nullptr)
+        {
+            continue;
+        }
+
+        TestRegistry::CurrentTestFailed() = false;
+        testCase.Function();
+        run++;
+
+        if (TestRegistry::CurrentTestFailed())
+        {
+            failed++;
+            printf("[FAIL] %s\n", testCase.Name);
+        }
+        else
+        {
+            printf("[PASS] %s\n", testCase.Name);
+        }
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
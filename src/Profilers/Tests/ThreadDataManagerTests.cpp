@@ -0,0 +1,68 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "MainProfiler/ThreadDataManager.h"
+#include "Logging/NullLogger.h"
+#include <thread>
+
+namespace
+{
+    const ThreadID FirstThread = 0x100;
+    const ThreadID SecondThread = 0x200;
+
+    bool HasException(ThreadDataManager& manager, ThreadID threadId)
+    {
+        bool hasException = false;
+        FunctionID catcherFunctionId = ThreadData::NoFunctionId;
+        manager.GetException(threadId, &hasException, &catcherFunctionId);
+        return hasException;
+    }
+}
+
+TEST(ThreadDataManager_ResetsWhenThreadIdChanges)
+{
+    ThreadDataManager manager(NullLogger::Instance);
+
+    ASSERT_SUCCEEDED(manager.SetHasException(FirstThread));
+    ASSERT_TRUE(HasException(manager, FirstThread));
+
+    // The OS thread now runs another managed thread, which has not thrown anything.
+    ASSERT_TRUE(!HasException(manager, SecondThread));
+    ASSERT_TRUE(!HasException(manager, FirstThread));
+}
+
+TEST(ThreadDataManager_ResetsWhenManagerChanges)
+{
+    {
+        ThreadDataManager manager(NullLogger::Instance);
+        ASSERT_SUCCEEDED(manager.SetHasException(FirstThread));
+        ASSERT_TRUE(HasException(manager, FirstThread));
+
+        ThreadDataManager otherManager(NullLogger::Instance);
+        ASSERT_TRUE(!HasException(otherManager, FirstThread));
+        ASSERT_SUCCEEDED(otherManager.SetHasException(FirstThread));
+    }
+
+    // A new manager may reuse the address of one that is gone, but not its data.
+    for (int i = 0; i < 4; i++)
+    {
+        ThreadDataManager manager(NullLogger::Instance);
+        ASSERT_TRUE(!HasException(manager, FirstThread));
+        ASSERT_SUCCEEDED(manager.SetHasException(FirstThread));
+    }
+}
+
+TEST(ThreadDataManager_IgnoresThreadDestroyedFromOtherThreads)
+{
+    ThreadDataManager manager(NullLogger::Instance);
+    ASSERT_SUCCEEDED(manager.SetHasException(FirstThread));
+
+    // The runtime can report a thread's destruction from another thread, which cannot reach its data.
+    std::thread other([&manager]() { manager.ThreadDestroyed(FirstThread); });
+    other.join();
+    ASSERT_TRUE(HasException(manager, FirstThread));
+
+    ASSERT_SUCCEEDED(manager.ThreadDestroyed(FirstThread));
+    ASSERT_TRUE(!HasException(manager, FirstThread));
+}
@@ -0,0 +1,135 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "MainProfiler/ThreadData.h"
+#include "Logging/NullLogger.h"
+
+namespace
+{
+    const FunctionID CatcherFunction = 0x1000;
+    const FunctionID FilterFunction = 0x2000;
+    const FunctionID FinallyFunction = 0x3000;
+
+    FunctionID GetCatcher(ThreadData& threadData, bool& hasException)
+    {
+        FunctionID catcherFunctionId = ThreadData::NoFunctionId;
+        threadData.GetException(&hasException, &catcherFunctionId);
+        return catcherFunctionId;
+    }
+}
+
+TEST(ThreadData_NestedExceptionsResumeOuter)
+{
+    ThreadData threadData(NullLogger::Instance);
+
+    bool hasException = true;
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(CatcherFunction));
+
+    // The nested exception is innermost until it is caught.
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_EQ(ThreadData::NoFunctionId, GetCatcher(threadData, hasException));
+    ASSERT_TRUE(hasException);
+
+    threadData.ClearException();
+    ASSERT_EQ(CatcherFunction, GetCatcher(threadData, hasException));
+    ASSERT_TRUE(hasException);
+
+    threadData.ClearException();
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+
+    // Clearing with nothing recorded is harmless.
+    threadData.ClearException();
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+}
+
+TEST(ThreadData_DropsOutermostExceptionPastMaxNesting)
+{
+    ThreadData threadData(NullLogger::Instance);
+
+    for (UINT32 i = 0; i <= ThreadData::MaxNestedExceptions; i++)
+    {
+        ASSERT_SUCCEEDED(threadData.SetHasException());
+        ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(CatcherFunction + i));
+    }
+
+    bool hasException = false;
+    for (UINT32 i = ThreadData::MaxNestedExceptions; i > 0; i--)
+    {
+        ASSERT_EQ(CatcherFunction + i, GetCatcher(threadData, hasException));
+        ASSERT_TRUE(hasException);
+        threadData.ClearException();
+    }
+
+    // The first exception was dropped to make room.
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+}
+
+TEST(ThreadData_DiscardsExceptionsThatEscapeFilters)
+{
+    ThreadData threadData(NullLogger::Instance);
+
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+
+    // The filter throws, and the runtime swallows the exception rather than finding a catcher for it.
+    ASSERT_SUCCEEDED(threadData.EnterExceptionHandler(FilterFunction, false));
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    threadData.LeaveExceptionHandler();
+
+    // The outer exception is innermost again, so its catcher is recorded against it.
+    ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(CatcherFunction));
+    bool hasException = false;
+    ASSERT_EQ(CatcherFunction, GetCatcher(threadData, hasException));
+    ASSERT_TRUE(hasException);
+
+    threadData.ClearException();
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+}
+
+TEST(ThreadData_KeepsExceptionsCaughtInsideFilters)
+{
+    ThreadData threadData(NullLogger::Instance);
+
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_SUCCEEDED(threadData.EnterExceptionHandler(FilterFunction, false));
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(FilterFunction));
+    threadData.ClearException();
+    threadData.LeaveExceptionHandler();
+
+    // Only the nested exception was cleared.
+    bool hasException = false;
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(hasException);
+}
+
+TEST(ThreadData_ExceptionsThatEscapeFinallySupersedeOuter)
+{
+    ThreadData threadData(NullLogger::Instance);
+
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(CatcherFunction));
+
+    // The finally block throws, and the new exception is caught further up than the function with the finally block.
+    ASSERT_SUCCEEDED(threadData.EnterExceptionHandler(FinallyFunction, true));
+    ASSERT_SUCCEEDED(threadData.SetHasException());
+    ASSERT_SUCCEEDED(threadData.SetExceptionCatcherFunction(CatcherFunction + 1));
+
+    // Unwinding other functions leaves the outer exception in place.
+    threadData.SupersedeEscapedException(FinallyFunction + 1);
+    threadData.SupersedeEscapedException(FinallyFunction);
+
+    bool hasException = false;
+    ASSERT_EQ(CatcherFunction + 1, GetCatcher(threadData, hasException));
+    threadData.ClearException();
+    GetCatcher(threadData, hasException);
+    ASSERT_TRUE(!hasException);
+}
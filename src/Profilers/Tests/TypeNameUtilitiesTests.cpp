@@ -0,0 +1,203 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "TestFramework.h"
+#include "Fakes/FakeCorProfilerInfo.h"
+#include "CommonUtilities/NameCache.h"
+#include "CommonUtilities/TypeNameUtilities.h"
+
+namespace
+{
+    const GUID TestMvid = { 0x33333333, 0x3333, 0x3333, { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33 } };
+
+    HRESULT Resolve(FakeCorProfilerInfo* profilerInfo, FunctionID functionId, tstring& name)
+    {
+        HRESULT hr;
+        NameCache nameCache;
+        TypeNameUtilities nameUtilities(profilerInfo);
+        IfFailRet(nameUtilities.CacheNames(nameCache, functionId, 0));
+        return nameCache.GetFullyQualifiedName(functionId, name);
+    }
+}
+
+TEST(TypeNameUtilities_ResolvesGenericInstantiation)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("/dotnet/System.Private.CoreLib.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef int32Type = metadata.AddType(_T("System.Int32"));
+    mdTypeDef listType = metadata.AddType(_T("System.Collections.Generic.List`1"));
+    ClassID int32Class = profilerInfo->AddClass(module, int32Type);
+    ClassID listClass = profilerInfo->AddClass(module, listType, { int32Class });
+    FunctionID function = profilerInfo->AddFunction(module, listClass, metadata.AddMethod(listType, _T("Add")));
+
+    tstring name;
+    ASSERT_SUCCEEDED(Resolve(profilerInfo, function, name));
+    ASSERT_TRUE(name == _T("System.Private.CoreLib.dll!System.Collections.Generic.List`1<System.Int32>.Add"));
+}
+
+TEST(TypeNameUtilities_ResolvesGenericMethodArguments)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef programType = metadata.AddType(_T("Sample.Program"));
+    mdTypeDef stringType = metadata.AddType(_T("System.String"));
+    ClassID programClass = profilerInfo->AddClass(module, programType);
+    ClassID stringClass = profilerInfo->AddClass(module, stringType);
+    FunctionID function = profilerInfo->AddFunction(module, programClass, metadata.AddMethod(programType, _T("Run")), { stringClass, stringClass });
+
+    tstring name;
+    ASSERT_SUCCEEDED(Resolve(profilerInfo, function, name));
+    ASSERT_TRUE(name == _T("Sample.dll!Sample.Program.Run<System.String,System.String>"));
+}
+
+TEST(TypeNameUtilities_ResolvesManyGenericMethodArguments)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef programType = metadata.AddType(_T("Sample.Program"));
+    ClassID programClass = profilerInfo->AddClass(module, programType);
+    std::vector<ClassID> typeArgs(40, programClass);
+    FunctionID function = profilerInfo->AddFunction(module, programClass, metadata.AddMethod(programType, _T("Run")), typeArgs);
+
+    FunctionInstance instance;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    ASSERT_SUCCEEDED(nameUtilities.GetFunctionInstance(function, 0, instance));
+    ASSERT_TRUE(instance.TypeArgs == typeArgs);
+}
+
+TEST(TypeNameUtilities_ResolvesSharedGenericCodeFromMetadata)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef workerType = metadata.AddType(_T("Sample.Worker`1"));
+    FunctionID function = profilerInfo->AddFunction(module, 0, metadata.AddMethod(workerType, _T("Execute")));
+
+    tstring name;
+    ASSERT_SUCCEEDED(Resolve(profilerInfo, function, name));
+    ASSERT_TRUE(name == _T("Sample.dll!Sample.Worker`1.Execute"));
+}
+
+TEST(TypeNameUtilities_ReplacesCanonicalInstantiation)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef workerType = metadata.AddType(_T("Sample.Worker`1"));
+    mdTypeDef stringType = metadata.AddType(_T("System.String"));
+    ClassID stringClass = profilerInfo->AddClass(module, stringType);
+    ClassID workerClass = profilerInfo->AddClass(module, workerType, { stringClass });
+    mdMethodDef executeMethod = metadata.AddMethod(workerType, _T("Execute"));
+    // Without frame info the runtime only knows the shared code.
+    FunctionID function = profilerInfo->AddFunction(module, 0, executeMethod);
+
+    NameCache nameCache;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, function, 0));
+
+    // A stack snapshot sees the exact instantiation on the frame.
+    FunctionInstance instance;
+    instance.FunctionId = function;
+    instance.ClassId = workerClass;
+    instance.ModuleId = module;
+    instance.Token = executeMethod;
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, instance));
+
+    tstring name;
+    ASSERT_SUCCEEDED(nameCache.GetFullyQualifiedName(function, name));
+    ASSERT_TRUE(name == _T("Sample.dll!Sample.Worker`1<System.String>.Execute"));
+}
+
+TEST(TypeNameUtilities_ResolvesNestedTypes)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef outerType = metadata.AddType(_T("Sample.Outer"));
+    mdTypeDef innerType = metadata.AddType(_T("Inner"), outerType);
+    ClassID innerClass = profilerInfo->AddClass(module, innerType);
+    FunctionID function = profilerInfo->AddFunction(module, innerClass, metadata.AddMethod(innerType, _T("Run")));
+
+    NameCache nameCache;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, function, 0));
+
+    // Both the nested type and its enclosing type are cached, with the namespace only on the outer type.
+    std::shared_ptr<TokenData> innerData;
+    std::shared_ptr<TokenData> outerData;
+    ASSERT_TRUE(nameCache.TryGetTokenData(module, innerType, innerData));
+    ASSERT_TRUE(nameCache.TryGetTokenData(module, outerType, outerData));
+    ASSERT_EQ(outerType, innerData->GetOuterToken());
+    ASSERT_TRUE(innerData->GetName() == _T("Inner"));
+    ASSERT_TRUE(innerData->GetNamespace().empty());
+    ASSERT_TRUE(outerData->GetName() == _T("Outer"));
+    ASSERT_TRUE(outerData->GetNamespace() == _T("Sample"));
+
+    tstring name;
+    ASSERT_SUCCEEDED(nameCache.GetFullyQualifiedName(function, name));
+    ASSERT_TRUE(name.find(_T("Sample.Outer+")) != tstring::npos);
+}
+
+TEST(TypeNameUtilities_ResolvesNamesLongerThanInitialBuffer)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    tstring longModule = _T("/") + tstring(300, _T('d')) + _T("/Long.dll");
+    tstring longType = _T("Sample.") + tstring(700, _T('T'));
+    tstring longMethod(1000, _T('m'));
+
+    ModuleID module = profilerInfo->AddModule(longModule, TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef type = metadata.AddType(longType);
+    ClassID typeClass = profilerInfo->AddClass(module, type);
+    FunctionID function = profilerInfo->AddFunction(module, typeClass, metadata.AddMethod(type, longMethod));
+
+    tstring name;
+    ASSERT_SUCCEEDED(Resolve(profilerInfo, function, name));
+    ASSERT_TRUE(name == _T("Long.dll!") + longType + _T(".") + longMethod);
+}
+
+TEST(TypeNameUtilities_StripsModulePaths)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID windowsModule = profilerInfo->AddModule(_T("C:\\app\\Windows.dll"), TestMvid);
+    ModuleID unixModule = profilerInfo->AddModule(_T("/app/Unix.dll"), TestMvid);
+
+    NameCache nameCache;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    ASSERT_SUCCEEDED(nameUtilities.CacheModuleNames(nameCache, windowsModule));
+    ASSERT_SUCCEEDED(nameUtilities.CacheModuleNames(nameCache, unixModule));
+
+    std::shared_ptr<ModuleData> moduleData;
+    ASSERT_TRUE(nameCache.TryGetModuleData(windowsModule, moduleData));
+    ASSERT_TRUE(moduleData->GetName() == _T("Windows.dll"));
+    ASSERT_TRUE(nameCache.TryGetModuleData(unixModule, moduleData));
+    ASSERT_TRUE(moduleData->GetName() == _T("Unix.dll"));
+}
+
+TEST(TypeNameUtilities_ReadsStackTraceHidden)
+{
+    ComPtr<FakeCorProfilerInfo> profilerInfo(new FakeCorProfilerInfo());
+    ModuleID module = profilerInfo->AddModule(_T("Sample.dll"), TestMvid);
+    FakeMetaDataImport& metadata = profilerInfo->GetMetaData(module);
+    mdTypeDef hiddenType = metadata.AddType(_T("Sample.Hidden"), mdTypeDefNil, true);
+    ClassID hiddenClass = profilerInfo->AddClass(module, hiddenType);
+    FunctionID visibleFunction = profilerInfo->AddFunction(module, hiddenClass, metadata.AddMethod(hiddenType, _T("Visible")));
+    FunctionID hiddenFunction = profilerInfo->AddFunction(module, hiddenClass, metadata.AddMethod(hiddenType, _T("Hidden"), true));
+
+    NameCache nameCache;
+    TypeNameUtilities nameUtilities(profilerInfo);
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, visibleFunction, 0));
+    ASSERT_SUCCEEDED(nameUtilities.CacheNames(nameCache, hiddenFunction, 0));
+
+    std::shared_ptr<FunctionData> functionData;
+    std::shared_ptr<ClassData> classData;
+    ASSERT_TRUE(nameCache.TryGetFunctionData(visibleFunction, functionData));
+    ASSERT_TRUE(!functionData->GetStackTraceHidden());
+    ASSERT_TRUE(nameCache.TryGetFunctionData(hiddenFunction, functionData));
+    ASSERT_TRUE(functionData->GetStackTraceHidden());
+    ASSERT_TRUE(nameCache.TryGetClassData(hiddenClass, classData));
+    ASSERT_TRUE(classData->GetStackTraceHidden());
+}